@@ -0,0 +1,239 @@
+/*
+ *   BSD LICENSE
+ *
+ * Copyright (c) 2017, Wind River Systems, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1) Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2) Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3) Neither the name of Wind River Systems nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Receives chained frames from an emulated AVP version 4 host one packet per
+ * call.  Each frame spans several compact descriptors, so the receive
+ * function must request whole packets even when the caller asks for fewer
+ * packets than a frame has descriptors.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <rte_common.h>
+#include <rte_version.h>
+#include <rte_cycles.h>
+#include <rte_mbuf.h>
+#include <rte_ether.h>
+#include <rte_ethdev.h>
+#include <rte_vdev.h>
+
+#include "rte_avp_common.h"
+
+#include "test_avp.h"
+
+#define CDESC_RX_DEVICE "net_avp_emu_rx"
+
+/* frame sizes without the CRC; all but the first span several descriptors */
+static const unsigned int cdesc_rx_frame_sizes[] = {
+	60, 3000, 9000
+};
+
+/* build a frame chained across as many mbufs as its length requires */
+static struct rte_mbuf *
+cdesc_rx_build(struct rte_mempool *pool, const struct ether_addr *dst,
+	       unsigned int pkt_len, uint32_t seq)
+{
+	struct rte_mbuf *head, *m;
+	struct ether_hdr *eth;
+	unsigned int remaining = pkt_len;
+	uint16_t len;
+
+	head = NULL;
+	while (remaining > 0) {
+		m = rte_pktmbuf_alloc(pool);
+		if (m == NULL)
+			goto error;
+
+		len = RTE_MIN(remaining, (unsigned int)rte_pktmbuf_tailroom(m));
+		rte_pktmbuf_append(m, len);
+		remaining -= len;
+
+		if (head == NULL) {
+			head = m;
+		} else if (rte_pktmbuf_chain(head, m) != 0) {
+			rte_pktmbuf_free(m);
+			goto error;
+		}
+	}
+
+	eth = rte_pktmbuf_mtod(head, struct ether_hdr *);
+	ether_addr_copy(dst, &eth->d_addr);
+	memset(&eth->s_addr, 0, sizeof(eth->s_addr));
+	eth->s_addr.addr_bytes[0] = 0x02;
+	eth->ether_type = rte_cpu_to_be_16(ETHER_TYPE_IPv4);
+	memcpy(eth + 1, &seq, sizeof(seq));
+
+	return head;
+
+error:
+	if (head != NULL)
+		rte_pktmbuf_free(head);
+	return NULL;
+}
+
+/* send CDESC_RX_PACKETS frames and receive them back one per call */
+static int
+cdesc_rx_run(uint8_t port_id, struct rte_mempool *pool,
+	     const struct ether_addr *dst, unsigned int pkt_len)
+{
+	struct rte_mbuf *pkts[CDESC_RX_BURST];
+	unsigned int sent, received, errors;
+	unsigned int i, n;
+	uint64_t end;
+	uint32_t seq;
+
+	sent = 0;
+	received = 0;
+	errors = 0;
+	end = rte_rdtsc() + (rte_get_tsc_hz() * CDESC_RX_TIMEOUT_MS) / 1000;
+	while ((received < CDESC_RX_PACKETS) && (rte_rdtsc() < end)) {
+		if (sent < CDESC_RX_PACKETS) {
+			n = RTE_MIN(CDESC_RX_PACKETS - sent,
+				    (unsigned int)CDESC_RX_BURST);
+			for (i = 0; i < n; i++) {
+				pkts[i] = cdesc_rx_build(pool, dst, pkt_len,
+							 sent + i);
+				if (pkts[i] == NULL)
+					break;
+			}
+			n = i;
+
+			i = rte_eth_tx_burst(port_id, 0, pkts, n);
+			sent += i;
+			while (n > i)
+				rte_pktmbuf_free(pkts[--n]);
+		}
+
+		/* a single packet per call, however many descriptors it has */
+		while (rte_eth_rx_burst(port_id, 0, pkts, 1) == 1) {
+			memcpy(&seq, rte_pktmbuf_mtod_offset(pkts[0], void *,
+					sizeof(struct ether_hdr)),
+			       sizeof(seq));
+			if ((rte_pktmbuf_pkt_len(pkts[0]) != pkt_len) ||
+			    (seq != received))
+				errors++;
+			rte_pktmbuf_free(pkts[0]);
+			received++;
+		}
+	}
+
+	printf("%6u %8u %8u %8u\n", pkt_len, sent, received, errors);
+
+	return ((received == CDESC_RX_PACKETS) && (errors == 0)) ? 0 : -1;
+}
+
+int
+test_cdesc_rx(void)
+{
+	struct rte_mempool *pool = NULL;
+	struct rte_eth_conf conf;
+	struct ether_addr mac;
+	char args[128];
+	uint8_t port_id;
+	unsigned int i;
+	int ret;
+
+	pool = rte_pktmbuf_pool_create("avp_cdesc_rx", CDESC_RX_MBUFS,
+				       RTE_MEMPOOL_CACHE_MAX_SIZE, 0,
+				       RTE_MBUF_DEFAULT_BUF_SIZE,
+				       rte_socket_id());
+	if (pool == NULL) {
+		printf("Failed to create mbuf pool\n");
+		return -1;
+	}
+
+	snprintf(args, sizeof(args),
+		 "mode=loopback,version=4,mru=%u,queues=1,buffers=%u",
+		 FWD_PERF_JUMBO_MRU, CDESC_RX_HOST_BUFFERS);
+#if RTE_VERSION >= RTE_VERSION_NUM(17, 8, 0, 0)
+	ret = rte_vdev_init(CDESC_RX_DEVICE, args);
+#else
+	ret = rte_eal_vdev_init(CDESC_RX_DEVICE, args);
+#endif
+	if (ret != 0) {
+		printf("Failed to create %s,%s, ret=%d\n",
+		       CDESC_RX_DEVICE, args, ret);
+		goto free_pool;
+	}
+
+	ret = rte_eth_dev_get_port_by_name(CDESC_RX_DEVICE, &port_id);
+	if (ret != 0) {
+		printf("Failed to find the port of %s, ret=%d\n",
+		       CDESC_RX_DEVICE, ret);
+		goto uninit;
+	}
+
+	memset(&conf, 0, sizeof(conf));
+	conf.rxmode.jumbo_frame = 1;
+	conf.rxmode.enable_scatter = 1;
+	conf.rxmode.max_rx_pkt_len = FWD_PERF_JUMBO_MRU;
+
+	ret = rte_eth_dev_configure(port_id, 1, 1, &conf);
+	if (ret == 0)
+		ret = rte_eth_rx_queue_setup(port_id, 0, 0,
+					     rte_eth_dev_socket_id(port_id),
+					     NULL, pool);
+	if (ret == 0)
+		ret = rte_eth_tx_queue_setup(port_id, 0, 0,
+					     rte_eth_dev_socket_id(port_id),
+					     NULL);
+	if (ret == 0)
+		ret = rte_eth_dev_start(port_id);
+	if (ret != 0) {
+		printf("Failed to start port %u, ret=%d\n", port_id, ret);
+		goto close;
+	}
+
+	rte_eth_macaddr_get(port_id, &mac);
+	printf("AVP compact descriptor receive; %u frames, 1 packet per call\n",
+	       CDESC_RX_PACKETS);
+	printf("%6s %8s %8s %8s\n", "frame", "sent", "received", "errors");
+	for (i = 0; i < RTE_DIM(cdesc_rx_frame_sizes); i++)
+		ret |= cdesc_rx_run(port_id, pool, &mac,
+				    cdesc_rx_frame_sizes[i]);
+
+	rte_eth_dev_stop(port_id);
+close:
+	rte_eth_dev_close(port_id);
+uninit:
+#if RTE_VERSION >= RTE_VERSION_NUM(17, 8, 0, 0)
+	rte_vdev_uninit(CDESC_RX_DEVICE);
+#else
+	rte_eal_vdev_uninit(CDESC_RX_DEVICE);
+#endif
+free_pool:
+	rte_mempool_free(pool);
+	return ret;
+}
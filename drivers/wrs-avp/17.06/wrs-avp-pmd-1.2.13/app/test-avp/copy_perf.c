@@ -0,0 +1,240 @@
+/*
+ *   BSD LICENSE
+ *
+ * Copyright (c) 2017, Wind River Systems, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1) Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2) Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3) Neither the name of Wind River Systems nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Measures the cost of each AVP copy engine and its effect on the cache
+ * footprint of the application.  Packets are copied into a host region that
+ * is much larger than the last level cache, as the transmit path does, and a
+ * guest working set that fits in the cache is probed after every burst.  A
+ * copy engine that bypasses the cache leaves the working set resident, which
+ * shows up as fewer last level cache misses and cheaper probes.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include <rte_common.h>
+#include <rte_malloc.h>
+#include <rte_cycles.h>
+
+#include "avp_copy.h"
+#ifdef AVP_COPY_HAVE_AVX512
+#include <rte_cpuflags.h>
+#endif
+
+#include "test_avp.h"
+
+/* open a counter of last level cache misses on the calling thread */
+static int
+copy_perf_counter_open(void)
+{
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.size = sizeof(attr);
+	attr.config = PERF_COUNT_HW_CACHE_MISSES;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+
+	return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static uint64_t
+copy_perf_counter_read(int fd)
+{
+	uint64_t count;
+
+	if ((fd < 0) || (read(fd, &count, sizeof(count)) != sizeof(count)))
+		return 0;
+	return count;
+}
+
+static int
+copy_perf_supported(enum avp_copy_mode mode)
+{
+	switch (mode) {
+	case AVP_COPY_MEMCPY:
+		return 1;
+#ifdef AVP_COPY_HAVE_STREAM
+	case AVP_COPY_STREAM:
+		return 1;
+#endif
+#ifdef AVP_COPY_HAVE_AVX512
+	case AVP_COPY_AVX512:
+		return rte_cpu_get_flag_enabled(RTE_CPUFLAG_AVX512F) > 0;
+#endif
+	default:
+		return 0;
+	}
+}
+
+/* read one word from each of a pseudo random set of working set lines */
+static uint64_t
+copy_perf_probe(const uint64_t *wset, uint32_t *seed)
+{
+	const unsigned int lines = COPY_PERF_WSET_SIZE / RTE_CACHE_LINE_SIZE;
+	uint64_t sum = 0;
+	unsigned int i;
+	uint32_t line;
+
+	for (i = 0; i < COPY_PERF_PROBES; i++) {
+		*seed = (*seed * 1103515245) + 12345;
+		line = (*seed >> 8) % lines;
+		sum += wset[line * (RTE_CACHE_LINE_SIZE / sizeof(*wset))];
+	}
+
+	return sum;
+}
+
+static void
+copy_perf_run(enum avp_copy_mode mode, uint8_t *host, uint64_t *wset,
+	      const uint8_t *pkt, int fd, struct copy_perf_result *result)
+{
+	uint64_t copy_cycles = 0;
+	uint64_t probe_cycles = 0;
+	uint64_t sum = 0;
+	uint32_t seed = 1;
+	size_t offset = 0;
+	uint64_t start;
+	unsigned int i;
+	unsigned int j;
+
+	/* start each mode with the working set resident */
+	for (i = 0; i < COPY_PERF_WSET_SIZE / sizeof(*wset); i++)
+		sum += wset[i];
+
+	if (fd >= 0) {
+		ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+		ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+	}
+
+	for (i = 0; i < COPY_PERF_PACKETS; i += COPY_PERF_BURST) {
+		start = rte_rdtsc();
+		for (j = 0; j < COPY_PERF_BURST; j++) {
+			avp_copy(mode, host + offset, pkt, COPY_PERF_PKT_LEN);
+			offset += COPY_PERF_BUF_SIZE;
+			if (offset >= COPY_PERF_HOST_SIZE)
+				offset = 0;
+		}
+		avp_copy_fence(mode);
+		copy_cycles += rte_rdtsc() - start;
+
+		start = rte_rdtsc();
+		for (j = 0; j < COPY_PERF_BURST; j++)
+			sum += copy_perf_probe(wset, &seed);
+		probe_cycles += rte_rdtsc() - start;
+	}
+
+	if (fd >= 0)
+		ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+
+	/* keep the probes from being optimized away */
+	wset[0] = sum;
+
+	result->copy = copy_cycles / COPY_PERF_PACKETS;
+	result->probe = probe_cycles / (COPY_PERF_PACKETS * COPY_PERF_PROBES);
+	result->misses = copy_perf_counter_read(fd);
+}
+
+int
+test_copy_perf(void)
+{
+	static const char * const modes[] = {
+		[AVP_COPY_MEMCPY] = "memcpy",
+		[AVP_COPY_STREAM] = "stream",
+		[AVP_COPY_AVX512] = "avx512",
+	};
+	struct copy_perf_result result;
+	uint64_t *wset = NULL;
+	uint8_t *host = NULL;
+	uint8_t *pkt = NULL;
+	unsigned int mode;
+	int ret = -1;
+	int fd;
+
+	host = rte_malloc("avp_copy_perf", COPY_PERF_HOST_SIZE,
+			  RTE_CACHE_LINE_SIZE);
+	wset = rte_malloc("avp_copy_perf", COPY_PERF_WSET_SIZE,
+			  RTE_CACHE_LINE_SIZE);
+	pkt = rte_malloc("avp_copy_perf", COPY_PERF_PKT_LEN,
+			 RTE_CACHE_LINE_SIZE);
+	if ((host == NULL) || (wset == NULL) || (pkt == NULL)) {
+		printf("Failed to allocate copy buffers\n");
+		goto done;
+	}
+	memset(host, 0, COPY_PERF_HOST_SIZE);
+	memset(wset, 0x5a, COPY_PERF_WSET_SIZE);
+	memset(pkt, 0xa5, COPY_PERF_PKT_LEN);
+
+	fd = copy_perf_counter_open();
+	if (fd < 0)
+		printf("Cache miss counter not available\n");
+
+	printf("AVP copy engines; %u byte packets, %u KB working set, %u probes per packet\n",
+	       COPY_PERF_PKT_LEN, COPY_PERF_WSET_SIZE / 1024, COPY_PERF_PROBES);
+	printf("%-8s %12s %12s %12s\n",
+	       "mode", "copy/pkt", "probe", "llc-miss/pkt");
+
+	for (mode = 0; mode < RTE_DIM(modes); mode++) {
+		if (!copy_perf_supported(mode)) {
+			printf("%-8s %12s\n", modes[mode], "unsupported");
+			continue;
+		}
+
+		copy_perf_run(mode, host, wset, pkt, fd, &result);
+		if (fd >= 0)
+			printf("%-8s %12" PRIu64 " %12" PRIu64 " %12.2f\n",
+			       modes[mode], result.copy, result.probe,
+			       (double)result.misses / COPY_PERF_PACKETS);
+		else
+			printf("%-8s %12" PRIu64 " %12" PRIu64 " %12s\n",
+			       modes[mode], result.copy, result.probe, "n/a");
+	}
+
+	if (fd >= 0)
+		close(fd);
+	ret = 0;
+
+done:
+	rte_free(pkt);
+	rte_free(wset);
+	rte_free(host);
+	return ret;
+}
@@ -0,0 +1,101 @@
+/*
+ *   BSD LICENSE
+ *
+ * Copyright (c) 2017, Wind River Systems, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1) Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2) Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3) Neither the name of Wind River Systems nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <inttypes.h>
+
+#include <rte_common.h>
+#include <rte_lcore.h>
+
+#include "test_avp.h"
+
+/* relative change of the C11 implementation against the barrier one */
+static double
+fifo_perf_delta(uint64_t barrier, uint64_t c11)
+{
+	if (barrier == 0)
+		return 0.0;
+	return 100.0 * ((double)c11 - (double)barrier) / (double)barrier;
+}
+
+static void
+fifo_perf_print(const char *layout, const char *name,
+		const struct fifo_perf_result *result)
+{
+	printf("%-8s %-10s %10" PRIu64 " %10" PRIu64 " %10" PRIu64 "\n",
+	       layout, name, result->single,
+	       result->producer, result->consumer);
+}
+
+int
+test_fifo_perf(void)
+{
+	static const char * const layouts[] = {
+		[FIFO_PERF_LAYOUT_V2] = "v2",
+		[FIFO_PERF_LAYOUT_V3] = "v3",
+	};
+	struct fifo_perf_result barrier;
+	struct fifo_perf_result c11;
+	unsigned int peer_lcore;
+	unsigned int layout;
+	int ret;
+
+	peer_lcore = rte_get_next_lcore(rte_lcore_id(), 1, 0);
+	if (peer_lcore >= RTE_MAX_LCORE)
+		printf("Only one lcore available; skipping cross lcore tests\n");
+
+	printf("AVP fifo performance; TSC cycles per burst of %u, %u entries\n",
+	       FIFO_PERF_BURST, FIFO_PERF_SIZE);
+	printf("%-8s %-10s %10s %10s %10s\n",
+	       "layout", "impl", "single", "producer", "consumer");
+
+	for (layout = 0; layout < RTE_DIM(layouts); layout++) {
+		ret = fifo_perf_barrier(layout, peer_lcore, &barrier);
+		if (ret != 0)
+			return ret;
+		fifo_perf_print(layouts[layout], "barrier", &barrier);
+
+		ret = fifo_perf_c11(layout, peer_lcore, &c11);
+		if (ret != 0)
+			return ret;
+		fifo_perf_print(layouts[layout], "c11", &c11);
+
+		printf("%-8s %-10s %9.1f%% %9.1f%% %9.1f%%\n",
+		       layouts[layout], "delta",
+		       fifo_perf_delta(barrier.single, c11.single),
+		       fifo_perf_delta(barrier.producer, c11.producer),
+		       fifo_perf_delta(barrier.consumer, c11.consumer));
+	}
+
+	return 0;
+}
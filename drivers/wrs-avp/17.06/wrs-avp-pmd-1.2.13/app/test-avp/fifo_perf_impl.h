@@ -0,0 +1,236 @@
+/*
+ *   BSD LICENSE
+ *
+ * Copyright (c) 2017, Wind River Systems, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1) Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2) Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3) Neither the name of Wind River Systems nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * AVP fifo microbenchmark.  This file is included once per fifo
+ * implementation with FIFO_PERF_NAME() defined so that each instance of the
+ * test functions is given a unique name.  The put/get calls are inlined into
+ * the measurement loops exactly as they are in the PMD burst functions.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+
+#include <rte_common.h>
+#include <rte_memory.h>
+#include <rte_ether.h>
+#include <rte_debug.h>
+#include <rte_malloc.h>
+#include <rte_cycles.h>
+#include <rte_launch.h>
+#include <rte_lcore.h>
+
+#include "rte_avp_common.h"
+#include "rte_avp_fifo.h"
+
+#include "test_avp.h"
+
+/* state shared with the peer lcore during the cross lcore test */
+struct FIFO_PERF_NAME(context) {
+	void *fifo; /**< Fifo under test */
+	unsigned int layout; /**< Layout of the fifo under test */
+	volatile unsigned int start; /**< Set to begin the cross lcore test */
+	uint64_t cycles; /**< Producer cycles per burst */
+};
+
+static inline __attribute__((always_inline)) unsigned int
+FIFO_PERF_NAME(put)(void *fifo, unsigned int layout,
+		    void **data, unsigned int num)
+{
+	if (layout == FIFO_PERF_LAYOUT_V3)
+		return avp_fifo_v3_put(fifo, data, num);
+	return avp_fifo_put(fifo, data, num);
+}
+
+static inline __attribute__((always_inline)) unsigned int
+FIFO_PERF_NAME(get)(void *fifo, unsigned int layout,
+		    void **data, unsigned int num)
+{
+	if (layout == FIFO_PERF_LAYOUT_V3)
+		return avp_fifo_v3_get(fifo, data, num);
+	return avp_fifo_get(fifo, data, num);
+}
+
+static inline __attribute__((always_inline)) uint64_t
+FIFO_PERF_NAME(single)(void *fifo, unsigned int layout)
+{
+	void *objs[FIFO_PERF_BURST];
+	uint64_t start;
+	unsigned int i;
+
+	for (i = 0; i < FIFO_PERF_BURST; i++)
+		objs[i] = &objs[i];
+
+	start = rte_rdtsc();
+	for (i = 0; i < FIFO_PERF_ITERATIONS; i++) {
+		FIFO_PERF_NAME(put)(fifo, layout, objs, FIFO_PERF_BURST);
+		FIFO_PERF_NAME(get)(fifo, layout, objs, FIFO_PERF_BURST);
+	}
+
+	return (rte_rdtsc() - start) / FIFO_PERF_ITERATIONS;
+}
+
+static inline __attribute__((always_inline)) void
+FIFO_PERF_NAME(produce)(struct FIFO_PERF_NAME(context) *ctx,
+			unsigned int layout)
+{
+	const uint64_t total = (uint64_t)FIFO_PERF_ITERATIONS * FIFO_PERF_BURST;
+	void *objs[FIFO_PERF_BURST];
+	uintptr_t seq = 1;
+	uint64_t sent = 0;
+	uint64_t start;
+	unsigned int i;
+
+	while (ctx->start == 0)
+		;
+
+	start = rte_rdtsc();
+	while (sent < total) {
+		for (i = 0; i < FIFO_PERF_BURST; i++)
+			objs[i] = (void *)(seq + i);
+		i = FIFO_PERF_NAME(put)(ctx->fifo, layout,
+					objs, FIFO_PERF_BURST);
+		seq += i;
+		sent += i;
+	}
+
+	ctx->cycles = (rte_rdtsc() - start) / FIFO_PERF_ITERATIONS;
+}
+
+static int
+FIFO_PERF_NAME(producer)(void *arg)
+{
+	struct FIFO_PERF_NAME(context) *ctx = arg;
+
+	if (ctx->layout == FIFO_PERF_LAYOUT_V3)
+		FIFO_PERF_NAME(produce)(ctx, FIFO_PERF_LAYOUT_V3);
+	else
+		FIFO_PERF_NAME(produce)(ctx, FIFO_PERF_LAYOUT_V2);
+	return 0;
+}
+
+/* returns the number of packets received out of order */
+static inline __attribute__((always_inline)) uint64_t
+FIFO_PERF_NAME(consume)(struct FIFO_PERF_NAME(context) *ctx,
+			unsigned int layout, uint64_t *cycles)
+{
+	const uint64_t total = (uint64_t)FIFO_PERF_ITERATIONS * FIFO_PERF_BURST;
+	void *objs[FIFO_PERF_BURST];
+	uintptr_t expected = 1;
+	uint64_t received = 0;
+	uint64_t errors = 0;
+	uint64_t start;
+	unsigned int i;
+	unsigned int n;
+
+	ctx->start = 1;
+
+	start = rte_rdtsc();
+	while (received < total) {
+		n = FIFO_PERF_NAME(get)(ctx->fifo, layout,
+					objs, FIFO_PERF_BURST);
+		for (i = 0; i < n; i++)
+			errors += ((uintptr_t)objs[i] != expected++);
+		received += n;
+	}
+
+	*cycles = (rte_rdtsc() - start) / FIFO_PERF_ITERATIONS;
+	return errors;
+}
+
+int
+FIFO_PERF_NAME(fifo_perf)(unsigned int layout, unsigned int peer_lcore,
+			  struct fifo_perf_result *result)
+{
+	struct FIFO_PERF_NAME(context) ctx;
+	uint64_t errors;
+	size_t size;
+	void *fifo;
+
+	if (layout == FIFO_PERF_LAYOUT_V3)
+		size = sizeof(struct rte_avp_fifo_v3);
+	else
+		size = sizeof(struct rte_avp_fifo);
+	size += FIFO_PERF_SIZE * sizeof(void *);
+
+	fifo = rte_zmalloc("avp_fifo_perf", size, RTE_CACHE_LINE_SIZE);
+	if (fifo == NULL)
+		return -ENOMEM;
+
+	memset(result, 0, sizeof(*result));
+
+	if (layout == FIFO_PERF_LAYOUT_V3) {
+		avp_fifo_v3_init(fifo, FIFO_PERF_SIZE);
+		result->single = FIFO_PERF_NAME(single)(fifo,
+							FIFO_PERF_LAYOUT_V3);
+	} else {
+		avp_fifo_init(fifo, FIFO_PERF_SIZE);
+		result->single = FIFO_PERF_NAME(single)(fifo,
+							FIFO_PERF_LAYOUT_V2);
+	}
+
+	if (peer_lcore >= RTE_MAX_LCORE) {
+		rte_free(fifo);
+		return 0;
+	}
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.fifo = fifo;
+	ctx.layout = layout;
+	if (rte_eal_remote_launch(FIFO_PERF_NAME(producer),
+				  &ctx, peer_lcore) != 0) {
+		rte_free(fifo);
+		return -EBUSY;
+	}
+
+	if (layout == FIFO_PERF_LAYOUT_V3)
+		errors = FIFO_PERF_NAME(consume)(&ctx, FIFO_PERF_LAYOUT_V3,
+						 &result->consumer);
+	else
+		errors = FIFO_PERF_NAME(consume)(&ctx, FIFO_PERF_LAYOUT_V2,
+						 &result->consumer);
+
+	rte_eal_wait_lcore(peer_lcore);
+	result->producer = ctx.cycles;
+	rte_free(fifo);
+
+	if (errors != 0) {
+		printf("%" PRIu64 " fifo entries received out of order\n",
+		       errors);
+		return -EIO;
+	}
+
+	return 0;
+}
@@ -0,0 +1,613 @@
+/*
+ *   BSD LICENSE
+ *
+ * Copyright (c) 2017, Wind River Systems, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1) Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2) Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3) Neither the name of Wind River Systems nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * Forwards packets through an emulated AVP host in loopback mode, as testpmd
+ * does between two ports, and reports per queue packet rates, TSC cycles per
+ * packet and latency percentiles.  Each queue is driven by its own lcore,
+ * which keeps a window of packets in flight, stamps the TSC into every packet
+ * it transmits and compares it on receipt.  The frame size, the burst
+ * functions (flat, scattered or compact descriptors) and the VLAN offload are
+ * varied between configurations.  When the PMD is built with
+ * CONFIG_RTE_LIBRTE_AVP_STAGE_CYCLES=y the cycles spent in each stage of its
+ * burst functions are reported as well.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+
+#include <rte_common.h>
+#include <rte_version.h>
+#include <rte_cycles.h>
+#include <rte_launch.h>
+#include <rte_lcore.h>
+#include <rte_malloc.h>
+#include <rte_mbuf.h>
+#include <rte_ether.h>
+#include <rte_ip.h>
+#include <rte_udp.h>
+#include <rte_ethdev.h>
+#include <rte_vdev.h>
+
+#include "rte_avp_common.h"
+#include "rte_pmd_avp.h"
+
+#include "test_avp.h"
+
+#define FWD_PERF_DEVICE "net_avp_emu_fwd"
+
+/* offset of the transmit timestamp; just past the UDP header */
+#define FWD_PERF_TS_OFFSET \
+	(sizeof(struct ether_hdr) + sizeof(struct ipv4_hdr) + \
+	 sizeof(struct udp_hdr))
+
+/*
+ * Burst functions exercised by a configuration.  Compact descriptors are
+ * only offered by AVP version 4 hosts and the flat functions are only used
+ * when the host MRU fits in a single host buffer.
+ */
+struct fwd_perf_mode {
+	const char *name;
+	unsigned int version; /**< AVP version of the emulated host */
+	unsigned int mru; /**< Maximum receive unit of the emulated host */
+};
+
+static const struct fwd_perf_mode fwd_perf_modes[] = {
+	{ "flat", 3, ETHER_MAX_LEN },
+	{ "scatter", 3, FWD_PERF_JUMBO_MRU },
+	{ "cdesc", 4, FWD_PERF_JUMBO_MRU },
+};
+
+/* frame sizes including the CRC, which is not transmitted */
+static const unsigned int fwd_perf_frame_sizes[] = {
+	64, 128, 256, 512, 1024, 1518, 9000
+};
+
+static const char * const fwd_perf_stages[RTE_PMD_AVP_STAGE_MAX] = {
+	[RTE_PMD_AVP_STAGE_FIFO_GET] = "get",
+	[RTE_PMD_AVP_STAGE_TRANSLATE] = "xlate",
+	[RTE_PMD_AVP_STAGE_FILTER] = "filter",
+	[RTE_PMD_AVP_STAGE_ALLOC] = "alloc",
+	[RTE_PMD_AVP_STAGE_COPY] = "copy",
+	[RTE_PMD_AVP_STAGE_FIFO_PUT] = "put",
+};
+
+/* state of the lcore driving one queue */
+struct fwd_perf_queue {
+	struct rte_mempool *pool;
+	uint8_t port_id;
+	uint16_t queue_id;
+	unsigned int pkt_len; /**< Packet length without the CRC */
+	unsigned int vlan; /**< Request VLAN insertion on transmit */
+	struct ether_addr dst; /**< MAC address of the port */
+	uint64_t *samples; /**< Latency samples; FWD_PERF_SAMPLES entries */
+	uint64_t nb_samples; /**< Samples taken, including overwritten ones */
+	struct fwd_perf_result result;
+} __rte_cache_aligned;
+
+/* build a UDP packet chained across as many mbufs as its length requires */
+static struct rte_mbuf *
+fwd_perf_build(struct fwd_perf_queue *fq)
+{
+	struct rte_mbuf *head, *m;
+	struct ether_hdr *eth;
+	struct ipv4_hdr *ip;
+	struct udp_hdr *udp;
+	unsigned int remaining = fq->pkt_len;
+	uint16_t len;
+
+	head = NULL;
+	while (remaining > 0) {
+		m = rte_pktmbuf_alloc(fq->pool);
+		if (m == NULL)
+			goto error;
+
+		len = RTE_MIN(remaining, (unsigned int)rte_pktmbuf_tailroom(m));
+		rte_pktmbuf_append(m, len);
+		remaining -= len;
+
+		if (head == NULL) {
+			head = m;
+		} else if (rte_pktmbuf_chain(head, m) != 0) {
+			rte_pktmbuf_free(m);
+			goto error;
+		}
+	}
+
+	eth = rte_pktmbuf_mtod(head, struct ether_hdr *);
+	ether_addr_copy(&fq->dst, &eth->d_addr);
+	memset(&eth->s_addr, 0, sizeof(eth->s_addr));
+	eth->s_addr.addr_bytes[0] = 0x02;
+	eth->s_addr.addr_bytes[5] = 0x01;
+	eth->ether_type = rte_cpu_to_be_16(ETHER_TYPE_IPv4);
+
+	ip = (struct ipv4_hdr *)(eth + 1);
+	memset(ip, 0, sizeof(*ip));
+	ip->version_ihl = 0x45;
+	ip->time_to_live = 64;
+	ip->next_proto_id = IPPROTO_UDP;
+	ip->total_length = rte_cpu_to_be_16(fq->pkt_len - sizeof(*eth));
+	ip->src_addr = rte_cpu_to_be_32(0xc0a80001); /* 192.168.0.1 */
+	ip->dst_addr = rte_cpu_to_be_32(0xc0a80002); /* 192.168.0.2 */
+	ip->hdr_checksum = rte_ipv4_cksum(ip);
+
+	udp = (struct udp_hdr *)(ip + 1);
+	udp->src_port = rte_cpu_to_be_16(9);
+	udp->dst_port = rte_cpu_to_be_16(9);
+	udp->dgram_len = rte_cpu_to_be_16(fq->pkt_len - sizeof(*eth) -
+					  sizeof(*ip));
+	udp->dgram_cksum = 0;
+
+	if (fq->vlan) {
+		head->ol_flags |= PKT_TX_VLAN_PKT;
+		head->vlan_tci = FWD_PERF_VLAN_TCI;
+	}
+
+	return head;
+
+error:
+	if (head != NULL)
+		rte_pktmbuf_free(head);
+	return NULL;
+}
+
+/* transmit a burst of timestamped packets; returns the number sent */
+static unsigned int
+fwd_perf_send(struct fwd_perf_queue *fq, unsigned int count)
+{
+	struct rte_mbuf *pkts[FWD_PERF_BURST];
+	unsigned int i, n;
+	uint64_t now;
+
+	for (n = 0; n < count; n++) {
+		pkts[n] = fwd_perf_build(fq);
+		if (pkts[n] == NULL)
+			break;
+	}
+
+	now = rte_rdtsc();
+	for (i = 0; i < n; i++)
+		memcpy(rte_pktmbuf_mtod_offset(pkts[i], void *,
+					       FWD_PERF_TS_OFFSET),
+		       &now, sizeof(now));
+
+	i = rte_eth_tx_burst(fq->port_id, fq->queue_id, pkts, n);
+	while (n > i)
+		rte_pktmbuf_free(pkts[--n]);
+
+	return i;
+}
+
+/* receive a burst, sample the latency of each packet and free it */
+static unsigned int
+fwd_perf_receive(struct fwd_perf_queue *fq)
+{
+	struct rte_mbuf *pkts[FWD_PERF_BURST];
+	struct rte_mbuf *m;
+	unsigned int i, n;
+	uint64_t now;
+	uint64_t ts;
+
+	n = rte_eth_rx_burst(fq->port_id, fq->queue_id, pkts, FWD_PERF_BURST);
+	if (n == 0)
+		return 0;
+
+	now = rte_rdtsc();
+	for (i = 0; i < n; i++) {
+		m = pkts[i];
+		if ((rte_pktmbuf_pkt_len(m) != fq->pkt_len) ||
+		    (fq->vlan && (!(m->ol_flags & PKT_RX_VLAN_PKT) ||
+				  (m->vlan_tci != FWD_PERF_VLAN_TCI)))) {
+			fq->result.errors++;
+		} else {
+			memcpy(&ts, rte_pktmbuf_mtod_offset(m, void *,
+							    FWD_PERF_TS_OFFSET),
+			       sizeof(ts));
+			fq->samples[fq->nb_samples++ &
+				    (FWD_PERF_SAMPLES - 1)] = now - ts;
+		}
+		rte_pktmbuf_free(m);
+	}
+
+	return n;
+}
+
+static int
+fwd_perf_lcore(void *arg)
+{
+	struct fwd_perf_queue *fq = arg;
+	unsigned int outstanding = 0;
+	uint64_t packets = 0;
+	uint64_t start, end, now;
+	unsigned int n;
+
+	start = rte_rdtsc();
+	end = start + (rte_get_tsc_hz() * FWD_PERF_DURATION_MS) / 1000;
+	do {
+		n = RTE_MIN(FWD_PERF_WINDOW - outstanding,
+			    (unsigned int)FWD_PERF_BURST);
+		if (n > 0)
+			outstanding += fwd_perf_send(fq, n);
+
+		n = fwd_perf_receive(fq);
+		outstanding -= RTE_MIN(n, outstanding);
+		packets += n;
+		now = rte_rdtsc();
+	} while (now < end);
+
+	fq->result.packets = packets;
+	fq->result.cycles = now - start;
+
+	/* collect the packets still in flight outside of the measurement */
+	end = now + (rte_get_tsc_hz() * FWD_PERF_DRAIN_MS) / 1000;
+	while ((outstanding > 0) && (rte_rdtsc() < end)) {
+		n = fwd_perf_receive(fq);
+		outstanding -= RTE_MIN(n, outstanding);
+	}
+
+	return 0;
+}
+
+static int
+fwd_perf_cmp(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a;
+	uint64_t y = *(const uint64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+/* sort the kept samples and pick the reported percentiles */
+static void
+fwd_perf_percentiles(struct fwd_perf_queue *fq)
+{
+	static const unsigned int permille[] = { 500, 990, 999 };
+	uint64_t count;
+	unsigned int i;
+
+	count = RTE_MIN(fq->nb_samples, (uint64_t)FWD_PERF_SAMPLES);
+	memset(fq->result.latency, 0, sizeof(fq->result.latency));
+	if (count == 0)
+		return;
+
+	qsort(fq->samples, count, sizeof(*fq->samples), fwd_perf_cmp);
+	for (i = 0; i < RTE_DIM(permille); i++)
+		fq->result.latency[i] =
+			fq->samples[((count - 1) * permille[i]) / 1000];
+}
+
+static double
+fwd_perf_usec(uint64_t cycles)
+{
+	return (double)cycles * 1E6 / (double)rte_get_tsc_hz();
+}
+
+static void
+fwd_perf_print_stages(const char *dir,
+		      const struct rte_pmd_avp_stage_stats *stats,
+		      uint64_t packets)
+{
+	unsigned int i;
+
+	if ((stats->bursts == 0) || (packets == 0)) {
+		/* the selected burst function is not instrumented */
+		printf("%6s stages: n/a\n", dir);
+		return;
+	}
+
+	printf("%6s stages:", dir);
+	for (i = 0; i < RTE_PMD_AVP_STAGE_MAX; i++)
+		printf(" %s %.1f", fwd_perf_stages[i],
+		       (double)stats->cycles[i] / packets);
+	printf(" (cycles/pkt, %.1f pkts/burst)\n",
+	       (double)packets / stats->bursts);
+}
+
+/* run all queues once with the given frame size and report the results */
+static int
+fwd_perf_run(struct fwd_perf_queue *queues, unsigned int nb_queues,
+	     const char *mode, unsigned int frame_size, int *stages)
+{
+	struct rte_pmd_avp_stage_stats rx_stats;
+	struct rte_pmd_avp_stage_stats tx_stats;
+	struct fwd_perf_queue *fq;
+	unsigned int lcore_id;
+	unsigned int q;
+	int ret = 0;
+
+	rte_eth_stats_reset(queues[0].port_id);
+
+	q = 1;
+	RTE_LCORE_FOREACH_SLAVE(lcore_id) {
+		if (q >= nb_queues)
+			break;
+		fq = &queues[q++];
+		fq->pkt_len = frame_size - ETHER_CRC_LEN;
+		fq->nb_samples = 0;
+		memset(&fq->result, 0, sizeof(fq->result));
+		rte_eal_remote_launch(fwd_perf_lcore, fq, lcore_id);
+	}
+
+	fq = &queues[0];
+	fq->pkt_len = frame_size - ETHER_CRC_LEN;
+	fq->nb_samples = 0;
+	memset(&fq->result, 0, sizeof(fq->result));
+	fwd_perf_lcore(fq);
+
+	rte_eal_mp_wait_lcore();
+
+	for (q = 0; q < nb_queues; q++) {
+		fq = &queues[q];
+		fwd_perf_percentiles(fq);
+
+		printf("%-8s %-5s %6u %5u %8.3f %8" PRIu64 " %8.2f %8.2f %8.2f",
+		       mode, fq->vlan ? "on" : "off", frame_size, q,
+		       (double)fq->result.packets /
+		       fwd_perf_usec(fq->result.cycles),
+		       fq->result.packets ?
+		       fq->result.cycles / fq->result.packets : 0,
+		       fwd_perf_usec(fq->result.latency[0]),
+		       fwd_perf_usec(fq->result.latency[1]),
+		       fwd_perf_usec(fq->result.latency[2]));
+		if (fq->result.errors != 0)
+			printf(" %" PRIu64 " errors", fq->result.errors);
+		printf("\n");
+
+		if ((fq->result.packets == 0) || (fq->result.errors != 0))
+			ret = -1;
+
+		if (!*stages)
+			continue;
+
+		if ((rte_pmd_avp_rx_stage_stats_get(fq->port_id, q,
+						    &rx_stats) != 0) ||
+		    (rte_pmd_avp_tx_stage_stats_get(fq->port_id, q,
+						    &tx_stats) != 0)) {
+			printf("Stage cycles not available; rebuild the PMD with CONFIG_RTE_LIBRTE_AVP_STAGE_CYCLES=y\n");
+			*stages = 0;
+			continue;
+		}
+		fwd_perf_print_stages("rx", &rx_stats, fq->result.packets);
+		fwd_perf_print_stages("tx", &tx_stats, fq->result.packets);
+	}
+
+	return ret;
+}
+
+/* find a CPU that is not used by an lcore for the emulator service thread */
+static int
+fwd_perf_service_cpu(void)
+{
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	int cpu;
+
+	for (cpu = cpus - 1; cpu >= 0; cpu--)
+		if ((cpu >= RTE_MAX_LCORE) || !rte_lcore_is_enabled(cpu))
+			return cpu;
+	return -1;
+}
+
+/* create an emulated AVP device and start nb_queues queue pairs on it */
+static int
+fwd_perf_port_start(const struct fwd_perf_mode *mode, unsigned int vlan,
+		    unsigned int nb_queues, struct rte_mempool *pool,
+		    uint8_t *port_id)
+{
+	struct rte_eth_conf conf;
+	char args[128];
+	unsigned int q;
+	int cpu;
+	int ret;
+
+	cpu = fwd_perf_service_cpu();
+	snprintf(args, sizeof(args),
+		 "mode=loopback,version=%u,mru=%u,queues=%u,buffers=%u",
+		 mode->version, mode->mru, nb_queues, FWD_PERF_HOST_BUFFERS);
+	if (cpu >= 0)
+		snprintf(args + strlen(args), sizeof(args) - strlen(args),
+			 ",cpu=%d", cpu);
+
+#if RTE_VERSION >= RTE_VERSION_NUM(17, 8, 0, 0)
+	ret = rte_vdev_init(FWD_PERF_DEVICE, args);
+#else
+	ret = rte_eal_vdev_init(FWD_PERF_DEVICE, args);
+#endif
+	if (ret != 0) {
+		printf("Failed to create %s,%s, ret=%d\n",
+		       FWD_PERF_DEVICE, args, ret);
+		return ret;
+	}
+
+	ret = rte_eth_dev_get_port_by_name(FWD_PERF_DEVICE, port_id);
+	if (ret != 0) {
+		printf("Failed to find the port of %s, ret=%d\n",
+		       FWD_PERF_DEVICE, ret);
+		goto error;
+	}
+
+	memset(&conf, 0, sizeof(conf));
+	conf.rxmode.hw_vlan_strip = (vlan != 0);
+	if (mode->mru > ETHER_MAX_LEN) {
+		conf.rxmode.jumbo_frame = 1;
+		conf.rxmode.enable_scatter = 1;
+	}
+	conf.rxmode.max_rx_pkt_len = mode->mru;
+
+	ret = rte_eth_dev_configure(*port_id, nb_queues, nb_queues, &conf);
+	if (ret != 0) {
+		printf("Failed to configure port %u, ret=%d\n", *port_id, ret);
+		goto error;
+	}
+
+	for (q = 0; q < nb_queues; q++) {
+		ret = rte_eth_rx_queue_setup(*port_id, q, 0,
+					     rte_eth_dev_socket_id(*port_id),
+					     NULL, pool);
+		if (ret == 0)
+			ret = rte_eth_tx_queue_setup(*port_id, q, 0,
+					rte_eth_dev_socket_id(*port_id),
+					NULL);
+		if (ret != 0) {
+			printf("Failed to setup queue %u of port %u, ret=%d\n",
+			       q, *port_id, ret);
+			goto error;
+		}
+	}
+
+	ret = rte_eth_dev_start(*port_id);
+	if (ret != 0) {
+		printf("Failed to start port %u, ret=%d\n", *port_id, ret);
+		goto error;
+	}
+
+	return 0;
+
+error:
+#if RTE_VERSION >= RTE_VERSION_NUM(17, 8, 0, 0)
+	rte_vdev_uninit(FWD_PERF_DEVICE);
+#else
+	rte_eal_vdev_uninit(FWD_PERF_DEVICE);
+#endif
+	return ret;
+}
+
+static void
+fwd_perf_port_stop(uint8_t port_id)
+{
+	rte_eth_dev_stop(port_id);
+	rte_eth_dev_close(port_id);
+#if RTE_VERSION >= RTE_VERSION_NUM(17, 8, 0, 0)
+	rte_vdev_uninit(FWD_PERF_DEVICE);
+#else
+	rte_eal_vdev_uninit(FWD_PERF_DEVICE);
+#endif
+}
+
+int
+test_fwd_perf(void)
+{
+	struct fwd_perf_queue *queues = NULL;
+	struct rte_mempool *pool = NULL;
+	const struct fwd_perf_mode *mode;
+	struct ether_addr mac;
+	unsigned int nb_queues;
+	unsigned int frame;
+	unsigned int vlan;
+	unsigned int m, q;
+	int stages = 1;
+	uint8_t port_id;
+	int ret = -1;
+
+	nb_queues = RTE_MIN(rte_lcore_count(),
+			    (unsigned int)RTE_AVP_MAX_QUEUES);
+	if (fwd_perf_service_cpu() < 0)
+		printf("No CPU left for the emulated host; results are not representative\n");
+
+	queues = rte_zmalloc("avp_fwd_perf", nb_queues * sizeof(*queues),
+			     RTE_CACHE_LINE_SIZE);
+	if (queues == NULL) {
+		printf("Failed to allocate queue state\n");
+		goto done;
+	}
+
+	for (q = 0; q < nb_queues; q++) {
+		queues[q].samples = rte_malloc("avp_fwd_perf",
+					       FWD_PERF_SAMPLES *
+					       sizeof(*queues[q].samples),
+					       RTE_CACHE_LINE_SIZE);
+		if (queues[q].samples == NULL) {
+			printf("Failed to allocate latency samples\n");
+			goto done;
+		}
+	}
+
+	pool = rte_pktmbuf_pool_create("avp_fwd_perf", FWD_PERF_MBUFS,
+				       RTE_MEMPOOL_CACHE_MAX_SIZE, 0,
+				       RTE_MBUF_DEFAULT_BUF_SIZE,
+				       rte_socket_id());
+	if (pool == NULL) {
+		printf("Failed to create mbuf pool\n");
+		goto done;
+	}
+
+	printf("AVP loopback forwarding; %u queues, %u packets in flight per queue, latency in usec\n",
+	       nb_queues, FWD_PERF_WINDOW);
+	printf("%-8s %-5s %6s %5s %8s %8s %8s %8s %8s\n",
+	       "mode", "vlan", "frame", "queue", "Mpps", "cyc/pkt",
+	       "p50", "p99", "p99.9");
+
+	ret = 0;
+	for (m = 0; m < RTE_DIM(fwd_perf_modes); m++) {
+		mode = &fwd_perf_modes[m];
+		for (vlan = 0; vlan <= 1; vlan++) {
+			if (fwd_perf_port_start(mode, vlan, nb_queues, pool,
+						&port_id) != 0) {
+				ret = -1;
+				goto done;
+			}
+
+			rte_eth_macaddr_get(port_id, &mac);
+			for (q = 0; q < nb_queues; q++) {
+				queues[q].pool = pool;
+				queues[q].port_id = port_id;
+				queues[q].queue_id = q;
+				queues[q].vlan = vlan;
+				ether_addr_copy(&mac, &queues[q].dst);
+			}
+
+			for (frame = 0;
+			     frame < RTE_DIM(fwd_perf_frame_sizes); frame++) {
+				if (fwd_perf_frame_sizes[frame] > mode->mru)
+					continue;
+				ret |= fwd_perf_run(queues, nb_queues,
+						    mode->name,
+						    fwd_perf_frame_sizes[frame],
+						    &stages);
+			}
+
+			fwd_perf_port_stop(port_id);
+		}
+	}
+
+done:
+	if (queues != NULL)
+		for (q = 0; q < nb_queues; q++)
+			rte_free(queues[q].samples);
+	rte_free(queues);
+	rte_mempool_free(pool);
+	return ret;
+}
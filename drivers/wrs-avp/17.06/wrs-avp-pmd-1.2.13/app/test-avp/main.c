@@ -0,0 +1,119 @@
+/*
+ *   BSD LICENSE
+ *
+ * Copyright (c) 2017, Wind River Systems, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1) Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2) Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3) Neither the name of Wind River Systems nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <rte_common.h>
+#include <rte_eal.h>
+#include <rte_debug.h>
+
+#include "test_avp.h"
+
+static const struct test_avp_command commands[] = {
+	{ "fifo_perf", "AVP fifo put/get cycles per burst", test_fifo_perf },
+	{ "copy_perf", "AVP copy engine cycles and cache misses",
+	  test_copy_perf },
+#ifdef RTE_LIBRTE_AVP_EMU
+	{ "fwd_perf", "AVP loopback forwarding rate, latency and stage cycles",
+	  test_fwd_perf },
+	{ "cdesc_rx", "AVP chained compact descriptor frames, 1 packet per call",
+	  test_cdesc_rx },
+#endif
+};
+
+static void
+usage(const char *prgname)
+{
+	unsigned int i;
+
+	printf("Usage: %s [EAL options] -- [test ...]\n"
+	       "Runs all tests if none are specified.  Available tests:\n",
+	       prgname);
+	for (i = 0; i < RTE_DIM(commands); i++)
+		printf("  %-16s %s\n", commands[i].name, commands[i].help);
+}
+
+static const struct test_avp_command *
+lookup(const char *name)
+{
+	unsigned int i;
+
+	for (i = 0; i < RTE_DIM(commands); i++)
+		if (strcmp(commands[i].name, name) == 0)
+			return &commands[i];
+	return NULL;
+}
+
+static int
+run(const struct test_avp_command *cmd)
+{
+	int ret;
+
+	printf("=== %s ===\n", cmd->name);
+	ret = cmd->run();
+	printf("%s: %s\n", cmd->name, ret == 0 ? "OK" : "FAILED");
+	return ret;
+}
+
+int
+main(int argc, char **argv)
+{
+	const char *prgname = argv[0];
+	unsigned int i;
+	int failed = 0;
+	int ret;
+
+	ret = rte_eal_init(argc, argv);
+	if (ret < 0)
+		rte_exit(EXIT_FAILURE, "Cannot init EAL\n");
+	argc -= ret;
+	argv += ret;
+
+	for (i = 1; i < (unsigned int)argc; i++) {
+		if (lookup(argv[i]) == NULL) {
+			usage(prgname);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (argc <= 1) {
+		for (i = 0; i < RTE_DIM(commands); i++)
+			failed |= (run(&commands[i]) != 0);
+	} else {
+		for (i = 1; i < (unsigned int)argc; i++)
+			failed |= (run(lookup(argv[i])) != 0);
+	}
+
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,133 @@
+/*
+ *   BSD LICENSE
+ *
+ * Copyright (c) 2017, Wind River Systems, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1) Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2) Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3) Neither the name of Wind River Systems nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _TEST_AVP_H_
+#define _TEST_AVP_H_
+
+#include <stdint.h>
+
+/**
+ * Description of a single performance test
+ */
+struct test_avp_command {
+	const char *name; /**< Name used to select the test */
+	const char *help; /**< One line description of the test */
+	int (*run)(void); /**< Returns 0 on success */
+};
+
+/**@{ AVP fifo performance test parameters */
+#define FIFO_PERF_SIZE 1024 /**< Number of fifo entries */
+#define FIFO_PERF_BURST 32 /**< Entries per put/get call */
+#define FIFO_PERF_ITERATIONS (1 << 20) /**< Bursts measured per test */
+/**@} */
+
+/**@{ AVP fifo layouts */
+#define FIFO_PERF_LAYOUT_V2 0 /**< struct rte_avp_fifo */
+#define FIFO_PERF_LAYOUT_V3 1 /**< struct rte_avp_fifo_v3 */
+/**@} */
+
+/**
+ * Results of a fifo test; all values are TSC cycles per burst.
+ */
+struct fifo_perf_result {
+	uint64_t single; /**< put followed by get on a single lcore */
+	uint64_t producer; /**< put while a second lcore consumes */
+	uint64_t consumer; /**< get while a second lcore produces */
+};
+
+/**
+ * Measure one fifo implementation.  The cross lcore tests are skipped if
+ * peer_lcore is RTE_MAX_LCORE.
+ */
+int fifo_perf_barrier(unsigned int layout, unsigned int peer_lcore,
+		      struct fifo_perf_result *result);
+int fifo_perf_c11(unsigned int layout, unsigned int peer_lcore,
+		  struct fifo_perf_result *result);
+
+int test_fifo_perf(void);
+
+/**@{ AVP copy engine performance test parameters */
+#define COPY_PERF_PKT_LEN 1024 /**< Bytes copied per packet */
+#define COPY_PERF_BUF_SIZE 2048 /**< Host buffer stride */
+#define COPY_PERF_HOST_SIZE (256 << 20) /**< Host region; exceeds the LLC */
+#define COPY_PERF_WSET_SIZE (1 << 20) /**< Guest working set; fits the LLC */
+#define COPY_PERF_PROBES 8 /**< Working set lines read per packet */
+#define COPY_PERF_BURST 32 /**< Packets copied between probes */
+#define COPY_PERF_PACKETS (1 << 20) /**< Packets measured per copy engine */
+/**@} */
+
+/**
+ * Results of a copy engine test
+ */
+struct copy_perf_result {
+	uint64_t copy; /**< TSC cycles per packet copy */
+	uint64_t probe; /**< TSC cycles per working set probe */
+	uint64_t misses; /**< Last level cache misses; 0 if not available */
+};
+
+int test_copy_perf(void);
+
+/**@{ AVP forwarding performance test parameters */
+#define FWD_PERF_BURST 32 /**< Packets per transmit and receive call */
+#define FWD_PERF_WINDOW 256 /**< Packets in flight per queue */
+#define FWD_PERF_DURATION_MS 500 /**< Measurement time per configuration */
+#define FWD_PERF_DRAIN_MS 100 /**< Time allowed for packets in flight */
+#define FWD_PERF_SAMPLES (1 << 16) /**< Latency samples kept per queue */
+#define FWD_PERF_MBUFS 32767 /**< Mbufs shared by all queues */
+#define FWD_PERF_HOST_BUFFERS 32768 /**< Buffers of the emulated host */
+#define FWD_PERF_VLAN_TCI 100 /**< VLAN tag of the VLAN configurations */
+#define FWD_PERF_JUMBO_MRU 9238 /**< MRU of the scattered configurations */
+/**@} */
+
+/**
+ * Results of a forwarding test on one queue
+ */
+struct fwd_perf_result {
+	uint64_t packets; /**< Packets received back */
+	uint64_t errors; /**< Packets received with unexpected metadata */
+	uint64_t cycles; /**< TSC cycles of the measurement */
+	uint64_t latency[3]; /**< 50th, 99th and 99.9th percentile latency */
+};
+
+int test_fwd_perf(void);
+
+/**@{ AVP compact descriptor receive test parameters */
+#define CDESC_RX_PACKETS 256 /**< Frames sent per frame size */
+#define CDESC_RX_BURST 32 /**< Frames per transmit call */
+#define CDESC_RX_TIMEOUT_MS 1000 /**< Time allowed per frame size */
+#define CDESC_RX_MBUFS 8191 /**< Mbufs of the test */
+#define CDESC_RX_HOST_BUFFERS 4096 /**< Buffers of the emulated host */
+/**@} */
+
+int test_cdesc_rx(void);
+
+#endif /* _TEST_AVP_H_ */
@@ -0,0 +1,190 @@
+/*
+ * BSD LICENSE
+ *
+ * Copyright (c) 2017, Wind River Systems, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1) Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2) Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3) Neither the name of Wind River Systems nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _AVP_COPY_H_
+#define _AVP_COPY_H_
+
+/*
+ * Packet copy engines.  Payloads copied into host buffers are never read
+ * again by the guest, so writing them with non-temporal stores avoids pulling
+ * every destination line into the cache and evicting the application working
+ * set.  Non-temporal stores are weakly ordered; avp_copy_fence() must be
+ * called before the copied buffers are published to another core.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <rte_common.h>
+#include <rte_memcpy.h>
+#include <rte_atomic.h>
+
+#ifdef RTE_ARCH_X86_64
+#include <x86intrin.h>
+#define AVP_COPY_HAVE_STREAM 1
+#if defined(RTE_MACHINE_CPUFLAG_AVX512F)
+#define AVP_COPY_HAVE_AVX512 1
+#endif
+#endif
+
+/*
+ * Defines how packet data is copied between host and guest buffers
+ */
+enum avp_copy_mode {
+	AVP_COPY_MEMCPY = 0, /**< rte_memcpy(); destination lines are cached */
+	AVP_COPY_STREAM, /**< 16 byte non-temporal stores */
+	AVP_COPY_AVX512, /**< 64 byte non-temporal stores */
+	AVP_COPY_MAX
+};
+
+#ifdef AVP_COPY_HAVE_STREAM
+/*
+ * Copy with 16 byte non-temporal stores.  The leading bytes up to the first
+ * 16 byte aligned destination address and the trailing bytes of less than 4
+ * bytes are written with regular stores.
+ */
+static inline void
+avp_copy_stream(void *dst, const void *src, size_t len)
+{
+	uint8_t *d = dst;
+	const uint8_t *s = src;
+	__m128i x0, x1, x2, x3;
+	long long q;
+	size_t head;
+	int w;
+
+	head = (-(uintptr_t)d) & 15;
+	if (head != 0) {
+		head = RTE_MIN(head, len);
+		rte_memcpy(d, s, head);
+		d += head;
+		s += head;
+		len -= head;
+	}
+
+	for (; len >= 64; len -= 64, d += 64, s += 64) {
+		x0 = _mm_loadu_si128((const __m128i *)(s + 0));
+		x1 = _mm_loadu_si128((const __m128i *)(s + 16));
+		x2 = _mm_loadu_si128((const __m128i *)(s + 32));
+		x3 = _mm_loadu_si128((const __m128i *)(s + 48));
+		_mm_stream_si128((__m128i *)(d + 0), x0);
+		_mm_stream_si128((__m128i *)(d + 16), x1);
+		_mm_stream_si128((__m128i *)(d + 32), x2);
+		_mm_stream_si128((__m128i *)(d + 48), x3);
+	}
+
+	for (; len >= 16; len -= 16, d += 16, s += 16)
+		_mm_stream_si128((__m128i *)d,
+				 _mm_loadu_si128((const __m128i *)s));
+
+	if (len >= 8) {
+		memcpy(&q, s, sizeof(q));
+		_mm_stream_si64((long long *)d, q);
+		d += 8;
+		s += 8;
+		len -= 8;
+	}
+
+	if (len >= 4) {
+		memcpy(&w, s, sizeof(w));
+		_mm_stream_si32((int *)d, w);
+		d += 4;
+		s += 4;
+		len -= 4;
+	}
+
+	if (len != 0)
+		memcpy(d, s, len);
+}
+#endif
+
+#ifdef AVP_COPY_HAVE_AVX512
+/*
+ * Copy with 64 byte non-temporal stores; i.e., one full cache line per store.
+ * Unaligned leading and trailing bytes are handled by avp_copy_stream().
+ */
+static inline void
+avp_copy_avx512(void *dst, const void *src, size_t len)
+{
+	uint8_t *d = dst;
+	const uint8_t *s = src;
+	size_t head;
+
+	head = (-(uintptr_t)d) & 63;
+	if (head != 0) {
+		head = RTE_MIN(head, len);
+		avp_copy_stream(d, s, head);
+		d += head;
+		s += head;
+		len -= head;
+	}
+
+	for (; len >= 64; len -= 64, d += 64, s += 64)
+		_mm512_stream_si512((__m512i *)d,
+				    _mm512_loadu_si512((const void *)s));
+
+	if (len != 0)
+		avp_copy_stream(d, s, len);
+}
+#endif
+
+/* copy packet data with the selected copy engine */
+static inline void
+avp_copy(enum avp_copy_mode mode, void *dst, const void *src, size_t len)
+{
+	switch (mode) {
+#ifdef AVP_COPY_HAVE_AVX512
+	case AVP_COPY_AVX512:
+		avp_copy_avx512(dst, src, len);
+		break;
+#endif
+#ifdef AVP_COPY_HAVE_STREAM
+	case AVP_COPY_STREAM:
+		avp_copy_stream(dst, src, len);
+		break;
+#endif
+	default:
+		rte_memcpy(dst, src, len);
+		break;
+	}
+}
+
+/* order the non-temporal stores of a copy engine before a following store */
+static inline void
+avp_copy_fence(enum avp_copy_mode mode)
+{
+	if (mode != AVP_COPY_MEMCPY)
+		rte_wmb();
+}
+
+#endif /* _AVP_COPY_H_ */
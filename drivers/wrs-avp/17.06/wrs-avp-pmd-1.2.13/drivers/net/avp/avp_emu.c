@@ -0,0 +1,1298 @@
+/*
+ * BSD LICENSE
+ *
+ * Copyright (c) 2017, Wind River Systems, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1) Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2) Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3) Neither the name of Wind River Systems nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Software AVP host.  The regions that a host exports through the AVP PCI
+ * BARs are built in hugepage memory and presented to the PMD as an emulated
+ * PCI device, and a service thread plays the part of the host: it answers
+ * requests, keeps the alloc fifos supplied with buffers, drains the free
+ * fifos, and loops back, sinks or sources traffic on the packet fifos.
+ * Migration interrupts are raised by calling the interrupt handler of the PMD
+ * directly since there is no MSI-X vector to signal.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* pthread_setaffinity_np() */
+#endif
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/queue.h>
+
+#include <rte_version.h>
+#include <rte_common.h>
+#include <rte_byteorder.h>
+#include <rte_atomic.h>
+#include <rte_cycles.h>
+#include <rte_malloc.h>
+#include <rte_memcpy.h>
+#include <rte_memzone.h>
+#include <rte_ether.h>
+#include <rte_ip.h>
+#include <rte_udp.h>
+#include <rte_kvargs.h>
+#include <rte_ethdev.h>
+
+#include "avp_emu.h"
+
+#ifdef AVP_EMU
+#include <rte_vdev.h>
+
+#include "rte_avp_common.h"
+#include "rte_avp_fifo.h"
+#include "rte_pmd_avp.h"
+#include "avp_logs.h"
+
+#define AVP_EMU_MODE_ARG "mode"
+#define AVP_EMU_VERSION_ARG "version"
+#define AVP_EMU_QUEUES_ARG "queues"
+#define AVP_EMU_BUFFERS_ARG "buffers"
+#define AVP_EMU_PKT_LEN_ARG "pkt_len"
+#define AVP_EMU_CPU_ARG "cpu"
+#define AVP_EMU_MRU_ARG "mru"
+
+#define AVP_EMU_FIFO_LEN 1024 /**< Entries per packet fifo; a power of 2 */
+#define AVP_EMU_REQ_FIFO_LEN 16 /**< Entries per request/response fifo */
+#define AVP_EMU_ALLOC_LEVEL 512 /**< Buffers kept on each alloc fifo */
+#define AVP_EMU_BURST 32 /**< Packets moved per fifo per iteration */
+#define AVP_EMU_DEFAULT_BUFFERS 16384
+#define AVP_EMU_DEFAULT_PKT_LEN (ETHER_MIN_LEN - ETHER_CRC_LEN)
+#define AVP_EMU_BUF_SIZE 2048 /**< Data room of each host buffer */
+#define AVP_EMU_MAX_RX_PKT_LEN 9238
+#define AVP_EMU_MMIO_SIZE 4096
+
+/* data follows the buffer header and headroom as in a host mbuf */
+#define AVP_EMU_BUF_OFFSET \
+	(sizeof(struct rte_avp_desc) + RTE_PKTMBUF_HEADROOM)
+#define AVP_EMU_BUF_STRIDE \
+	RTE_ALIGN(AVP_EMU_BUF_OFFSET + AVP_EMU_BUF_SIZE, RTE_CACHE_LINE_SIZE)
+
+/*
+ * Space reserved for each fifo.  A compact descriptor ring is the largest
+ * layout so the same space suits every host version.
+ */
+#define AVP_EMU_FIFO_SIZE(_len) \
+	RTE_ALIGN(sizeof(struct rte_avp_ring) + \
+		  ((_len) * sizeof(struct rte_avp_cdesc)), RTE_CACHE_LINE_SIZE)
+
+/* locally administered addresses of the emulated device and its peer */
+static const uint8_t avp_emu_ethaddr[ETHER_ADDR_LEN] = {
+	0x02, 0x00, 0x00, 0xa0, 0x00, 0x00
+};
+static const uint8_t avp_emu_peer_ethaddr[ETHER_ADDR_LEN] = {
+	0x02, 0x00, 0x00, 0xa0, 0xff, 0x00
+};
+
+/*
+ * Defines what the host does with the packets transmitted by the guest
+ */
+enum avp_emu_mode {
+	AVP_EMU_LOOPBACK = 0, /**< Transmitted packets are received back */
+	AVP_EMU_SINK, /**< Transmitted packets are discarded */
+	AVP_EMU_SOURCE, /**< Discard, and receive a generated packet stream */
+	AVP_EMU_MODE_MAX
+};
+
+static const char * const avp_emu_mode_names[AVP_EMU_MODE_MAX] = {
+	[AVP_EMU_LOOPBACK] = "loopback",
+	[AVP_EMU_SINK] = "sink",
+	[AVP_EMU_SOURCE] = "source",
+};
+
+/*
+ * Emulated BARs, each backed by a memzone
+ */
+enum avp_emu_region {
+	AVP_EMU_MMIO = 0,
+	AVP_EMU_DEVICE,
+	AVP_EMU_MEMMAP,
+	AVP_EMU_MEMORY,
+	AVP_EMU_NB_REGIONS
+};
+
+static const unsigned int avp_emu_region_bar[AVP_EMU_NB_REGIONS] = {
+	[AVP_EMU_MMIO] = RTE_AVP_PCI_MMIO_BAR,
+	[AVP_EMU_DEVICE] = RTE_AVP_PCI_DEVICE_BAR,
+	[AVP_EMU_MEMMAP] = RTE_AVP_PCI_MEMMAP_BAR,
+	[AVP_EMU_MEMORY] = RTE_AVP_PCI_MEMORY_BAR,
+};
+
+static const char * const avp_emu_region_names[AVP_EMU_NB_REGIONS] = {
+	[AVP_EMU_MMIO] = "mmio",
+	[AVP_EMU_DEVICE] = "device",
+	[AVP_EMU_MEMMAP] = "memmap",
+	[AVP_EMU_MEMORY] = "memory",
+};
+
+/*
+ * Defines the state of an emulated AVP host
+ */
+struct avp_emu {
+	TAILQ_ENTRY(avp_emu) next;
+	char name[RTE_ETH_NAME_MAX_LEN]; /**< Name of the virtual device */
+	struct rte_pci_device pci_dev; /**< Device presented to the PMD */
+	struct rte_devargs devargs; /**< PMD arguments of the device */
+	const struct rte_memzone *mz[AVP_EMU_NB_REGIONS];
+
+	/* configuration */
+	enum avp_emu_mode mode;
+	unsigned int major; /**< AVP major version implemented */
+	unsigned int nb_queues; /**< Number of fifos of each kind */
+	unsigned int nb_bufs; /**< Number of buffers in the pool */
+	unsigned int pkt_len; /**< Length of generated packets */
+	int cpu; /**< CPU of the service thread (-1: any) */
+	unsigned int mru; /**< Maximum receive unit of the host */
+
+	/* emulated regions */
+	void *registers;
+	struct rte_avp_device_info *info;
+	struct rte_avp_memmap_info *memmap;
+	void *memory;
+	phys_addr_t memory_phys;
+	void *req_q;
+	void *resp_q;
+	struct rte_avp_request *sync;
+	void *tx_q[RTE_AVP_MAX_QUEUES];
+	void *rx_q[RTE_AVP_MAX_QUEUES];
+	void *alloc_q[RTE_AVP_MAX_QUEUES];
+	void *free_q[RTE_AVP_MAX_QUEUES];
+	uint8_t *pool;
+	uint64_t device_id;
+
+	/* service thread */
+	pthread_t thread;
+	volatile int stop; /**< Request the thread to exit */
+	volatile int quiesce; /**< Request the thread to stop touching memory */
+	volatile int quiesced; /**< The thread is not touching memory */
+
+	/* host state owned by the service thread */
+	uint32_t *free_ids; /**< Stack of free buffer indices */
+	unsigned int nb_free;
+	unsigned int nb_rx; /**< Receive fifos configured by the guest */
+	unsigned int if_up; /**< Interface state requested by the guest */
+	uint32_t features; /**< Features negotiated by the guest */
+	struct rte_pmd_avp_emu_stats stats;
+
+	uint8_t template[AVP_EMU_BUF_SIZE]; /**< Generated packet */
+};
+
+TAILQ_HEAD(avp_emu_list, avp_emu);
+static struct avp_emu_list avp_emu_list =
+	TAILQ_HEAD_INITIALIZER(avp_emu_list);
+
+static const char * const avp_emu_valid_arguments[] = {
+	AVP_EMU_MODE_ARG,
+	AVP_EMU_VERSION_ARG,
+	AVP_EMU_QUEUES_ARG,
+	AVP_EMU_BUFFERS_ARG,
+	AVP_EMU_PKT_LEN_ARG,
+	AVP_EMU_CPU_ARG,
+	AVP_EMU_MRU_ARG,
+	NULL
+};
+
+/*
+ * Host side fifo accessors.  The host is the producer of the rx, alloc and
+ * response fifos and the consumer of the tx, free and request fifos.
+ */
+static inline unsigned int
+avp_emu_fifo_put(struct avp_emu *emu, void *fifo, void **data, unsigned int n)
+{
+	if (emu->major >= RTE_AVP_MAJOR_VERSION_3)
+		return avp_fifo_v3_put(fifo, data, n);
+	return avp_fifo_put(fifo, data, n);
+}
+
+static inline unsigned int
+avp_emu_fifo_get(struct avp_emu *emu, void *fifo, void **data, unsigned int n)
+{
+	if (emu->major >= RTE_AVP_MAJOR_VERSION_3)
+		return avp_fifo_v3_get(fifo, data, n);
+	return avp_fifo_get(fifo, data, n);
+}
+
+static inline unsigned int
+avp_emu_fifo_free_count(struct avp_emu *emu, void *fifo, unsigned int num)
+{
+	if (emu->major >= RTE_AVP_MAJOR_VERSION_3)
+		return avp_fifo_v3_free_count(fifo, num);
+	return avp_fifo_free_count(fifo);
+}
+
+static inline unsigned int
+avp_emu_ring_free_count(void *ring, unsigned int num)
+{
+	/* the ring indices are laid out as in a version 3 fifo */
+	return avp_fifo_v3_free_count(ring, num);
+}
+
+static inline struct rte_avp_desc *
+avp_emu_buf_desc(struct avp_emu *emu, uint32_t id)
+{
+	return (struct rte_avp_desc *)(emu->pool + (id * AVP_EMU_BUF_STRIDE));
+}
+
+static inline void *
+avp_emu_buf_data(struct avp_emu *emu, uint32_t id)
+{
+	return emu->pool + (id * AVP_EMU_BUF_STRIDE) + AVP_EMU_BUF_OFFSET;
+}
+
+/* translate a buffer address returned by the guest to a buffer index */
+static inline int
+avp_emu_buf_id(struct avp_emu *emu, const void *desc, uint32_t *id)
+{
+	uintptr_t offset = RTE_PTR_DIFF(desc, emu->pool);
+
+	if ((offset % AVP_EMU_BUF_STRIDE) != 0)
+		return -EINVAL;
+	*id = offset / AVP_EMU_BUF_STRIDE;
+	return (*id < emu->nb_bufs) ? 0 : -EINVAL;
+}
+
+static inline void
+avp_emu_buf_free(struct avp_emu *emu, uint32_t id)
+{
+	if (unlikely(emu->nb_free >= emu->nb_bufs)) {
+		/* returned twice */
+		emu->stats.errors++;
+		return;
+	}
+	emu->free_ids[emu->nb_free++] = id;
+}
+
+/* return every buffer of a packet chain to the pool */
+static void
+avp_emu_buf_free_chain(struct avp_emu *emu, struct rte_avp_desc *desc)
+{
+	unsigned int count = 0;
+	uint32_t id;
+
+	while (desc != NULL) {
+		if (unlikely((avp_emu_buf_id(emu, desc, &id) != 0) ||
+			     (++count > emu->nb_bufs))) {
+			emu->stats.errors++;
+			return;
+		}
+		desc = desc->next;
+		avp_emu_buf_free(emu, id);
+	}
+}
+
+/* prepare a buffer to be handed to the guest as a single segment */
+static inline struct rte_avp_desc *
+avp_emu_buf_reset(struct avp_emu *emu, uint32_t id, uint16_t data_len)
+{
+	struct rte_avp_desc *desc = avp_emu_buf_desc(emu, id);
+
+	desc->pkt_mbuf = NULL;
+	desc->ol_flags = 0;
+	desc->next = NULL;
+	desc->data = avp_emu_buf_data(emu, id);
+	desc->data_len = data_len;
+	desc->nb_segs = 1;
+	desc->pkt_len = data_len;
+	desc->rss_hash = 0;
+	desc->vlan_tci = 0;
+	return desc;
+}
+
+static inline void
+avp_emu_cdesc_reset(struct rte_avp_cdesc *desc, uint32_t id,
+		    uint16_t data_len)
+{
+	memset(desc, 0, sizeof(*desc));
+	desc->buf_id = id;
+	desc->offset = AVP_EMU_BUF_OFFSET;
+	desc->data_len = data_len;
+}
+
+/* answer a pending request from the guest */
+static unsigned int
+avp_emu_service_request(struct avp_emu *emu)
+{
+	struct rte_avp_request *req = emu->sync;
+	struct rte_avp_device_config *config;
+	void *addr;
+
+	if (avp_emu_fifo_get(emu, emu->req_q, &addr, 1) == 0)
+		return 0;
+
+	if (addr != emu->sync) {
+		PMD_DRV_LOG(ERR, "Invalid request address %p\n", addr);
+		emu->stats.errors++;
+		return 1;
+	}
+
+	switch (req->req_id) {
+	case RTE_AVP_REQ_CFG_DEVICE:
+		config = &req->config;
+		if ((config->num_tx_queues == 0) ||
+		    (config->num_tx_queues > emu->nb_queues) ||
+		    (config->num_rx_queues == 0) ||
+		    (config->num_rx_queues > emu->nb_queues) ||
+		    (config->features & ~emu->info->features)) {
+			req->result = -EINVAL;
+			break;
+		}
+		emu->nb_rx = config->num_rx_queues;
+		emu->features = config->features;
+		emu->if_up = config->if_up;
+		req->result = 0;
+		break;
+	case RTE_AVP_REQ_CFG_NETWORK_IF:
+		emu->if_up = req->if_up;
+		req->result = 0;
+		break;
+	case RTE_AVP_REQ_SHUTDOWN_DEVICE:
+		emu->if_up = 0;
+		req->result = 0;
+		break;
+	case RTE_AVP_REQ_CHANGE_MTU:
+		req->result = (req->new_mtu <= emu->mru) ? 0 : -EINVAL;
+		break;
+	default:
+		req->result = -ENOTSUP;
+		break;
+	}
+
+	PMD_DRV_LOG(DEBUG, "Request %u completed with %d\n",
+		    req->req_id, req->result);
+
+	avp_emu_fifo_put(emu, emu->resp_q, &addr, 1);
+	return 1;
+}
+
+/* return the buffers released by the guest to the pool */
+static unsigned int
+avp_emu_service_free(struct avp_emu *emu, unsigned int fifo)
+{
+	struct rte_avp_cdesc descs[AVP_EMU_BURST];
+	void *bufs[AVP_EMU_BURST];
+	unsigned int i, n;
+
+	if (emu->major >= RTE_AVP_MAJOR_VERSION_4) {
+		n = avp_ring_get(emu->free_q[fifo], descs, AVP_EMU_BURST);
+		for (i = 0; i < n; i++) {
+			if (unlikely(descs[i].buf_id >= emu->nb_bufs))
+				emu->stats.errors++;
+			else
+				avp_emu_buf_free(emu, descs[i].buf_id);
+		}
+		return n;
+	}
+
+	n = avp_emu_fifo_get(emu, emu->free_q[fifo], bufs, AVP_EMU_BURST);
+	for (i = 0; i < n; i++)
+		avp_emu_buf_free_chain(emu, bufs[i]);
+	return n;
+}
+
+/* keep the alloc fifo of a transmit queue supplied with empty buffers */
+static unsigned int
+avp_emu_service_alloc(struct avp_emu *emu, unsigned int fifo)
+{
+	struct rte_avp_cdesc descs[AVP_EMU_BURST];
+	void *bufs[AVP_EMU_BURST];
+	unsigned int used, n, i;
+	uint32_t id;
+
+	/* only reload the guest index when the fifo seems to be filled */
+	if (emu->major >= RTE_AVP_MAJOR_VERSION_4)
+		used = (AVP_EMU_FIFO_LEN - 1) -
+			avp_emu_ring_free_count(emu->alloc_q[fifo],
+				AVP_EMU_FIFO_LEN - AVP_EMU_ALLOC_LEVEL);
+	else
+		used = (AVP_EMU_FIFO_LEN - 1) -
+			avp_emu_fifo_free_count(emu, emu->alloc_q[fifo],
+				AVP_EMU_FIFO_LEN - AVP_EMU_ALLOC_LEVEL);
+
+	if (used >= AVP_EMU_ALLOC_LEVEL)
+		return 0;
+
+	n = RTE_MIN(AVP_EMU_ALLOC_LEVEL - used, emu->nb_free);
+	n = RTE_MIN(n, (unsigned int)AVP_EMU_BURST);
+
+	for (i = 0; i < n; i++) {
+		id = emu->free_ids[--emu->nb_free];
+		if (emu->major >= RTE_AVP_MAJOR_VERSION_4)
+			avp_emu_cdesc_reset(&descs[i], id, 0);
+		else
+			bufs[i] = avp_emu_buf_reset(emu, id, 0);
+	}
+
+	/* there is space for every buffer since we are the only producer */
+	if (emu->major >= RTE_AVP_MAJOR_VERSION_4)
+		avp_ring_put(emu->alloc_q[fifo], descs, n);
+	else
+		avp_emu_fifo_put(emu, emu->alloc_q[fifo], bufs, n);
+	return n;
+}
+
+/* convert the transmit flags of a looped back packet to receive flags */
+static inline uint16_t
+avp_emu_rx_flags(uint16_t flags)
+{
+	return (flags & RTE_AVP_CDESC_MORE) |
+		((flags & RTE_AVP_TX_VLAN_PKT) ? RTE_AVP_RX_VLAN_PKT : 0);
+}
+
+/* consume the packets transmitted on a fifo according to the host mode */
+static unsigned int
+avp_emu_service_tx_flat(struct avp_emu *emu, unsigned int fifo)
+{
+	struct rte_avp_desc *bufs[AVP_EMU_BURST];
+	unsigned int i, n, sent;
+
+	n = avp_emu_fifo_get(emu, emu->tx_q[fifo], (void **)bufs,
+			     AVP_EMU_BURST);
+	if (n == 0)
+		return 0;
+
+	emu->stats.tx_packets += n;
+
+	sent = 0;
+	if ((emu->mode == AVP_EMU_LOOPBACK) && emu->if_up) {
+		for (i = 0; i < n; i++)
+			bufs[i]->ol_flags = avp_emu_rx_flags(bufs[i]->ol_flags);
+		sent = avp_emu_fifo_put(emu, emu->rx_q[fifo % emu->nb_rx],
+					(void **)bufs, n);
+		emu->stats.rx_packets += sent;
+		emu->stats.rx_dropped += n - sent;
+	}
+
+	for (i = sent; i < n; i++)
+		avp_emu_buf_free_chain(emu, bufs[i]);
+
+	return n;
+}
+
+static unsigned int
+avp_emu_service_tx_cdesc(struct avp_emu *emu, unsigned int fifo)
+{
+	struct rte_avp_cdesc descs[AVP_EMU_BURST];
+	unsigned int i, n, avail, sent, pkts, looped;
+
+	n = avp_ring_get(emu->tx_q[fifo], descs, AVP_EMU_BURST);
+	if (n == 0)
+		return 0;
+
+	pkts = 0;
+	for (i = 0; i < n; i++)
+		if (!(descs[i].flags & RTE_AVP_CDESC_MORE))
+			pkts++;
+	emu->stats.tx_packets += pkts;
+
+	sent = 0;
+	if ((emu->mode == AVP_EMU_LOOPBACK) && emu->if_up) {
+		fifo = fifo % emu->nb_rx;
+
+		/* only whole packets are looped back */
+		avail = RTE_MIN(n, avp_emu_ring_free_count(emu->rx_q[fifo], n));
+		for (i = 0; i < avail; i++) {
+			descs[i].flags = avp_emu_rx_flags(descs[i].flags);
+			if (!(descs[i].flags & RTE_AVP_CDESC_MORE))
+				sent = i + 1;
+		}
+		avp_ring_put(emu->rx_q[fifo], descs, sent);
+
+		looped = 0;
+		for (i = 0; i < sent; i++)
+			if (!(descs[i].flags & RTE_AVP_CDESC_MORE))
+				looped++;
+		emu->stats.rx_packets += looped;
+		emu->stats.rx_dropped += pkts - looped;
+	}
+
+	for (i = sent; i < n; i++) {
+		if (unlikely(descs[i].buf_id >= emu->nb_bufs))
+			emu->stats.errors++;
+		else
+			avp_emu_buf_free(emu, descs[i].buf_id);
+	}
+
+	return n;
+}
+
+/* generate packets on a receive fifo */
+static unsigned int
+avp_emu_service_source(struct avp_emu *emu, unsigned int fifo)
+{
+	struct rte_avp_cdesc descs[AVP_EMU_BURST];
+	void *bufs[AVP_EMU_BURST];
+	unsigned int n, i;
+	uint32_t id;
+
+	if (emu->major >= RTE_AVP_MAJOR_VERSION_4)
+		n = avp_emu_ring_free_count(emu->rx_q[fifo], AVP_EMU_BURST);
+	else
+		n = avp_emu_fifo_free_count(emu, emu->rx_q[fifo],
+					    AVP_EMU_BURST);
+
+	n = RTE_MIN(n, emu->nb_free);
+	n = RTE_MIN(n, (unsigned int)AVP_EMU_BURST);
+
+	for (i = 0; i < n; i++) {
+		id = emu->free_ids[--emu->nb_free];
+		rte_memcpy(avp_emu_buf_data(emu, id), emu->template,
+			   emu->pkt_len);
+		if (emu->major >= RTE_AVP_MAJOR_VERSION_4)
+			avp_emu_cdesc_reset(&descs[i], id, emu->pkt_len);
+		else
+			bufs[i] = avp_emu_buf_reset(emu, id, emu->pkt_len);
+	}
+
+	if (emu->major >= RTE_AVP_MAJOR_VERSION_4)
+		avp_ring_put(emu->rx_q[fifo], descs, n);
+	else
+		avp_emu_fifo_put(emu, emu->rx_q[fifo], bufs, n);
+
+	emu->stats.rx_packets += n;
+	return n;
+}
+
+static void *
+avp_emu_service(void *arg)
+{
+	struct avp_emu *emu = arg;
+	unsigned int work;
+	unsigned int i;
+
+	while (!emu->stop) {
+		if (emu->quiesce) {
+			/* the host memory is being re-initialized */
+			emu->quiesced = 1;
+			rte_mb();
+			rte_pause();
+			continue;
+		}
+		emu->quiesced = 0;
+
+		work = avp_emu_service_request(emu);
+
+		for (i = 0; i < emu->nb_queues; i++) {
+			work += avp_emu_service_free(emu, i);
+			if (emu->major >= RTE_AVP_MAJOR_VERSION_4)
+				work += avp_emu_service_tx_cdesc(emu, i);
+			else
+				work += avp_emu_service_tx_flat(emu, i);
+			work += avp_emu_service_alloc(emu, i);
+		}
+
+		if ((emu->mode == AVP_EMU_SOURCE) && emu->if_up)
+			for (i = 0; i < emu->nb_rx; i++)
+				work += avp_emu_service_source(emu, i);
+
+		if (work == 0)
+			rte_pause();
+	}
+
+	return NULL;
+}
+
+/* stop the service thread from touching the host memory */
+static void
+avp_emu_quiesce(struct avp_emu *emu)
+{
+	emu->quiesced = 0;
+	rte_mb();
+	emu->quiesce = 1;
+	while (!emu->quiesced)
+		rte_pause();
+	rte_mb();
+}
+
+static void
+avp_emu_resume(struct avp_emu *emu)
+{
+	rte_mb();
+	emu->quiesce = 0;
+}
+
+static void
+avp_emu_fifo_init(struct avp_emu *emu, void *fifo, unsigned int len,
+		  int ring)
+{
+	struct rte_avp_fifo_v3 *fifo_v3 = fifo;
+	struct rte_avp_fifo *fifo_v2 = fifo;
+	struct rte_avp_ring *desc_ring = fifo;
+
+	memset(fifo, 0, AVP_EMU_FIFO_SIZE(len));
+	if (ring && (emu->major >= RTE_AVP_MAJOR_VERSION_4)) {
+		desc_ring->len = len;
+		desc_ring->elem_size = sizeof(struct rte_avp_cdesc);
+	} else if (emu->major >= RTE_AVP_MAJOR_VERSION_3) {
+		fifo_v3->len = len;
+		fifo_v3->elem_size = sizeof(void *);
+	} else {
+		fifo_v2->len = len;
+		fifo_v2->elem_size = sizeof(void *);
+	}
+}
+
+static inline phys_addr_t
+avp_emu_phys(struct avp_emu *emu, const void *addr)
+{
+	return emu->memory_phys + RTE_PTR_DIFF(addr, emu->memory);
+}
+
+/*
+ * carve the host memory region into fifos and buffers and return its size.
+ * Called with a NULL region to size it before it is reserved.
+ */
+static size_t
+avp_emu_layout(struct avp_emu *emu, uint8_t *memory)
+{
+	const size_t fifo_size = AVP_EMU_FIFO_SIZE(AVP_EMU_FIFO_LEN);
+	const size_t req_size = AVP_EMU_FIFO_SIZE(AVP_EMU_REQ_FIFO_LEN);
+	uint8_t *addr = memory;
+	unsigned int i;
+
+	emu->req_q = addr;
+	addr += req_size;
+	emu->resp_q = addr;
+	addr += req_size;
+	emu->sync = (struct rte_avp_request *)addr;
+	addr += RTE_ALIGN(sizeof(struct rte_avp_request), RTE_CACHE_LINE_SIZE);
+
+	for (i = 0; i < emu->nb_queues; i++, addr += fifo_size)
+		emu->tx_q[i] = addr;
+	for (i = 0; i < emu->nb_queues; i++, addr += fifo_size)
+		emu->rx_q[i] = addr;
+	for (i = 0; i < emu->nb_queues; i++, addr += fifo_size)
+		emu->alloc_q[i] = addr;
+	for (i = 0; i < emu->nb_queues; i++, addr += fifo_size)
+		emu->free_q[i] = addr;
+
+	emu->pool = addr;
+	addr += (size_t)emu->nb_bufs * AVP_EMU_BUF_STRIDE;
+
+	return RTE_PTR_DIFF(addr, memory);
+}
+
+/* build the packet sent in source mode; a UDP datagram to the guest */
+static void
+avp_emu_template_init(struct avp_emu *emu)
+{
+	struct ether_hdr *eth = (struct ether_hdr *)emu->template;
+	struct ipv4_hdr *ip = (struct ipv4_hdr *)(eth + 1);
+	struct udp_hdr *udp = (struct udp_hdr *)(ip + 1);
+	uint16_t ip_len = emu->pkt_len - sizeof(*eth);
+
+	memset(emu->template, 0, sizeof(emu->template));
+	memcpy(&eth->d_addr, emu->info->ethaddr, ETHER_ADDR_LEN);
+	memcpy(&eth->s_addr, avp_emu_peer_ethaddr, ETHER_ADDR_LEN);
+	eth->ether_type = rte_cpu_to_be_16(ETHER_TYPE_IPv4);
+
+	ip->version_ihl = 0x45;
+	ip->total_length = rte_cpu_to_be_16(ip_len);
+	ip->fragment_offset = rte_cpu_to_be_16(IPV4_HDR_DF_FLAG);
+	ip->time_to_live = 64;
+	ip->next_proto_id = IPPROTO_UDP;
+	ip->src_addr = rte_cpu_to_be_32(0xc0a80002); /* 192.168.0.2 */
+	ip->dst_addr = rte_cpu_to_be_32(0xc0a80001); /* 192.168.0.1 */
+	ip->hdr_checksum = rte_ipv4_cksum(ip);
+
+	udp->src_port = rte_cpu_to_be_16(9);
+	udp->dst_port = rte_cpu_to_be_16(9);
+	udp->dgram_len = rte_cpu_to_be_16(ip_len - sizeof(*ip));
+}
+
+/*
+ * Initialize the host memory and device information as a freshly created
+ * host device.  Any buffer still referenced by the guest is forgotten.
+ */
+static void
+avp_emu_host_init(struct avp_emu *emu)
+{
+	struct rte_avp_device_info *info = emu->info;
+	const size_t fifo_size = AVP_EMU_FIFO_SIZE(AVP_EMU_FIFO_LEN);
+	unsigned int i;
+
+	avp_emu_fifo_init(emu, emu->req_q, AVP_EMU_REQ_FIFO_LEN, 0);
+	avp_emu_fifo_init(emu, emu->resp_q, AVP_EMU_REQ_FIFO_LEN, 0);
+	memset(emu->sync, 0, sizeof(*emu->sync));
+	for (i = 0; i < emu->nb_queues; i++) {
+		avp_emu_fifo_init(emu, emu->tx_q[i], AVP_EMU_FIFO_LEN, 1);
+		avp_emu_fifo_init(emu, emu->rx_q[i], AVP_EMU_FIFO_LEN, 1);
+		avp_emu_fifo_init(emu, emu->alloc_q[i], AVP_EMU_FIFO_LEN, 1);
+		avp_emu_fifo_init(emu, emu->free_q[i], AVP_EMU_FIFO_LEN, 1);
+	}
+
+	/* lowest indices on top so that buffers are handed out in order */
+	for (i = 0; i < emu->nb_bufs; i++)
+		emu->free_ids[i] = emu->nb_bufs - i - 1;
+	emu->nb_free = emu->nb_bufs;
+
+	emu->nb_rx = emu->nb_queues;
+	emu->if_up = 0;
+	emu->features = 0;
+
+	memset(info, 0, sizeof(*info));
+	info->magic = RTE_AVP_DEVICE_MAGIC;
+	info->version = RTE_AVP_MAKE_VERSION(RTE_AVP_RELEASE_VERSION_1,
+					     emu->major,
+					     RTE_AVP_MINOR_VERSION_0);
+	snprintf(info->ifname, sizeof(info->ifname), "%s", emu->name);
+
+	info->tx_phys = avp_emu_phys(emu, emu->tx_q[0]);
+	info->rx_phys = avp_emu_phys(emu, emu->rx_q[0]);
+	info->alloc_phys = avp_emu_phys(emu, emu->alloc_q[0]);
+	info->free_phys = avp_emu_phys(emu, emu->free_q[0]);
+	info->tx_size = fifo_size;
+	info->rx_size = fifo_size;
+	info->alloc_size = fifo_size;
+	info->free_size = fifo_size;
+
+	info->features = RTE_AVP_FEATURE_VLAN_OFFLOAD;
+	info->min_tx_queues = 1;
+	info->num_tx_queues = emu->nb_queues;
+	info->max_tx_queues = emu->nb_queues;
+	info->min_rx_queues = 1;
+	info->num_rx_queues = emu->nb_queues;
+	info->max_rx_queues = emu->nb_queues;
+
+	info->req_phys = avp_emu_phys(emu, emu->req_q);
+	info->resp_phys = avp_emu_phys(emu, emu->resp_q);
+	info->sync_phys = avp_emu_phys(emu, emu->sync);
+	info->sync_va = emu->sync;
+
+	info->mbuf_va = emu->pool;
+	info->mbuf_phys = avp_emu_phys(emu, emu->pool);
+	info->pool[0].addr = emu->pool;
+	info->pool[0].phys_addr = info->mbuf_phys;
+	info->pool[0].length = (uint64_t)emu->nb_bufs * AVP_EMU_BUF_STRIDE;
+
+	memcpy(info->ethaddr, avp_emu_ethaddr, ETHER_ADDR_LEN);
+	info->ethaddr[ETHER_ADDR_LEN - 1] = emu->pci_dev.addr.devid;
+	info->mode = RTE_AVP_MODE_GUEST;
+	info->mbuf_size = AVP_EMU_BUF_SIZE;
+	info->device_id = ++emu->device_id;
+	info->max_rx_pkt_len = emu->mru;
+	if (emu->major >= RTE_AVP_MAJOR_VERSION_4)
+		info->buf_stride = AVP_EMU_BUF_STRIDE;
+
+	avp_emu_template_init(emu);
+}
+
+static inline uint32_t
+avp_emu_read32(struct avp_emu *emu, unsigned int offset)
+{
+	return *(volatile uint32_t *)RTE_PTR_ADD(emu->registers, offset);
+}
+
+static inline void
+avp_emu_write32(struct avp_emu *emu, unsigned int offset, uint32_t value)
+{
+	*(volatile uint32_t *)RTE_PTR_ADD(emu->registers, offset) = value;
+}
+
+/*
+ * Set the migration status register and raise the migration interrupt.  The
+ * interrupt handler of the PMD runs on the calling thread and acknowledges
+ * the new status before returning.
+ */
+static int
+avp_emu_migration_signal(struct avp_emu *emu, uint32_t status)
+{
+	uint32_t mask;
+	uint32_t ack;
+	int ret;
+
+	mask = avp_emu_read32(emu, RTE_AVP_INTERRUPT_MASK_OFFSET);
+	if (!(mask & RTE_AVP_MIGRATION_INTERRUPT_MASK)) {
+		PMD_DRV_LOG(ERR, "Migration interrupts are disabled on %s\n",
+			    emu->name);
+		return -EIO;
+	}
+
+	avp_emu_write32(emu, RTE_AVP_MIGRATION_ACK_OFFSET,
+			RTE_AVP_MIGRATION_NONE);
+	avp_emu_write32(emu, RTE_AVP_MIGRATION_STATUS_OFFSET, status);
+	avp_emu_write32(emu, RTE_AVP_INTERRUPT_STATUS_OFFSET,
+			RTE_AVP_MIGRATION_INTERRUPT_MASK);
+	rte_mb();
+
+	ret = avp_dev_emu_interrupt(emu->name);
+
+	/* the status register clears on read */
+	avp_emu_write32(emu, RTE_AVP_INTERRUPT_STATUS_OFFSET, 0);
+	if (ret < 0)
+		return ret;
+
+	ack = avp_emu_read32(emu, RTE_AVP_MIGRATION_ACK_OFFSET);
+	if (ack != status) {
+		PMD_DRV_LOG(ERR, "Migration status %u of %s acknowledged with %u\n",
+			    status, emu->name, ack);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+static struct avp_emu *
+avp_emu_lookup(uint8_t port_id)
+{
+	struct rte_eth_dev *eth_dev;
+	struct avp_emu *emu;
+
+	if (!rte_eth_dev_is_valid_port(port_id))
+		return NULL;
+
+	eth_dev = &rte_eth_devices[port_id];
+	TAILQ_FOREACH(emu, &avp_emu_list, next)
+		if (strcmp(emu->name, eth_dev->data->name) == 0)
+			return emu;
+
+	return NULL;
+}
+
+int
+rte_pmd_avp_emu_detach(uint8_t port_id)
+{
+	struct avp_emu *emu = avp_emu_lookup(port_id);
+
+	if (emu == NULL)
+		return -ENODEV;
+
+	return avp_emu_migration_signal(emu, RTE_AVP_MIGRATION_DETACHED);
+}
+
+int
+rte_pmd_avp_emu_attach(uint8_t port_id, unsigned int version)
+{
+	struct avp_emu *emu = avp_emu_lookup(port_id);
+
+	if (emu == NULL)
+		return -ENODEV;
+
+	if (avp_emu_read32(emu, RTE_AVP_MIGRATION_STATUS_OFFSET) !=
+	    RTE_AVP_MIGRATION_DETACHED)
+		return -EINVAL;
+
+	if ((version != 0) &&
+	    ((version < RTE_AVP_MAJOR_VERSION_2) ||
+	     (version > RTE_AVP_MAJOR_VERSION)))
+		return -EINVAL;
+
+	/* the guest now attaches to a different host */
+	avp_emu_quiesce(emu);
+	if (version != 0)
+		emu->major = version;
+	avp_emu_host_init(emu);
+	avp_emu_resume(emu);
+
+	return avp_emu_migration_signal(emu, RTE_AVP_MIGRATION_ATTACHED);
+}
+
+int
+rte_pmd_avp_emu_stats_get(uint8_t port_id,
+			  struct rte_pmd_avp_emu_stats *stats)
+{
+	struct avp_emu *emu = avp_emu_lookup(port_id);
+
+	if (emu == NULL)
+		return -ENODEV;
+	if (stats == NULL)
+		return -EINVAL;
+
+	*stats = emu->stats;
+	return 0;
+}
+
+static int
+avp_emu_parse_uint(const char *key, const char *value, void *extra_args)
+{
+	unsigned int *result = extra_args;
+	unsigned long n;
+	char *end;
+
+	errno = 0;
+	n = strtoul(value, &end, 0);
+	if ((errno != 0) || (end == value) || (*end != '\0') ||
+	    (n > UINT32_MAX)) {
+		PMD_DRV_LOG(ERR, "Invalid %s value %s\n", key, value);
+		return -EINVAL;
+	}
+
+	*result = n;
+	return 0;
+}
+
+static int
+avp_emu_parse_mode(const char *key, const char *value, void *extra_args)
+{
+	enum avp_emu_mode *mode = extra_args;
+	unsigned int i;
+
+	for (i = 0; i < AVP_EMU_MODE_MAX; i++) {
+		if (strcmp(value, avp_emu_mode_names[i]) == 0) {
+			*mode = i;
+			return 0;
+		}
+	}
+
+	PMD_DRV_LOG(ERR, "Invalid %s value %s\n", key, value);
+	return -EINVAL;
+}
+
+/*
+ * Split the device arguments into those of the emulator and those that are
+ * passed on to the PMD through the devargs of the emulated PCI device.
+ */
+static int
+avp_emu_parse_args(struct avp_emu *emu, const char *args)
+{
+	char host_args[sizeof(emu->devargs.args)];
+	struct rte_kvargs *kvlist;
+	unsigned int cpu = UINT32_MAX;
+	const char *arg, *end;
+	size_t host_len = 0;
+	size_t pmd_len = 0;
+	size_t key_len;
+	char *dst;
+	size_t *len;
+	unsigned int i;
+	int ret;
+
+	emu->mode = AVP_EMU_LOOPBACK;
+	emu->major = RTE_AVP_MAJOR_VERSION;
+	emu->nb_queues = 1;
+	emu->nb_bufs = AVP_EMU_DEFAULT_BUFFERS;
+	emu->pkt_len = AVP_EMU_DEFAULT_PKT_LEN;
+	emu->cpu = -1;
+	emu->mru = AVP_EMU_MAX_RX_PKT_LEN;
+
+	host_args[0] = '\0';
+	emu->devargs.args[0] = '\0';
+	for (arg = args; (arg != NULL) && (*arg != '\0'); arg = end) {
+		end = strchr(arg, ',');
+		end = (end == NULL) ? (arg + strlen(arg)) : end;
+		key_len = strcspn(arg, "=,");
+
+		dst = emu->devargs.args;
+		len = &pmd_len;
+		for (i = 0; avp_emu_valid_arguments[i] != NULL; i++) {
+			if ((strlen(avp_emu_valid_arguments[i]) == key_len) &&
+			    (strncmp(arg, avp_emu_valid_arguments[i],
+				     key_len) == 0)) {
+				dst = host_args;
+				len = &host_len;
+				break;
+			}
+		}
+
+		if ((*len + (end - arg) + 2) > sizeof(host_args))
+			return -E2BIG;
+		*len += sprintf(dst + *len, "%s%.*s", (*len == 0) ? "" : ",",
+				(int)(end - arg), arg);
+
+		if (*end == ',')
+			end++;
+	}
+
+	kvlist = rte_kvargs_parse(host_args, avp_emu_valid_arguments);
+	if (kvlist == NULL)
+		return -EINVAL;
+
+	ret = rte_kvargs_process(kvlist, AVP_EMU_MODE_ARG,
+				 avp_emu_parse_mode, &emu->mode);
+	if (ret == 0)
+		ret = rte_kvargs_process(kvlist, AVP_EMU_VERSION_ARG,
+					 avp_emu_parse_uint, &emu->major);
+	if (ret == 0)
+		ret = rte_kvargs_process(kvlist, AVP_EMU_QUEUES_ARG,
+					 avp_emu_parse_uint, &emu->nb_queues);
+	if (ret == 0)
+		ret = rte_kvargs_process(kvlist, AVP_EMU_BUFFERS_ARG,
+					 avp_emu_parse_uint, &emu->nb_bufs);
+	if (ret == 0)
+		ret = rte_kvargs_process(kvlist, AVP_EMU_PKT_LEN_ARG,
+					 avp_emu_parse_uint, &emu->pkt_len);
+	if (ret == 0)
+		ret = rte_kvargs_process(kvlist, AVP_EMU_CPU_ARG,
+					 avp_emu_parse_uint, &cpu);
+	if (ret == 0)
+		ret = rte_kvargs_process(kvlist, AVP_EMU_MRU_ARG,
+					 avp_emu_parse_uint, &emu->mru);
+	rte_kvargs_free(kvlist);
+	if (ret < 0)
+		return -EINVAL;
+
+	if ((emu->major < RTE_AVP_MAJOR_VERSION_2) ||
+	    (emu->major > RTE_AVP_MAJOR_VERSION)) {
+		PMD_DRV_LOG(ERR, "Unsupported AVP version %u\n", emu->major);
+		return -EINVAL;
+	}
+
+	if ((emu->nb_queues == 0) || (emu->nb_queues > RTE_AVP_MAX_QUEUES)) {
+		PMD_DRV_LOG(ERR, "Invalid number of queues %u\n",
+			    emu->nb_queues);
+		return -EINVAL;
+	}
+
+	/* every alloc fifo must be kept full with buffers to spare */
+	if ((emu->nb_bufs < (2 * emu->nb_queues * AVP_EMU_ALLOC_LEVEL)) ||
+	    (emu->nb_bufs > RTE_AVP_CDESC_INDEX_MASK)) {
+		PMD_DRV_LOG(ERR, "Invalid number of buffers %u\n",
+			    emu->nb_bufs);
+		return -EINVAL;
+	}
+
+	if ((emu->pkt_len < AVP_EMU_DEFAULT_PKT_LEN) ||
+	    (emu->pkt_len > AVP_EMU_BUF_SIZE)) {
+		PMD_DRV_LOG(ERR, "Invalid packet length %u\n", emu->pkt_len);
+		return -EINVAL;
+	}
+
+	if ((emu->mru < ETHER_MIN_LEN) || (emu->mru > AVP_EMU_MAX_RX_PKT_LEN)) {
+		PMD_DRV_LOG(ERR, "Invalid maximum receive unit %u\n", emu->mru);
+		return -EINVAL;
+	}
+
+	if (cpu != UINT32_MAX) {
+		if (cpu >= CPU_SETSIZE) {
+			PMD_DRV_LOG(ERR, "Invalid cpu %u\n", cpu);
+			return -EINVAL;
+		}
+		emu->cpu = cpu;
+	}
+
+	return 0;
+}
+
+static int
+avp_emu_regions_create(struct avp_emu *emu)
+{
+	char name[RTE_MEMZONE_NAMESIZE];
+	const struct rte_memzone *mz;
+	size_t size[AVP_EMU_NB_REGIONS];
+	unsigned int bar;
+	unsigned int i;
+	int socket_id;
+
+	size[AVP_EMU_MMIO] = AVP_EMU_MMIO_SIZE;
+	size[AVP_EMU_DEVICE] = sizeof(struct rte_avp_device_info);
+	size[AVP_EMU_MEMMAP] = sizeof(struct rte_avp_memmap_info);
+	size[AVP_EMU_MEMORY] = avp_emu_layout(emu, NULL);
+
+	socket_id = emu->pci_dev.device.numa_node;
+	for (i = 0; i < AVP_EMU_NB_REGIONS; i++) {
+		if (snprintf(name, sizeof(name), "%s_%s", emu->name,
+			     avp_emu_region_names[i]) >= (int)sizeof(name))
+			return -ENAMETOOLONG;
+
+		mz = rte_memzone_reserve_aligned(name, size[i], socket_id, 0,
+						 RTE_CACHE_LINE_SIZE);
+		if (mz == NULL) {
+			PMD_DRV_LOG(ERR, "Failed to reserve %zu bytes for %s\n",
+				    size[i], name);
+			return -ENOMEM;
+		}
+		emu->mz[i] = mz;
+		memset(mz->addr, 0, size[i]);
+
+		bar = avp_emu_region_bar[i];
+		emu->pci_dev.mem_resource[bar].addr = mz->addr;
+		emu->pci_dev.mem_resource[bar].phys_addr = mz->phys_addr;
+		emu->pci_dev.mem_resource[bar].len = size[i];
+	}
+
+	emu->registers = emu->mz[AVP_EMU_MMIO]->addr;
+	emu->info = emu->mz[AVP_EMU_DEVICE]->addr;
+	emu->memmap = emu->mz[AVP_EMU_MEMMAP]->addr;
+	emu->memory = emu->mz[AVP_EMU_MEMORY]->addr;
+	emu->memory_phys = emu->mz[AVP_EMU_MEMORY]->phys_addr;
+	avp_emu_layout(emu, emu->memory);
+
+	/* the whole memory BAR is a single host region */
+	emu->memmap->magic = RTE_AVP_MEMMAP_MAGIC;
+	emu->memmap->version = RTE_AVP_MEMMAP_VERSION;
+	emu->memmap->nb_maps = 1;
+	emu->memmap->maps[0].addr = emu->memory;
+	emu->memmap->maps[0].phys_addr = emu->memory_phys;
+	emu->memmap->maps[0].length = size[AVP_EMU_MEMORY];
+
+	return 0;
+}
+
+static void
+avp_emu_free(struct avp_emu *emu)
+{
+	unsigned int i;
+
+	for (i = 0; i < AVP_EMU_NB_REGIONS; i++)
+		if (emu->mz[i] != NULL)
+			rte_memzone_free(emu->mz[i]);
+	rte_free(emu->free_ids);
+	rte_free(emu);
+}
+
+static int
+avp_emu_thread_start(struct avp_emu *emu)
+{
+	cpu_set_t cpuset;
+	int ret;
+
+	ret = pthread_create(&emu->thread, NULL, avp_emu_service, emu);
+	if (ret != 0)
+		return -ret;
+
+	if (emu->cpu < 0)
+		return 0;
+
+	CPU_ZERO(&cpuset);
+	CPU_SET(emu->cpu, &cpuset);
+	ret = pthread_setaffinity_np(emu->thread, sizeof(cpuset), &cpuset);
+	if (ret != 0)
+		PMD_DRV_LOG(WARNING, "Failed to bind %s to cpu %d, ret=%d\n",
+			    emu->name, emu->cpu, ret);
+
+	return 0;
+}
+
+static void
+avp_emu_thread_stop(struct avp_emu *emu)
+{
+	emu->stop = 1;
+	rte_mb();
+	pthread_join(emu->thread, NULL);
+}
+
+static int
+avp_emu_probe(struct rte_vdev_device *vdev)
+{
+	const char *name = rte_vdev_device_name(vdev);
+	static uint8_t instance;
+	struct avp_emu *emu;
+	int ret;
+
+	PMD_DRV_LOG(NOTICE, "Creating emulated AVP device %s\n", name);
+
+	emu = rte_zmalloc_socket(name, sizeof(*emu), RTE_CACHE_LINE_SIZE,
+				 vdev->device.numa_node);
+	if (emu == NULL)
+		return -ENOMEM;
+
+	snprintf(emu->name, sizeof(emu->name), "%s", name);
+	ret = avp_emu_parse_args(emu, rte_vdev_device_args(vdev));
+	if (ret < 0)
+		goto error;
+
+	emu->free_ids = rte_malloc_socket(name,
+					  emu->nb_bufs * sizeof(uint32_t), 0,
+					  vdev->device.numa_node);
+	if (emu->free_ids == NULL) {
+		ret = -ENOMEM;
+		goto error;
+	}
+
+	/* a PCI device that is not bound to any kernel driver */
+	emu->pci_dev.device.numa_node = vdev->device.numa_node;
+	emu->pci_dev.device.devargs = &emu->devargs;
+	emu->pci_dev.id.vendor_id = RTE_AVP_PCI_VENDOR_ID;
+	emu->pci_dev.id.device_id = RTE_AVP_PCI_DEVICE_ID;
+	emu->pci_dev.id.subsystem_vendor_id = RTE_AVP_PCI_SUB_VENDOR_ID;
+	emu->pci_dev.id.subsystem_device_id = RTE_AVP_PCI_SUB_DEVICE_ID;
+	emu->pci_dev.addr.devid = instance++;
+	emu->pci_dev.kdrv = RTE_KDRV_NONE;
+	emu->pci_dev.intr_handle.fd = -1;
+	emu->pci_dev.intr_handle.type = RTE_INTR_HANDLE_UNKNOWN;
+
+	ret = avp_emu_regions_create(emu);
+	if (ret < 0)
+		goto error;
+
+	avp_emu_host_init(emu);
+
+	ret = avp_emu_thread_start(emu);
+	if (ret < 0)
+		goto error;
+
+	ret = avp_dev_emu_probe(name, &emu->pci_dev);
+	if (ret < 0) {
+		avp_emu_thread_stop(emu);
+		goto error;
+	}
+
+	TAILQ_INSERT_TAIL(&avp_emu_list, emu, next);
+	return 0;
+
+error:
+	PMD_DRV_LOG(ERR, "Failed to create emulated AVP device %s, ret=%d\n",
+		    name, ret);
+	avp_emu_free(emu);
+	return ret;
+}
+
+static int
+avp_emu_remove(struct rte_vdev_device *vdev)
+{
+	const char *name = rte_vdev_device_name(vdev);
+	struct avp_emu *emu;
+	int ret;
+
+	TAILQ_FOREACH(emu, &avp_emu_list, next)
+		if (strcmp(emu->name, name) == 0)
+			break;
+	if (emu == NULL)
+		return -ENODEV;
+
+	ret = avp_dev_emu_remove(name);
+	if (ret < 0)
+		return ret;
+
+	TAILQ_REMOVE(&avp_emu_list, emu, next);
+	avp_emu_thread_stop(emu);
+	avp_emu_free(emu);
+	return 0;
+}
+
+static struct rte_vdev_driver avp_emu_driver = {
+	.probe = avp_emu_probe,
+	.remove = avp_emu_remove,
+};
+
+RTE_PMD_REGISTER_VDEV(net_avp_emu, avp_emu_driver);
+RTE_PMD_REGISTER_PARAM_STRING(net_avp_emu,
+			      AVP_EMU_MODE_ARG "=<loopback|sink|source> "
+			      AVP_EMU_VERSION_ARG "=<2|3|4> "
+			      AVP_EMU_QUEUES_ARG "=<1-8> "
+			      AVP_EMU_BUFFERS_ARG "=<count> "
+			      AVP_EMU_PKT_LEN_ARG "=<60-2048> "
+			      AVP_EMU_CPU_ARG "=<cpu> "
+			      AVP_EMU_MRU_ARG "=<64-9238>");
+#endif /* AVP_EMU */
@@ -0,0 +1,75 @@
+/*
+ * BSD LICENSE
+ *
+ * Copyright (c) 2017, Wind River Systems, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1) Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2) Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3) Neither the name of Wind River Systems nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _AVP_EMU_H_
+#define _AVP_EMU_H_
+
+#include <rte_version.h>
+
+#if defined(RTE_LIBRTE_AVP_EMU) && \
+	(RTE_VERSION >= RTE_VERSION_NUM(17, 5, 0, 0))
+/*
+ * The host emulator is built with CONFIG_RTE_LIBRTE_AVP_EMU=y and registers a
+ * virtual device with the 17.05 vdev API
+ */
+#define AVP_EMU 1
+#endif
+
+struct rte_pci_device;
+
+/**
+ * Create an ethdev for an emulated AVP device.  The PCI device is owned by
+ * the emulator; its memory resources reference the emulated BARs and its
+ * kdrv is RTE_KDRV_NONE since there are no interrupts to enable.
+ *
+ * @param name
+ *   Name of the ethdev; i.e., of the virtual device.
+ * @param pci_dev
+ *   The emulated PCI device.
+ * @return
+ *   0 on success, a negative errno value otherwise.
+ */
+int avp_dev_emu_probe(const char *name, struct rte_pci_device *pci_dev);
+
+/**
+ * Release the ethdev of an emulated AVP device.
+ */
+int avp_dev_emu_remove(const char *name);
+
+/**
+ * Deliver an interrupt to the ethdev of an emulated AVP device as if it was
+ * raised on its migration MSI-X vector.  Runs the interrupt handler on the
+ * calling thread.
+ */
+int avp_dev_emu_interrupt(const char *name);
+
+#endif /* _AVP_EMU_H_ */
@@ -33,6 +33,7 @@
 #include <stdint.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <errno.h>
 #include <unistd.h>
 #include <sys/io.h>
@@ -52,11 +53,21 @@
 #include <rte_byteorder.h>
 #include <rte_memory.h>
 #include <rte_eal.h>
+#include <rte_kvargs.h>
+#include <rte_alarm.h>
 
 #include "rte_avp_common.h"
 #include "rte_avp_fifo.h"
+#include "rte_pmd_avp.h"
 
 #include "avp_logs.h"
+#include "avp_rss.h"
+#include "avp_gro.h"
+#include "avp_copy.h"
+#include "avp_emu.h"
+#ifdef AVP_COPY_HAVE_AVX512
+#include <rte_cpuflags.h>
+#endif
 
 #include <rte_version.h>
 #if RTE_VERSION >= RTE_VERSION_NUM(1, 7, 0, 0)
@@ -65,6 +76,9 @@
 #if RTE_VERSION >= RTE_VERSION_NUM(17, 2, 0, 0)
 #include <rte_io.h>
 #endif
+#if RTE_VERSION >= RTE_VERSION_NUM(17, 5, 0, 0)
+#include <rte_pause.h>
+#endif
 #if RTE_VERSION < RTE_VERSION_NUM(17, 2, 0, 0)
 #include "rte_avp_mbuf.h"
 #endif
@@ -96,6 +110,69 @@
 
 #endif
 
+#if RTE_VERSION >= RTE_VERSION_NUM(17, 2, 0, 0)
+#define avp_pktmbuf_alloc_bulk(p, m, n) rte_pktmbuf_alloc_bulk(p, m, n)
+#define avp_pktmbuf_prefree_seg(m) rte_pktmbuf_prefree_seg(m)
+#else
+#define avp_pktmbuf_alloc_bulk(p, m, n) wrs_pktmbuf_alloc_bulk(p, m, n)
+#define avp_pktmbuf_prefree_seg(m) __rte_pktmbuf_prefree_seg(m)
+#endif
+
+#if RTE_VERSION >= RTE_VERSION_NUM(17, 5, 0, 0)
+/* Device arguments are reachable from the generic device */
+#define AVP_DEVARGS 1
+/*
+ * Zero-copy buffers depend on free mbufs keeping a reference count of 1 while
+ * they sit in their mempool.
+ */
+#define AVP_ZERO_COPY 1
+/* The telemetry page is enabled through a device argument */
+#define AVP_TELEMETRY 1
+/* Transmit fifos may be shared by several queues (tx_mp argument) */
+#define AVP_TX_MP 1
+#endif
+
+#if RTE_VERSION >= RTE_VERSION_NUM(2, 1, 0, 0)
+/* Receive queue interrupts are delivered through per queue event fds */
+#define AVP_RX_INTR 1
+#endif
+
+#if RTE_VERSION >= RTE_VERSION_NUM(16, 7, 0, 0)
+/* Extended statistics are reported by name and value separately */
+#define AVP_XSTATS 1
+#endif
+
+#if (RTE_VERSION >= RTE_VERSION_NUM(17, 5, 0, 0)) && \
+	defined(RTE_MACHINE_CPUFLAG_SSSE3)
+/*
+ * The vector receive path relies on free mbufs having their next and nb_segs
+ * fields reset while they sit in their mempool.
+ */
+#define AVP_VECTOR_RX 1
+#include <rte_vect.h>
+#endif
+
+#ifdef RTE_LIBRTE_AVP_STAGE_CYCLES
+/*
+ * Charge the TSC cycles elapsed since the previous mark of a burst to a
+ * stage.  Bursts that return before their first mark are not accounted.
+ */
+#define AVP_STAGE_START(q, tsc) ((tsc) = rte_rdtsc())
+#define AVP_STAGE_MARK(q, tsc, stage) do { \
+		uint64_t _now = rte_rdtsc(); \
+		(q)->stages.cycles[(stage)] += _now - (tsc); \
+		(tsc) = _now; \
+	} while (0)
+#define AVP_STAGE_END(q, tsc) do { \
+		AVP_STAGE_MARK(q, tsc, RTE_PMD_AVP_STAGE_FIFO_PUT); \
+		(q)->stages.bursts++; \
+	} while (0)
+#else
+#define AVP_STAGE_START(q, tsc) do { } while (0)
+#define AVP_STAGE_MARK(q, tsc, stage) do { } while (0)
+#define AVP_STAGE_END(q, tsc) do { } while (0)
+#endif
+
 static int avp_dev_create(struct rte_pci_device *pci_dev,
 			  struct rte_eth_dev *eth_dev);
 
@@ -110,6 +187,31 @@ static int avp_dev_link_update(struct rte_eth_dev *dev,
 			       __rte_unused int wait_to_complete);
 static void avp_dev_promiscuous_enable(struct rte_eth_dev *dev);
 static void avp_dev_promiscuous_disable(struct rte_eth_dev *dev);
+static void avp_dev_allmulticast_enable(struct rte_eth_dev *dev);
+static void avp_dev_allmulticast_disable(struct rte_eth_dev *dev);
+#if RTE_VERSION >= RTE_VERSION_NUM(17, 5, 0, 0)
+static int avp_dev_mac_addr_add(struct rte_eth_dev *dev,
+				struct ether_addr *mac_addr,
+				uint32_t index, uint32_t vmdq);
+#else
+static void avp_dev_mac_addr_add(struct rte_eth_dev *dev,
+				 struct ether_addr *mac_addr,
+				 uint32_t index, uint32_t vmdq);
+#endif
+static void avp_dev_mac_addr_remove(struct rte_eth_dev *dev, uint32_t index);
+static int avp_dev_set_mc_addr_list(struct rte_eth_dev *dev,
+				    struct ether_addr *mc_addr_set,
+				    uint32_t nb_mc_addr);
+static int avp_dev_reta_update(struct rte_eth_dev *dev,
+			       struct rte_eth_rss_reta_entry64 *reta_conf,
+			       uint16_t reta_size);
+static int avp_dev_reta_query(struct rte_eth_dev *dev,
+			      struct rte_eth_rss_reta_entry64 *reta_conf,
+			      uint16_t reta_size);
+static int avp_dev_rss_hash_update(struct rte_eth_dev *dev,
+				   struct rte_eth_rss_conf *rss_conf);
+static int avp_dev_rss_hash_conf_get(struct rte_eth_dev *dev,
+				     struct rte_eth_rss_conf *rss_conf);
 
 static int avp_dev_rx_queue_setup(struct rte_eth_dev *dev,
 				  uint16_t rx_queue_id,
@@ -124,28 +226,78 @@ static int avp_dev_tx_queue_setup(struct rte_eth_dev *dev,
 				  unsigned int socket_id,
 				  const struct rte_eth_txconf *tx_conf);
 
+#ifdef AVP_RX_INTR
+static int avp_dev_rx_queue_intr_enable(struct rte_eth_dev *dev,
+					uint16_t rx_queue_id);
+static int avp_dev_rx_queue_intr_disable(struct rte_eth_dev *dev,
+					 uint16_t rx_queue_id);
+static void avp_dev_rx_intr_wakeup(struct rte_eth_dev *dev);
+#endif
+
 static uint16_t avp_recv_scattered_pkts(void *rx_queue,
 					struct rte_mbuf **rx_pkts,
 					uint16_t nb_pkts);
 
-static uint16_t avp_recv_pkts(void *rx_queue,
-			      struct rte_mbuf **rx_pkts,
-			      uint16_t nb_pkts);
+static uint16_t avp_recv_pkts_cdesc(void *rx_queue,
+				    struct rte_mbuf **rx_pkts,
+				    uint16_t nb_pkts);
+
+static uint16_t avp_recv_pkts_multi(void *rx_queue,
+				    struct rte_mbuf **rx_pkts,
+				    uint16_t nb_pkts);
+
+static uint16_t avp_recv_pkts_gro(void *rx_queue,
+				  struct rte_mbuf **rx_pkts,
+				  uint16_t nb_pkts);
+
+static uint16_t avp_xmit_pkts_hold(void *tx_queue,
+				   struct rte_mbuf **tx_pkts,
+				   uint16_t nb_pkts);
+
+#ifdef AVP_ZERO_COPY
+static uint16_t avp_recv_pkts_zc(void *rx_queue,
+				 struct rte_mbuf **rx_pkts,
+				 uint16_t nb_pkts);
+
+static uint16_t avp_xmit_pkts_zc(void *tx_queue,
+				 struct rte_mbuf **tx_pkts,
+				 uint16_t nb_pkts);
+#endif
 
 static uint16_t avp_xmit_scattered_pkts(void *tx_queue,
 					struct rte_mbuf **tx_pkts,
 					uint16_t nb_pkts);
 
-static uint16_t avp_xmit_pkts(void *tx_queue,
-			      struct rte_mbuf **tx_pkts,
-			      uint16_t nb_pkts);
+static uint16_t avp_xmit_pkts_cdesc(void *tx_queue,
+				    struct rte_mbuf **tx_pkts,
+				    uint16_t nb_pkts);
+
+#ifdef AVP_TX_MP
+static uint16_t avp_xmit_pkts_mp(void *tx_queue,
+				 struct rte_mbuf **tx_pkts,
+				 uint16_t nb_pkts);
+
+static uint16_t avp_xmit_pkts_cdesc_mp(void *tx_queue,
+				       struct rte_mbuf **tx_pkts,
+				       uint16_t nb_pkts);
+#endif
 
 static void avp_dev_rx_queue_release(void *rxq);
 static void avp_dev_tx_queue_release(void *txq);
 
+static void avp_dev_set_burst_functions(struct rte_eth_dev *eth_dev);
+
 static void avp_dev_stats_get(struct rte_eth_dev *dev,
 			      struct rte_eth_stats *stats);
 static void avp_dev_stats_reset(struct rte_eth_dev *dev);
+#ifdef AVP_XSTATS
+static int avp_dev_xstats_get(struct rte_eth_dev *dev,
+			      struct rte_eth_xstat *xstats, unsigned int n);
+static int avp_dev_xstats_get_names(struct rte_eth_dev *dev,
+				    struct rte_eth_xstat_name *names,
+				    unsigned int limit);
+static void avp_dev_xstats_reset(struct rte_eth_dev *dev);
+#endif
 
 
 #if RTE_VERSION < RTE_VERSION_NUM(17, 2, 0, 0)
@@ -154,24 +306,115 @@ static void avp_dev_stats_reset(struct rte_eth_dev *dev);
 #define AVP_DEV_TO_PCI(eth_dev) RTE_DEV_TO_PCI((eth_dev)->device)
 #endif
 
+#ifdef AVP_EMU
+/*
+ * Emulated devices are not bound to a kernel driver and have no interrupt
+ * source; their interrupts are delivered by avp_dev_emu_interrupt().
+ */
+#define AVP_DEV_EMULATED(pci_dev) ((pci_dev)->kdrv == RTE_KDRV_NONE)
+#else
+#define AVP_DEV_EMULATED(pci_dev) 0
+#endif
+
 
 #define AVP_MAX_RX_BURST 64
 #define AVP_MAX_TX_BURST 64
-#define AVP_MAX_MAC_ADDRS 1
+/* number of mbufs held by each receive queue; enough for a scattered burst */
+#define AVP_RX_MBUF_CACHE_SIZE (AVP_MAX_RX_BURST * RTE_AVP_MAX_MBUF_SEGMENTS)
+#define AVP_MAX_MAC_ADDRS 8
+/* number of bits in the hashed multicast address filter */
+#define AVP_MC_HASH_BITS 8
+#define AVP_MC_HASH_SIZE (1 << AVP_MC_HASH_BITS)
+/* flow types that can be hashed by the host or in software */
+#define AVP_RSS_OFFLOAD_ALL ( \
+	ETH_RSS_IPV4 | \
+	ETH_RSS_NONFRAG_IPV4_TCP | \
+	ETH_RSS_NONFRAG_IPV4_UDP | \
+	ETH_RSS_IPV6 | \
+	ETH_RSS_NONFRAG_IPV6_TCP | \
+	ETH_RSS_NONFRAG_IPV6_UDP)
 #define AVP_MIN_RX_BUFSIZE ETHER_MIN_LEN
 
+/*
+ * Defines the number of zero-copy buffers that can be held by the application
+ * on a single queue at any one time.  Must be a power of 2.
+ */
+#define AVP_ZC_RING_SIZE 1024
+#define AVP_ZC_RING_MASK (AVP_ZC_RING_SIZE - 1)
+
+/**@{ AVP device arguments */
+#define AVP_ZERO_COPY_RX_ARG "zero_copy_rx"
+#define AVP_ZERO_COPY_TX_ARG "zero_copy_tx"
+#define AVP_RX_POLICY_ARG "rx_policy"
+#define AVP_TX_HOLD_PKTS_ARG "tx_hold_pkts"
+#define AVP_TX_HOLD_BYTES_ARG "tx_hold_bytes"
+#define AVP_TX_COPY_ARG "tx_copy"
+#define AVP_RX_COPY_ARG "rx_copy"
+#define AVP_TELEMETRY_ARG "telemetry_ms"
+#define AVP_TX_MP_ARG "tx_mp"
+/**@} */
+
+/* upper bound on the number of packets held per transmit queue */
+#define AVP_TX_HOLD_MAX_PKTS 65536
+
+/* upper bound on the telemetry page update period (milliseconds) */
+#define AVP_TELEMETRY_MAX_MS 60000
+
+/* upper bound on the number of transmit queues sharing the host fifos */
+#define AVP_TX_MP_MAX_QUEUES RTE_MIN(RTE_MAX_LCORE, RTE_MAX_QUEUES_PER_PORT)
+
+/*
+ * Defines how a device queue services the AVP fifos that are mapped to it
+ * when the host provides more fifos than the number of configured queues.
+ */
+enum avp_rx_policy {
+	AVP_RX_POLICY_RR = 0, /**< Service a single fifo per burst */
+	AVP_RX_POLICY_DRAIN, /**< Service all fifos until the burst is full */
+	AVP_RX_POLICY_WEIGHTED, /**< Share the burst by fifo occupancy */
+};
+
+/**@{ Compile time specializations of the flat receive functions */
+#define AVP_RX_VLAN (1 << 0) /**< Host may strip VLAN tags */
+#define AVP_RX_PROMISC (1 << 1) /**< No destination MAC filtering */
+#define AVP_RX_MULTI_FIFO (1 << 2) /**< Some queue services several fifos */
+#define AVP_RX_VARIANTS (1 << 3)
+/**@} */
+
+/**@{ Compile time specializations of the flat transmit function */
+#define AVP_TX_VLAN (1 << 0) /**< Host may insert VLAN tags */
+#define AVP_TX_OFFLOAD (1 << 1) /**< Checksum or segmentation offloads */
+#define AVP_TX_INLINE (1 << 2) /**< Small packets are carried inline */
+#define AVP_TX_VARIANTS (1 << 3)
+/**@} */
+
+/* flat burst functions indexed by their AVP_RX_* or AVP_TX_* flags */
+static const eth_rx_burst_t avp_recv_pkts_variants[AVP_RX_VARIANTS];
+#ifdef AVP_VECTOR_RX
+static const eth_rx_burst_t avp_recv_pkts_vec_variants[AVP_RX_VARIANTS];
+#endif
+static const eth_tx_burst_t avp_xmit_pkts_variants[AVP_TX_VARIANTS];
+
+
+/*
+ * Defines the number of microseconds to busy wait for a response before
+ * starting to sleep between checks of the response queue.
+ */
+#define AVP_REQUEST_SPIN_USECS (50)
 
 /*
- * Defines the number of microseconds to wait before checking the response
- * queue for completion.
+ * Defines the initial and maximum number of microseconds to sleep between
+ * checks of the response queue.  The delay doubles after each check.
  */
-#define AVP_REQUEST_DELAY_USECS (5000)
+#define AVP_REQUEST_MIN_DELAY_USECS (10)
+#define AVP_REQUEST_DELAY_USECS (5000U)
 
 /*
- * Defines the number times to check the response queue for completion before
- * declaring a timeout.
+ * Defines the number times to check the response queue for completion at the
+ * maximum delay before declaring a timeout.
  */
 #define AVP_MAX_REQUEST_RETRY (100)
+#define AVP_REQUEST_TIMEOUT_USECS \
+	(AVP_MAX_REQUEST_RETRY * AVP_REQUEST_DELAY_USECS)
 
 /* Defines the current PCI driver version number */
 #define AVP_DPDK_DRIVER_VERSION RTE_AVP_CURRENT_GUEST_VERSION
@@ -213,13 +456,31 @@ static struct eth_dev_ops avp_eth_dev_ops = {
 	.vlan_offload_set    = avp_vlan_offload_set,
 	.stats_get           = avp_dev_stats_get,
 	.stats_reset         = avp_dev_stats_reset,
+#ifdef AVP_XSTATS
+	.xstats_get          = avp_dev_xstats_get,
+	.xstats_get_names    = avp_dev_xstats_get_names,
+	.xstats_reset        = avp_dev_xstats_reset,
+#endif
 	.link_update         = avp_dev_link_update,
 	.promiscuous_enable  = avp_dev_promiscuous_enable,
 	.promiscuous_disable = avp_dev_promiscuous_disable,
+	.allmulticast_enable = avp_dev_allmulticast_enable,
+	.allmulticast_disable = avp_dev_allmulticast_disable,
+	.mac_addr_add        = avp_dev_mac_addr_add,
+	.mac_addr_remove     = avp_dev_mac_addr_remove,
+	.set_mc_addr_list    = avp_dev_set_mc_addr_list,
+	.reta_update         = avp_dev_reta_update,
+	.reta_query          = avp_dev_reta_query,
+	.rss_hash_update     = avp_dev_rss_hash_update,
+	.rss_hash_conf_get   = avp_dev_rss_hash_conf_get,
 	.rx_queue_setup      = avp_dev_rx_queue_setup,
 	.rx_queue_release    = avp_dev_rx_queue_release,
 	.tx_queue_setup      = avp_dev_tx_queue_setup,
 	.tx_queue_release    = avp_dev_tx_queue_release,
+#ifdef AVP_RX_INTR
+	.rx_queue_intr_enable = avp_dev_rx_queue_intr_enable,
+	.rx_queue_intr_disable = avp_dev_rx_queue_intr_disable,
+#endif
 };
 
 /**@{ AVP device flags */
@@ -227,11 +488,73 @@ static struct eth_dev_ops avp_eth_dev_ops = {
 #define AVP_F_CONFIGURED (1 << 2)
 #define AVP_F_LINKUP (1 << 3)
 #define AVP_F_DETACHED (1 << 4)
+#define AVP_F_FIFO_V3 (1 << 5)
+#define AVP_F_ALLMULTI (1 << 6)
+#define AVP_F_CDESC (1 << 7)
+/**@} */
+
+/**@{ AVP device options (set from device arguments) */
+#define AVP_OPT_ZERO_COPY_RX (1 << 0)
+#define AVP_OPT_ZERO_COPY_TX (1 << 1)
+#define AVP_OPT_TX_MP (1 << 2)
 /**@} */
 
 /* Ethernet device validation marker */
 #define AVP_ETHDEV_MAGIC 0x92972862
 
+/*
+ * Defines the address translation parameters of a host mbuf pool
+ */
+struct avp_mempool_map {
+	void *host_addr; /**< (host) MBUF pool start address */
+	void *addr; /**< MBUF pool start address */
+	phys_addr_t phys_addr; /**< MBUF pool start physical address */
+	uint64_t length; /**< MBUF pool length */
+};
+
+/*
+ * Defines a host memory region along with its offset into the memory BAR
+ */
+struct avp_memmap_entry {
+	phys_addr_t phys_addr; /**< (host) region start physical address */
+	uint64_t length; /**< Region length */
+	uint64_t offset; /**< Region offset within the memory BAR */
+};
+
+/*
+ * Host memory regions sorted by host physical address.  Built each time the
+ * device is attached so that address translations do not need to scan the
+ * full list of host memory regions.
+ */
+struct avp_memmap_index {
+	void *addr; /**< Memory BAR start address */
+	unsigned int nb_maps; /**< Number of regions */
+	struct avp_memmap_entry maps[0]; /**< Regions */
+};
+
+/*
+ * Guest side state of a host transmit and allocation fifo pair shared by
+ * several device queues.  Queues claim allocation fifo entries and reserve
+ * transmit fifo slots together by moving a single head with a compare-and-set,
+ * and only move the indices seen by the host once all earlier reservations
+ * are complete.  The indices are free running so that a stale compare-and-set
+ * cannot succeed once the fifo position wraps.
+ */
+struct avp_tx_mp {
+	volatile uint64_t head __rte_cache_aligned;
+	/**< Allocation fifo entries claimed and transmit fifo slots reserved */
+	volatile uint32_t prod_tail __rte_cache_aligned;
+	/**< Transmit fifo slots made visible */
+	volatile uint32_t cons_tail; /**< Allocation fifo entries released */
+	rte_atomic32_t busy; /**< Queues transmitting on the fifo pair */
+};
+
+/* the allocation fifo index is kept in the low word of the shared head */
+#define AVP_MP_CONS(head) ((uint32_t)(head))
+#define AVP_MP_PROD(head) ((uint32_t)((head) >> 32))
+#define AVP_MP_HEAD(cons, prod) \
+	(((uint64_t)(uint32_t)(prod) << 32) | (uint32_t)(cons))
+
 /*
  * Defines the AVP device attributes which are attached to an RTE ethernet
  * device
@@ -248,8 +571,34 @@ struct avp_dev {
 	unsigned int guest_mbuf_size; /**< local pool mbuf size */
 	unsigned int host_mbuf_size; /**< host mbuf size */
 	unsigned int max_rx_pkt_len; /**< maximum receive unit */
+	unsigned int inline_len; /**< maximum inline packet length */
 	uint32_t host_features; /**< Supported feature bitmap */
 	uint32_t features; /**< Enabled feature bitmap */
+	uint32_t options; /**< Driver options from device arguments */
+	enum avp_rx_policy rx_policy; /**< Multi-fifo receive policy */
+	unsigned int tx_hold_pkts; /**< Packets held per tx queue if detached */
+	uint64_t tx_hold_bytes; /**< Bytes held per tx queue (0: no limit) */
+	enum avp_copy_mode tx_copy; /**< Copy engine for transmit payloads */
+	enum avp_copy_mode rx_copy; /**< Copy engine for receive payloads */
+	uint32_t epoch; /**< Incremented each time the device is re-attached */
+	uint64_t detaches; /**< Live migration detach events */
+	uint64_t attaches; /**< Live migration attach events */
+	uint64_t detach_tsc; /**< TSC of the last detach; 0 if attached */
+	uint64_t blackout_cycles; /**< TSC cycles spent detached */
+	uint64_t blackout_max; /**< Longest time spent detached (TSC cycles) */
+	unsigned int telemetry_ms; /**< Telemetry page update period (0: off) */
+	const struct rte_memzone *telemetry_mz; /**< Telemetry page memzone */
+	struct ether_addr mac_addrs[AVP_MAX_MAC_ADDRS];
+	/**< Additional unicast addresses; index 0 is unused (see ethaddr) */
+	uint32_t mac_addr_mask; /**< Bit mask of valid mac_addrs entries */
+	uint32_t nb_mc_addrs; /**< Number of multicast addresses in mc_hash */
+	uint64_t mc_hash[AVP_MC_HASH_SIZE / 64];
+	/**< Hashed multicast address filter */
+	uint32_t rss_hash_types; /**< Enabled RTE_AVP_RSS_* hash types */
+	uint8_t rss_key[RTE_AVP_RSS_KEY_SIZE]; /**< Toeplitz hash key */
+	uint16_t reta[RTE_AVP_RSS_RETA_SIZE]; /**< Rx queue per hash bucket */
+	struct avp_rss *rss; /**< Software flow hash state (if required) */
+	struct avp_rss *rss_retired; /**< Replaced state, freed when replaced */
 	unsigned int num_tx_queues; /**< Negotiated number of transmit queues */
 	unsigned int max_tx_queues; /**< Maximum number of transmit queues */
 	unsigned int num_rx_queues; /**< Negotiated number of receive queues */
@@ -261,6 +610,8 @@ struct avp_dev {
 	/**< Allocated mbufs queue */
 	struct rte_avp_fifo *free_q[RTE_AVP_MAX_QUEUES];
 	/**< To be freed mbufs queue */
+	struct avp_tx_mp tx_mp[RTE_AVP_MAX_QUEUES];
+	/**< Shared transmit fifo state (tx_mp argument) */
 
 	/* mutual exclusion over the 'flag' and 'resp_q/req_q' fields */
 	rte_spinlock_t lock;
@@ -270,8 +621,12 @@ struct avp_dev {
 	struct rte_avp_fifo *resp_q; /**< Response queue */
 	void *host_sync_addr; /**< (host) Req/Resp Mem address */
 	void *sync_addr; /**< Req/Resp Mem address */
-	void *host_mbuf_addr; /**< (host) MBUF pool start address */
-	void *mbuf_addr; /**< MBUF pool start address */
+	unsigned int nb_pools; /**< Number of host MBUF pools */
+	struct avp_mempool_map pools[RTE_AVP_MAX_MEMPOOLS];
+	/**< Address translation table for each host MBUF pool */
+	void *buf_base[RTE_AVP_MAX_MEMPOOLS];
+	/**< Start address of each host pool indexed by compact descriptors */
+	unsigned int buf_stride; /**< Size of each compact descriptor buffer */
 } __rte_cache_aligned;
 
 /* RTE ethernet private data */
@@ -279,6 +634,22 @@ struct avp_adapter {
 	struct avp_dev avp;
 } __rte_cache_aligned;
 
+/*
+ * Burst functions called by the wrapper burst functions of a port.  Function
+ * addresses are only meaningful to the process that resolved them so they are
+ * kept in process local memory rather than in the shared dev_private area.
+ */
+struct avp_burst_functions {
+	eth_rx_burst_t rx_pkt_burst;
+	/**< Single fifo receive function used by avp_recv_pkts_multi() */
+	eth_rx_burst_t rx_gro_burst;
+	/**< Receive function used by avp_recv_pkts_gro() */
+	eth_tx_burst_t tx_pkt_burst;
+	/**< Transmit function used by avp_xmit_pkts_hold() */
+};
+
+static struct avp_burst_functions avp_burst_functions[RTE_MAX_ETHPORTS];
+
 
 #if RTE_VERSION >= RTE_VERSION_NUM(17, 2, 0, 0)
 /* 32-bit MMIO register write */
@@ -302,6 +673,27 @@ struct avp_adapter {
  * Defines the structure of a AVP device queue for the purpose of handling the
  * receive and transmit burst callback functions
  */
+/* Number of burst size buckets: 1, 2-3, 4-7, 8-15, 16-31, 32-63, 64+ */
+#define AVP_BURST_BUCKETS 7
+
+/*
+ * Extended counters of a queue.  Apart from the rare error cases these are
+ * updated once per burst.
+ */
+struct avp_queue_xstats {
+	uint64_t filtered; /**< Packets discarded by the MAC filter */
+	uint64_t oversized; /**< Packets too large for the buffers */
+	uint64_t nombuf; /**< Receive mbuf allocation failures */
+	uint64_t nobuf; /**< Packets refused for lack of host buffers */
+	uint64_t bad_address; /**< Packets dropped for a bad host address */
+	uint64_t fifo_full;
+	/**< Packets refused by a full tx_q (tx) or free_q stalls (rx) */
+	uint64_t detached; /**< Packets refused while detached */
+	uint64_t bursts[AVP_BURST_BUCKETS]; /**< Non-empty bursts per size */
+	uint64_t fifo_max; /**< Highest rx_q (rx) or alloc_q (tx) occupancy */
+	uint64_t fifo_min_free; /**< Fewest free_q (rx) or tx_q (tx) slots */
+};
+
 struct avp_queue {
 	struct rte_eth_dev_data *dev_data;
 	/**< Backpointer to ethernet device data */
@@ -316,8 +708,352 @@ struct avp_queue {
 	uint64_t packets;
 	uint64_t bytes;
 	uint64_t errors;
+
+	struct avp_zc_ring *zc; /**< Zero-copy buffer tracking (if enabled) */
+	struct avp_tx_hold *hold; /**< Transmit holding ring (if enabled) */
+	uint64_t held; /**< Packets held while detached */
+	uint64_t flushed; /**< Held packets sent once re-attached */
+	uint64_t overflows; /**< Packets refused because the hold was full */
+	unsigned int gro; /**< Receive segment coalescing enabled */
+	uint64_t gro_segments; /**< Packets received while coalescing */
+	uint64_t gro_merged; /**< Packets appended to a preceding packet */
+	unsigned int intr_armed; /**< Receive interrupt requested */
+	struct rte_pmd_avp_stage_stats stages; /**< Burst stage cycles */
+	struct avp_queue_xstats xstats; /**< Extended counters */
+
+	uint64_t mbuf_initializer; /**< Value to init mbufs (vector rx) */
+	unsigned int nb_mbufs; /**< Number of mbufs held in the mbuf cache */
+	struct rte_mbuf *mbufs[AVP_RX_MBUF_CACHE_SIZE];
+	/**< Receive mbufs allocated in bulk but not yet used */
 };
 
+/*
+ * Per-mbuf private data of zero-copy mbufs.  Identifies the host buffer that
+ * is referenced by the mbuf so that it can be handed back to the host once the
+ * application has released it.
+ */
+struct avp_zc_priv {
+	void *host_buf; /**< (host) AVP buffer owned by this mbuf */
+	uint32_t epoch; /**< Device epoch at which the buffer was acquired */
+	uint16_t fifo; /**< AVP fifo index the buffer must be returned to */
+};
+
+#define AVP_ZC_PRIV_SIZE \
+	RTE_ALIGN(sizeof(struct avp_zc_priv), RTE_MBUF_PRIV_ALIGN)
+
+/* Macro to access the zero-copy private data of an mbuf */
+#define AVP_ZC_PRIV(m) \
+	((struct avp_zc_priv *)RTE_PTR_ADD((m), sizeof(struct rte_mbuf)))
+
+/*
+ * Tracks the zero-copy mbufs handed to the application on a queue.  The PMD
+ * holds an extra reference on each mbuf so that it is never returned to its
+ * pool by the application; once the reference count drops back to 1 the
+ * application is done with it and the host buffer can be reclaimed.  Buffers
+ * are reclaimed in the order they were handed out.
+ */
+struct avp_zc_ring {
+	struct rte_mempool *pool; /**< Pool of buffer-less mbuf headers */
+	unsigned int head; /**< Next slot to be filled */
+	unsigned int tail; /**< Oldest slot not yet reclaimed */
+	struct rte_mbuf *mbufs[AVP_ZC_RING_SIZE];
+	unsigned int nb_stash; /**< Number of stashed host buffers */
+	uint32_t stash_epoch; /**< Device epoch of the stashed buffers */
+	void *stash[AVP_ZC_RING_SIZE];
+	/**< (host) Transmit buffers released by the application unsent */
+};
+
+/*
+ * Holds the packets transmitted on a queue while the device is detached from
+ * the host during a live migration.  The packets are sent in order once the
+ * device is re-attached.
+ */
+struct avp_tx_hold {
+	unsigned int size; /**< Number of slots; a power of 2 */
+	unsigned int max_pkts; /**< Maximum number of held packets */
+	uint64_t max_bytes; /**< Maximum number of held bytes (0: no limit) */
+	uint64_t bytes; /**< Number of held bytes */
+	unsigned int head; /**< Next slot to be filled */
+	unsigned int tail; /**< Oldest held packet */
+	struct rte_mbuf *mbufs[0];
+};
+
+/*
+ * Shared FIFO accessors.  The FIFO layout is determined by the version of the
+ * host device therefore each access is dispatched on the layout in use.
+ */
+#define AVP_FIFO_V3(_fifo) ((struct rte_avp_fifo_v3 *)(void *)(_fifo))
+#define AVP_RING(_fifo) ((struct rte_avp_ring *)(void *)(_fifo))
+
+static inline unsigned int
+avp_dev_fifo_put(struct avp_dev *avp, struct rte_avp_fifo *fifo,
+		 void **data, unsigned int num)
+{
+	if (avp->flags & AVP_F_FIFO_V3)
+		return avp_fifo_v3_put(AVP_FIFO_V3(fifo), data, num);
+	return avp_fifo_put(fifo, data, num);
+}
+
+static inline unsigned int
+avp_dev_fifo_get(struct avp_dev *avp, struct rte_avp_fifo *fifo,
+		 void **data, unsigned int num)
+{
+	if (avp->flags & AVP_F_FIFO_V3)
+		return avp_fifo_v3_get(AVP_FIFO_V3(fifo), data, num);
+	return avp_fifo_get(fifo, data, num);
+}
+
+static inline unsigned int
+avp_dev_fifo_peek(struct avp_dev *avp, struct rte_avp_fifo *fifo,
+		  void **data, unsigned int num)
+{
+	if (avp->flags & AVP_F_FIFO_V3)
+		return avp_fifo_v3_peek(AVP_FIFO_V3(fifo), data, num);
+	return avp_fifo_peek(fifo, data, num);
+}
+
+static inline void
+avp_dev_fifo_consume(struct avp_dev *avp, struct rte_avp_fifo *fifo,
+		     unsigned int num)
+{
+	if (avp->flags & AVP_F_FIFO_V3)
+		avp_fifo_v3_consume(AVP_FIFO_V3(fifo), num);
+	else
+		avp_fifo_consume(fifo, num);
+}
+
+/*
+ * number of elements in a fifo (consumer only); num is the burst size the
+ * caller wants so that a version 3 fifo only reloads the producer index when
+ * its shadow copy cannot satisfy it.
+ */
+static inline unsigned int
+avp_dev_fifo_count(struct avp_dev *avp, struct rte_avp_fifo *fifo,
+		   unsigned int num)
+{
+	if (avp->flags & AVP_F_FIFO_V3)
+		return avp_fifo_v3_count(AVP_FIFO_V3(fifo), num);
+	return avp_fifo_count(fifo);
+}
+
+/*
+ * occupancy of a fifo for monitoring purposes.  Unlike avp_dev_fifo_count()
+ * it never writes to the fifo so it is safe to call from any thread.
+ */
+static inline unsigned int
+avp_dev_fifo_level(struct avp_dev *avp, struct rte_avp_fifo *fifo)
+{
+	if (avp->flags & AVP_F_FIFO_V3)
+		return avp_fifo_v3_level(AVP_FIFO_V3(fifo));
+	return avp_fifo_count(fifo);
+}
+
+/* as avp_dev_fifo_count() for the free slots of a fifo (producer only) */
+static inline unsigned int
+avp_dev_fifo_free_count(struct avp_dev *avp, struct rte_avp_fifo *fifo,
+			unsigned int num)
+{
+	if (avp->flags & AVP_F_FIFO_V3)
+		return avp_fifo_v3_free_count(AVP_FIFO_V3(fifo), num);
+	return avp_fifo_free_count(fifo);
+}
+
+static inline unsigned int
+avp_dev_fifo_len(struct avp_dev *avp, struct rte_avp_fifo *fifo)
+{
+	if (avp->flags & AVP_F_FIFO_V3)
+		return AVP_FIFO_V3(fifo)->len;
+	return fifo->len;
+}
+
+#ifdef AVP_TX_MP
+/*
+ * Accessors to the host visible indices of a fifo.  The compact descriptor
+ * rings share the version 3 index layout.
+ */
+static inline volatile unsigned int *
+avp_dev_fifo_write_index(struct avp_dev *avp, struct rte_avp_fifo *fifo)
+{
+	if (avp->flags & AVP_F_FIFO_V3)
+		return (volatile unsigned int *)&AVP_FIFO_V3(fifo)->write;
+	return (volatile unsigned int *)&fifo->write;
+}
+
+static inline volatile unsigned int *
+avp_dev_fifo_read_index(struct avp_dev *avp, struct rte_avp_fifo *fifo)
+{
+	if (avp->flags & AVP_F_FIFO_V3)
+		return (volatile unsigned int *)&AVP_FIFO_V3(fifo)->read;
+	return (volatile unsigned int *)&fifo->read;
+}
+
+static inline void *RTE_AVP_FIFO_VOLATILE *
+avp_dev_fifo_buffer(struct avp_dev *avp, struct rte_avp_fifo *fifo)
+{
+	if (avp->flags & AVP_F_FIFO_V3)
+		return AVP_FIFO_V3(fifo)->buffer;
+	return fifo->buffer;
+}
+
+/*
+ * Wait for the reservations that precede [start, start + num) to complete and
+ * then move the host visible index past them.  The caller orders its accesses
+ * to the reserved entries before this call.  Only other queues are waited
+ * for; the host never holds back a reservation that was granted.
+ */
+static inline void
+avp_mp_update_tail(volatile uint32_t *tail, volatile unsigned int *index,
+		   unsigned int mask, uint32_t start, unsigned int num)
+{
+	while (unlikely(*tail != start))
+		rte_pause();
+
+	*index = (start + num) & mask;
+	rte_smp_wmb();
+	*tail = start + num;
+}
+
+/*
+ * Read the num host buffers claimed from a shared allocation fifo at start
+ * and release their entries to the host.
+ */
+static inline void
+avp_dev_fifo_mc_get(struct avp_dev *avp, struct avp_tx_mp *mp,
+		    struct rte_avp_fifo *fifo, uint32_t start, void **data,
+		    unsigned int num)
+{
+	void *RTE_AVP_FIFO_VOLATILE *buffer = avp_dev_fifo_buffer(avp, fifo);
+	unsigned int mask = avp_dev_fifo_len(avp, fifo) - 1;
+	unsigned int i;
+
+	AVP_RMB();
+	for (i = 0; i < num; i++)
+		data[i] = buffer[(start + i) & mask];
+	AVP_RMB();
+
+	avp_mp_update_tail(&mp->cons_tail, avp_dev_fifo_read_index(avp, fifo),
+			   mask, start, num);
+}
+
+/*
+ * Fill the num shared transmit fifo slots reserved at start and make them
+ * visible to the host.
+ */
+static inline void
+avp_dev_fifo_mp_put(struct avp_dev *avp, struct avp_tx_mp *mp,
+		    struct rte_avp_fifo *fifo, uint32_t start, void **data,
+		    unsigned int num)
+{
+	void *RTE_AVP_FIFO_VOLATILE *buffer = avp_dev_fifo_buffer(avp, fifo);
+	unsigned int mask = avp_dev_fifo_len(avp, fifo) - 1;
+	unsigned int i;
+
+	for (i = 0; i < num; i++)
+		buffer[(start + i) & mask] = data[i];
+	AVP_WMB();
+
+	avp_mp_update_tail(&mp->prod_tail, avp_dev_fifo_write_index(avp, fifo),
+			   mask, start, num);
+}
+
+/* as avp_dev_fifo_mc_get() for a compact descriptor ring */
+static inline void
+avp_ring_mc_get(struct avp_dev *avp, struct avp_tx_mp *mp,
+		struct rte_avp_fifo *fifo, uint32_t start,
+		struct rte_avp_cdesc *descs, unsigned int num)
+{
+	struct rte_avp_ring *ring = AVP_RING(fifo);
+	unsigned int mask = ring->len - 1;
+	unsigned int i;
+
+	AVP_RMB();
+	for (i = 0; i < num; i++)
+		descs[i] = ring->desc[(start + i) & mask];
+	AVP_RMB();
+
+	avp_mp_update_tail(&mp->cons_tail, avp_dev_fifo_read_index(avp, fifo),
+			   mask, start, num);
+}
+
+/* as avp_dev_fifo_mp_put() for a compact descriptor ring */
+static inline void
+avp_ring_mp_put(struct avp_dev *avp, struct avp_tx_mp *mp,
+		struct rte_avp_fifo *fifo, uint32_t start,
+		const struct rte_avp_cdesc *descs, unsigned int num)
+{
+	struct rte_avp_ring *ring = AVP_RING(fifo);
+	unsigned int mask = ring->len - 1;
+	unsigned int i;
+
+	for (i = 0; i < num; i++)
+		ring->desc[(start + i) & mask] = descs[i];
+	AVP_WMB();
+
+	avp_mp_update_tail(&mp->prod_tail, avp_dev_fifo_write_index(avp, fifo),
+			   mask, start, num);
+}
+
+/*
+ * Start the shared fifo state from the current host positions.  Must only be
+ * called while the device is detached or stopped; the queues that started
+ * transmitting before are waited for since they may be waiting on each
+ * other's indices.
+ */
+static void
+avp_dev_tx_mp_reset(struct avp_dev *avp)
+{
+	struct avp_tx_mp *mp;
+	unsigned int i;
+
+	if (!(avp->options & AVP_OPT_TX_MP))
+		return;
+
+	for (i = 0; i < avp->num_tx_queues; i++) {
+		mp = &avp->tx_mp[i];
+		while (rte_atomic32_read(&mp->busy) != 0)
+			rte_pause();
+
+		mp->prod_tail = *avp_dev_fifo_write_index(avp, avp->tx_q[i]);
+		mp->cons_tail = *avp_dev_fifo_read_index(avp, avp->alloc_q[i]);
+		mp->head = AVP_MP_HEAD(mp->cons_tail, mp->prod_tail);
+	}
+}
+#endif
+
+/*
+ * Record the fifo levels seen at the start of a burst; the occupancy of the
+ * fifo the queue consumes from and the free slots of the one it produces to.
+ */
+static inline void
+avp_dev_fifo_watermarks(struct avp_queue *q, unsigned int count,
+			unsigned int free_count)
+{
+	if (unlikely(count > q->xstats.fifo_max))
+		q->xstats.fifo_max = count;
+	if (unlikely(free_count < q->xstats.fifo_min_free))
+		q->xstats.fifo_min_free = free_count;
+}
+
+/* count a burst in the bucket of its log2 size */
+static inline void
+avp_dev_burst_account(struct avp_queue *q, unsigned int n)
+{
+	unsigned int bucket;
+
+	if (unlikely(n == 0))
+		return;
+
+	bucket = 31 - __builtin_clz(n);
+	q->xstats.bursts[RTE_MIN(bucket, AVP_BURST_BUCKETS - 1U)]++;
+}
+
+static inline void
+avp_dev_queue_xstats_reset(struct avp_queue *q)
+{
+	memset(&q->xstats, 0, sizeof(q->xstats));
+	q->xstats.fifo_min_free = UINT64_MAX;
+}
+
 /* send a request and wait for a response
  *
  * @warning must be called while holding the avp->lock spinlock.
@@ -325,21 +1061,31 @@ struct avp_queue {
 static int
 avp_dev_process_request(struct avp_dev *avp, struct rte_avp_request *request)
 {
-	unsigned int retry = AVP_MAX_REQUEST_RETRY;
+	unsigned int delay = AVP_REQUEST_MIN_DELAY_USECS;
+	uint64_t hz = rte_get_timer_hz();
+	uint64_t start, spin, deadline;
 	void *resp_addr = NULL;
 	unsigned int count;
+	size_t size;
+	uint64_t now;
 	int ret;
 
 	PMD_DRV_LOG(DEBUG, "Sending request %u to host\n", request->req_id);
 
 	request->result = -ENOTSUP;
 
+	/* only the hosts that negotiated RSS know of the trailing config */
+	if (request->req_id == RTE_AVP_REQ_CFG_RSS)
+		size = sizeof(*request);
+	else
+		size = offsetof(struct rte_avp_request, rss);
+
 	/* Discard any stale responses before starting a new request */
-	while (avp_fifo_get(avp->resp_q, (void **)&resp_addr, 1))
+	while (avp_dev_fifo_get(avp, avp->resp_q, (void **)&resp_addr, 1))
 		PMD_DRV_LOG(DEBUG, "Discarding stale response\n");
 
-	rte_memcpy(avp->sync_addr, request, sizeof(*request));
-	count = avp_fifo_put(avp->req_q, &avp->host_sync_addr, 1);
+	rte_memcpy(avp->sync_addr, request, size);
+	count = avp_dev_fifo_put(avp, avp->req_q, &avp->host_sync_addr, 1);
 	if (count < 1) {
 		PMD_DRV_LOG(ERR, "Cannot send request %u to host\n",
 			    request->req_id);
@@ -347,26 +1093,37 @@ avp_dev_process_request(struct avp_dev *avp, struct rte_avp_request *request)
 		goto done;
 	}
 
-	while (retry--) {
-		/* wait for a response */
-		usleep(AVP_REQUEST_DELAY_USECS);
-
-		count = avp_fifo_count(avp->resp_q);
-		if (count >= 1) {
-			/* response received */
-			break;
-		}
-
-		if ((count < 1) && (retry == 0)) {
+	/*
+	 * Most requests are handled by the host within microseconds therefore
+	 * busy wait briefly before backing off exponentially.
+	 */
+	start = rte_get_timer_cycles();
+	spin = start + (hz * AVP_REQUEST_SPIN_USECS) / US_PER_S;
+	deadline = start + (hz * AVP_REQUEST_TIMEOUT_USECS) / US_PER_S;
+	while (avp_dev_fifo_count(avp, avp->resp_q, 1) < 1) {
+		now = rte_get_timer_cycles();
+		if (now >= deadline) {
 			PMD_DRV_LOG(ERR, "Timeout while waiting for a response for %u\n",
 				    request->req_id);
 			ret = -ETIME;
 			goto done;
 		}
+
+		if (now < spin) {
+			rte_pause();
+			continue;
+		}
+
+		usleep(delay);
+		delay = RTE_MIN(delay * 2, AVP_REQUEST_DELAY_USECS);
 	}
 
+	PMD_DRV_LOG(DEBUG, "Response received for request %u after %" PRIu64 " usecs\n",
+		    request->req_id,
+		    ((rte_get_timer_cycles() - start) * US_PER_S) / hz);
+
 	/* retrieve the response */
-	count = avp_fifo_get(avp->resp_q, (void **)&resp_addr, 1);
+	count = avp_dev_fifo_get(avp, avp->resp_q, (void **)&resp_addr, 1);
 	if ((count != 1) || (resp_addr != avp->host_sync_addr)) {
 		PMD_DRV_LOG(ERR, "Invalid response from host, count=%u resp=%p host_sync_addr=%p\n",
 			    count, resp_addr, avp->host_sync_addr);
@@ -375,7 +1132,7 @@ avp_dev_process_request(struct avp_dev *avp, struct rte_avp_request *request)
 	}
 
 	/* copy to user buffer */
-	rte_memcpy(request, avp->sync_addr, sizeof(*request));
+	rte_memcpy(request, avp->sync_addr, size);
 	ret = 0;
 
 	PMD_DRV_LOG(DEBUG, "Result %d received for request %u\n",
@@ -436,56 +1193,185 @@ avp_dev_ctrl_shutdown(struct rte_eth_dev *eth_dev)
 	return ret == 0 ? request.result : ret;
 }
 
+/*
+ * find the pool that holds a host mbuf virtual address.  Returns NULL if the
+ * address is outside of all pools.
+ */
+static inline const struct avp_mempool_map *
+avp_dev_buffer_pool(struct avp_dev *avp, void *host_mbuf_address)
+{
+	const struct avp_mempool_map *pool = &avp->pools[0];
+	unsigned int i;
+
+	for (i = 0; i < avp->nb_pools; i++, pool++)
+		if (RTE_PTR_DIFF(host_mbuf_address, pool->host_addr) <
+		    pool->length)
+			return pool;
+
+#ifdef RTE_LIBRTE_AVP_DEBUG_BUFFERS
+	PMD_DRV_LOG(ERR, "Host mbuf address %p is outside of all %u pools\n",
+		    host_mbuf_address, avp->nb_pools);
+#endif
+	return NULL;
+}
+
 /* translate from host mbuf virtual address to guest virtual address */
 static inline void *
 avp_dev_translate_buffer(struct avp_dev *avp, void *host_mbuf_address)
 {
+	const struct avp_mempool_map *pool;
+
+	pool = avp_dev_buffer_pool(avp, host_mbuf_address);
+	if (unlikely(pool == NULL))
+		return NULL;
 	return RTE_PTR_ADD(RTE_PTR_SUB(host_mbuf_address,
-				       (uintptr_t)avp->host_mbuf_addr),
-			   (uintptr_t)avp->mbuf_addr);
+				       (uintptr_t)pool->host_addr),
+			   (uintptr_t)pool->addr);
 }
 
-/* translate from host physical address to guest virtual address */
-static void *
-avp_dev_translate_address(struct rte_eth_dev *eth_dev,
-			  phys_addr_t host_phys_addr)
+/* translate from host mbuf virtual address to guest physical address */
+static inline phys_addr_t
+avp_dev_translate_buffer_phys(struct avp_dev *avp, void *host_mbuf_address)
 {
-	struct rte_pci_device *pci_dev = AVP_DEV_TO_PCI(eth_dev);
-#if RTE_VERSION >= RTE_VERSION_NUM(16, 11, 0, 0)
-	struct rte_mem_resource *resource;
-#else
-	struct rte_pci_resource *resource;
-#endif
-	struct rte_avp_memmap_info *info;
-	struct rte_avp_memmap *map;
-	off_t offset;
-	void *addr;
+	const struct avp_mempool_map *pool;
+
+	pool = avp_dev_buffer_pool(avp, host_mbuf_address);
+	if (unlikely(pool == NULL))
+		return RTE_BAD_PHYS_ADDR;
+	return pool->phys_addr +
+		RTE_PTR_DIFF(host_mbuf_address, pool->host_addr);
+}
+
+/*
+ * return the guest virtual address of the data held by a host buffer, which
+ * may be carried inline in the descriptor extension.  Returns NULL if the
+ * descriptor or its data is outside of all pools.
+ */
+static inline void *
+avp_dev_buffer_data(struct avp_dev *avp, struct rte_avp_desc *pkt_buf)
+{
+	if (unlikely(pkt_buf == NULL))
+		return NULL;
+
+	if (pkt_buf->ol_flags & RTE_AVP_INLINE_PKT)
+		return RTE_PTR_ADD(pkt_buf, sizeof(*pkt_buf));
+
+	return avp_dev_translate_buffer(avp, pkt_buf->data);
+}
+
+/*
+ * check that every descriptor and data address of a host buffer chain is
+ * inside one of the pools and that the chain is no longer than its segment
+ * count.  Returns 0 if the whole chain can be accessed.
+ */
+static inline int
+avp_dev_buffer_chain_check(struct avp_dev *avp, struct rte_avp_desc *first_buf)
+{
+	struct rte_avp_desc *pkt_buf = first_buf;
+	unsigned int nb_segs = 0;
+	void *buf;
+
+	do {
+		if (unlikely(avp_dev_buffer_data(avp, pkt_buf) == NULL))
+			return -EFAULT;
+		buf = pkt_buf->next;
+		if (buf == NULL)
+			return 0;
+		pkt_buf = avp_dev_translate_buffer(avp, buf);
+	} while (++nb_segs < first_buf->nb_segs);
+
+	return -EFAULT;
+}
+
+static int
+avp_memmap_entry_cmp(const void *a, const void *b)
+{
+	const struct avp_memmap_entry *x = a;
+	const struct avp_memmap_entry *y = b;
+
+	if (x->phys_addr < y->phys_addr)
+		return -1;
+	return x->phys_addr > y->phys_addr;
+}
+
+/*
+ * build an index of the host memory regions so that each translation is a
+ * binary search rather than a scan of every region.
+ */
+static struct avp_memmap_index *
+avp_dev_memmap_index_create(struct rte_pci_device *pci_dev)
+{
+	struct avp_memmap_index *index;
+	struct rte_avp_memmap_info *info;
+	struct rte_avp_memmap *map;
+	unsigned int nb_maps;
+	uint64_t offset;
 	unsigned int i;
 
-	addr = pci_dev->mem_resource[RTE_AVP_PCI_MEMORY_BAR].addr;
-	resource = &pci_dev->mem_resource[RTE_AVP_PCI_MEMMAP_BAR];
-	info = (struct rte_avp_memmap_info *)resource->addr;
+	info = pci_dev->mem_resource[RTE_AVP_PCI_MEMMAP_BAR].addr;
+	nb_maps = RTE_MIN(info->nb_maps, (uint32_t)RTE_AVP_MAX_MAPS);
 
+	index = rte_malloc("avp_memmap_index", sizeof(*index) +
+			   (nb_maps * sizeof(index->maps[0])), 0);
+	if (index == NULL)
+		return NULL;
+
+	index->addr = pci_dev->mem_resource[RTE_AVP_PCI_MEMORY_BAR].addr;
+	index->nb_maps = 0;
+
+	/* regions are laid out in the memory BAR in the order listed */
 	offset = 0;
-	for (i = 0; i < info->nb_maps; i++) {
-		/* search all segments looking for a matching address */
+	for (i = 0; i < nb_maps; i++) {
 		map = &info->maps[i];
+		if (map->length != 0) {
+			index->maps[index->nb_maps].phys_addr = map->phys_addr;
+			index->maps[index->nb_maps].length = map->length;
+			index->maps[index->nb_maps].offset = offset;
+			index->nb_maps++;
+		}
+		offset += map->length;
+	}
 
-		if ((host_phys_addr >= map->phys_addr) &&
-			(host_phys_addr < (map->phys_addr + map->length))) {
-			/* address is within this segment */
-			offset += (host_phys_addr - map->phys_addr);
-			addr = RTE_PTR_ADD(addr, offset);
+	qsort(index->maps, index->nb_maps, sizeof(index->maps[0]),
+	      avp_memmap_entry_cmp);
 
-			PMD_DRV_LOG(DEBUG, "Translating host physical 0x%" PRIx64 " to guest virtual 0x%p\n",
-				    host_phys_addr, addr);
+	return index;
+}
 
-			return addr;
-		}
-		offset += map->length;
+/* translate from host physical address to guest virtual address */
+static void *
+avp_dev_translate_address(const struct avp_memmap_index *index,
+			  phys_addr_t host_phys_addr)
+{
+	const struct avp_memmap_entry *map;
+	unsigned int lo = 0;
+	unsigned int hi = index->nb_maps;
+	unsigned int mid;
+	void *addr;
+
+	/* find the last region that starts at or below the address */
+	while (lo < hi) {
+		mid = lo + ((hi - lo) / 2);
+		if (index->maps[mid].phys_addr <= host_phys_addr)
+			lo = mid + 1;
+		else
+			hi = mid;
 	}
 
-	return NULL;
+	if (lo == 0)
+		return NULL;
+
+	map = &index->maps[lo - 1];
+	if ((host_phys_addr - map->phys_addr) >= map->length)
+		return NULL;
+
+	addr = RTE_PTR_ADD(index->addr,
+			   map->offset + (host_phys_addr - map->phys_addr));
+
+	PMD_DRV_LOG(DEBUG, "Translating host physical 0x%" PRIx64 " to guest virtual 0x%p\n",
+		    host_phys_addr, addr);
+
+	return addr;
 }
 
 /* verify that the incoming device version is compatible with our version */
@@ -598,6 +1484,9 @@ avp_dev_detach(struct rte_eth_dev *eth_dev)
 	avp->flags |= AVP_F_DETACHED;
 	rte_wmb();
 
+	avp->detaches++;
+	avp->detach_tsc = rte_rdtsc();
+
 	/* wait for queues to acknowledge the presence of the detach flag */
 	rte_delay_ms(1);
 
@@ -609,34 +1498,45 @@ unlock:
 }
 
 static void
-_avp_set_rx_queue_mappings(struct rte_eth_dev *eth_dev, uint16_t rx_queue_id)
+_avp_get_rx_queue_range(struct rte_eth_dev *eth_dev, uint16_t rx_queue_id,
+			uint16_t *queue_base, uint16_t *queue_count)
 {
 	struct avp_dev *avp =
 		AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
-	struct avp_queue *rxq;
-	uint16_t queue_count;
+	uint16_t count;
 	uint16_t remainder;
 
-	rxq = (struct avp_queue *)eth_dev->data->rx_queues[rx_queue_id];
-
 	/*
 	 * Must map all AVP fifos as evenly as possible between the configured
 	 * device queues.  Each device queue will service a subset of the AVP
 	 * fifos. If there is an odd number of device queues the first set of
 	 * device queues will get the extra AVP fifos.
 	 */
-	queue_count = avp->num_rx_queues / eth_dev->data->nb_rx_queues;
+	count = avp->num_rx_queues / eth_dev->data->nb_rx_queues;
 	remainder = avp->num_rx_queues % eth_dev->data->nb_rx_queues;
 	if (rx_queue_id < remainder) {
 		/* these queues must service one extra FIFO */
-		rxq->queue_base = rx_queue_id * (queue_count + 1);
-		rxq->queue_limit = rxq->queue_base + (queue_count + 1) - 1;
+		*queue_base = rx_queue_id * (count + 1);
+		*queue_count = count + 1;
 	} else {
 		/* these queues service the regular number of FIFO */
-		rxq->queue_base = ((remainder * (queue_count + 1)) +
-				   ((rx_queue_id - remainder) * queue_count));
-		rxq->queue_limit = rxq->queue_base + queue_count - 1;
+		*queue_base = ((remainder * (count + 1)) +
+			       ((rx_queue_id - remainder) * count));
+		*queue_count = count;
 	}
+}
+
+static void
+_avp_set_rx_queue_mappings(struct rte_eth_dev *eth_dev, uint16_t rx_queue_id)
+{
+	struct avp_queue *rxq;
+	uint16_t queue_count;
+
+	rxq = (struct avp_queue *)eth_dev->data->rx_queues[rx_queue_id];
+
+	_avp_get_rx_queue_range(eth_dev, rx_queue_id,
+				&rxq->queue_base, &queue_count);
+	rxq->queue_limit = rxq->queue_base + queue_count - 1;
 
 	PMD_DRV_LOG(DEBUG, "rxq %u at %p base %u limit %u\n",
 		    rx_queue_id, rxq, rxq->queue_base, rxq->queue_limit);
@@ -661,6 +1561,13 @@ _avp_set_queue_counts(struct rte_eth_dev *eth_dev)
 	 * queues (host rx queues).
 	 */
 	avp->num_tx_queues = eth_dev->data->nb_tx_queues;
+#ifdef AVP_TX_MP
+	if (avp->options & AVP_OPT_TX_MP) {
+		/* the queues beyond the host maximum share its fifos */
+		avp->num_tx_queues = RTE_MIN(avp->num_tx_queues,
+					     avp->max_tx_queues);
+	}
+#endif
 
 	/*
 	 * the receive direction is more restrictive.  The host requires a
@@ -676,11 +1583,273 @@ _avp_set_queue_counts(struct rte_eth_dev *eth_dev)
 		    avp->num_tx_queues, avp->num_rx_queues);
 }
 
+static int
+avp_dev_ctrl_set_rss(struct rte_eth_dev *eth_dev)
+{
+	struct avp_dev *avp = AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
+	struct rte_avp_request request;
+	uint16_t queue_base;
+	uint16_t queue_count;
+	unsigned int i;
+	int ret;
+
+	/* setup a receive side scaling request */
+	memset(&request, 0, sizeof(request));
+	request.req_id = RTE_AVP_REQ_CFG_RSS;
+	request.rss.hash_types = avp->rss_hash_types;
+	memcpy(request.rss.key, avp->rss_key, sizeof(request.rss.key));
+
+	/* spread the buckets of each device queue across all of its fifos */
+	for (i = 0; i < RTE_AVP_RSS_RETA_SIZE; i++) {
+		_avp_get_rx_queue_range(eth_dev, avp->reta[i],
+					&queue_base, &queue_count);
+		request.rss.reta[i] = queue_base + (i % queue_count);
+	}
+
+	ret = avp_dev_process_request(avp, &request);
+
+	return ret == 0 ? request.result : ret;
+}
+
+static uint32_t
+_avp_rss_hf_to_types(uint64_t rss_hf)
+{
+	uint32_t types = 0;
+
+	if (rss_hf & ETH_RSS_IPV4)
+		types |= RTE_AVP_RSS_IPV4;
+	if (rss_hf & ETH_RSS_NONFRAG_IPV4_TCP)
+		types |= RTE_AVP_RSS_IPV4_TCP;
+	if (rss_hf & ETH_RSS_NONFRAG_IPV4_UDP)
+		types |= RTE_AVP_RSS_IPV4_UDP;
+	if (rss_hf & ETH_RSS_IPV6)
+		types |= RTE_AVP_RSS_IPV6;
+	if (rss_hf & ETH_RSS_NONFRAG_IPV6_TCP)
+		types |= RTE_AVP_RSS_IPV6_TCP;
+	if (rss_hf & ETH_RSS_NONFRAG_IPV6_UDP)
+		types |= RTE_AVP_RSS_IPV6_UDP;
+
+	return types;
+}
+
+static uint64_t
+_avp_rss_types_to_hf(uint32_t types)
+{
+	uint64_t rss_hf = 0;
+
+	if (types & RTE_AVP_RSS_IPV4)
+		rss_hf |= ETH_RSS_IPV4;
+	if (types & RTE_AVP_RSS_IPV4_TCP)
+		rss_hf |= ETH_RSS_NONFRAG_IPV4_TCP;
+	if (types & RTE_AVP_RSS_IPV4_UDP)
+		rss_hf |= ETH_RSS_NONFRAG_IPV4_UDP;
+	if (types & RTE_AVP_RSS_IPV6)
+		rss_hf |= ETH_RSS_IPV6;
+	if (types & RTE_AVP_RSS_IPV6_TCP)
+		rss_hf |= ETH_RSS_NONFRAG_IPV6_TCP;
+	if (types & RTE_AVP_RSS_IPV6_UDP)
+		rss_hf |= ETH_RSS_NONFRAG_IPV6_UDP;
+
+	return rss_hf;
+}
+
+/*
+ * Replace the software flow hash state.  The receive functions of any process
+ * may still be using the previous state so it is only freed once it has been
+ * replaced in turn, or when the device is released.
+ */
+static void
+avp_dev_rss_publish(struct avp_dev *avp, struct avp_rss *rss)
+{
+	struct avp_rss *old = avp->rss;
+
+	rte_wmb();
+	avp->rss = rss;
+	rte_free(avp->rss_retired);
+	avp->rss_retired = old;
+}
+
+/*
+ * Apply the current receive side scaling parameters.  When the feature has
+ * been negotiated the host hashes and steers the packets; otherwise the flow
+ * hash is computed in software by the receive functions.  A new software
+ * state is built for each change and published only once initialized so that
+ * it can be changed while the receive functions are running.
+ */
+static int
+avp_dev_rss_apply(struct rte_eth_dev *eth_dev)
+{
+	struct avp_dev *avp = AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
+	struct avp_rss *rss = NULL;
+	uint32_t sw_types = 0;
+	int ret;
+
+	if (avp->features & RTE_AVP_FEATURE_RSS) {
+		ret = avp_dev_ctrl_set_rss(eth_dev);
+		if (ret < 0) {
+			PMD_DRV_LOG(ERR, "RSS config request failed by host, ret=%d\n",
+				    ret);
+			return ret;
+		}
+	} else {
+		sw_types = avp->rss_hash_types;
+	}
+
+	if (sw_types != 0) {
+		rss = rte_zmalloc_socket("avp_rss", sizeof(*rss),
+					 RTE_CACHE_LINE_SIZE,
+					 eth_dev->data->numa_node);
+		if (rss == NULL) {
+			PMD_DRV_LOG(ERR, "Failed to allocate %zu bytes for RSS\n",
+				    sizeof(*rss));
+			return -ENOMEM;
+		}
+
+		avp_rss_init(rss, avp->rss_key, sw_types);
+		if (avp->rss == NULL)
+			PMD_DRV_LOG(NOTICE, "Using software RSS on port %u\n",
+				    eth_dev->data->port_id);
+	}
+
+	if ((rss != NULL) || (avp->rss != NULL))
+		avp_dev_rss_publish(avp, rss);
+
+	return 0;
+}
+
+/*
+ * Negotiate the host flow hash feature.  Must be called prior to sending the
+ * device configuration to the host.
+ */
+static void
+avp_dev_rss_negotiate(struct rte_eth_dev *eth_dev)
+{
+	struct avp_dev *avp = AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
+
+	if ((eth_dev->data->dev_conf.rxmode.mq_mode & ETH_MQ_RX_RSS_FLAG) &&
+	    (avp->host_features & RTE_AVP_FEATURE_RSS))
+		avp->features |= RTE_AVP_FEATURE_RSS;
+	else
+		avp->features &= ~RTE_AVP_FEATURE_RSS;
+}
+
+/* reset the receive side scaling parameters from the device configuration */
+static void
+avp_dev_rss_configure(struct rte_eth_dev *eth_dev)
+{
+	struct avp_dev *avp = AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
+	struct rte_eth_rss_conf *rss_conf;
+	unsigned int i;
+
+	rss_conf = &eth_dev->data->dev_conf.rx_adv_conf.rss_conf;
+
+	if (eth_dev->data->dev_conf.rxmode.mq_mode & ETH_MQ_RX_RSS_FLAG)
+		avp->rss_hash_types = _avp_rss_hf_to_types(rss_conf->rss_hf);
+	else
+		avp->rss_hash_types = 0;
+
+	if ((rss_conf->rss_key != NULL) &&
+	    (rss_conf->rss_key_len == RTE_AVP_RSS_KEY_SIZE))
+		memcpy(avp->rss_key, rss_conf->rss_key, RTE_AVP_RSS_KEY_SIZE);
+	else
+		memcpy(avp->rss_key, avp_rss_default_key,
+		       RTE_AVP_RSS_KEY_SIZE);
+
+	for (i = 0; i < RTE_AVP_RSS_RETA_SIZE; i++)
+		avp->reta[i] = i % eth_dev->data->nb_rx_queues;
+
+	avp_dev_rss_negotiate(eth_dev);
+}
+
+/*
+ * Negotiate carrying small packets in the descriptor extension.  Zero-copy
+ * receive hands the host buffer data area to the application so it cannot
+ * accept inline packets, and compact descriptors have no extension.  Must be
+ * called prior to sending the device configuration to the host.
+ */
+static void
+avp_dev_inline_negotiate(struct rte_eth_dev *eth_dev)
+{
+	struct rte_pci_device *pci_dev = AVP_DEV_TO_PCI(eth_dev);
+	struct avp_dev *avp = AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
+	struct rte_avp_device_info *host_info;
+
+	host_info = pci_dev->mem_resource[RTE_AVP_PCI_DEVICE_BAR].addr;
+
+	if ((host_info->features & RTE_AVP_FEATURE_INLINE) &&
+	    (host_info->inline_len != 0) &&
+	    !(avp->flags & AVP_F_CDESC) &&
+	    !(avp->options & AVP_OPT_ZERO_COPY_RX)) {
+		avp->features |= RTE_AVP_FEATURE_INLINE;
+		avp->inline_len = RTE_MIN(host_info->inline_len,
+					  (uint32_t)RTE_AVP_INLINE_MAX_LEN);
+	} else {
+		avp->features &= ~RTE_AVP_FEATURE_INLINE;
+		avp->inline_len = 0;
+	}
+
+	PMD_DRV_LOG(DEBUG, "AVP inline packet length is %u\n",
+		    avp->inline_len);
+}
+
+/* checksum and segmentation offload features */
+#define AVP_OFFLOAD_FEATURES \
+	(RTE_AVP_FEATURE_RX_CSUM | RTE_AVP_FEATURE_TX_CSUM | RTE_AVP_FEATURE_TSO)
+
+/*
+ * Negotiate the checksum and segmentation offloads.  Transmit offloads are
+ * requested per packet so they are enabled whenever the host supports them,
+ * whereas receive checksum validation must be enabled by the application.
+ * Must be called prior to sending the device configuration to the host.
+ */
+static void
+avp_dev_offload_negotiate(struct rte_eth_dev *eth_dev)
+{
+	struct rte_pci_device *pci_dev = AVP_DEV_TO_PCI(eth_dev);
+	struct avp_dev *avp = AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
+	struct rte_avp_device_info *host_info;
+	uint32_t wanted;
+
+	host_info = pci_dev->mem_resource[RTE_AVP_PCI_DEVICE_BAR].addr;
+
+	wanted = RTE_AVP_FEATURE_TX_CSUM | RTE_AVP_FEATURE_TSO;
+	if (eth_dev->data->dev_conf.rxmode.hw_ip_checksum)
+		wanted |= RTE_AVP_FEATURE_RX_CSUM;
+
+	avp->features &= ~AVP_OFFLOAD_FEATURES;
+	avp->features |= (host_info->features & wanted);
+}
+
+/*
+ * Negotiate receive queue interrupts.  They are only requested when enabled
+ * by the application since the host must then check whether an interrupt is
+ * armed each time it adds packets to a receive fifo.  Must be called prior to
+ * sending the device configuration to the host.
+ */
+static void
+avp_dev_rx_intr_negotiate(struct rte_eth_dev *eth_dev)
+{
+	struct rte_pci_device *pci_dev = AVP_DEV_TO_PCI(eth_dev);
+	struct avp_dev *avp = AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
+	struct rte_avp_device_info *host_info;
+
+	host_info = pci_dev->mem_resource[RTE_AVP_PCI_DEVICE_BAR].addr;
+
+	avp->features &= ~RTE_AVP_FEATURE_RX_INTR;
+#ifdef AVP_RX_INTR
+	if (eth_dev->data->dev_conf.intr_conf.rxq)
+		avp->features |= (host_info->features &
+				  RTE_AVP_FEATURE_RX_INTR);
+#endif
+}
+
 static int
 avp_dev_attach(struct rte_eth_dev *eth_dev)
 {
 	struct avp_dev *avp = AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
 	struct rte_avp_device_config config;
+	uint64_t blackout;
+	uint32_t cdesc;
 	unsigned int i;
 	int ret;
 
@@ -703,10 +1872,16 @@ avp_dev_attach(struct rte_eth_dev *eth_dev)
 	avp->flags |= AVP_F_DETACHED;
 	rte_wmb();
 
+	/* the new host may not support the flow hash or offload features */
+	avp->features &= ~(RTE_AVP_FEATURE_RSS | RTE_AVP_FEATURE_INLINE |
+			   AVP_OFFLOAD_FEATURES | RTE_AVP_FEATURE_RX_INTR);
+	avp->inline_len = 0;
+
 	/*
 	 * re-run the device create utility which will parse the new host info
 	 * and setup the AVP device queue pointers.
 	 */
+	cdesc = avp->flags & AVP_F_CDESC;
 	ret = avp_dev_create(AVP_DEV_TO_PCI(eth_dev), eth_dev);
 	if (ret < 0) {
 		PMD_DRV_LOG(ERR, "Failed to re-create AVP device, ret=%d\n",
@@ -714,6 +1889,17 @@ avp_dev_attach(struct rte_eth_dev *eth_dev)
 		goto unlock;
 	}
 
+	if (cdesc != (avp->flags & AVP_F_CDESC)) {
+		/* the new host exchanges a different descriptor format */
+		avp_dev_set_burst_functions(eth_dev);
+	}
+
+	/*
+	 * buffers acquired from the previous host must never be handed to the
+	 * new one.
+	 */
+	avp->epoch++;
+
 	if (avp->flags & AVP_F_CONFIGURED) {
 		/*
 		 * Update the receive queue mapping to handle cases where the
@@ -725,6 +1911,13 @@ avp_dev_attach(struct rte_eth_dev *eth_dev)
 		_avp_set_queue_counts(eth_dev);
 		for (i = 0; i < eth_dev->data->nb_rx_queues; i++)
 			_avp_set_rx_queue_mappings(eth_dev, i);
+		avp_dev_rss_negotiate(eth_dev);
+		avp_dev_inline_negotiate(eth_dev);
+		avp_dev_offload_negotiate(eth_dev);
+		avp_dev_rx_intr_negotiate(eth_dev);
+
+		/* the transmit function depends on segmentation offload */
+		avp_dev_set_burst_functions(eth_dev);
 
 		/*
 		 * Update the host with our config details so that it knows the
@@ -745,11 +1938,36 @@ avp_dev_attach(struct rte_eth_dev *eth_dev)
 				    ret);
 			goto unlock;
 		}
+
+		ret = avp_dev_rss_apply(eth_dev);
+		if (ret < 0)
+			goto unlock;
 	}
 
+#ifdef AVP_TX_MP
+	/* the fifos of the new host start from their initial positions */
+	avp_dev_tx_mp_reset(avp);
+#endif
+
 	rte_wmb();
 	avp->flags &= ~AVP_F_DETACHED;
 
+	avp->attaches++;
+	if (avp->detach_tsc != 0) {
+		blackout = rte_rdtsc() - avp->detach_tsc;
+		avp->blackout_cycles += blackout;
+		avp->blackout_max = RTE_MAX(avp->blackout_max, blackout);
+		avp->detach_tsc = 0;
+	}
+
+#ifdef AVP_RX_INTR
+	/*
+	 * Receive fifos armed on the previous host are not armed on this one;
+	 * wake up any queue that is waiting so that it polls and re-arms.
+	 */
+	avp_dev_rx_intr_wakeup(eth_dev);
+#endif
+
 	ret = 0;
 
 unlock:
@@ -809,6 +2027,9 @@ avp_dev_interrupt_handler(struct rte_intr_handle *intr_handle,
 		PMD_DRV_LOG(WARNING, "AVP unexpected interrupt, status=0x%08x\n",
 			    status);
 
+	if (AVP_DEV_EMULATED(pci_dev))
+		return;
+
 	/* re-enable UIO interrupt handling */
 	ret = rte_intr_enable(intr_handle);
 	if (ret < 0) {
@@ -829,7 +2050,8 @@ avp_dev_enable_interrupts(struct rte_eth_dev *eth_dev)
 		return -EINVAL;
 
 	/* enable UIO interrupt handling */
-	ret = rte_intr_enable(&pci_dev->intr_handle);
+	ret = AVP_DEV_EMULATED(pci_dev) ? 0 :
+		rte_intr_enable(&pci_dev->intr_handle);
 	if (ret < 0) {
 		PMD_DRV_LOG(ERR, "Failed to enable UIO interrupts, ret=%d\n",
 			    ret);
@@ -858,7 +2080,8 @@ avp_dev_disable_interrupts(struct rte_eth_dev *eth_dev)
 		    RTE_PTR_ADD(registers, RTE_AVP_INTERRUPT_MASK_OFFSET));
 
 	/* enable UIO interrupt handling */
-	ret = rte_intr_disable(&pci_dev->intr_handle);
+	ret = AVP_DEV_EMULATED(pci_dev) ? 0 :
+		rte_intr_disable(&pci_dev->intr_handle);
 	if (ret < 0) {
 		PMD_DRV_LOG(ERR, "Failed to disable UIO interrupts, ret=%d\n",
 			    ret);
@@ -875,9 +2098,10 @@ avp_dev_setup_interrupts(struct rte_eth_dev *eth_dev)
 	int ret;
 
 	/* register a callback handler with UIO for interrupt notifications */
-	ret = rte_intr_callback_register(&pci_dev->intr_handle,
-					 avp_dev_interrupt_handler,
-					 (void *)eth_dev);
+	ret = AVP_DEV_EMULATED(pci_dev) ? 0 :
+		rte_intr_callback_register(&pci_dev->intr_handle,
+					   avp_dev_interrupt_handler,
+					   (void *)eth_dev);
 	if (ret < 0) {
 		PMD_DRV_LOG(ERR, "Failed to register UIO interrupt callback, ret=%d\n",
 			    ret);
@@ -888,52 +2112,262 @@ avp_dev_setup_interrupts(struct rte_eth_dev *eth_dev)
 	return avp_dev_enable_interrupts(eth_dev);
 }
 
+#ifdef AVP_RX_INTR
+/*
+ * Bind one event fd per receive queue to the MSI-X vectors that follow the
+ * migration vector.  Only vfio-pci supports more than a single vector.
+ */
 static int
-avp_dev_migration_pending(struct rte_eth_dev *eth_dev)
+avp_dev_rx_intr_setup(struct rte_eth_dev *eth_dev)
 {
 	struct rte_pci_device *pci_dev = AVP_DEV_TO_PCI(eth_dev);
-	void *registers = pci_dev->mem_resource[RTE_AVP_PCI_MMIO_BAR].addr;
-	uint32_t value;
+	struct rte_intr_handle *intr_handle = &pci_dev->intr_handle;
+	unsigned int nb_rx_queues = eth_dev->data->nb_rx_queues;
+	unsigned int i;
+	int ret;
 
-	if (registers == NULL)
-		return 0;
+	if (intr_handle->type != RTE_INTR_HANDLE_VFIO_MSIX) {
+		PMD_DRV_LOG(ERR, "Receive queue interrupts require vfio-pci MSI-X support\n");
+		return -ENOTSUP;
+	}
 
-	value = AVP_READ32(RTE_PTR_ADD(registers,
-				       RTE_AVP_MIGRATION_STATUS_OFFSET));
-	if (value == RTE_AVP_MIGRATION_DETACHED) {
-		/* migration is in progress; ack it if we have not already */
-		AVP_WRITE32(value,
-			    RTE_PTR_ADD(registers,
-					RTE_AVP_MIGRATION_ACK_OFFSET));
-		return 1;
+	if (intr_handle->intr_vec != NULL)
+		return 0; /* restarted */
+
+	if (RTE_AVP_RX_MSIX_VECTOR_BASE + nb_rx_queues >
+	    RTE_AVP_MAX_MSIX_VECTORS) {
+		PMD_DRV_LOG(ERR, "Too many receive queue interrupts, %u > %u\n",
+			    nb_rx_queues,
+			    RTE_AVP_MAX_MSIX_VECTORS -
+			    RTE_AVP_RX_MSIX_VECTOR_BASE);
+		return -EINVAL;
 	}
-	return 0;
+
+	/*
+	 * vfio binds event fd i to MSI-X vector RTE_INTR_VEC_RXTX_OFFSET + i
+	 * so the vector raised by the host for a queue must be the same.
+	 */
+	RTE_BUILD_BUG_ON(RTE_AVP_RX_MSIX_VECTOR_BASE !=
+			 RTE_INTR_VEC_RXTX_OFFSET);
+
+	/* the vectors are only bound to their event fds when enabled */
+	rte_intr_disable(intr_handle);
+
+	ret = rte_intr_efd_enable(intr_handle, nb_rx_queues);
+	if (ret != 0) {
+		PMD_DRV_LOG(ERR, "Failed to create receive queue event fds, ret=%d\n",
+			    ret);
+		goto enable;
+	}
+
+	intr_handle->intr_vec = rte_zmalloc("avp_intr_vec",
+					    nb_rx_queues * sizeof(int), 0);
+	if (intr_handle->intr_vec == NULL) {
+		PMD_DRV_LOG(ERR, "Failed to allocate %u receive queue vectors\n",
+			    nb_rx_queues);
+		rte_intr_efd_disable(intr_handle);
+		ret = -ENOMEM;
+		goto enable;
+	}
+
+	for (i = 0; i < nb_rx_queues; i++)
+		intr_handle->intr_vec[i] = RTE_INTR_VEC_RXTX_OFFSET + i;
+
+	ret = 0;
+
+enable:
+	if (rte_intr_enable(intr_handle) < 0)
+		PMD_DRV_LOG(ERR, "Failed to re-enable interrupts\n");
+	return ret;
 }
 
 /*
- * create a AVP device using the supplied device info by first translating it
- * to guest address space(s).
+ * write the receive interrupt control register of each fifo of a queue; the
+ * vector is the MSI-X vector raised by the host, or 0 to disable.
  */
-static int
-avp_dev_create(struct rte_pci_device *pci_dev,
-	       struct rte_eth_dev *eth_dev)
+static void
+avp_dev_rx_intr_arm(struct rte_eth_dev *eth_dev, struct avp_queue *rxq,
+		    uint32_t vector)
 {
-	struct avp_dev *avp = AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
-	struct rte_avp_device_info *host_info;
-#if RTE_VERSION >= RTE_VERSION_NUM(16, 11, 0, 0)
-	struct rte_mem_resource *resource;
-#else
-	struct rte_pci_resource *resource;
-#endif
+	struct rte_pci_device *pci_dev = AVP_DEV_TO_PCI(eth_dev);
+	void *registers = pci_dev->mem_resource[RTE_AVP_PCI_MMIO_BAR].addr;
 	unsigned int i;
 
-	resource = &pci_dev->mem_resource[RTE_AVP_PCI_DEVICE_BAR];
-	if (resource->addr == NULL) {
-		PMD_DRV_LOG(ERR, "BAR%u is not mapped\n",
-			    RTE_AVP_PCI_DEVICE_BAR);
-		return -EFAULT;
-	}
-	host_info = (struct rte_avp_device_info *)resource->addr;
+	if (registers == NULL)
+		return;
+
+	for (i = rxq->queue_base; i <= rxq->queue_limit; i++)
+		AVP_WRITE32(vector,
+			    RTE_PTR_ADD(registers,
+					RTE_AVP_RX_INTERRUPT_OFFSET(i)));
+}
+
+/* signal the event fd of a receive queue as if the host had raised it */
+static void
+avp_dev_rx_intr_signal(struct rte_intr_handle *intr_handle,
+		       uint16_t rx_queue_id)
+{
+	uint64_t value = 1;
+	int efd;
+
+	efd = intr_handle->efds[intr_handle->intr_vec[rx_queue_id] -
+				RTE_INTR_VEC_RXTX_OFFSET];
+	if (write(efd, &value, sizeof(value)) != sizeof(value))
+		PMD_DRV_LOG(DEBUG, "Failed to signal receive queue %u event fd\n",
+			    rx_queue_id);
+}
+
+static void
+avp_dev_rx_intr_wakeup(struct rte_eth_dev *eth_dev)
+{
+	struct rte_pci_device *pci_dev = AVP_DEV_TO_PCI(eth_dev);
+	struct rte_intr_handle *intr_handle = &pci_dev->intr_handle;
+	struct avp_queue *rxq;
+	uint16_t i;
+
+	if (intr_handle->intr_vec == NULL)
+		return;
+
+	/* order the DETACHED flag update against avp_dev_rx_queue_intr_enable */
+	rte_mb();
+
+	for (i = 0; i < eth_dev->data->nb_rx_queues; i++) {
+		rxq = eth_dev->data->rx_queues[i];
+		if ((rxq != NULL) && rxq->intr_armed)
+			avp_dev_rx_intr_signal(intr_handle, i);
+	}
+}
+
+static void
+avp_dev_rx_intr_teardown(struct rte_eth_dev *eth_dev)
+{
+	struct rte_pci_device *pci_dev = AVP_DEV_TO_PCI(eth_dev);
+	struct rte_intr_handle *intr_handle = &pci_dev->intr_handle;
+	struct avp_queue *rxq;
+	uint16_t i;
+
+	if (intr_handle->intr_vec == NULL)
+		return;
+
+	for (i = 0; i < eth_dev->data->nb_rx_queues; i++) {
+		rxq = eth_dev->data->rx_queues[i];
+		if (rxq == NULL)
+			continue;
+		rxq->intr_armed = 0;
+		avp_dev_rx_intr_arm(eth_dev, rxq, 0);
+	}
+
+	/* keep the migration interrupt enabled */
+	rte_intr_disable(intr_handle);
+	rte_intr_efd_disable(intr_handle);
+	rte_free(intr_handle->intr_vec);
+	intr_handle->intr_vec = NULL;
+	if (rte_intr_enable(intr_handle) < 0)
+		PMD_DRV_LOG(ERR, "Failed to re-enable interrupts\n");
+}
+
+static int
+avp_dev_rx_queue_intr_enable(struct rte_eth_dev *eth_dev, uint16_t rx_queue_id)
+{
+	struct avp_dev *avp = AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
+	struct rte_pci_device *pci_dev = AVP_DEV_TO_PCI(eth_dev);
+	struct rte_intr_handle *intr_handle = &pci_dev->intr_handle;
+	struct avp_queue *rxq = eth_dev->data->rx_queues[rx_queue_id];
+	unsigned int pending = 0;
+	unsigned int i;
+
+	if (intr_handle->intr_vec == NULL)
+		return -ENOTSUP;
+
+	rxq->intr_armed = 1;
+	rte_mb();
+
+	if (avp->flags & AVP_F_DETACHED)
+		return 0; /* signalled by avp_dev_attach() */
+
+	avp_dev_rx_intr_arm(eth_dev, rxq,
+			    RTE_AVP_RX_MSIX_VECTOR_BASE + rx_queue_id);
+
+	/*
+	 * Packets added before the fifos were armed do not raise an interrupt
+	 * so signal the queue here rather than leave them unserviced.
+	 */
+	rte_mb();
+	for (i = rxq->queue_base; i <= rxq->queue_limit; i++)
+		pending += avp_dev_fifo_level(avp, avp->rx_q[i]);
+	if (pending != 0)
+		avp_dev_rx_intr_signal(intr_handle, rx_queue_id);
+
+	return 0;
+}
+
+static int
+avp_dev_rx_queue_intr_disable(struct rte_eth_dev *eth_dev, uint16_t rx_queue_id)
+{
+	struct avp_dev *avp = AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
+	struct rte_pci_device *pci_dev = AVP_DEV_TO_PCI(eth_dev);
+	struct avp_queue *rxq = eth_dev->data->rx_queues[rx_queue_id];
+
+	if (pci_dev->intr_handle.intr_vec == NULL)
+		return -ENOTSUP;
+
+	rxq->intr_armed = 0;
+
+	if (!(avp->flags & AVP_F_DETACHED))
+		avp_dev_rx_intr_arm(eth_dev, rxq, 0);
+
+	return 0;
+}
+#endif
+
+static int
+avp_dev_migration_pending(struct rte_eth_dev *eth_dev)
+{
+	struct rte_pci_device *pci_dev = AVP_DEV_TO_PCI(eth_dev);
+	void *registers = pci_dev->mem_resource[RTE_AVP_PCI_MMIO_BAR].addr;
+	uint32_t value;
+
+	if (registers == NULL)
+		return 0;
+
+	value = AVP_READ32(RTE_PTR_ADD(registers,
+				       RTE_AVP_MIGRATION_STATUS_OFFSET));
+	if (value == RTE_AVP_MIGRATION_DETACHED) {
+		/* migration is in progress; ack it if we have not already */
+		AVP_WRITE32(value,
+			    RTE_PTR_ADD(registers,
+					RTE_AVP_MIGRATION_ACK_OFFSET));
+		return 1;
+	}
+	return 0;
+}
+
+/*
+ * create a AVP device using the supplied device info by first translating it
+ * to guest address space(s).
+ */
+static int
+avp_dev_create(struct rte_pci_device *pci_dev,
+	       struct rte_eth_dev *eth_dev)
+{
+	struct avp_dev *avp = AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
+	struct rte_avp_device_info *host_info;
+#if RTE_VERSION >= RTE_VERSION_NUM(16, 11, 0, 0)
+	struct rte_mem_resource *resource;
+#else
+	struct rte_pci_resource *resource;
+#endif
+	struct avp_memmap_index *index;
+	struct avp_mempool_map *pool;
+	unsigned int i;
+
+	resource = &pci_dev->mem_resource[RTE_AVP_PCI_DEVICE_BAR];
+	if (resource->addr == NULL) {
+		PMD_DRV_LOG(ERR, "BAR%u is not mapped\n",
+			    RTE_AVP_PCI_DEVICE_BAR);
+		return -EFAULT;
+	}
+	host_info = (struct rte_avp_device_info *)resource->addr;
 
 	if ((host_info->magic != RTE_AVP_DEVICE_MAGIC) ||
 		avp_dev_version_check(host_info->version)) {
@@ -988,16 +2422,43 @@ avp_dev_create(struct rte_pci_device *pci_dev,
 	/* the device id is allowed to change over migrations */
 	avp->device_id = host_info->device_id;
 
+	/* the FIFO layout may change if migrated to a different host version */
+	if (RTE_AVP_STRIP_MINOR_VERSION(host_info->version) >=
+	    RTE_AVP_STRIP_MINOR_VERSION(RTE_AVP_FIFO_V3_VERSION))
+		avp->flags |= AVP_F_FIFO_V3;
+	else
+		avp->flags &= ~AVP_F_FIFO_V3;
+
+	/* as are the packet descriptors */
+	if (RTE_AVP_STRIP_MINOR_VERSION(host_info->version) >=
+	    RTE_AVP_STRIP_MINOR_VERSION(RTE_AVP_CDESC_VERSION)) {
+		if (host_info->buf_stride == 0) {
+			PMD_DRV_LOG(ERR, "Invalid AVP host buffer stride\n");
+			return -EINVAL;
+		}
+		avp->flags |= AVP_F_CDESC;
+		avp->buf_stride = host_info->buf_stride;
+	} else {
+		avp->flags &= ~AVP_F_CDESC;
+		avp->buf_stride = 0;
+	}
+
 	/* translate incoming host addresses to guest address space */
+	index = avp_dev_memmap_index_create(pci_dev);
+	if (index == NULL) {
+		PMD_DRV_LOG(ERR, "Failed to allocate memory map index\n");
+		return -ENOMEM;
+	}
+
 	PMD_DRV_LOG(DEBUG, "AVP first host tx queue at 0x%" PRIx64 "\n",
 		    host_info->tx_phys);
 	PMD_DRV_LOG(DEBUG, "AVP first host alloc queue at 0x%" PRIx64 "\n",
 		    host_info->alloc_phys);
 	for (i = 0; i < avp->max_tx_queues; i++) {
-		avp->tx_q[i] = avp_dev_translate_address(eth_dev,
+		avp->tx_q[i] = avp_dev_translate_address(index,
 			host_info->tx_phys + (i * host_info->tx_size));
 
-		avp->alloc_q[i] = avp_dev_translate_address(eth_dev,
+		avp->alloc_q[i] = avp_dev_translate_address(index,
 			host_info->alloc_phys + (i * host_info->alloc_size));
 	}
 
@@ -1006,9 +2467,9 @@ avp_dev_create(struct rte_pci_device *pci_dev,
 	PMD_DRV_LOG(DEBUG, "AVP first host free queue at 0x%" PRIx64 "\n",
 		    host_info->free_phys);
 	for (i = 0; i < avp->max_rx_queues; i++) {
-		avp->rx_q[i] = avp_dev_translate_address(eth_dev,
+		avp->rx_q[i] = avp_dev_translate_address(index,
 			host_info->rx_phys + (i * host_info->rx_size));
-		avp->free_q[i] = avp_dev_translate_address(eth_dev,
+		avp->free_q[i] = avp_dev_translate_address(index,
 			host_info->free_phys + (i * host_info->free_size));
 	}
 
@@ -1020,19 +2481,59 @@ avp_dev_create(struct rte_pci_device *pci_dev,
 		    host_info->sync_phys);
 	PMD_DRV_LOG(DEBUG, "AVP host mbuf address at 0x%" PRIx64 "\n",
 		    host_info->mbuf_phys);
-	avp->req_q = avp_dev_translate_address(eth_dev, host_info->req_phys);
-	avp->resp_q = avp_dev_translate_address(eth_dev, host_info->resp_phys);
+	avp->req_q = avp_dev_translate_address(index, host_info->req_phys);
+	avp->resp_q = avp_dev_translate_address(index, host_info->resp_phys);
 	avp->sync_addr =
-		avp_dev_translate_address(eth_dev, host_info->sync_phys);
-	avp->mbuf_addr =
-		avp_dev_translate_address(eth_dev, host_info->mbuf_phys);
+		avp_dev_translate_address(index, host_info->sync_phys);
+	avp->host_sync_addr = host_info->sync_va;
 
 	/*
-	 * store the host mbuf virtual address so that we can calculate
-	 * relative offsets for each mbuf as they are processed
+	 * store the host mbuf virtual address of each pool so that we can
+	 * calculate relative offsets for each mbuf as they are processed.  Hosts
+	 * that do not describe their pools export a single memory area.
 	 */
-	avp->host_mbuf_addr = host_info->mbuf_va;
-	avp->host_sync_addr = host_info->sync_va;
+	avp->nb_pools = 0;
+	memset(avp->buf_base, 0, sizeof(avp->buf_base));
+	for (i = 0; i < RTE_AVP_MAX_MEMPOOLS; i++) {
+		if (host_info->pool[i].length == 0)
+			continue;
+
+		pool = &avp->pools[avp->nb_pools++];
+		pool->host_addr = host_info->pool[i].addr;
+		pool->length = host_info->pool[i].length;
+		pool->addr = avp_dev_translate_address(index,
+			host_info->pool[i].phys_addr);
+		avp->buf_base[i] = pool->addr;
+		PMD_DRV_LOG(DEBUG, "AVP host mbuf pool %u at 0x%" PRIx64 " length %" PRIu64 "\n",
+			    i, host_info->pool[i].phys_addr, pool->length);
+	}
+	if (avp->nb_pools == 0) {
+		pool = &avp->pools[avp->nb_pools++];
+		pool->host_addr = host_info->mbuf_va;
+		pool->length = UINT64_MAX;
+		pool->addr = avp_dev_translate_address(index,
+			host_info->mbuf_phys);
+		avp->buf_base[0] = pool->addr;
+	}
+
+	/*
+	 * the mbuf pools live in the memory BAR which is physically contiguous
+	 * from the guest point of view.
+	 */
+	resource = &pci_dev->mem_resource[RTE_AVP_PCI_MEMORY_BAR];
+	for (i = 0; i < avp->nb_pools; i++) {
+		pool = &avp->pools[i];
+		if (pool->addr == NULL) {
+			PMD_DRV_LOG(ERR, "Failed to translate host mbuf pool %u\n",
+				    i);
+			rte_free(index);
+			return -EINVAL;
+		}
+		pool->phys_addr = resource->phys_addr +
+			RTE_PTR_DIFF(pool->addr, resource->addr);
+	}
+
+	rte_free(index);
 
 	/*
 	 * store the maximum packet length that is supported by the host.
@@ -1044,814 +2545,4118 @@ avp_dev_create(struct rte_pci_device *pci_dev,
 	return 0;
 }
 
-/*
- * This function is based on probe() function in avp_pci.c
- * It returns 0 on success.
- */
+#ifdef AVP_DEVARGS
+static const char * const avp_valid_arguments[] = {
+	AVP_ZERO_COPY_RX_ARG,
+	AVP_ZERO_COPY_TX_ARG,
+	AVP_RX_POLICY_ARG,
+	AVP_TX_HOLD_PKTS_ARG,
+	AVP_TX_HOLD_BYTES_ARG,
+	AVP_TX_COPY_ARG,
+	AVP_RX_COPY_ARG,
+	AVP_TELEMETRY_ARG,
+	AVP_TX_MP_ARG,
+	NULL
+};
+
+static const char * const avp_copy_mode_names[AVP_COPY_MAX] = {
+	[AVP_COPY_MEMCPY] = "memcpy",
+	[AVP_COPY_STREAM] = "stream",
+	[AVP_COPY_AVX512] = "avx512",
+};
+
 static int
-#if RTE_VERSION < RTE_VERSION_NUM(1, 8, 0, 0)
-eth_avp_dev_init(__attribute__((__unused__)) struct eth_driver *eth_drv,
-				 struct rte_eth_dev *eth_dev)
-#else
-eth_avp_dev_init(struct rte_eth_dev *eth_dev)
-#endif
+avp_dev_parse_uint(const char *key, const char *value, void *extra_args)
 {
-	struct avp_dev *avp =
-		AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
-	struct rte_pci_device *pci_dev;
-	int ret;
+	uint64_t *result = extra_args;
+	char *end = NULL;
+
+	errno = 0;
+	*result = strtoull(value, &end, 0);
+	if ((errno != 0) || (end == value) || (*end != '\0') ||
+	    (value[0] == '-')) {
+		PMD_DRV_LOG(ERR, "Invalid value \"%s\" for argument %s\n",
+			    value, key);
+		return -EINVAL;
+	}
 
-	pci_dev = AVP_DEV_TO_PCI(eth_dev);
-	eth_dev->dev_ops = &avp_eth_dev_ops;
-	eth_dev->rx_pkt_burst = &avp_recv_pkts;
-	eth_dev->tx_pkt_burst = &avp_xmit_pkts;
+	return 0;
+}
 
-	if (rte_eal_process_type() != RTE_PROC_PRIMARY) {
-		/*
-		 * no setup required on secondary processes.  All data is saved
-		 * in dev_private by the primary process. All resource should
-		 * be mapped to the same virtual address so all pointers should
-		 * be valid.
-		 */
-		if (eth_dev->data->scattered_rx) {
-			PMD_DRV_LOG(NOTICE, "AVP device configured for chained mbufs\n");
-			eth_dev->rx_pkt_burst = avp_recv_scattered_pkts;
-			eth_dev->tx_pkt_burst = avp_xmit_scattered_pkts;
-		}
-		return 0;
+static int
+avp_dev_parse_rx_policy(const char *key, const char *value, void *extra_args)
+{
+	enum avp_rx_policy *policy = extra_args;
+
+	if (strcmp(value, "rr") == 0) {
+		*policy = AVP_RX_POLICY_RR;
+	} else if (strcmp(value, "drain") == 0) {
+		*policy = AVP_RX_POLICY_DRAIN;
+	} else if (strcmp(value, "weighted") == 0) {
+		*policy = AVP_RX_POLICY_WEIGHTED;
+	} else {
+		PMD_DRV_LOG(ERR, "Invalid value \"%s\" for argument %s\n",
+			    value, key);
+		return -EINVAL;
 	}
 
-#if RTE_VERSION >= RTE_VERSION_NUM(2, 2, 0, 0)
-	rte_eth_copy_pci_info(eth_dev, pci_dev);
-#endif
-#if RTE_VERSION > RTE_VERSION_NUM(17, 2, 0, 0)
-	eth_dev->data->dev_flags |= RTE_ETH_DEV_DETACHABLE;
-#endif
+	return 0;
+}
 
-	/* Check current migration status */
-	if (avp_dev_migration_pending(eth_dev)) {
-		PMD_DRV_LOG(ERR, "VM live migration operation in progress\n");
-		return -EBUSY;
-	}
+static int
+avp_dev_parse_copy_mode(const char *key, const char *value, void *extra_args)
+{
+	enum avp_copy_mode *mode = extra_args;
+	unsigned int i;
 
-	/* Check BAR resources */
-	ret = avp_dev_check_regions(eth_dev);
-	if (ret < 0) {
-		PMD_DRV_LOG(ERR, "Failed to validate BAR resources, ret=%d\n",
-			    ret);
-		return ret;
+	for (i = 0; i < AVP_COPY_MAX; i++) {
+		if (strcmp(value, avp_copy_mode_names[i]) == 0) {
+			*mode = i;
+			return 0;
+		}
 	}
 
-	/* Enable interrupts */
-	ret = avp_dev_setup_interrupts(eth_dev);
-	if (ret < 0) {
-		PMD_DRV_LOG(ERR, "Failed to enable interrupts, ret=%d\n", ret);
-		return ret;
-	}
+	PMD_DRV_LOG(ERR, "Invalid value \"%s\" for argument %s\n",
+		    value, key);
+	return -EINVAL;
+}
 
-	/* Handle each subtype */
-	ret = avp_dev_create(pci_dev, eth_dev);
-	if (ret < 0) {
-		PMD_DRV_LOG(ERR, "Failed to create device, ret=%d\n", ret);
-		return ret;
-	}
+/*
+ * Downgrade a copy engine that is not built in or is not supported by the
+ * running processor to the next best one.
+ */
+static enum avp_copy_mode
+avp_dev_copy_mode_check(struct rte_eth_dev *eth_dev, const char *key,
+			enum avp_copy_mode mode)
+{
+	enum avp_copy_mode requested = mode;
 
-	/* Allocate memory for storing MAC addresses */
-	eth_dev->data->mac_addrs = rte_zmalloc("avp_ethdev", ETHER_ADDR_LEN, 0);
-	if (eth_dev->data->mac_addrs == NULL) {
-		PMD_DRV_LOG(ERR, "Failed to allocate %d bytes needed to store MAC addresses\n",
-			    ETHER_ADDR_LEN);
-		return -ENOMEM;
+	if (mode == AVP_COPY_AVX512) {
+#ifdef AVP_COPY_HAVE_AVX512
+		if (rte_cpu_get_flag_enabled(RTE_CPUFLAG_AVX512F) <= 0)
+			mode = AVP_COPY_STREAM;
+#else
+		mode = AVP_COPY_STREAM;
+#endif
 	}
 
-	/* Get a mac from device config */
-	ether_addr_copy(&avp->ethaddr, &eth_dev->data->mac_addrs[0]);
+#ifndef AVP_COPY_HAVE_STREAM
+	if (mode == AVP_COPY_STREAM)
+		mode = AVP_COPY_MEMCPY;
+#endif
+
+	if (mode != requested)
+		PMD_DRV_LOG(NOTICE, "AVP %s=%s not supported on port %u; using %s\n",
+			    key, avp_copy_mode_names[requested],
+			    eth_dev->data->port_id, avp_copy_mode_names[mode]);
+
+	return mode;
+}
+
+static int
+avp_dev_parse_bool(const char *key, const char *value, void *extra_args)
+{
+	int *enabled = extra_args;
+
+	if ((strcmp(value, "0") != 0) && (strcmp(value, "1") != 0)) {
+		PMD_DRV_LOG(ERR, "Invalid value \"%s\" for argument %s\n",
+			    value, key);
+		return -EINVAL;
+	}
 
+	*enabled = (value[0] == '1');
 	return 0;
 }
 
-#if RTE_VERSION >= RTE_VERSION_NUM(2, 0, 0, 0)
 static int
-eth_avp_dev_uninit(struct rte_eth_dev *eth_dev)
+avp_dev_parse_devargs(struct rte_eth_dev *eth_dev)
 {
+	struct avp_dev *avp = AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
+	struct rte_devargs *devargs = AVP_DEV_TO_PCI(eth_dev)->device.devargs;
+	struct rte_kvargs *kvlist;
+	uint64_t value;
+	int enabled;
 	int ret;
 
-	if (rte_eal_process_type() != RTE_PROC_PRIMARY)
-		return -EPERM;
-
-	if (eth_dev->data == NULL)
+	if (devargs == NULL)
 		return 0;
 
-	ret = avp_dev_disable_interrupts(eth_dev);
-	if (ret != 0) {
-		PMD_DRV_LOG(ERR, "Failed to disable interrupts, ret=%d\n", ret);
-		return ret;
+	kvlist = rte_kvargs_parse(devargs->args, avp_valid_arguments);
+	if (kvlist == NULL) {
+		PMD_DRV_LOG(ERR, "Invalid device arguments \"%s\"\n",
+			    devargs->args);
+		return -EINVAL;
 	}
 
-	if (eth_dev->data->mac_addrs != NULL) {
-		rte_free(eth_dev->data->mac_addrs);
-		eth_dev->data->mac_addrs = NULL;
+	enabled = 0;
+	ret = rte_kvargs_process(kvlist, AVP_ZERO_COPY_RX_ARG,
+				 avp_dev_parse_bool, &enabled);
+	if (ret < 0)
+		goto done;
+	if (enabled) {
+		PMD_DRV_LOG(NOTICE, "AVP zero-copy receive enabled on port %u\n",
+			    eth_dev->data->port_id);
+		avp->options |= AVP_OPT_ZERO_COPY_RX;
 	}
 
-	return 0;
-}
-#endif
+	enabled = 0;
+	ret = rte_kvargs_process(kvlist, AVP_ZERO_COPY_TX_ARG,
+				 avp_dev_parse_bool, &enabled);
+	if (ret < 0)
+		goto done;
+	if (enabled) {
+		PMD_DRV_LOG(NOTICE, "AVP zero-copy transmit enabled on port %u\n",
+			    eth_dev->data->port_id);
+		avp->options |= AVP_OPT_ZERO_COPY_TX;
+	}
 
+	ret = rte_kvargs_process(kvlist, AVP_RX_POLICY_ARG,
+				 avp_dev_parse_rx_policy, &avp->rx_policy);
+	if (ret < 0)
+		goto done;
 
-static struct eth_driver rte_avp_pmd = {
-	{
-#if RTE_VERSION < RTE_VERSION_NUM(16, 11, 0, 0)
-		.name = "rte_avp_pmd",
-#endif
-		.id_table = pci_id_avp_map,
-#if RTE_VERSION < RTE_VERSION_NUM(1, 7, 0, 0)
-#ifdef RTE_EAL_UNBIND_PORTS
-		.drv_flags = RTE_PCI_DRV_NEED_IGB_UIO,
-#endif
-#elif RTE_VERSION < RTE_VERSION_NUM(2, 0, 0, 0)
-		.drv_flags = RTE_PCI_DRV_NEED_MAPPING,
-#elif RTE_VERSION <= RTE_VERSION_NUM(17, 2, 0, 0)
-		.drv_flags = RTE_PCI_DRV_NEED_MAPPING | RTE_PCI_DRV_DETACHABLE,
-#else
-		.drv_flags = RTE_PCI_DRV_NEED_MAPPING,
-#endif
-#if RTE_VERSION >= RTE_VERSION_NUM(16, 11, 0, 0)
-		.probe = rte_eth_dev_pci_probe,
-		.remove = rte_eth_dev_pci_remove,
-#endif
-	},
-	.eth_dev_init = eth_avp_dev_init,
-#if RTE_VERSION >= RTE_VERSION_NUM(2, 0, 0, 0)
-	.eth_dev_uninit = eth_avp_dev_uninit,
-#endif
-	.dev_private_size = sizeof(struct avp_adapter),
-};
+	value = 0;
+	ret = rte_kvargs_process(kvlist, AVP_TX_HOLD_PKTS_ARG,
+				 avp_dev_parse_uint, &value);
+	if (ret < 0)
+		goto done;
+	if (value > AVP_TX_HOLD_MAX_PKTS) {
+		PMD_DRV_LOG(ERR, "Invalid value %" PRIu64 " for argument %s; maximum is %u\n",
+			    value, AVP_TX_HOLD_PKTS_ARG, AVP_TX_HOLD_MAX_PKTS);
+		ret = -EINVAL;
+		goto done;
+	}
+	avp->tx_hold_pkts = value;
 
-/*
- * Driver initialization routine.
- * Invoked once at EAL init time.
- * Registers itself as the [Poll Mode] Driver of PCI AVP devices.
- * Returns 0 on success.
- */
-#if RTE_VERSION >= RTE_VERSION_NUM(1, 7, 0, 0)
-#if RTE_VERSION < RTE_VERSION_NUM(16, 11, 0, 0)
-static int
-rte_avp_pmd_init(const char *name __rte_unused, const char *param __rte_unused)
-{
-	/* Register the AVP ethernet driver */
-	rte_eth_driver_register(&rte_avp_pmd);
-	return 0;
-}
-#endif
-#else
-int
-rte_avp_pmd_init(void)
-{
-	/* Register the AVP ethernet driver */
-	rte_eth_driver_register(&rte_avp_pmd);
-	return 0;
-}
-#endif
+	value = 0;
+	ret = rte_kvargs_process(kvlist, AVP_TX_HOLD_BYTES_ARG,
+				 avp_dev_parse_uint, &value);
+	if (ret < 0)
+		goto done;
+	avp->tx_hold_bytes = value;
 
+	if (avp->tx_hold_pkts != 0)
+		PMD_DRV_LOG(NOTICE, "AVP transmit hold of %u packets enabled on port %u\n",
+			    avp->tx_hold_pkts, eth_dev->data->port_id);
 
-static int
-avp_dev_enable_scattered(struct rte_eth_dev *eth_dev,
-			 struct avp_dev *avp)
-{
-	unsigned int max_rx_pkt_len;
+	ret = rte_kvargs_process(kvlist, AVP_TX_COPY_ARG,
+				 avp_dev_parse_copy_mode, &avp->tx_copy);
+	if (ret < 0)
+		goto done;
+	avp->tx_copy = avp_dev_copy_mode_check(eth_dev, AVP_TX_COPY_ARG,
+					       avp->tx_copy);
 
-	max_rx_pkt_len = eth_dev->data->dev_conf.rxmode.max_rx_pkt_len;
+	ret = rte_kvargs_process(kvlist, AVP_RX_COPY_ARG,
+				 avp_dev_parse_copy_mode, &avp->rx_copy);
+	if (ret < 0)
+		goto done;
+	avp->rx_copy = avp_dev_copy_mode_check(eth_dev, AVP_RX_COPY_ARG,
+					       avp->rx_copy);
 
-	if ((max_rx_pkt_len > avp->guest_mbuf_size) ||
-	    (max_rx_pkt_len > avp->host_mbuf_size)) {
-		/*
-		 * If the guest MTU is greater than either the host or guest
-		 * buffers then chained mbufs have to be enabled in the TX
-		 * direction.  It is assumed that the application will not need
-		 * to send packets larger than their max_rx_pkt_len (MRU).
-		 */
-		return 1;
+	value = 0;
+	ret = rte_kvargs_process(kvlist, AVP_TELEMETRY_ARG,
+				 avp_dev_parse_uint, &value);
+	if (ret < 0)
+		goto done;
+	if (value > AVP_TELEMETRY_MAX_MS) {
+		PMD_DRV_LOG(ERR, "Invalid value %" PRIu64 " for argument %s; maximum is %u\n",
+			    value, AVP_TELEMETRY_ARG, AVP_TELEMETRY_MAX_MS);
+		ret = -EINVAL;
+		goto done;
 	}
+	avp->telemetry_ms = value;
 
-	if ((avp->max_rx_pkt_len > avp->guest_mbuf_size) ||
-	    (avp->max_rx_pkt_len > avp->host_mbuf_size)) {
-		/*
-		 * If the host MRU is greater than its own mbuf size or the
-		 * guest mbuf size then chained mbufs have to be enabled in the
-		 * RX direction.
-		 */
-		return 1;
+	enabled = 0;
+	ret = rte_kvargs_process(kvlist, AVP_TX_MP_ARG,
+				 avp_dev_parse_bool, &enabled);
+	if (ret < 0)
+		goto done;
+	if (enabled) {
+		if (avp->options & AVP_OPT_ZERO_COPY_TX) {
+			PMD_DRV_LOG(ERR, "AVP %s cannot be combined with %s\n",
+				    AVP_TX_MP_ARG, AVP_ZERO_COPY_TX_ARG);
+			ret = -EINVAL;
+			goto done;
+		}
+		PMD_DRV_LOG(NOTICE, "AVP shared transmit fifos enabled on port %u\n",
+			    eth_dev->data->port_id);
+		avp->options |= AVP_OPT_TX_MP;
 	}
 
-	return 0;
+	ret = 0;
+
+done:
+	rte_kvargs_free(kvlist);
+	return ret;
 }
+#endif
 
-static int
-avp_dev_rx_queue_setup(struct rte_eth_dev *eth_dev,
-		       uint16_t rx_queue_id,
-		       uint16_t nb_rx_desc,
-		       unsigned int socket_id,
-		       const struct rte_eth_rxconf *rx_conf,
-		       struct rte_mempool *pool)
+#ifdef AVP_TELEMETRY
+static uint32_t
+avp_dev_telemetry_flags(uint32_t flags)
 {
-	struct avp_dev *avp = AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
-	struct rte_pktmbuf_pool_private *mbp_priv;
-	struct avp_queue *rxq;
+	uint32_t state = 0;
+
+	if (flags & AVP_F_CONFIGURED)
+		state |= RTE_PMD_AVP_TELEMETRY_F_CONFIGURED;
+	if (flags & AVP_F_LINKUP)
+		state |= RTE_PMD_AVP_TELEMETRY_F_LINKUP;
+	if (flags & AVP_F_DETACHED)
+		state |= RTE_PMD_AVP_TELEMETRY_F_DETACHED;
+	if (flags & AVP_F_PROMISC)
+		state |= RTE_PMD_AVP_TELEMETRY_F_PROMISC;
+	if (flags & AVP_F_ALLMULTI)
+		state |= RTE_PMD_AVP_TELEMETRY_F_ALLMULTI;
+
+	return state;
+}
 
-	if (rx_queue_id >= eth_dev->data->nb_rx_queues) {
-		PMD_DRV_LOG(ERR, "RX queue id is out of range: rx_queue_id=%u, nb_rx_queues=%u\n",
-			    rx_queue_id, eth_dev->data->nb_rx_queues);
-		return -EINVAL;
-	}
+static void
+avp_dev_telemetry_queue(struct avp_dev *avp, struct avp_queue *q,
+			struct rte_avp_fifo **fifos, struct rte_avp_fifo **bufs,
+			uint32_t flags, struct rte_pmd_avp_telemetry_queue *tq)
+{
+	unsigned int i;
 
-	/* Save mbuf pool pointer */
-	avp->pool = pool;
+	memset(tq, 0, sizeof(*tq));
+	if (q == NULL)
+		return;
 
-	/* Save the local mbuf size */
-	mbp_priv = rte_mempool_get_priv(pool);
-	avp->guest_mbuf_size = (uint16_t)(mbp_priv->mbuf_data_room_size);
-	avp->guest_mbuf_size -= RTE_PKTMBUF_HEADROOM;
+	tq->packets = q->packets;
+	tq->bytes = q->bytes;
+	tq->errors = q->errors;
 
-	if (avp_dev_enable_scattered(eth_dev, avp)) {
-		if (!eth_dev->data->scattered_rx) {
-			PMD_DRV_LOG(NOTICE, "AVP device configured for chained mbufs\n");
-			eth_dev->data->scattered_rx = 1;
-			eth_dev->rx_pkt_burst = avp_recv_scattered_pkts;
-			eth_dev->tx_pkt_burst = avp_xmit_scattered_pkts;
-		}
+	/* the host fifos may be unmapped during a live migration */
+	if (flags & AVP_F_DETACHED)
+		return;
+
+	for (i = q->queue_base; i <= q->queue_limit; i++) {
+		tq->fifo_count += avp_dev_fifo_level(avp, fifos[i]);
+		tq->fifo_size += avp_dev_fifo_len(avp, fifos[i]) - 1;
+		tq->buf_count += avp_dev_fifo_level(avp, bufs[i]);
 	}
+}
 
-	PMD_DRV_LOG(DEBUG, "AVP max_rx_pkt_len=(%u,%u) mbuf_size=(%u,%u)\n",
-		    avp->max_rx_pkt_len,
-		    eth_dev->data->dev_conf.rxmode.max_rx_pkt_len,
-		    avp->host_mbuf_size,
-		    avp->guest_mbuf_size);
+/*
+ * Publish the current state of the port.  The queue counters are read without
+ * synchronization as is done by avp_dev_stats_get(); only one update runs at a
+ * time so the sequence number is all that is needed to protect the readers.
+ */
+static void
+avp_dev_telemetry_update(struct rte_eth_dev *eth_dev)
+{
+	struct avp_dev *avp = AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
+	struct rte_pmd_avp_telemetry *page;
+	uint32_t flags = avp->flags;
+	unsigned int i;
 
-	/* allocate a queue object */
-	rxq = rte_zmalloc_socket("ethdev RX queue", sizeof(struct avp_queue),
-				 RTE_CACHE_LINE_SIZE, socket_id);
-	if (rxq == NULL) {
-		PMD_DRV_LOG(ERR, "Failed to allocate new Rx queue object\n");
-		return -ENOMEM;
-	}
+	if (avp->telemetry_mz == NULL)
+		return;
+
+	page = avp->telemetry_mz->addr;
+	page->seq++;
+	rte_smp_wmb();
+
+	page->tsc = rte_rdtsc();
+	page->updates++;
+	page->flags = avp_dev_telemetry_flags(flags);
+	page->epoch = avp->epoch;
+	page->detaches = avp->detaches;
+	page->attaches = avp->attaches;
+	page->nb_rx_queues = RTE_MIN(eth_dev->data->nb_rx_queues,
+				     RTE_PMD_AVP_TELEMETRY_MAX_QUEUES);
+	page->nb_tx_queues = RTE_MIN(eth_dev->data->nb_tx_queues,
+				     RTE_PMD_AVP_TELEMETRY_MAX_QUEUES);
+
+	for (i = 0; i < page->nb_rx_queues; i++)
+		avp_dev_telemetry_queue(avp, eth_dev->data->rx_queues[i],
+					avp->rx_q, avp->free_q, flags,
+					&page->rxq[i]);
+
+	for (i = 0; i < page->nb_tx_queues; i++)
+		avp_dev_telemetry_queue(avp, eth_dev->data->tx_queues[i],
+					avp->tx_q, avp->alloc_q, flags,
+					&page->txq[i]);
+
+	rte_smp_wmb();
+	page->seq++;
+}
 
-	/* save back pointers to AVP and Ethernet devices */
-	rxq->avp = avp;
-	rxq->dev_data = eth_dev->data;
-	eth_dev->data->rx_queues[rx_queue_id] = (void *)rxq;
+static void
+avp_dev_telemetry_alarm(void *arg)
+{
+	struct rte_eth_dev *eth_dev = arg;
+	struct avp_dev *avp = AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
+	int ret;
 
-	/* setup the queue receive mapping for the current queue. */
-	_avp_set_rx_queue_mappings(eth_dev, rx_queue_id);
+	avp_dev_telemetry_update(eth_dev);
 
-	PMD_DRV_LOG(DEBUG, "Rx queue %u setup at %p\n", rx_queue_id, rxq);
+	ret = rte_eal_alarm_set(avp->telemetry_ms * 1000ULL,
+				avp_dev_telemetry_alarm, eth_dev);
+	if (ret < 0)
+		PMD_DRV_LOG(ERR, "Failed to schedule telemetry update on port %u, ret=%d\n",
+			    eth_dev->data->port_id, ret);
+}
 
-	(void)nb_rx_desc;
-	(void)rx_conf;
-	return 0;
+/*
+ * Updates are only scheduled while the port is started since the queues may
+ * be released or replaced while it is stopped.
+ */
+static void
+avp_dev_telemetry_start(struct rte_eth_dev *eth_dev)
+{
+	struct avp_dev *avp = AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
+
+	if (avp->telemetry_mz != NULL)
+		avp_dev_telemetry_alarm(eth_dev);
+}
+
+/* cancel the periodic updates; waits for an update in progress */
+static void
+avp_dev_telemetry_stop(struct rte_eth_dev *eth_dev)
+{
+	struct avp_dev *avp = AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
+
+	if (avp->telemetry_mz != NULL)
+		rte_eal_alarm_cancel(avp_dev_telemetry_alarm, eth_dev);
 }
 
 static int
-avp_dev_tx_queue_setup(struct rte_eth_dev *eth_dev,
-		       uint16_t tx_queue_id,
-		       uint16_t nb_tx_desc,
-		       unsigned int socket_id,
-		       const struct rte_eth_txconf *tx_conf)
+avp_dev_telemetry_init(struct rte_eth_dev *eth_dev)
 {
 	struct avp_dev *avp = AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
-	struct avp_queue *txq;
+	struct rte_pmd_avp_telemetry *page;
+	const struct rte_memzone *mz;
+	char name[RTE_MEMZONE_NAMESIZE];
 
-	if (tx_queue_id >= eth_dev->data->nb_tx_queues) {
-		PMD_DRV_LOG(ERR, "TX queue id is out of range: tx_queue_id=%u, nb_tx_queues=%u\n",
-			    tx_queue_id, eth_dev->data->nb_tx_queues);
-		return -EINVAL;
-	}
+	if (avp->telemetry_ms == 0)
+		return 0;
 
-	/* allocate a queue object */
-	txq = rte_zmalloc_socket("ethdev TX queue", sizeof(struct avp_queue),
-				 RTE_CACHE_LINE_SIZE, socket_id);
-	if (txq == NULL) {
-		PMD_DRV_LOG(ERR, "Failed to allocate new Tx queue object\n");
+	snprintf(name, sizeof(name), RTE_PMD_AVP_TELEMETRY_MZ_FMT,
+		 eth_dev->data->port_id);
+
+	/* reuse the page of a previous instance of the port */
+	mz = rte_memzone_lookup(name);
+	if (mz == NULL)
+		mz = rte_memzone_reserve(name, sizeof(*page), SOCKET_ID_ANY, 0);
+	if ((mz == NULL) || (mz->len < sizeof(*page))) {
+		PMD_DRV_LOG(ERR, "Failed to reserve telemetry memzone %s\n",
+			    name);
 		return -ENOMEM;
 	}
 
-	/* only the configured set of transmit queues are used */
-	txq->queue_id = tx_queue_id;
-	txq->queue_base = tx_queue_id;
-	txq->queue_limit = tx_queue_id;
+	page = mz->addr;
+	memset(page, 0, sizeof(*page));
+	page->size = sizeof(*page);
+	page->version = RTE_PMD_AVP_TELEMETRY_VERSION;
+	page->tsc_hz = rte_get_tsc_hz();
+	page->port_id = eth_dev->data->port_id;
+	rte_smp_wmb();
+	page->magic = RTE_PMD_AVP_TELEMETRY_MAGIC;
 
-	/* save back pointers to AVP and Ethernet devices */
-	txq->avp = avp;
-	txq->dev_data = eth_dev->data;
-	eth_dev->data->tx_queues[tx_queue_id] = (void *)txq;
+	avp->telemetry_mz = mz;
+	avp_dev_telemetry_update(eth_dev);
 
-	PMD_DRV_LOG(DEBUG, "Tx queue %u setup at %p\n", tx_queue_id, txq);
+	PMD_DRV_LOG(NOTICE, "AVP telemetry page %s updated every %u ms\n",
+		    name, avp->telemetry_ms);
 
-	(void)nb_tx_desc;
-	(void)tx_conf;
 	return 0;
 }
 
-static inline int
-_avp_cmp_ether_addr(struct ether_addr *a, struct ether_addr *b)
+static void
+avp_dev_telemetry_uninit(struct rte_eth_dev *eth_dev)
 {
-	uint16_t *_a = (uint16_t *)&a->addr_bytes[0];
-	uint16_t *_b = (uint16_t *)&b->addr_bytes[0];
-	return (_a[0] ^ _b[0]) | (_a[1] ^ _b[1]) | (_a[2] ^ _b[2]);
+	struct avp_dev *avp = AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
+	struct rte_pmd_avp_telemetry *page;
+
+	if (avp->telemetry_mz == NULL)
+		return;
+
+	avp_dev_telemetry_stop(eth_dev);
+
+	/* invalidate the page for readers that still have it mapped */
+	page = avp->telemetry_mz->addr;
+	page->magic = 0;
+	rte_smp_wmb();
+
+	rte_memzone_free(avp->telemetry_mz);
+	avp->telemetry_mz = NULL;
 }
+#endif
 
-static inline int
-_avp_mac_filter(struct avp_dev *avp, struct rte_mbuf *m)
+/*
+ * This function is based on probe() function in avp_pci.c
+ * It returns 0 on success.
+ */
+static int
+#if RTE_VERSION < RTE_VERSION_NUM(1, 8, 0, 0)
+eth_avp_dev_init(__attribute__((__unused__)) struct eth_driver *eth_drv,
+				 struct rte_eth_dev *eth_dev)
+#else
+eth_avp_dev_init(struct rte_eth_dev *eth_dev)
+#endif
 {
-	struct ether_hdr *eth = rte_pktmbuf_mtod(m, struct ether_hdr *);
+	struct avp_dev *avp =
+		AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
+	struct rte_pci_device *pci_dev;
+	int ret;
 
-	if (likely(_avp_cmp_ether_addr(&avp->ethaddr, &eth->d_addr) == 0)) {
-		/* allow all packets destined to our address */
+	pci_dev = AVP_DEV_TO_PCI(eth_dev);
+	eth_dev->dev_ops = &avp_eth_dev_ops;
+	/* the unspecialized variants handle any configuration */
+	eth_dev->rx_pkt_burst = avp_recv_pkts_variants[AVP_RX_VARIANTS - 1];
+	eth_dev->tx_pkt_burst = avp_xmit_pkts_variants[AVP_TX_VARIANTS - 1];
+
+	if (rte_eal_process_type() != RTE_PROC_PRIMARY) {
+		/*
+		 * no setup required on secondary processes.  All data is saved
+		 * in dev_private by the primary process. All resource should
+		 * be mapped to the same virtual address so all pointers should
+		 * be valid.
+		 */
+		if (eth_dev->data->scattered_rx)
+			PMD_DRV_LOG(NOTICE, "AVP device configured for chained mbufs\n");
+		avp_dev_set_burst_functions(eth_dev);
 		return 0;
 	}
 
-	if (likely(is_broadcast_ether_addr(&eth->d_addr))) {
-		/* allow all broadcast packets */
-		return 0;
+#if RTE_VERSION >= RTE_VERSION_NUM(2, 2, 0, 0)
+	rte_eth_copy_pci_info(eth_dev, pci_dev);
+#endif
+#if RTE_VERSION > RTE_VERSION_NUM(17, 2, 0, 0)
+	eth_dev->data->dev_flags |= RTE_ETH_DEV_DETACHABLE;
+#endif
+
+	/* Check current migration status */
+	if (avp_dev_migration_pending(eth_dev)) {
+		PMD_DRV_LOG(ERR, "VM live migration operation in progress\n");
+		return -EBUSY;
 	}
 
-	if (likely(is_multicast_ether_addr(&eth->d_addr))) {
-		/* allow all multicast packets */
-		return 0;
+	/* Check BAR resources */
+	ret = avp_dev_check_regions(eth_dev);
+	if (ret < 0) {
+		PMD_DRV_LOG(ERR, "Failed to validate BAR resources, ret=%d\n",
+			    ret);
+		return ret;
 	}
 
-	if (avp->flags & AVP_F_PROMISC) {
-		/* allow all packets when in promiscuous mode */
-		return 0;
+	/* Enable interrupts */
+	ret = avp_dev_setup_interrupts(eth_dev);
+	if (ret < 0) {
+		PMD_DRV_LOG(ERR, "Failed to enable interrupts, ret=%d\n", ret);
+		return ret;
 	}
 
-	return -1;
-}
+	/* Handle each subtype */
+	ret = avp_dev_create(pci_dev, eth_dev);
+	if (ret < 0) {
+		PMD_DRV_LOG(ERR, "Failed to create device, ret=%d\n", ret);
+		return ret;
+	}
+
+#ifdef AVP_DEVARGS
+	/* Apply device arguments */
+	ret = avp_dev_parse_devargs(eth_dev);
+	if (ret < 0) {
+		PMD_DRV_LOG(ERR, "Failed to parse device arguments, ret=%d\n",
+			    ret);
+		return ret;
+	}
+#endif
+
+#ifdef AVP_TELEMETRY
+	/* Publish the telemetry page */
+	ret = avp_dev_telemetry_init(eth_dev);
+	if (ret < 0)
+		return ret;
+#endif
+
+	/* Allocate memory for storing MAC addresses */
+	eth_dev->data->mac_addrs = rte_zmalloc("avp_ethdev",
+		ETHER_ADDR_LEN * AVP_MAX_MAC_ADDRS, 0);
+	if (eth_dev->data->mac_addrs == NULL) {
+		PMD_DRV_LOG(ERR, "Failed to allocate %d bytes needed to store MAC addresses\n",
+			    ETHER_ADDR_LEN * AVP_MAX_MAC_ADDRS);
+		return -ENOMEM;
+	}
+
+	/* Get a mac from device config */
+	ether_addr_copy(&avp->ethaddr, &eth_dev->data->mac_addrs[0]);
+
+	return 0;
+}
+
+#if RTE_VERSION >= RTE_VERSION_NUM(2, 0, 0, 0)
+static int
+eth_avp_dev_uninit(struct rte_eth_dev *eth_dev)
+{
+	struct avp_dev *avp = AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
+	int ret;
+
+	if (rte_eal_process_type() != RTE_PROC_PRIMARY)
+		return -EPERM;
+
+	if (eth_dev->data == NULL)
+		return 0;
+
+#ifdef AVP_TELEMETRY
+	avp_dev_telemetry_uninit(eth_dev);
+#endif
+
+	ret = avp_dev_disable_interrupts(eth_dev);
+	if (ret != 0) {
+		PMD_DRV_LOG(ERR, "Failed to disable interrupts, ret=%d\n", ret);
+		return ret;
+	}
+
+	rte_free(avp->rss);
+	avp->rss = NULL;
+	rte_free(avp->rss_retired);
+	avp->rss_retired = NULL;
+
+	if (eth_dev->data->mac_addrs != NULL) {
+		rte_free(eth_dev->data->mac_addrs);
+		eth_dev->data->mac_addrs = NULL;
+	}
+
+	return 0;
+}
+#endif
+
+
+static struct eth_driver rte_avp_pmd = {
+	{
+#if RTE_VERSION < RTE_VERSION_NUM(16, 11, 0, 0)
+		.name = "rte_avp_pmd",
+#endif
+		.id_table = pci_id_avp_map,
+#if RTE_VERSION < RTE_VERSION_NUM(1, 7, 0, 0)
+#ifdef RTE_EAL_UNBIND_PORTS
+		.drv_flags = RTE_PCI_DRV_NEED_IGB_UIO,
+#endif
+#elif RTE_VERSION < RTE_VERSION_NUM(2, 0, 0, 0)
+		.drv_flags = RTE_PCI_DRV_NEED_MAPPING,
+#elif RTE_VERSION <= RTE_VERSION_NUM(17, 2, 0, 0)
+		.drv_flags = RTE_PCI_DRV_NEED_MAPPING | RTE_PCI_DRV_DETACHABLE,
+#else
+		.drv_flags = RTE_PCI_DRV_NEED_MAPPING,
+#endif
+#if RTE_VERSION >= RTE_VERSION_NUM(16, 11, 0, 0)
+		.probe = rte_eth_dev_pci_probe,
+		.remove = rte_eth_dev_pci_remove,
+#endif
+	},
+	.eth_dev_init = eth_avp_dev_init,
+#if RTE_VERSION >= RTE_VERSION_NUM(2, 0, 0, 0)
+	.eth_dev_uninit = eth_avp_dev_uninit,
+#endif
+	.dev_private_size = sizeof(struct avp_adapter),
+};
+
+#ifdef AVP_EMU
+/*
+ * Create an ethdev for an emulated device the way rte_eth_dev_pci_probe()
+ * does for a PCI device claimed by this driver.
+ */
+int
+avp_dev_emu_probe(const char *name, struct rte_pci_device *pci_dev)
+{
+	struct rte_eth_dev *eth_dev;
+	int ret;
+
+	eth_dev = rte_eth_dev_allocate(name);
+	if (eth_dev == NULL)
+		return -ENOMEM;
+
+	eth_dev->data->dev_private = rte_zmalloc_socket(name,
+		rte_avp_pmd.dev_private_size, RTE_CACHE_LINE_SIZE,
+		pci_dev->device.numa_node);
+	if (eth_dev->data->dev_private == NULL) {
+		rte_eth_dev_release_port(eth_dev);
+		return -ENOMEM;
+	}
+
+	pci_dev->driver = &rte_avp_pmd.pci_drv;
+	eth_dev->device = &pci_dev->device;
+	eth_dev->intr_handle = &pci_dev->intr_handle;
+	eth_dev->driver = &rte_avp_pmd;
+
+	ret = eth_avp_dev_init(eth_dev);
+	if (ret < 0) {
+		rte_free(eth_dev->data->dev_private);
+		rte_eth_dev_release_port(eth_dev);
+	}
+
+	return ret;
+}
+
+int
+avp_dev_emu_remove(const char *name)
+{
+	struct rte_eth_dev *eth_dev;
+	int ret;
+
+	eth_dev = rte_eth_dev_allocated(name);
+	if (eth_dev == NULL)
+		return -ENODEV;
+
+	ret = eth_avp_dev_uninit(eth_dev);
+	if (ret < 0)
+		return ret;
+
+	rte_free(eth_dev->data->dev_private);
+	rte_eth_dev_release_port(eth_dev);
+	return 0;
+}
+
+int
+avp_dev_emu_interrupt(const char *name)
+{
+	struct rte_pci_device *pci_dev;
+	struct rte_eth_dev *eth_dev;
+
+	eth_dev = rte_eth_dev_allocated(name);
+	if (eth_dev == NULL)
+		return -ENODEV;
+
+	pci_dev = AVP_DEV_TO_PCI(eth_dev);
+	avp_dev_interrupt_handler(&pci_dev->intr_handle, eth_dev);
+	return 0;
+}
+#else
+int
+rte_pmd_avp_emu_detach(uint8_t port_id __rte_unused)
+{
+	return -ENOTSUP;
+}
+
+int
+rte_pmd_avp_emu_attach(uint8_t port_id __rte_unused,
+		       unsigned int version __rte_unused)
+{
+	return -ENOTSUP;
+}
+
+int
+rte_pmd_avp_emu_stats_get(uint8_t port_id __rte_unused,
+			  struct rte_pmd_avp_emu_stats *stats __rte_unused)
+{
+	return -ENOTSUP;
+}
+#endif
+
+/*
+ * Driver initialization routine.
+ * Invoked once at EAL init time.
+ * Registers itself as the [Poll Mode] Driver of PCI AVP devices.
+ * Returns 0 on success.
+ */
+#if RTE_VERSION >= RTE_VERSION_NUM(1, 7, 0, 0)
+#if RTE_VERSION < RTE_VERSION_NUM(16, 11, 0, 0)
+static int
+rte_avp_pmd_init(const char *name __rte_unused, const char *param __rte_unused)
+{
+	/* Register the AVP ethernet driver */
+	rte_eth_driver_register(&rte_avp_pmd);
+	return 0;
+}
+#endif
+#else
+int
+rte_avp_pmd_init(void)
+{
+	/* Register the AVP ethernet driver */
+	rte_eth_driver_register(&rte_avp_pmd);
+	return 0;
+}
+#endif
+
+/*
+ * Select the specialization of the flat receive functions that matches the
+ * current device configuration.  Must be re-evaluated whenever the VLAN
+ * offload, the promiscuous mode or the queue to fifo mapping changes.
+ */
+static unsigned int
+avp_dev_rx_variant(struct rte_eth_dev *eth_dev)
+{
+	struct avp_dev *avp = AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
+	unsigned int variant = 0;
+	struct avp_queue *rxq;
+	unsigned int i;
+
+	if (avp->features & RTE_AVP_FEATURE_VLAN_OFFLOAD)
+		variant |= AVP_RX_VLAN;
+
+	if (avp->flags & AVP_F_PROMISC)
+		variant |= AVP_RX_PROMISC;
+
+	for (i = 0; i < eth_dev->data->nb_rx_queues; i++) {
+		rxq = eth_dev->data->rx_queues[i];
+		if ((rxq != NULL) && (rxq->queue_limit != rxq->queue_base))
+			variant |= AVP_RX_MULTI_FIFO;
+	}
+
+	return variant;
+}
+
+/*
+ * Select the specialization of the flat transmit function that matches the
+ * features negotiated with the host.
+ */
+static unsigned int
+avp_dev_tx_variant(struct avp_dev *avp)
+{
+	unsigned int variant = 0;
+
+	if (avp->host_features & RTE_AVP_FEATURE_VLAN_OFFLOAD)
+		variant |= AVP_TX_VLAN;
+
+	if (avp->features & (RTE_AVP_FEATURE_TX_CSUM | RTE_AVP_FEATURE_TSO))
+		variant |= AVP_TX_OFFLOAD;
+
+	if (avp->inline_len != 0)
+		variant |= AVP_TX_INLINE;
+
+	return variant;
+}
+
+/*
+ * Select the receive and transmit burst functions that match the current
+ * device configuration.
+ */
+static void
+avp_dev_set_burst_functions(struct rte_eth_dev *eth_dev)
+{
+	struct avp_dev *avp = AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
+	struct avp_burst_functions *fns = &avp_burst_functions[avp->port_id];
+	eth_rx_burst_t rx_fifo_burst = NULL;
+	eth_rx_burst_t rx_gro_burst = NULL;
+	eth_tx_burst_t tx_hold_burst = NULL;
+	eth_rx_burst_t rx_pkt_burst;
+	eth_tx_burst_t tx_pkt_burst;
+	struct avp_queue *rxq;
+	unsigned int i;
+
+	if (avp->flags & AVP_F_CDESC) {
+		/* the compact descriptor functions handle all other modes */
+		rx_pkt_burst = avp_recv_pkts_cdesc;
+		tx_pkt_burst = avp_xmit_pkts_cdesc;
+	} else if (eth_dev->data->scattered_rx) {
+		rx_pkt_burst = avp_recv_scattered_pkts;
+		tx_pkt_burst = avp_xmit_scattered_pkts;
+	} else {
+#ifdef AVP_VECTOR_RX
+		rx_pkt_burst =
+			avp_recv_pkts_vec_variants[avp_dev_rx_variant(eth_dev)];
+#else
+		rx_pkt_burst =
+			avp_recv_pkts_variants[avp_dev_rx_variant(eth_dev)];
+#endif
+		tx_pkt_burst = avp_xmit_pkts_variants[avp_dev_tx_variant(avp)];
+	}
+
+#ifdef AVP_ZERO_COPY
+	/* the zero-copy functions handle both flat and chained mbufs */
+	if ((avp->options & AVP_OPT_ZERO_COPY_RX) &&
+	    !(avp->flags & AVP_F_CDESC))
+		rx_pkt_burst = avp_recv_pkts_zc;
+	if ((avp->options & AVP_OPT_ZERO_COPY_TX) &&
+	    !(avp->flags & AVP_F_CDESC))
+		tx_pkt_burst = avp_xmit_pkts_zc;
+#endif
+
+#ifdef AVP_TX_MP
+	if (avp->options & AVP_OPT_TX_MP) {
+		/* several queues may transmit on each host fifo */
+		if (avp->flags & AVP_F_CDESC)
+			tx_pkt_burst = avp_xmit_pkts_cdesc_mp;
+		else
+			tx_pkt_burst = avp_xmit_pkts_mp;
+	}
+#endif
+
+	if (avp->rx_policy != AVP_RX_POLICY_RR) {
+		/* service all mapped fifos on each call */
+		rx_fifo_burst = rx_pkt_burst;
+		rx_pkt_burst = avp_recv_pkts_multi;
+	}
+
+	for (i = 0; i < eth_dev->data->nb_rx_queues; i++) {
+		rxq = eth_dev->data->rx_queues[i];
+		if ((rxq != NULL) && rxq->gro) {
+			/* coalesce segments across all fifos of a queue */
+			rx_gro_burst = rx_pkt_burst;
+			rx_pkt_burst = avp_recv_pkts_gro;
+			break;
+		}
+	}
+
+	if (avp->tx_hold_pkts != 0) {
+		/* hold transmitted packets during live migrations */
+		tx_hold_burst = tx_pkt_burst;
+		tx_pkt_burst = avp_xmit_pkts_hold;
+	}
+
+	/*
+	 * The functions may be replaced while the queues are running.  Publish
+	 * the wrapped functions before the wrappers that call them, and each
+	 * ethdev function only once so that no partially wrapped function is
+	 * ever called.
+	 */
+	if (rx_fifo_burst != NULL)
+		fns->rx_pkt_burst = rx_fifo_burst;
+	if (rx_gro_burst != NULL)
+		fns->rx_gro_burst = rx_gro_burst;
+	if (tx_hold_burst != NULL)
+		fns->tx_pkt_burst = tx_hold_burst;
+	rte_smp_wmb();
+	eth_dev->rx_pkt_burst = rx_pkt_burst;
+	eth_dev->tx_pkt_burst = tx_pkt_burst;
+}
+
+static int
+avp_dev_enable_scattered(struct rte_eth_dev *eth_dev,
+			 struct avp_dev *avp)
+{
+	unsigned int max_rx_pkt_len;
+
+	max_rx_pkt_len = eth_dev->data->dev_conf.rxmode.max_rx_pkt_len;
+
+	if ((max_rx_pkt_len > avp->guest_mbuf_size) ||
+	    (max_rx_pkt_len > avp->host_mbuf_size)) {
+		/*
+		 * If the guest MTU is greater than either the host or guest
+		 * buffers then chained mbufs have to be enabled in the TX
+		 * direction.  It is assumed that the application will not need
+		 * to send packets larger than their max_rx_pkt_len (MRU).
+		 */
+		return 1;
+	}
+
+	if ((avp->max_rx_pkt_len > avp->guest_mbuf_size) ||
+	    (avp->max_rx_pkt_len > avp->host_mbuf_size)) {
+		/*
+		 * If the host MRU is greater than its own mbuf size or the
+		 * guest mbuf size then chained mbufs have to be enabled in the
+		 * RX direction.
+		 */
+		return 1;
+	}
+
+	return 0;
+}
+
+#ifdef AVP_ZERO_COPY
+static struct avp_zc_ring *
+avp_dev_zc_ring_create(struct rte_eth_dev *eth_dev,
+		       const char *type,
+		       uint16_t queue_id,
+		       unsigned int socket_id)
+{
+	char name[RTE_MEMPOOL_NAMESIZE];
+	struct avp_zc_ring *ring;
+
+	ring = rte_zmalloc_socket("AVP zero-copy ring", sizeof(*ring),
+				  RTE_CACHE_LINE_SIZE, socket_id);
+	if (ring == NULL) {
+		PMD_DRV_LOG(ERR, "Failed to allocate zero-copy ring\n");
+		return NULL;
+	}
+
+	/*
+	 * The mbufs only carry a header; their buffer address is set to point
+	 * directly into the host buffer each time one is used.  The pool is
+	 * kept across queue setups since the application may still be holding
+	 * mbufs from a previous setup.
+	 */
+	snprintf(name, sizeof(name), "avp_zc_%s_%u_%u",
+		 type, eth_dev->data->port_id, queue_id);
+	ring->pool = rte_mempool_lookup(name);
+	if (ring->pool == NULL)
+		ring->pool = rte_pktmbuf_pool_create(name, AVP_ZC_RING_SIZE, 0,
+						     AVP_ZC_PRIV_SIZE, 0,
+						     socket_id);
+	if (ring->pool == NULL) {
+		PMD_DRV_LOG(ERR, "Failed to create zero-copy mbuf pool %s\n",
+			    name);
+		rte_free(ring);
+		return NULL;
+	}
+
+	return ring;
+}
+#endif
+
+static struct avp_tx_hold *
+avp_dev_tx_hold_create(struct avp_dev *avp, unsigned int socket_id)
+{
+	struct avp_tx_hold *hold;
+	unsigned int size;
+
+	size = rte_align32pow2(avp->tx_hold_pkts);
+	hold = rte_zmalloc_socket("AVP transmit hold",
+				  sizeof(*hold) + size * sizeof(hold->mbufs[0]),
+				  RTE_CACHE_LINE_SIZE, socket_id);
+	if (hold == NULL) {
+		PMD_DRV_LOG(ERR, "Failed to allocate transmit hold of %u packets\n",
+			    avp->tx_hold_pkts);
+		return NULL;
+	}
+
+	hold->size = size;
+	hold->max_pkts = avp->tx_hold_pkts;
+	hold->max_bytes = avp->tx_hold_bytes;
+
+	return hold;
+}
+
+static void
+avp_dev_tx_hold_free(struct avp_tx_hold *hold)
+{
+	while (hold->tail != hold->head)
+		rte_pktmbuf_free(hold->mbufs[hold->tail++ & (hold->size - 1)]);
+	rte_free(hold);
+}
+
+#ifdef AVP_VECTOR_RX
+/*
+ * Build the value written to the rearm_data field of each receive mbuf;
+ * i.e., data_off, refcnt, nb_segs and port.
+ */
+static uint64_t
+avp_dev_mbuf_initializer(uint8_t port_id)
+{
+	struct rte_mbuf mb_def = { .buf_addr = 0 }; /* zeroed mbuf */
+	uintptr_t p;
+
+	mb_def.nb_segs = 1;
+	mb_def.data_off = RTE_PKTMBUF_HEADROOM;
+	mb_def.port = port_id;
+	rte_mbuf_refcnt_set(&mb_def, 1);
+
+	/* prevent compiler reordering: rearm_data covers previous fields */
+	rte_compiler_barrier();
+	p = (uintptr_t)&mb_def.rearm_data;
+	return *(uint64_t *)p;
+}
+#endif
+
+static int
+avp_dev_rx_queue_setup(struct rte_eth_dev *eth_dev,
+		       uint16_t rx_queue_id,
+		       uint16_t nb_rx_desc,
+		       unsigned int socket_id,
+		       const struct rte_eth_rxconf *rx_conf,
+		       struct rte_mempool *pool)
+{
+	struct avp_dev *avp = AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
+	struct rte_pktmbuf_pool_private *mbp_priv;
+	struct avp_queue *rxq;
+
+	if (rx_queue_id >= eth_dev->data->nb_rx_queues) {
+		PMD_DRV_LOG(ERR, "RX queue id is out of range: rx_queue_id=%u, nb_rx_queues=%u\n",
+			    rx_queue_id, eth_dev->data->nb_rx_queues);
+		return -EINVAL;
+	}
+
+	/* Save mbuf pool pointer */
+	avp->pool = pool;
+
+	/* Save the local mbuf size */
+	mbp_priv = rte_mempool_get_priv(pool);
+	avp->guest_mbuf_size = (uint16_t)(mbp_priv->mbuf_data_room_size);
+	avp->guest_mbuf_size -= RTE_PKTMBUF_HEADROOM;
+
+	if (avp_dev_enable_scattered(eth_dev, avp)) {
+		if (!eth_dev->data->scattered_rx) {
+			PMD_DRV_LOG(NOTICE, "AVP device configured for chained mbufs\n");
+			eth_dev->data->scattered_rx = 1;
+		}
+	}
+
+	PMD_DRV_LOG(DEBUG, "AVP max_rx_pkt_len=(%u,%u) mbuf_size=(%u,%u)\n",
+		    avp->max_rx_pkt_len,
+		    eth_dev->data->dev_conf.rxmode.max_rx_pkt_len,
+		    avp->host_mbuf_size,
+		    avp->guest_mbuf_size);
+
+	/* allocate a queue object */
+	rxq = rte_zmalloc_socket("ethdev RX queue", sizeof(struct avp_queue),
+				 RTE_CACHE_LINE_SIZE, socket_id);
+	if (rxq == NULL) {
+		PMD_DRV_LOG(ERR, "Failed to allocate new Rx queue object\n");
+		return -ENOMEM;
+	}
+	avp_dev_queue_xstats_reset(rxq);
+
+#ifdef AVP_ZERO_COPY
+	if (avp->options & AVP_OPT_ZERO_COPY_RX) {
+		rxq->zc = avp_dev_zc_ring_create(eth_dev, "rx",
+						 rx_queue_id, socket_id);
+		if (rxq->zc == NULL) {
+			rte_free(rxq);
+			return -ENOMEM;
+		}
+	}
+#endif
+
+	/* save back pointers to AVP and Ethernet devices */
+	rxq->avp = avp;
+	rxq->dev_data = eth_dev->data;
+	eth_dev->data->rx_queues[rx_queue_id] = (void *)rxq;
+
+#ifdef AVP_VECTOR_RX
+	rxq->mbuf_initializer = avp_dev_mbuf_initializer(avp->port_id);
+#endif
+
+	/* setup the queue receive mapping for the current queue. */
+	_avp_set_rx_queue_mappings(eth_dev, rx_queue_id);
+
+	avp_dev_set_burst_functions(eth_dev);
+
+	PMD_DRV_LOG(DEBUG, "Rx queue %u setup at %p\n", rx_queue_id, rxq);
+
+	(void)nb_rx_desc;
+	(void)rx_conf;
+	return 0;
+}
+
+static int
+avp_dev_tx_queue_setup(struct rte_eth_dev *eth_dev,
+		       uint16_t tx_queue_id,
+		       uint16_t nb_tx_desc,
+		       unsigned int socket_id,
+		       const struct rte_eth_txconf *tx_conf)
+{
+	struct avp_dev *avp = AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
+	struct avp_queue *txq;
+
+	if (tx_queue_id >= eth_dev->data->nb_tx_queues) {
+		PMD_DRV_LOG(ERR, "TX queue id is out of range: tx_queue_id=%u, nb_tx_queues=%u\n",
+			    tx_queue_id, eth_dev->data->nb_tx_queues);
+		return -EINVAL;
+	}
+
+	/* allocate a queue object */
+	txq = rte_zmalloc_socket("ethdev TX queue", sizeof(struct avp_queue),
+				 RTE_CACHE_LINE_SIZE, socket_id);
+	if (txq == NULL) {
+		PMD_DRV_LOG(ERR, "Failed to allocate new Tx queue object\n");
+		return -ENOMEM;
+	}
+	avp_dev_queue_xstats_reset(txq);
+
+	/* only the configured set of transmit queues are used */
+	txq->queue_id = tx_queue_id;
+#ifdef AVP_TX_MP
+	if (avp->options & AVP_OPT_TX_MP)
+		txq->queue_id = tx_queue_id % avp->num_tx_queues;
+#endif
+	txq->queue_base = txq->queue_id;
+	txq->queue_limit = txq->queue_id;
+
+#ifdef AVP_ZERO_COPY
+	if (avp->options & AVP_OPT_ZERO_COPY_TX) {
+		txq->zc = avp_dev_zc_ring_create(eth_dev, "tx",
+						 tx_queue_id, socket_id);
+		if (txq->zc == NULL) {
+			rte_free(txq);
+			return -ENOMEM;
+		}
+	}
+#endif
+
+	if (avp->tx_hold_pkts != 0) {
+		txq->hold = avp_dev_tx_hold_create(avp, socket_id);
+		if (txq->hold == NULL) {
+			rte_free(txq->zc);
+			rte_free(txq);
+			return -ENOMEM;
+		}
+	}
+
+	/* save back pointers to AVP and Ethernet devices */
+	txq->avp = avp;
+	txq->dev_data = eth_dev->data;
+	eth_dev->data->tx_queues[tx_queue_id] = (void *)txq;
+
+	avp_dev_set_burst_functions(eth_dev);
+
+	PMD_DRV_LOG(DEBUG, "Tx queue %u setup at %p\n", tx_queue_id, txq);
+
+	(void)nb_tx_desc;
+	(void)tx_conf;
+	return 0;
+}
+
+static inline int
+_avp_cmp_ether_addr(struct ether_addr *a, struct ether_addr *b)
+{
+	uint16_t *_a = (uint16_t *)&a->addr_bytes[0];
+	uint16_t *_b = (uint16_t *)&b->addr_bytes[0];
+	return (_a[0] ^ _b[0]) | (_a[1] ^ _b[1]) | (_a[2] ^ _b[2]);
+}
+
+static inline unsigned int
+_avp_mc_hash(const struct ether_addr *addr)
+{
+	uint64_t key = 0;
+
+	/* multiplicative hash of the 48-bit address */
+	memcpy(&key, addr, ETHER_ADDR_LEN);
+	return (key * 0x9E3779B97F4A7C15ULL) >> (64 - AVP_MC_HASH_BITS);
+}
+
+/*
+ * All multicast packets are accepted when the all-multicast mode is enabled or
+ * when the application has not configured a multicast address list.
+ */
+static inline int
+_avp_allmulti(struct avp_dev *avp)
+{
+	return (avp->flags & AVP_F_ALLMULTI) || (avp->nb_mc_addrs == 0);
+}
+
+static inline int
+_avp_mac_filter(struct avp_dev *avp, struct ether_addr *d_addr)
+{
+	unsigned int hash;
+	uint32_t mask;
+
+	if (likely(_avp_cmp_ether_addr(&avp->ethaddr, d_addr) == 0)) {
+		/* allow all packets destined to our address */
+		return 0;
+	}
+
+	if (likely(is_broadcast_ether_addr(d_addr))) {
+		/* allow all broadcast packets */
+		return 0;
+	}
+
+	if (likely(is_multicast_ether_addr(d_addr))) {
+		if (_avp_allmulti(avp))
+			return 0;
+
+		/* allow multicast packets that hit the hash filter */
+		hash = _avp_mc_hash(d_addr);
+		if (avp->mc_hash[hash / 64] & (1ULL << (hash % 64)))
+			return 0;
+	} else {
+		/* allow packets destined to our additional addresses */
+		for (mask = avp->mac_addr_mask; mask != 0; mask &= mask - 1)
+			if (_avp_cmp_ether_addr(&avp->mac_addrs[rte_bsf32(mask)],
+						d_addr) == 0)
+				return 0;
+	}
+
+	if (avp->flags & AVP_F_PROMISC) {
+		/* allow all packets when in promiscuous mode */
+		return 0;
+	}
+
+	return -1;
+}
+
+/*
+ * Set the flow hash of a received packet.  The hash is either provided by the
+ * host or computed in software when the host does not support the feature and
+ * the application has enabled receive side scaling.
+ */
+static inline void
+avp_dev_rx_hash(struct avp_dev *avp, uint16_t ol_flags, uint32_t rss_hash,
+		struct rte_mbuf *m)
+{
+	struct avp_rss *rss = avp->rss;
+	uint32_t hash;
+
+	if ((ol_flags & RTE_AVP_RX_RSS_HASH) &&
+	    (avp->features & RTE_AVP_FEATURE_RSS)) {
+		/* only a host that negotiated the feature provides a hash */
+		m->hash.rss = rss_hash;
+		m->ol_flags |= PKT_RX_RSS_HASH;
+	} else if ((rss != NULL) &&
+		   (avp_rss_hash(rss, rte_pktmbuf_mtod(m, void *),
+				 rte_pktmbuf_data_len(m), &hash) == 0)) {
+		m->hash.rss = hash;
+		m->ol_flags |= PKT_RX_RSS_HASH;
+	}
+}
+
+/* translate the receive checksum status of a packet to mbuf flags */
+static inline uint64_t
+avp_dev_rx_cksum_flags(struct avp_dev *avp, uint16_t ol_flags)
+{
+	uint64_t flags = 0;
+
+	if (!(avp->features & RTE_AVP_FEATURE_RX_CSUM))
+		return 0;
+
+#if RTE_VERSION >= RTE_VERSION_NUM(16, 11, 0, 0)
+	if (ol_flags & RTE_AVP_RX_IP_CKSUM_GOOD)
+		flags |= PKT_RX_IP_CKSUM_GOOD;
+	if (ol_flags & RTE_AVP_RX_L4_CKSUM_GOOD)
+		flags |= PKT_RX_L4_CKSUM_GOOD;
+#endif
+	if (ol_flags & RTE_AVP_RX_IP_CKSUM_BAD)
+		flags |= PKT_RX_IP_CKSUM_BAD;
+	if (ol_flags & RTE_AVP_RX_L4_CKSUM_BAD)
+		flags |= PKT_RX_L4_CKSUM_BAD;
+
+	return flags;
+}
+
+/*
+ * Translate the transmit checksum and segmentation requests of a packet to
+ * descriptor flags.  Requests for offloads not negotiated with the host are
+ * ignored.
+ */
+static inline uint16_t
+avp_dev_tx_offload_flags(struct avp_dev *avp, const struct rte_mbuf *m)
+{
+	uint64_t ol_flags = m->ol_flags;
+	uint16_t flags = 0;
+
+	if (likely(!(ol_flags & (PKT_TX_IP_CKSUM | PKT_TX_L4_MASK |
+				 PKT_TX_TCP_SEG))))
+		return 0;
+
+	if (avp->features & RTE_AVP_FEATURE_TX_CSUM) {
+		if (ol_flags & PKT_TX_IP_CKSUM)
+			flags |= RTE_AVP_TX_IP_CKSUM;
+
+		switch (ol_flags & PKT_TX_L4_MASK) {
+		case PKT_TX_TCP_CKSUM:
+			flags |= RTE_AVP_TX_TCP_CKSUM;
+			break;
+		case PKT_TX_UDP_CKSUM:
+			flags |= RTE_AVP_TX_UDP_CKSUM;
+			break;
+		default:
+			break;
+		}
+	}
+
+	if ((ol_flags & PKT_TX_TCP_SEG) &&
+	    (avp->features & RTE_AVP_FEATURE_TSO))
+		flags |= RTE_AVP_TX_TCP_SEG;
+
+	return flags;
+}
+
+/* request the transmit offloads of a packet in its first host buffer */
+static inline void
+avp_dev_tx_offload(struct avp_dev *avp, const struct rte_mbuf *m,
+		   struct rte_avp_desc *pkt_buf)
+{
+	uint16_t flags = avp_dev_tx_offload_flags(avp, m);
+
+	if (flags != 0) {
+		pkt_buf->ol_flags |= flags;
+		pkt_buf->tso_segsz = m->tso_segsz;
+		pkt_buf->l2_len = m->l2_len;
+		pkt_buf->l3_len = m->l3_len;
+	}
+}
+
+/* maximum number of host buffers that a transmitted packet may span */
+static inline unsigned int
+avp_dev_tx_max_segments(struct avp_dev *avp, const struct rte_mbuf *m)
+{
+	if ((m->ol_flags & PKT_TX_TCP_SEG) &&
+	    (avp->features & RTE_AVP_FEATURE_TSO))
+		return RTE_AVP_MAX_TSO_SEGMENTS;
+
+	return RTE_AVP_MAX_MBUF_SEGMENTS;
+}
+
+/*
+ * Apply the destination MAC filter to a burst of received host buffers before
+ * any mbuf is allocated or any data is copied.  Returns a bit mask with bit i
+ * set if packet i must be discarded.
+ */
+static inline uint64_t
+avp_dev_mac_filter_burst(struct avp_dev *avp,
+			 struct rte_avp_desc * const *pkt_bufs,
+			 unsigned int count)
+{
+	struct ether_hdr *eth;
+	uint64_t drop = 0;
+	unsigned int i = 0;
+#ifdef AVP_VECTOR_RX
+	const __m128i *addr0;
+	const __m128i *addr1;
+	uint64_t station = 0;
+	__m128i station2;
+	__m128i addrs;
+	unsigned int eq;
+	unsigned int mc;
+	unsigned int allmulti;
+#endif
+
+	RTE_BUILD_BUG_ON(AVP_MAX_RX_BURST > 64);
+
+	if (avp->flags & AVP_F_PROMISC) {
+		/* allow all packets when in promiscuous mode */
+		return 0;
+	}
+
+#ifdef AVP_VECTOR_RX
+	/*
+	 * Compare the destinations of 2 packets at a time against our address.
+	 * The first 8 bytes of each header are loaded so only the low 6 bytes
+	 * of each lane are significant.  The group bit (i.e., multicast, which
+	 * includes broadcast) is the low bit of the first byte and is moved to
+	 * the top bit of that byte to be picked up by the byte mask.  Packets
+	 * that are not accepted by either test go through the full filter.
+	 */
+	memcpy(&station, &avp->ethaddr, ETHER_ADDR_LEN);
+	station2 = _mm_set1_epi64x(station);
+	allmulti = _avp_allmulti(avp) ? 0x0101 : 0;
+	for (; i + 2 <= count; i += 2) {
+		addr0 = avp_dev_buffer_data(avp, pkt_bufs[i]);
+		addr1 = avp_dev_buffer_data(avp, pkt_bufs[i + 1]);
+		if (unlikely((addr0 == NULL) || (addr1 == NULL)))
+			break;
+		addrs = _mm_unpacklo_epi64(_mm_loadl_epi64(addr0),
+					   _mm_loadl_epi64(addr1));
+		eq = _mm_movemask_epi8(_mm_cmpeq_epi8(addrs, station2));
+		mc = _mm_movemask_epi8(_mm_slli_epi64(addrs, 7)) & allmulti;
+
+		if (((eq & 0x003F) != 0x003F) && !(mc & 0x0001) &&
+		    (_avp_mac_filter(avp, (struct ether_addr *)
+				     (uintptr_t)addr0) != 0))
+			drop |= 1ULL << i;
+		if (((eq & 0x3F00) != 0x3F00) && !(mc & 0x0100) &&
+		    (_avp_mac_filter(avp, (struct ether_addr *)
+				     (uintptr_t)addr1) != 0))
+			drop |= 1ULL << (i + 1);
+	}
+#endif
+
+	for (; i < count; i++) {
+		/* bad host addresses are accounted for by the caller */
+		eth = avp_dev_buffer_data(avp, pkt_bufs[i]);
+		if ((eth != NULL) && (_avp_mac_filter(avp, &eth->d_addr) != 0))
+			drop |= 1ULL << i;
+	}
+
+	return drop;
+}
+
+#ifdef RTE_LIBRTE_AVP_DEBUG_BUFFERS
+static inline void
+__avp_dev_buffer_sanity_check(struct avp_dev *avp, struct rte_avp_desc *buf)
+{
+	struct rte_avp_desc *first_buf;
+	struct rte_avp_desc *pkt_buf;
+	unsigned int pkt_len;
+	unsigned int nb_segs;
+	void *pkt_data;
+	unsigned int i;
+
+	first_buf = avp_dev_translate_buffer(avp, buf);
+	if (first_buf == NULL)
+		rte_panic("bad buffer: invalid address %p\n", buf);
+
+	i = 0;
+	pkt_len = 0;
+	nb_segs = first_buf->nb_segs;
+	do {
+		/* Adjust pointers for guest addressing */
+		pkt_buf = avp_dev_translate_buffer(avp, buf);
+		if (pkt_buf == NULL)
+			rte_panic("bad buffer: segment %u has an invalid address %p\n",
+				  i, buf);
+		pkt_data = avp_dev_buffer_data(avp, pkt_buf);
+		if (pkt_data == NULL)
+			rte_panic("bad buffer: segment %u has a NULL data pointer\n",
+				  i);
+		if (pkt_buf->data_len == 0)
+			rte_panic("bad buffer: segment %u has 0 data length\n",
+				  i);
+		pkt_len += pkt_buf->data_len;
+		nb_segs--;
+		i++;
+
+	} while (nb_segs && (buf = pkt_buf->next) != NULL);
+
+	if (nb_segs != 0)
+		rte_panic("bad buffer: expected %u segments found %u\n",
+			  first_buf->nb_segs, (first_buf->nb_segs - nb_segs));
+	if (pkt_len != first_buf->pkt_len)
+		rte_panic("bad buffer: expected length %u found %u\n",
+			  first_buf->pkt_len, pkt_len);
+}
+
+#define avp_dev_buffer_sanity_check(a, b) \
+	__avp_dev_buffer_sanity_check((a), (b))
+
+#else /* RTE_LIBRTE_AVP_DEBUG_BUFFERS */
+
+#define avp_dev_buffer_sanity_check(a, b) do {} while (0)
+
+#endif
+
+/*
+ * Ensure that at least 'count' mbufs are held in the receive queue mbuf cache
+ * by allocating the shortfall with a single bulk operation.  Returns the
+ * number of mbufs available which is less than 'count' only if the mempool
+ * is exhausted; the caller accounts for the packets it cannot receive.
+ */
+static inline unsigned int
+avp_dev_rx_refill(struct avp_dev *avp, struct avp_queue *rxq,
+		  unsigned int count)
+{
+	unsigned int required;
+
+	if (likely(rxq->nb_mbufs >= count))
+		return count;
+
+	required = count - rxq->nb_mbufs;
+	if (unlikely(avp_pktmbuf_alloc_bulk(avp->pool,
+					    &rxq->mbufs[rxq->nb_mbufs],
+					    required) != 0))
+		return rxq->nb_mbufs;
+
+	rxq->nb_mbufs = count;
+	return count;
+}
+
+/* account for packets left on a receive fifo for lack of mbufs */
+static inline void
+avp_dev_rx_nombuf(struct avp_queue *rxq, unsigned int count)
+{
+	rxq->dev_data->rx_mbuf_alloc_failed += count;
+	rxq->xstats.nombuf += count;
+}
+
+/*
+ * Copy a host buffer chain to a set of mbufs.	This function assumes that
+ * there exactly the required number of mbufs to copy all source bytes.
+ */
+static inline struct rte_mbuf *
+avp_dev_copy_from_buffers(struct avp_dev *avp,
+			  struct rte_avp_desc *buf,
+			  struct rte_mbuf **mbufs,
+			  unsigned int count)
+{
+	struct rte_mbuf *m_previous = NULL;
+	struct rte_avp_desc *pkt_buf;
+	unsigned int total_length = 0;
+	unsigned int copy_length;
+	unsigned int src_offset;
+	struct rte_mbuf *m;
+	uint16_t ol_flags;
+	uint16_t vlan_tci;
+	void *pkt_data;
+	unsigned int i;
+
+	avp_dev_buffer_sanity_check(avp, buf);
+
+	/* setup the first source buffer */
+	pkt_buf = avp_dev_translate_buffer(avp, buf);
+	pkt_data = avp_dev_buffer_data(avp, pkt_buf);
+	total_length = pkt_buf->pkt_len;
+	src_offset = 0;
+
+	if (pkt_buf->ol_flags & RTE_AVP_RX_VLAN_PKT) {
+		ol_flags = PKT_RX_VLAN_PKT;
+		vlan_tci = pkt_buf->vlan_tci;
+	} else {
+		ol_flags = 0;
+		vlan_tci = 0;
+	}
+
+	for (i = 0; (i < count) && (buf != NULL); i++) {
+		/* fill each destination buffer */
+		m = mbufs[i];
+
+		if (m_previous != NULL)
+			rte_pktmbuf_next(m_previous) = m;
+
+		m_previous = m;
+
+		do {
+			/*
+			 * Copy as many source buffers as will fit in the
+			 * destination buffer.
+			 */
+			copy_length = RTE_MIN((avp->guest_mbuf_size -
+					       rte_pktmbuf_data_len(m)),
+					      (pkt_buf->data_len -
+					       src_offset));
+			avp_copy(avp->rx_copy,
+				 RTE_PTR_ADD(rte_pktmbuf_mtod(m, void *),
+					     rte_pktmbuf_data_len(m)),
+				 RTE_PTR_ADD(pkt_data, src_offset),
+				 copy_length);
+			rte_pktmbuf_data_len(m) += copy_length;
+			src_offset += copy_length;
+
+			if (likely(src_offset == pkt_buf->data_len)) {
+				/* need a new source buffer */
+				buf = pkt_buf->next;
+				if (buf != NULL) {
+					pkt_buf = avp_dev_translate_buffer(
+						avp, buf);
+					pkt_data = avp_dev_buffer_data(
+						avp, pkt_buf);
+					src_offset = 0;
+				}
+			}
+
+			if (unlikely(rte_pktmbuf_data_len(m) ==
+				     avp->guest_mbuf_size)) {
+				/* need a new destination mbuf */
+				break;
+			}
+
+		} while (buf != NULL);
+	}
+
+	m = mbufs[0];
+	m->ol_flags = ol_flags;
+	rte_pktmbuf_nb_segs(m) = count;
+	rte_pktmbuf_pkt_len(m) = total_length;
+	rte_pktmbuf_vlan_tci(m) = vlan_tci;
+
+	avp_mbuf_sanity_check(m, 1);
+
+	return m;
+}
+
+static uint16_t
+avp_recv_scattered_pkts(void *rx_queue,
+			struct rte_mbuf **rx_pkts,
+			uint16_t nb_pkts)
+{
+	struct avp_queue *rxq = (struct avp_queue *)rx_queue;
+	struct rte_avp_desc *pkt_bufs[AVP_MAX_RX_BURST];
+	struct rte_avp_desc *avp_bufs[AVP_MAX_RX_BURST];
+	uint8_t segments[AVP_MAX_RX_BURST];
+	struct avp_dev *avp = rxq->avp;
+	struct rte_avp_desc *pkt_buf;
+	struct rte_avp_fifo *free_q;
+	struct rte_avp_fifo *rx_q;
+	struct rte_avp_desc *buf;
+	unsigned int count, avail, n;
+	unsigned int guest_mbuf_size;
+	struct rte_mbuf *m;
+	unsigned int required;
+	unsigned int buf_len;
+	unsigned int port_id;
+	unsigned int i;
+	uint64_t drop;
+	uint64_t bad;
+	uint64_t tsc __rte_unused;
+
+	if (unlikely(avp->flags & AVP_F_DETACHED)) {
+		/* VM live migration in progress */
+		return 0;
+	}
+
+	guest_mbuf_size = avp->guest_mbuf_size;
+	port_id = avp->port_id;
+	rx_q = avp->rx_q[rxq->queue_id];
+	free_q = avp->free_q[rxq->queue_id];
+
+	/* setup next queue to service */
+	rxq->queue_id = (rxq->queue_id < rxq->queue_limit) ?
+		(rxq->queue_id + 1) : rxq->queue_base;
+
+	AVP_STAGE_START(rxq, tsc);
+
+	/* determine how many slots are available in the free queue */
+	count = avp_dev_fifo_free_count(avp, free_q, nb_pkts);
+
+	/* determine how many packets are available in the rx queue */
+	avail = avp_dev_fifo_count(avp, rx_q, nb_pkts);
+	avp_dev_fifo_watermarks(rxq, avail, count);
+
+	/* determine how many packets can be received */
+	count = RTE_MIN(count, avail);
+	count = RTE_MIN(count, nb_pkts);
+	count = RTE_MIN(count, (unsigned int)AVP_MAX_RX_BURST);
+
+	if (unlikely(count == 0)) {
+		/* no free buffers, or no buffers on the rx queue */
+		return 0;
+	}
+
+	/* look at the pending packets without removing them from the fifo */
+	n = avp_dev_fifo_peek(avp, rx_q, (void **)&avp_bufs, count);
+	PMD_RX_LOG(DEBUG, "Receiving %u packets from Rx queue at %p\n",
+		   count, rx_q);
+	AVP_STAGE_MARK(rxq, tsc, RTE_PMD_AVP_STAGE_FIFO_GET);
+
+	for (i = 0; i < n; i++) {
+		pkt_bufs[i] = avp_dev_translate_buffer(avp, avp_bufs[i]);
+		rte_prefetch0(pkt_bufs[i]);
+	}
+	AVP_STAGE_MARK(rxq, tsc, RTE_PMD_AVP_STAGE_TRANSLATE);
+
+	/* discard packets not destined to our MAC before copying them */
+	drop = avp_dev_mac_filter_burst(avp, pkt_bufs, n);
+	AVP_STAGE_MARK(rxq, tsc, RTE_PMD_AVP_STAGE_FILTER);
+
+	/* Peek into each packet to determine the mbufs required by the burst */
+	count = 0;
+	bad = 0;
+	for (i = 0; i < n; i++) {
+		if (drop & (1ULL << i)) {
+			segments[i] = 0;
+			continue;
+		}
+
+		pkt_buf = pkt_bufs[i];
+		if (unlikely(avp_dev_buffer_chain_check(avp, pkt_buf) != 0)) {
+			bad |= 1ULL << i;
+			segments[i] = 0;
+			continue;
+		}
+
+		required = (pkt_buf->pkt_len + guest_mbuf_size - 1) /
+			guest_mbuf_size;
+		if (unlikely((required == 0) ||
+			     (required > RTE_AVP_MAX_MBUF_SEGMENTS)))
+			required = 0;
+		segments[i] = required;
+		count += required;
+	}
+
+	/* Allocate enough mbufs to receive the entire burst */
+	avail = avp_dev_rx_refill(avp, rxq, count);
+	if (unlikely(avail < count)) {
+		/* leave the packets that do not fit for the next call */
+		count = 0;
+		for (i = 0; i < n; i++) {
+			if (count + segments[i] > avail)
+				break;
+			count += segments[i];
+		}
+		avp_dev_rx_nombuf(rxq, n - i);
+		n = i;
+		drop &= (1ULL << n) - 1;
+	}
+	rxq->xstats.filtered += __builtin_popcountll(drop);
+	avp_dev_fifo_consume(avp, rx_q, n);
+	AVP_STAGE_MARK(rxq, tsc, RTE_PMD_AVP_STAGE_ALLOC);
+
+	count = 0;
+	for (i = 0; i < n; i++) {
+		if (drop & (1ULL << i)) {
+			/* silently discard packets not destined to our MAC */
+			continue;
+		}
+
+		if (unlikely(bad & (1ULL << i))) {
+			/* the host address is outside of all pools */
+			rxq->errors++;
+			rxq->xstats.bad_address++;
+			continue;
+		}
+
+		buf = avp_bufs[i];
+		pkt_buf = pkt_bufs[i];
+		buf_len = pkt_buf->pkt_len;
+
+		required = segments[i];
+		if (unlikely(required == 0)) {
+			rxq->errors++;
+			rxq->xstats.oversized++;
+			continue;
+		}
+
+		/* Copy the data from the buffers to our mbufs */
+		rxq->nb_mbufs -= required;
+		m = avp_dev_copy_from_buffers(avp, buf,
+					      &rxq->mbufs[rxq->nb_mbufs],
+					      required);
+
+		/* finalize mbuf */
+		rte_pktmbuf_port(m) = port_id;
+		m->ol_flags |= avp_dev_rx_cksum_flags(avp, pkt_buf->ol_flags);
+		avp_dev_rx_hash(avp, pkt_buf->ol_flags, pkt_buf->rss_hash, m);
+
+		/* return new mbuf to caller */
+		rx_pkts[count++] = m;
+		rxq->bytes += buf_len;
+	}
+
+	avp_copy_fence(avp->rx_copy);
+	AVP_STAGE_MARK(rxq, tsc, RTE_PMD_AVP_STAGE_COPY);
+
+	rxq->packets += count;
+
+	/* return the buffers to the free queue */
+	avp_dev_fifo_put(avp, free_q, (void **)&avp_bufs[0], n);
+	AVP_STAGE_END(rxq, tsc);
+
+	avp_dev_burst_account(rxq, count);
+
+	return count;
+}
+
+/* define a burst function as a specialization of a common body */
+#define AVP_BURST(name, body, variant) \
+static uint16_t \
+name(void *queue, struct rte_mbuf **pkts, uint16_t nb_pkts) \
+{ \
+	return body(queue, pkts, nb_pkts, (variant)); \
+}
+
+/*
+ * Define every specialization of a flat burst function body along with a
+ * table of them indexed by their AVP_RX_* or AVP_TX_* flags.  The branches on
+ * configuration that is constant across bursts are resolved at compile time
+ * within each specialization.
+ */
+#define AVP_BURST_VARIANTS(name, body, type) \
+	AVP_BURST(name ## _0, body, 0) \
+	AVP_BURST(name ## _1, body, 1) \
+	AVP_BURST(name ## _2, body, 2) \
+	AVP_BURST(name ## _3, body, 3) \
+	AVP_BURST(name ## _4, body, 4) \
+	AVP_BURST(name ## _5, body, 5) \
+	AVP_BURST(name ## _6, body, 6) \
+	AVP_BURST(name ## _7, body, 7) \
+	static const type name ## _variants[] = { \
+		name ## _0, name ## _1, name ## _2, name ## _3, \
+		name ## _4, name ## _5, name ## _6, name ## _7, \
+	}
+
+static inline __attribute__((always_inline)) uint16_t
+avp_recv_pkts_common(void *rx_queue,
+		     struct rte_mbuf **rx_pkts,
+		     uint16_t nb_pkts,
+		     const unsigned int variant)
+{
+	struct avp_queue *rxq = (struct avp_queue *)rx_queue;
+	struct rte_avp_desc *pkt_bufs[AVP_MAX_RX_BURST];
+	struct rte_avp_desc *avp_bufs[AVP_MAX_RX_BURST];
+	struct avp_dev *avp = rxq->avp;
+	struct rte_avp_desc *pkt_buf;
+	struct rte_avp_fifo *free_q;
+	struct rte_avp_fifo *rx_q;
+	unsigned int count, avail, n;
+	unsigned int pkt_len;
+	struct rte_mbuf *m;
+	char *pkt_data;
+	unsigned int i;
+	uint64_t drop;
+	uint64_t tsc __rte_unused;
+
+	if (unlikely(avp->flags & AVP_F_DETACHED)) {
+		/* VM live migration in progress */
+		return 0;
+	}
+
+	rx_q = avp->rx_q[rxq->queue_id];
+	free_q = avp->free_q[rxq->queue_id];
+
+	/* setup next queue to service */
+	if (variant & AVP_RX_MULTI_FIFO)
+		rxq->queue_id = (rxq->queue_id < rxq->queue_limit) ?
+			(rxq->queue_id + 1) : rxq->queue_base;
+
+	AVP_STAGE_START(rxq, tsc);
+
+	/* determine how many slots are available in the free queue */
+	count = avp_dev_fifo_free_count(avp, free_q, nb_pkts);
+
+	/* determine how many packets are available in the rx queue */
+	avail = avp_dev_fifo_count(avp, rx_q, nb_pkts);
+	avp_dev_fifo_watermarks(rxq, avail, count);
+
+	/* determine how many packets can be received */
+	count = RTE_MIN(count, avail);
+	count = RTE_MIN(count, nb_pkts);
+	count = RTE_MIN(count, (unsigned int)AVP_MAX_RX_BURST);
+
+	/* allocate the mbufs for the whole burst up front */
+	n = avp_dev_rx_refill(avp, rxq, count);
+	if (unlikely(n < count)) {
+		/* leave the packets that do not fit for the next call */
+		avp_dev_rx_nombuf(rxq, count - n);
+		count = n;
+	}
+
+	if (unlikely(count == 0)) {
+		/* no free buffers, or no buffers on the rx queue */
+		return 0;
+	}
+	AVP_STAGE_MARK(rxq, tsc, RTE_PMD_AVP_STAGE_ALLOC);
+
+	/* retrieve pending packets */
+	n = avp_dev_fifo_get(avp, rx_q, (void **)&avp_bufs, count);
+	PMD_RX_LOG(DEBUG, "Receiving %u packets from Rx queue at %p\n",
+		   count, rx_q);
+	AVP_STAGE_MARK(rxq, tsc, RTE_PMD_AVP_STAGE_FIFO_GET);
+
+	/* Adjust host pointers for guest addressing */
+	for (i = 0; i < n; i++) {
+		pkt_bufs[i] = avp_dev_translate_buffer(avp, avp_bufs[i]);
+		rte_prefetch0(pkt_bufs[i]);
+	}
+	AVP_STAGE_MARK(rxq, tsc, RTE_PMD_AVP_STAGE_TRANSLATE);
+
+	/* discard packets not destined to our MAC before copying them */
+	if (variant & AVP_RX_PROMISC)
+		drop = 0;
+	else
+		drop = avp_dev_mac_filter_burst(avp, pkt_bufs, n);
+	rxq->xstats.filtered += __builtin_popcountll(drop);
+	AVP_STAGE_MARK(rxq, tsc, RTE_PMD_AVP_STAGE_FILTER);
+
+	count = 0;
+	for (i = 0; i < n; i++) {
+		if (drop & (1ULL << i)) {
+			/* silently discard packets not destined to our MAC */
+			continue;
+		}
+
+		pkt_buf = pkt_bufs[i];
+		pkt_data = avp_dev_buffer_data(avp, pkt_buf);
+		if (unlikely(pkt_data == NULL)) {
+			/* the host address is outside of all pools */
+			rxq->errors++;
+			rxq->xstats.bad_address++;
+			continue;
+		}
+
+		pkt_len = pkt_buf->pkt_len;
+
+		if (unlikely((pkt_len > avp->guest_mbuf_size) ||
+			     (pkt_buf->nb_segs > 1))) {
+			/*
+			 * application should be using the scattered receive
+			 * function
+			 */
+			rxq->errors++;
+			rxq->xstats.oversized++;
+			continue;
+		}
+
+		/* process each packet to be transmitted */
+		m = rxq->mbufs[--rxq->nb_mbufs];
+
+		/* copy data out of the host buffer to our buffer */
+		rte_pktmbuf_data_offset(m, RTE_PKTMBUF_HEADROOM);
+		avp_copy(avp->rx_copy, rte_pktmbuf_mtod(m, void *),
+			 pkt_data, pkt_len);
+
+		/* initialize the local mbuf */
+		rte_pktmbuf_data_len(m) = pkt_len;
+		rte_pktmbuf_pkt_len(m) = pkt_len;
+		rte_pktmbuf_port(m) = avp->port_id;
+
+		if ((variant & AVP_RX_VLAN) &&
+		    (pkt_buf->ol_flags & RTE_AVP_RX_VLAN_PKT)) {
+			m->ol_flags = PKT_RX_VLAN_PKT;
+			rte_pktmbuf_vlan_tci(m) = pkt_buf->vlan_tci;
+		}
+
+		m->ol_flags |= avp_dev_rx_cksum_flags(avp, pkt_buf->ol_flags);
+		avp_dev_rx_hash(avp, pkt_buf->ol_flags, pkt_buf->rss_hash, m);
+
+		/* return new mbuf to caller */
+		rx_pkts[count++] = m;
+		rxq->bytes += pkt_len;
+	}
+
+	avp_copy_fence(avp->rx_copy);
+	AVP_STAGE_MARK(rxq, tsc, RTE_PMD_AVP_STAGE_COPY);
+
+	rxq->packets += count;
+
+	/* return the buffers to the free queue */
+	avp_dev_fifo_put(avp, free_q, (void **)&avp_bufs[0], n);
+	AVP_STAGE_END(rxq, tsc);
+
+	avp_dev_burst_account(rxq, count);
+
+	return count;
+}
+
+AVP_BURST_VARIANTS(avp_recv_pkts, avp_recv_pkts_common, eth_rx_burst_t);
+
+/* translate a compact descriptor to the guest virtual address of its data */
+static inline void *
+avp_dev_cdesc_data(struct avp_dev *avp, const struct rte_avp_cdesc *desc)
+{
+	uint32_t buf_id = desc->buf_id;
+
+	return RTE_PTR_ADD(avp->buf_base[buf_id >> RTE_AVP_CDESC_POOL_SHIFT],
+			   ((uint64_t)(buf_id & RTE_AVP_CDESC_INDEX_MASK) *
+			    avp->buf_stride) + desc->offset);
+}
+
+/*
+ * Copy a packet described by a set of compact descriptors to a set of mbufs.
+ * This function assumes that there are exactly the required number of mbufs
+ * to copy all source bytes.
+ */
+static inline struct rte_mbuf *
+avp_dev_copy_from_cdesc(struct avp_dev *avp,
+			const struct rte_avp_cdesc *descs,
+			unsigned int nb_descs,
+			unsigned int pkt_len,
+			struct rte_mbuf **mbufs,
+			unsigned int count)
+{
+	unsigned int copy_length;
+	unsigned int src_offset;
+	struct rte_mbuf *m;
+	char *pkt_data;
+	unsigned int i;
+	unsigned int d;
+
+	d = 0;
+	src_offset = 0;
+	pkt_data = avp_dev_cdesc_data(avp, &descs[0]);
+	for (i = 0; i < count; i++) {
+		/* fill each destination buffer */
+		m = mbufs[i];
+		if (i > 0)
+			rte_pktmbuf_next(mbufs[i - 1]) = m;
+
+		while ((d < nb_descs) &&
+		       (rte_pktmbuf_data_len(m) < avp->guest_mbuf_size)) {
+			copy_length = RTE_MIN((avp->guest_mbuf_size -
+					       rte_pktmbuf_data_len(m)),
+					      (descs[d].data_len - src_offset));
+			avp_copy(avp->rx_copy,
+				 RTE_PTR_ADD(rte_pktmbuf_mtod(m, void *),
+					     rte_pktmbuf_data_len(m)),
+				 RTE_PTR_ADD(pkt_data, src_offset),
+				 copy_length);
+			rte_pktmbuf_data_len(m) += copy_length;
+			src_offset += copy_length;
+
+			if (src_offset == descs[d].data_len) {
+				/* need a new source buffer */
+				if (++d < nb_descs)
+					pkt_data = avp_dev_cdesc_data(
+						avp, &descs[d]);
+				src_offset = 0;
+			}
+		}
+	}
+
+	m = mbufs[0];
+	rte_pktmbuf_nb_segs(m) = count;
+	rte_pktmbuf_pkt_len(m) = pkt_len;
+	rte_pktmbuf_port(m) = avp->port_id;
+
+	if (descs[0].flags & RTE_AVP_RX_VLAN_PKT) {
+		m->ol_flags = PKT_RX_VLAN_PKT;
+		rte_pktmbuf_vlan_tci(m) = descs[0].vlan_tci;
+	}
+
+	m->ol_flags |= avp_dev_rx_cksum_flags(avp, descs[0].flags);
+	avp_dev_rx_hash(avp, descs[0].flags, descs[0].rss_hash, m);
+	avp_mbuf_sanity_check(m, 1);
+
+	return m;
+}
+
+/*
+ * Receive packets from a host that exchanges compact descriptors.  Buffers
+ * are located by index so no host pointer needs to be translated, and a
+ * single function handles both flat and chained packets.
+ */
+static uint16_t
+avp_recv_pkts_cdesc(void *rx_queue,
+		    struct rte_mbuf **rx_pkts,
+		    uint16_t nb_pkts)
+{
+	struct avp_queue *rxq = (struct avp_queue *)rx_queue;
+	struct rte_avp_cdesc descs[AVP_MAX_RX_BURST];
+	uint16_t lengths[AVP_MAX_RX_BURST];
+	uint8_t segments[AVP_MAX_RX_BURST];
+	uint8_t chains[AVP_MAX_RX_BURST];
+	struct avp_dev *avp = rxq->avp;
+	unsigned int guest_mbuf_size;
+	struct rte_avp_fifo *free_q;
+	struct rte_avp_fifo *rx_q;
+	unsigned int count, avail, n;
+	unsigned int nb_descs;
+	unsigned int nb_rx;
+	unsigned int required;
+	unsigned int pkt_len;
+	struct rte_mbuf *m;
+	unsigned int i;
+	uint64_t drop;
+	uint64_t tsc __rte_unused;
+
+	RTE_BUILD_BUG_ON(offsetof(struct rte_avp_ring, write) !=
+			 offsetof(struct rte_avp_fifo_v3, write));
+	RTE_BUILD_BUG_ON(offsetof(struct rte_avp_ring, read) !=
+			 offsetof(struct rte_avp_fifo_v3, read));
+	RTE_BUILD_BUG_ON(offsetof(struct rte_avp_ring, desc) !=
+			 offsetof(struct rte_avp_fifo_v3, buffer));
+	RTE_BUILD_BUG_ON(sizeof(struct rte_avp_cdesc) != 16);
+
+	if (unlikely(avp->flags & AVP_F_DETACHED)) {
+		/* VM live migration in progress */
+		return 0;
+	}
+
+	guest_mbuf_size = avp->guest_mbuf_size;
+	rx_q = avp->rx_q[rxq->queue_id];
+	free_q = avp->free_q[rxq->queue_id];
+
+	/* setup next queue to service */
+	rxq->queue_id = (rxq->queue_id < rxq->queue_limit) ?
+		(rxq->queue_id + 1) : rxq->queue_base;
+
+	AVP_STAGE_START(rxq, tsc);
+
+	/* determine how many slots are available in the free queue */
+	count = avp_dev_fifo_free_count(avp, free_q,
+					nb_pkts * RTE_AVP_MAX_MBUF_SEGMENTS);
+
+	/* determine how many descriptors are available in the rx queue */
+	avail = avp_dev_fifo_count(avp, rx_q,
+				   nb_pkts * RTE_AVP_MAX_MBUF_SEGMENTS);
+	avp_dev_fifo_watermarks(rxq, avail, count);
+
+	/*
+	 * determine how many descriptors can be received.  Only whole packets
+	 * are retrieved so the request is sized in descriptors and the number
+	 * of packets is limited once they have been walked.
+	 */
+	count = RTE_MIN(count, avail);
+	count = RTE_MIN(count, (unsigned int)nb_pkts *
+			RTE_AVP_MAX_MBUF_SEGMENTS);
+	count = RTE_MIN(count, (unsigned int)AVP_MAX_RX_BURST);
+
+	if (unlikely(count == 0)) {
+		/* no free buffers, or no buffers on the rx queue */
+		return 0;
+	}
+
+	/* look at the pending packets without removing them from the ring */
+	n = avp_ring_peek(AVP_RING(rx_q), descs, count);
+	if (unlikely(n == 0)) {
+		if ((count < RTE_AVP_MAX_MBUF_SEGMENTS) && (count < avail)) {
+			/* too few free_q slots to return a whole packet */
+			rxq->xstats.fifo_full++;
+		}
+		return 0;
+	}
+
+	PMD_RX_LOG(DEBUG, "Receiving %u descriptors from Rx queue at %p\n",
+		   n, rx_q);
+	AVP_STAGE_MARK(rxq, tsc, RTE_PMD_AVP_STAGE_FIFO_GET);
+
+	/*
+	 * Walk each packet to determine the mbufs required by the burst and
+	 * discard packets not destined to our MAC before copying them.
+	 */
+	count = 0;
+	nb_rx = 0;
+	drop = 0;
+	for (i = 0; i < n; i += nb_descs) {
+		if (nb_rx == nb_pkts) {
+			/* leave the remaining packets for the next call */
+			break;
+		}
+
+		nb_descs = 1;
+		pkt_len = descs[i].data_len;
+		while (descs[i + nb_descs - 1].flags & RTE_AVP_CDESC_MORE)
+			pkt_len += descs[i + nb_descs++].data_len;
+		chains[i] = nb_descs;
+		lengths[i] = pkt_len;
+
+		if (!(avp->flags & AVP_F_PROMISC) &&
+		    (_avp_mac_filter(avp, avp_dev_cdesc_data(avp, &descs[i]))
+		     != 0)) {
+			drop |= 1ULL << i;
+			segments[i] = 0;
+			continue;
+		}
+
+		required = (pkt_len + guest_mbuf_size - 1) / guest_mbuf_size;
+		if (unlikely((required == 0) ||
+			     (required > RTE_AVP_MAX_MBUF_SEGMENTS) ||
+			     ((required > 1) && !rxq->dev_data->scattered_rx)))
+			required = 0;
+		else
+			nb_rx++;
+		segments[i] = required;
+		count += required;
+	}
+	n = i;
+	AVP_STAGE_MARK(rxq, tsc, RTE_PMD_AVP_STAGE_FILTER);
+
+	/* Allocate enough mbufs to receive the entire burst */
+	avail = avp_dev_rx_refill(avp, rxq, count);
+	if (unlikely(avail < count)) {
+		/* leave the packets that do not fit for the next call */
+		count = 0;
+		for (i = 0; i < n; i += chains[i]) {
+			if (count + segments[i] > avail)
+				break;
+			count += segments[i];
+			if (segments[i] != 0)
+				nb_rx--;
+		}
+		avp_dev_rx_nombuf(rxq, nb_rx);
+		n = i;
+		drop &= (1ULL << n) - 1;
+	}
+	rxq->xstats.filtered += __builtin_popcountll(drop);
+	avp_ring_consume(AVP_RING(rx_q), n);
+	AVP_STAGE_MARK(rxq, tsc, RTE_PMD_AVP_STAGE_ALLOC);
+
+	count = 0;
+	for (i = 0; i < n; i += nb_descs) {
+		nb_descs = chains[i];
+		pkt_len = lengths[i];
+		required = segments[i];
+		if (drop & (1ULL << i)) {
+			/* silently discard packets not destined to our MAC */
+			continue;
+		}
+
+		if (unlikely(required == 0)) {
+			rxq->errors++;
+			rxq->xstats.oversized++;
+			continue;
+		}
+
+		/* Copy the data from the buffers to our mbufs */
+		rxq->nb_mbufs -= required;
+		m = avp_dev_copy_from_cdesc(avp, &descs[i], nb_descs, pkt_len,
+					    &rxq->mbufs[rxq->nb_mbufs],
+					    required);
+
+		/* return new mbuf to caller */
+		rx_pkts[count++] = m;
+		rxq->bytes += pkt_len;
+	}
+
+	avp_copy_fence(avp->rx_copy);
+	AVP_STAGE_MARK(rxq, tsc, RTE_PMD_AVP_STAGE_COPY);
+
+	rxq->packets += count;
+
+	/* return the buffers to the free queue */
+	avp_ring_put(AVP_RING(free_q), descs, n);
+	AVP_STAGE_END(rxq, tsc);
+
+	avp_dev_burst_account(rxq, count);
+
+	return count;
+}
+
+/*
+ * Receive from all of the AVP fifos mapped to a device queue in a single call.
+ * The underlying receive function services one fifo per call starting at
+ * rxq->queue_id and then advances to the next mapped fifo.
+ */
+static uint16_t
+avp_recv_pkts_multi(void *rx_queue,
+		    struct rte_mbuf **rx_pkts,
+		    uint16_t nb_pkts)
+{
+	struct avp_queue *rxq = (struct avp_queue *)rx_queue;
+	unsigned int counts[RTE_AVP_MAX_QUEUES];
+	struct avp_dev *avp = rxq->avp;
+	eth_rx_burst_t rx_pkt_burst;
+	unsigned int nb_fifos;
+	unsigned int total;
+	unsigned int share;
+	unsigned int last;
+	uint16_t count;
+	unsigned int i;
+
+	rx_pkt_burst = avp_burst_functions[avp->port_id].rx_pkt_burst;
+	nb_fifos = rxq->queue_limit - rxq->queue_base + 1;
+	if (nb_fifos == 1)
+		return rx_pkt_burst(rx_queue, rx_pkts, nb_pkts);
+
+	if (unlikely(avp->flags & AVP_F_DETACHED)) {
+		/* VM live migration in progress */
+		return 0;
+	}
+
+	count = 0;
+	if (avp->rx_policy == AVP_RX_POLICY_WEIGHTED) {
+		/* share the burst in proportion to the occupancy of each fifo */
+		total = 0;
+		for (i = 0; i < nb_fifos; i++) {
+			counts[i] = avp_dev_fifo_count(avp,
+				avp->rx_q[rxq->queue_base + i], nb_pkts);
+			total += counts[i];
+		}
+
+		for (i = 0; (i < nb_fifos) && (count < nb_pkts); i++) {
+			if (counts[i] == 0)
+				continue;
+
+			share = (counts[i] * nb_pkts + total - 1) / total;
+			rxq->queue_id = rxq->queue_base + i;
+			count += rx_pkt_burst(rx_queue, &rx_pkts[count],
+				RTE_MIN(share, (unsigned int)(nb_pkts - count)));
+		}
+
+		return count;
+	}
+
+	/*
+	 * Visit each fifo in turn, resuming after the last fifo serviced by
+	 * the previous call, until the burst is full or a full pass over all
+	 * of the fifos yields no packets.
+	 */
+	do {
+		last = count;
+		for (i = 0; (i < nb_fifos) && (count < nb_pkts); i++)
+			count += rx_pkt_burst(rx_queue, &rx_pkts[count],
+					      nb_pkts - count);
+	} while ((count < nb_pkts) && (count != last));
+
+	return count;
+}
+
+/*
+ * Receive a burst with the underlying receive function and coalesce the TCP
+ * segments that it holds if enabled on the queue.
+ */
+static uint16_t
+avp_recv_pkts_gro(void *rx_queue,
+		  struct rte_mbuf **rx_pkts,
+		  uint16_t nb_pkts)
+{
+	struct avp_queue *rxq = (struct avp_queue *)rx_queue;
+	eth_rx_burst_t rx_gro_burst;
+	unsigned int count;
+
+	rx_gro_burst = avp_burst_functions[rxq->avp->port_id].rx_gro_burst;
+	count = rx_gro_burst(rx_queue, rx_pkts, nb_pkts);
+	if (!rxq->gro)
+		return count;
+
+	rxq->gro_segments += count;
+	if (count > 1)
+		count = avp_gro_reassemble(rx_pkts, count, &rxq->gro_merged);
+
+	return count;
+}
+
+#ifdef AVP_VECTOR_RX
+/*
+ * Offset of the 16 byte window of a host descriptor that holds its data_len,
+ * nb_segs, pkt_len and vlan_tci fields.
+ */
+#define AVP_DESC_RX_FIELDS_OFFSET 44
+
+/* rebase a burst of host buffer addresses to guest addresses */
+static inline void
+avp_dev_translate_burst_vec(struct avp_dev *avp, void * const *host_bufs,
+			    void **bufs, unsigned int count)
+{
+	uintptr_t delta = RTE_PTR_DIFF(avp->pools[0].addr,
+				       avp->pools[0].host_addr);
+	const __m128i delta2 = _mm_set1_epi64x(delta);
+#ifdef RTE_MACHINE_CPUFLAG_AVX2
+	const __m256i delta4 = _mm256_set1_epi64x(delta);
+#endif
+	unsigned int i = 0;
+
+	if (unlikely(avp->nb_pools > 1)) {
+		/* each buffer may need a different offset */
+		for (; i < count; i++)
+			bufs[i] = avp_dev_translate_buffer(avp, host_bufs[i]);
+		return;
+	}
+
+#ifdef RTE_MACHINE_CPUFLAG_AVX2
+	for (; i + 4 <= count; i += 4)
+		_mm256_storeu_si256((__m256i *)&bufs[i],
+			_mm256_add_epi64(_mm256_loadu_si256(
+				(const __m256i *)&host_bufs[i]), delta4));
+#endif
+	for (; i + 2 <= count; i += 2)
+		_mm_storeu_si128((__m128i *)&bufs[i],
+			_mm_add_epi64(_mm_loadu_si128(
+				(const __m128i *)&host_bufs[i]), delta2));
+	if (i < count)
+		bufs[i] = RTE_PTR_ADD(host_bufs[i], delta);
+
+	/* as avp_dev_translate_buffer(), reject addresses outside the pool */
+	for (i = 0; i < count; i++)
+		if (unlikely(RTE_PTR_DIFF(host_bufs[i],
+					  avp->pools[0].host_addr) >=
+			     avp->pools[0].length))
+			bufs[i] = NULL;
+}
+
+/*
+ * Same as avp_dev_rx_refill() except that the mbufs are taken directly from
+ * the mempool and initialized with vector stores.
+ */
+static inline unsigned int
+avp_dev_rx_refill_vec(struct avp_dev *avp, struct avp_queue *rxq,
+		      unsigned int count)
+{
+	const __m128i rearm = _mm_set_epi64x(0, rxq->mbuf_initializer);
+	const __m128i zero = _mm_setzero_si128();
+	struct rte_mbuf **mbufs;
+	unsigned int required;
+	unsigned int i;
+
+	if (likely(rxq->nb_mbufs >= count))
+		return count;
+
+	required = count - rxq->nb_mbufs;
+	mbufs = &rxq->mbufs[rxq->nb_mbufs];
+	if (unlikely(rte_mempool_get_bulk(avp->pool, (void **)mbufs,
+					  required) != 0))
+		return rxq->nb_mbufs;
+
+	/* equivalent to rte_pktmbuf_reset() for the receive fields */
+	for (i = 0; i < required; i++) {
+		_mm_storeu_si128((__m128i *)&mbufs[i]->rearm_data, rearm);
+		_mm_storeu_si128((__m128i *)&mbufs[i]->rx_descriptor_fields1,
+				 zero);
+	}
+
+	rxq->nb_mbufs = count;
+	return count;
+}
+
+/*
+ * Vector version of avp_recv_pkts().  The host addresses of the burst are
+ * rebased with vector adds, and the length and VLAN fields of each descriptor
+ * are loaded with a single load and shuffled directly into the layout of the
+ * mbuf receive descriptor fields.
+ */
+static inline __attribute__((always_inline)) uint16_t
+avp_recv_pkts_vec_common(void *rx_queue,
+			 struct rte_mbuf **rx_pkts,
+			 uint16_t nb_pkts,
+			 const unsigned int variant)
+{
+	struct avp_queue *rxq = (struct avp_queue *)rx_queue;
+	/* shuffle descriptor fields to packet_type, pkt_len, data_len, vlan */
+	const __m128i shuf_vlan = _mm_set_epi8(
+		0xFF, 0xFF, 0xFF, 0xFF, /* hash.rss */
+		15, 14,			/* vlan_tci */
+		5, 4,			/* data_len */
+		0xFF, 0xFF, 9, 8,	/* pkt_len */
+		0xFF, 0xFF, 0xFF, 0xFF	/* packet_type */
+		);
+	const __m128i shuf = _mm_set_epi8(
+		0xFF, 0xFF, 0xFF, 0xFF, /* hash.rss */
+		0xFF, 0xFF,		/* vlan_tci */
+		5, 4,			/* data_len */
+		0xFF, 0xFF, 9, 8,	/* pkt_len */
+		0xFF, 0xFF, 0xFF, 0xFF	/* packet_type */
+		);
+	struct rte_avp_desc *pkt_bufs[AVP_MAX_RX_BURST];
+	struct rte_avp_desc *avp_bufs[AVP_MAX_RX_BURST];
+	struct avp_dev *avp = rxq->avp;
+	struct rte_avp_desc *pkt_buf;
+	struct rte_avp_fifo *free_q;
+	struct rte_avp_fifo *rx_q;
+	unsigned int count, avail, n;
+	unsigned int pkt_len;
+	struct rte_mbuf *m;
+	__m128i fields;
+	void *pkt_data;
+	uint16_t vlan;
+	unsigned int i;
+	uint64_t drop;
+
+	/* the shuffles and vector stores depend on the following layouts */
+	RTE_BUILD_BUG_ON(offsetof(struct rte_avp_desc, data_len) !=
+			 AVP_DESC_RX_FIELDS_OFFSET + 4);
+	RTE_BUILD_BUG_ON(offsetof(struct rte_avp_desc, nb_segs) !=
+			 AVP_DESC_RX_FIELDS_OFFSET + 6);
+	RTE_BUILD_BUG_ON(offsetof(struct rte_avp_desc, pkt_len) !=
+			 AVP_DESC_RX_FIELDS_OFFSET + 8);
+	RTE_BUILD_BUG_ON(offsetof(struct rte_avp_desc, vlan_tci) !=
+			 AVP_DESC_RX_FIELDS_OFFSET + 14);
+	RTE_BUILD_BUG_ON(offsetof(struct rte_mbuf, ol_flags) !=
+			 offsetof(struct rte_mbuf, rearm_data) + 8);
+	RTE_BUILD_BUG_ON(offsetof(struct rte_mbuf, pkt_len) !=
+			 offsetof(struct rte_mbuf, rx_descriptor_fields1) + 4);
+	RTE_BUILD_BUG_ON(offsetof(struct rte_mbuf, data_len) !=
+			 offsetof(struct rte_mbuf, rx_descriptor_fields1) + 8);
+	RTE_BUILD_BUG_ON(offsetof(struct rte_mbuf, vlan_tci) !=
+			 offsetof(struct rte_mbuf, rx_descriptor_fields1) + 10);
+
+	if (unlikely(avp->flags & AVP_F_DETACHED)) {
+		/* VM live migration in progress */
+		return 0;
+	}
+
+	rx_q = avp->rx_q[rxq->queue_id];
+	free_q = avp->free_q[rxq->queue_id];
+
+	/* setup next queue to service */
+	if (variant & AVP_RX_MULTI_FIFO)
+		rxq->queue_id = (rxq->queue_id < rxq->queue_limit) ?
+			(rxq->queue_id + 1) : rxq->queue_base;
+
+	/* determine how many slots are available in the free queue */
+	count = avp_dev_fifo_free_count(avp, free_q, nb_pkts);
+
+	/* determine how many packets are available in the rx queue */
+	avail = avp_dev_fifo_count(avp, rx_q, nb_pkts);
+	avp_dev_fifo_watermarks(rxq, avail, count);
+
+	/* determine how many packets can be received */
+	count = RTE_MIN(count, avail);
+	count = RTE_MIN(count, nb_pkts);
+	count = RTE_MIN(count, (unsigned int)AVP_MAX_RX_BURST);
+
+	/* allocate the mbufs for the whole burst up front */
+	n = avp_dev_rx_refill_vec(avp, rxq, count);
+	if (unlikely(n < count)) {
+		/* leave the packets that do not fit for the next call */
+		avp_dev_rx_nombuf(rxq, count - n);
+		count = n;
+	}
+
+	if (unlikely(count == 0)) {
+		/* no free buffers, or no buffers on the rx queue */
+		return 0;
+	}
+
+	/* retrieve pending packets */
+	n = avp_dev_fifo_get(avp, rx_q, (void **)&avp_bufs, count);
+	PMD_RX_LOG(DEBUG, "Receiving %u packets from Rx queue at %p\n",
+		   count, rx_q);
+
+	/* Adjust host pointers for guest addressing */
+	avp_dev_translate_burst_vec(avp, (void **)avp_bufs,
+				    (void **)pkt_bufs, n);
+	for (i = 0; i < n; i++)
+		rte_prefetch0(pkt_bufs[i]);
+
+	/* discard packets not destined to our MAC before copying them */
+	if (variant & AVP_RX_PROMISC)
+		drop = 0;
+	else
+		drop = avp_dev_mac_filter_burst(avp, pkt_bufs, n);
+	rxq->xstats.filtered += __builtin_popcountll(drop);
+
+	count = 0;
+	for (i = 0; i < n; i++) {
+		if (drop & (1ULL << i)) {
+			/* silently discard packets not destined to our MAC */
+			continue;
+		}
+
+		pkt_buf = pkt_bufs[i];
+		pkt_data = avp_dev_buffer_data(avp, pkt_buf);
+		if (unlikely(pkt_data == NULL)) {
+			/* the host address is outside of all pools */
+			rxq->errors++;
+			rxq->xstats.bad_address++;
+			continue;
+		}
+
+		fields = _mm_loadu_si128((const __m128i *)
+			RTE_PTR_ADD(pkt_buf, AVP_DESC_RX_FIELDS_OFFSET));
+		pkt_len = _mm_extract_epi16(fields, 4);
+
+		if (unlikely((pkt_len > avp->guest_mbuf_size) ||
+			     ((_mm_extract_epi16(fields, 3) & 0xFF) > 1))) {
+			/*
+			 * application should be using the scattered receive
+			 * function
+			 */
+			rxq->errors++;
+			rxq->xstats.oversized++;
+			continue;
+		}
+
+		m = rxq->mbufs[--rxq->nb_mbufs];
+
+		/* copy data out of the host buffer to our buffer */
+		avp_copy(avp->rx_copy, rte_pktmbuf_mtod(m, void *),
+			 pkt_data, pkt_len);
+
+		/* initialize the local mbuf */
+		vlan = (variant & AVP_RX_VLAN) ?
+			(pkt_buf->ol_flags & RTE_AVP_RX_VLAN_PKT) : 0;
+		_mm_storeu_si128((__m128i *)&m->rearm_data,
+				 _mm_set_epi64x(vlan ? PKT_RX_VLAN_PKT : 0,
+						rxq->mbuf_initializer));
+		_mm_storeu_si128((__m128i *)&m->rx_descriptor_fields1,
+				 _mm_shuffle_epi8(fields,
+						  vlan ? shuf_vlan : shuf));
+		m->ol_flags |= avp_dev_rx_cksum_flags(avp, pkt_buf->ol_flags);
+		avp_dev_rx_hash(avp, pkt_buf->ol_flags, pkt_buf->rss_hash, m);
+
+		/* return new mbuf to caller */
+		rx_pkts[count++] = m;
+		rxq->bytes += pkt_len;
+	}
+
+	avp_copy_fence(avp->rx_copy);
+
+	rxq->packets += count;
+
+	/* return the buffers to the free queue */
+	avp_dev_fifo_put(avp, free_q, (void **)&avp_bufs[0], n);
+
+	avp_dev_burst_account(rxq, count);
+
+	return count;
+}
+
+AVP_BURST_VARIANTS(avp_recv_pkts_vec, avp_recv_pkts_vec_common,
+		   eth_rx_burst_t);
+#endif
+
+#ifdef AVP_ZERO_COPY
+/* return a zero-copy mbuf chain to its header pool */
+static inline void
+avp_zc_mbuf_free(struct rte_mbuf *m)
+{
+	struct rte_mbuf *m_next;
+
+	while (m != NULL) {
+		m_next = rte_pktmbuf_next(m);
+		rte_pktmbuf_next(m) = NULL;
+		rte_pktmbuf_nb_segs(m) = 1;
+		rte_mbuf_refcnt_set(m, 1);
+		rte_mbuf_raw_free(m);
+		m = m_next;
+	}
+}
+
+/* check whether the application has released all of its references */
+static inline int
+avp_zc_mbuf_released(struct rte_mbuf *m)
+{
+	while (m != NULL) {
+		if (rte_mbuf_refcnt_read(m) != 1)
+			return 0;
+		m = rte_pktmbuf_next(m);
+	}
+	return 1;
+}
+
+/*
+ * Build an mbuf chain that references a host buffer chain in place.  Returns
+ * NULL if not enough mbuf headers are available.
+ */
+static inline struct rte_mbuf *
+avp_dev_zc_from_buffers(struct avp_dev *avp,
+			struct rte_mempool *pool,
+			struct rte_avp_desc *first_buf)
+{
+	struct rte_avp_desc *pkt_buf = first_buf;
+	struct rte_mbuf *m_previous = NULL;
+	struct rte_mbuf *m_first = NULL;
+	unsigned int nb_segs = 0;
+	struct rte_mbuf *m;
+	void *buf;
+
+	do {
+		m = rte_mbuf_raw_alloc(pool);
+		if (unlikely(m == NULL)) {
+			avp_zc_mbuf_free(m_first);
+			return NULL;
+		}
+
+		m->buf_addr = avp_dev_translate_buffer(avp, pkt_buf->data);
+		m->buf_physaddr = avp_dev_translate_buffer_phys(avp,
+								pkt_buf->data);
+		m->buf_len = avp->host_mbuf_size;
+		rte_pktmbuf_reset(m);
+		rte_pktmbuf_data_offset(m, 0);
+		rte_pktmbuf_data_len(m) = pkt_buf->data_len;
+
+		if (m_previous != NULL)
+			rte_pktmbuf_next(m_previous) = m;
+		else
+			m_first = m;
+		m_previous = m;
+		nb_segs++;
+
+		buf = pkt_buf->next;
+		if (buf != NULL)
+			pkt_buf = avp_dev_translate_buffer(avp, buf);
+	} while ((buf != NULL) && (nb_segs < RTE_AVP_MAX_MBUF_SEGMENTS));
+
+	m = m_first;
+	rte_pktmbuf_nb_segs(m) = nb_segs;
+	rte_pktmbuf_pkt_len(m) = first_buf->pkt_len;
+	rte_pktmbuf_port(m) = avp->port_id;
+
+	if (first_buf->ol_flags & RTE_AVP_RX_VLAN_PKT) {
+		m->ol_flags = PKT_RX_VLAN_PKT;
+		rte_pktmbuf_vlan_tci(m) = first_buf->vlan_tci;
+	}
+
+	return m;
+}
+
+/*
+ * Return the host buffers of all zero-copy mbufs that the application has
+ * finished with to their free queues.  An mbuf is only recycled once the
+ * host has accepted its buffer; those that do not fit on a full free queue
+ * stay on the ring for the next call.
+ */
+static inline void
+avp_dev_zc_rx_reclaim(struct avp_dev *avp, struct avp_zc_ring *ring)
+{
+	void *avp_bufs[AVP_MAX_RX_BURST];
+	uint32_t epoch = avp->epoch;
+	struct avp_zc_priv *priv;
+	unsigned int fifo = 0;
+	unsigned int count;
+	unsigned int tail;
+	struct rte_mbuf *m;
+	unsigned int n;
+
+	do {
+		/* gather the buffers owed to a single free queue */
+		n = 0;
+		for (tail = ring->tail; tail != ring->head; tail++) {
+			m = ring->mbufs[tail & AVP_ZC_RING_MASK];
+			if (!avp_zc_mbuf_released(m)) {
+				/* still in use; preserve ordering */
+				break;
+			}
+
+			priv = AVP_ZC_PRIV(m);
+			if (unlikely(priv->epoch != epoch)) {
+				/* the buffer belongs to a previous host */
+				continue;
+			}
+			if ((n == AVP_MAX_RX_BURST) ||
+			    ((n > 0) && (priv->fifo != fifo)))
+				break;
+			fifo = priv->fifo;
+			avp_bufs[n++] = priv->host_buf;
+		}
+
+		count = 0;
+		if (n > 0)
+			count = avp_dev_fifo_put(avp, avp->free_q[fifo],
+						 avp_bufs, n);
+
+		/* recycle the mbufs whose buffers were accepted by the host */
+		while (ring->tail != tail) {
+			m = ring->mbufs[ring->tail & AVP_ZC_RING_MASK];
+			if (likely(AVP_ZC_PRIV(m)->epoch == epoch)) {
+				if (count == 0)
+					break;
+				count--;
+			}
+			avp_zc_mbuf_free(m);
+			ring->tail++;
+		}
+	} while ((n > 0) && (ring->tail == tail));
+}
+
+static uint16_t
+avp_recv_pkts_zc(void *rx_queue,
+		 struct rte_mbuf **rx_pkts,
+		 uint16_t nb_pkts)
+{
+	struct avp_queue *rxq = (struct avp_queue *)rx_queue;
+	struct rte_avp_desc *pkt_bufs[AVP_MAX_RX_BURST];
+	struct rte_avp_desc *avp_bufs[AVP_MAX_RX_BURST];
+	struct rte_avp_desc *drop_bufs[AVP_MAX_RX_BURST];
+	struct avp_zc_ring *ring = rxq->zc;
+	struct avp_dev *avp = rxq->avp;
+	struct rte_avp_desc *pkt_buf;
+	struct rte_avp_fifo *free_q;
+	struct rte_avp_fifo *rx_q;
+	unsigned int count, avail, n;
+	struct avp_zc_priv *priv;
+	unsigned int queue_id;
+	unsigned int nb_drop;
+	struct rte_mbuf *m_seg;
+	struct rte_mbuf *m;
+	unsigned int i;
+	uint64_t drop;
+
+	if (unlikely(avp->flags & AVP_F_DETACHED)) {
+		/* VM live migration in progress */
+		return 0;
+	}
+
+	/* hand back whatever the application has released since last time */
+	avp_dev_zc_rx_reclaim(avp, ring);
+
+	queue_id = rxq->queue_id;
+	rx_q = avp->rx_q[queue_id];
+	free_q = avp->free_q[queue_id];
+
+	/* setup next queue to service */
+	rxq->queue_id = (rxq->queue_id < rxq->queue_limit) ?
+		(rxq->queue_id + 1) : rxq->queue_base;
+
+	/* determine how many slots are available in the free queue */
+	count = avp_dev_fifo_free_count(avp, free_q, nb_pkts);
+
+	/* determine how many packets are available in the rx queue */
+	avail = avp_dev_fifo_count(avp, rx_q, nb_pkts);
+	avp_dev_fifo_watermarks(rxq, avail, count);
+
+	/* determine how many packets can be received */
+	count = RTE_MIN(count, avail);
+	count = RTE_MIN(count, nb_pkts);
+	count = RTE_MIN(count, (unsigned int)AVP_MAX_RX_BURST);
+
+	/* each received packet holds a ring slot until it is released */
+	count = RTE_MIN(count, AVP_ZC_RING_SIZE - (ring->head - ring->tail));
+
+	if (unlikely(count == 0)) {
+		/* no free buffers, or no buffers on the rx queue */
+		return 0;
+	}
+
+	/* retrieve pending packets */
+	n = avp_dev_fifo_get(avp, rx_q, (void **)&avp_bufs, count);
+	PMD_RX_LOG(DEBUG, "Receiving %u zero-copy packets from Rx queue at %p\n",
+		   count, rx_q);
+
+	for (i = 0; i < n; i++) {
+		pkt_bufs[i] = avp_dev_translate_buffer(avp, avp_bufs[i]);
+		rte_prefetch0(pkt_bufs[i]);
+	}
+
+	/* discard packets not destined to our MAC before wrapping them */
+	drop = avp_dev_mac_filter_burst(avp, pkt_bufs, n);
+	rxq->xstats.filtered += __builtin_popcountll(drop);
+
+	count = 0;
+	nb_drop = 0;
+	for (i = 0; i < n; i++) {
+		if (drop & (1ULL << i)) {
+			/* silently discard packets not destined to our MAC */
+			drop_bufs[nb_drop++] = avp_bufs[i];
+			continue;
+		}
+
+		avp_dev_buffer_sanity_check(avp, avp_bufs[i]);
+		pkt_buf = pkt_bufs[i];
+		if (unlikely(avp_dev_buffer_chain_check(avp, pkt_buf) != 0)) {
+			/* the host address is outside of all pools */
+			rxq->errors++;
+			rxq->xstats.bad_address++;
+			drop_bufs[nb_drop++] = avp_bufs[i];
+			continue;
+		}
+
+		/* wrap the host buffer chain without copying it */
+		m = avp_dev_zc_from_buffers(avp, ring->pool, pkt_buf);
+		if (unlikely(m == NULL)) {
+			rxq->dev_data->rx_mbuf_alloc_failed++;
+			rxq->xstats.nombuf++;
+			drop_bufs[nb_drop++] = avp_bufs[i];
+			continue;
+		}
+
+		m->ol_flags |= avp_dev_rx_cksum_flags(avp, pkt_buf->ol_flags);
+		avp_dev_rx_hash(avp, pkt_buf->ol_flags, pkt_buf->rss_hash, m);
+
+		/* remember which host buffer must be returned on release */
+		priv = AVP_ZC_PRIV(m);
+		priv->host_buf = avp_bufs[i];
+		priv->epoch = avp->epoch;
+		priv->fifo = queue_id;
+
+		/* keep our own reference so that the mbuf comes back to us */
+		for (m_seg = m; m_seg != NULL; m_seg = rte_pktmbuf_next(m_seg))
+			rte_mbuf_refcnt_set(m_seg, 2);
+		ring->mbufs[ring->head++ & AVP_ZC_RING_MASK] = m;
+
+		/* return new mbuf to caller */
+		rx_pkts[count++] = m;
+		rxq->bytes += pkt_buf->pkt_len;
+	}
+
+	rxq->packets += count;
+
+	/* return the dropped buffers to the free queue */
+	if (nb_drop > 0)
+		avp_dev_fifo_put(avp, free_q, (void **)&drop_bufs[0], nb_drop);
+
+	avp_dev_burst_account(rxq, count);
+
+	return count;
+}
+#endif
+
+/*
+ * Copy a chained mbuf to a set of host buffers.  This function assumes that
+ * there are sufficient destination buffers to contain the entire source
+ * packet.  Returns the number of bytes copied, or 0 without modifying any of
+ * the buffers if one of their addresses is outside of all pools.
+ */
+static inline uint16_t
+avp_dev_copy_to_buffers(struct avp_dev *avp,
+			struct rte_mbuf *mbuf,
+			struct rte_avp_desc **buffers,
+			unsigned int count)
+{
+	struct rte_avp_desc *pkt_bufs[RTE_AVP_MAX_TSO_SEGMENTS];
+	void *pkt_datas[RTE_AVP_MAX_TSO_SEGMENTS];
+	struct rte_avp_desc *previous_buf = NULL;
+	struct rte_avp_desc *first_buf = NULL;
+	struct rte_avp_desc *pkt_buf;
+	size_t total_length;
+	struct rte_mbuf *m;
+	size_t copy_length;
+	size_t src_offset;
+	char *pkt_data;
+	unsigned int i;
+
+	avp_mbuf_sanity_check(mbuf, 1);
+
+	/* Adjust pointers for guest addressing before touching any buffer */
+	total_length = rte_pktmbuf_pkt_len(mbuf);
+	for (i = 0; i < count; i++) {
+		pkt_bufs[i] = avp_dev_translate_buffer(avp, buffers[i]);
+		if (unlikely(pkt_bufs[i] == NULL))
+			return 0;
+		rte_prefetch0(pkt_bufs[i]);
+	}
+	for (i = 0; i < count; i++) {
+		if (total_length <= avp->inline_len) {
+			/* small packets fit in a single descriptor extension */
+			pkt_datas[i] = RTE_PTR_ADD(pkt_bufs[i],
+						   sizeof(*pkt_bufs[i]));
+		} else {
+			pkt_datas[i] = avp_dev_translate_buffer(
+				avp, pkt_bufs[i]->data);
+			if (unlikely(pkt_datas[i] == NULL))
+				return 0;
+		}
+	}
+
+	m = mbuf;
+	src_offset = 0;
+	for (i = 0; (i < count) && (m != NULL); i++) {
+		/* fill each destination buffer */
+		pkt_buf = pkt_bufs[i];
+		pkt_data = pkt_datas[i];
+		if (total_length <= avp->inline_len)
+			pkt_buf->ol_flags |= RTE_AVP_INLINE_PKT;
+
+		/* setup the buffer chain */
+		if (previous_buf != NULL)
+			previous_buf->next = buffers[i];
+		else
+			first_buf = pkt_buf;
+
+		previous_buf = pkt_buf;
+
+		do {
+			/*
+			 * copy as many source mbuf segments as will fit in the
+			 * destination buffer.
+			 */
+			copy_length = RTE_MIN((avp->host_mbuf_size -
+					       pkt_buf->data_len),
+					      (rte_pktmbuf_data_len(m) -
+					       src_offset));
+			avp_copy(avp->tx_copy,
+				 RTE_PTR_ADD(pkt_data, pkt_buf->data_len),
+				 RTE_PTR_ADD(rte_pktmbuf_mtod(m, void *),
+					     src_offset),
+				 copy_length);
+			pkt_buf->data_len += copy_length;
+			src_offset += copy_length;
+
+			if (likely(src_offset == rte_pktmbuf_data_len(m))) {
+				/* need a new source buffer */
+				m = rte_pktmbuf_next(m);
+				src_offset = 0;
+			}
+
+			if (unlikely(pkt_buf->data_len ==
+				     avp->host_mbuf_size)) {
+				/* need a new destination buffer */
+				break;
+			}
+
+		} while (m != NULL);
+	}
+
+	first_buf->nb_segs = count;
+	first_buf->pkt_len = total_length;
+
+	if (mbuf->ol_flags & PKT_TX_VLAN_PKT) {
+		first_buf->ol_flags |= RTE_AVP_TX_VLAN_PKT;
+		first_buf->vlan_tci = rte_pktmbuf_vlan_tci(mbuf);
+	}
+
+	avp_dev_tx_offload(avp, mbuf, first_buf);
+
+	avp_dev_buffer_sanity_check(avp, buffers[0]);
+
+	return total_length;
+}
+
+
+/*
+ * Free a burst of transmitted packets.  Segments are returned to their
+ * mempool in bulk; consecutive segments from the same mempool are grouped
+ * into a single put operation.
+ */
+static inline void
+avp_dev_free_pkts(struct rte_mbuf **pkts, unsigned int count)
+{
+	struct rte_mbuf *free_mbufs[AVP_MAX_TX_BURST];
+	struct rte_mempool *pool = NULL;
+	unsigned int nb_free = 0;
+	struct rte_mbuf *m_next;
+	struct rte_mbuf *m;
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		m = pkts[i];
+		while (m != NULL) {
+			m_next = rte_pktmbuf_next(m);
+			m = avp_pktmbuf_prefree_seg(m);
+			if (likely(m != NULL)) {
+				if (unlikely((m->pool != pool) ||
+					     (nb_free == AVP_MAX_TX_BURST))) {
+					if (nb_free > 0)
+						rte_mempool_put_bulk(
+							pool,
+							(void **)free_mbufs,
+							nb_free);
+					pool = m->pool;
+					nb_free = 0;
+				}
+				rte_pktmbuf_next(m) = NULL;
+				rte_pktmbuf_nb_segs(m) = 1;
+				free_mbufs[nb_free++] = m;
+			}
+			m = m_next;
+		}
+	}
+
+	if (nb_free > 0)
+		rte_mempool_put_bulk(pool, (void **)free_mbufs, nb_free);
+}
+
+static uint16_t
+avp_xmit_scattered_pkts(void *tx_queue,
+			struct rte_mbuf **tx_pkts,
+			uint16_t nb_pkts)
+{
+	struct rte_avp_desc *avp_bufs[(AVP_MAX_TX_BURST *
+				       RTE_AVP_MAX_MBUF_SEGMENTS)];
+	struct avp_queue *txq = (struct avp_queue *)tx_queue;
+	struct rte_avp_desc *tx_bufs[AVP_MAX_TX_BURST];
+	struct avp_dev *avp = txq->avp;
+	struct rte_avp_fifo *alloc_q;
+	struct rte_avp_fifo *tx_q;
+	unsigned int count, avail, n;
+	unsigned int orig_nb_pkts;
+	struct rte_mbuf *m;
+	unsigned int required;
+	unsigned int segments;
+	unsigned int tx_bytes;
+	unsigned int nb_bad;
+	unsigned int copied;
+	unsigned int i;
+	uint64_t tsc __rte_unused;
+
+	orig_nb_pkts = nb_pkts;
+	if (unlikely(avp->flags & AVP_F_DETACHED)) {
+		/* VM live migration in progress */
+		/* packets are held by avp_xmit_pkts_hold() if configured */
+		txq->errors += nb_pkts;
+		txq->xstats.detached += nb_pkts;
+		return 0;
+	}
+
+	tx_q = avp->tx_q[txq->queue_id];
+	alloc_q = avp->alloc_q[txq->queue_id];
+
+	/* limit the number of transmitted packets to the max burst size */
+	if (unlikely(nb_pkts > AVP_MAX_TX_BURST))
+		nb_pkts = AVP_MAX_TX_BURST;
+
+	AVP_STAGE_START(txq, tsc);
+
+	/* determine how many buffers are available to copy into */
+	avail = avp_dev_fifo_count(avp, alloc_q, nb_pkts);
+
+	/* determine how many slots are available in the transmit queue */
+	count = avp_dev_fifo_free_count(avp, tx_q, nb_pkts);
+	avp_dev_fifo_watermarks(txq, avail, count);
+
+	if (unlikely(avail > (AVP_MAX_TX_BURST *
+			      RTE_AVP_MAX_MBUF_SEGMENTS)))
+		avail = AVP_MAX_TX_BURST * RTE_AVP_MAX_MBUF_SEGMENTS;
+
+	/* determine how many packets can be sent */
+	if (unlikely(count < nb_pkts)) {
+		txq->xstats.fifo_full += nb_pkts - count;
+		nb_pkts = count;
+	}
+
+	/* determine how many packets will fit in the available buffers */
+	count = 0;
+	segments = 0;
+	for (i = 0; i < nb_pkts; i++) {
+		m = tx_pkts[i];
+		if (likely(i < (unsigned int)nb_pkts - 1)) {
+			/* prefetch next entry while processing this one */
+			rte_prefetch0(tx_pkts[i + 1]);
+		}
+		required = (rte_pktmbuf_pkt_len(m) + avp->host_mbuf_size - 1) /
+			avp->host_mbuf_size;
+
+		if (unlikely((required == 0) ||
+			     (required > avp_dev_tx_max_segments(avp, m)) ||
+			     (rte_pktmbuf_pkt_len(m) > UINT16_MAX))) {
+			/* refuse this packet and those queued behind it */
+			txq->xstats.oversized += nb_pkts - i;
+			break;
+		} else if (unlikely(required + segments > avail)) {
+			txq->xstats.nobuf += nb_pkts - i;
+			break;
+		}
+		segments += required;
+		count++;
+	}
+	nb_pkts = count;
+
+	if (unlikely(nb_pkts == 0)) {
+		/* no available buffers, or no space on the tx queue */
+		txq->errors += orig_nb_pkts;
+		return 0;
+	}
+
+	PMD_TX_LOG(DEBUG, "Sending %u packets on Tx queue at %p\n",
+		   nb_pkts, tx_q);
+
+	/* retrieve sufficient send buffers */
+	n = avp_dev_fifo_get(avp, alloc_q, (void **)&avp_bufs, segments);
+	if (unlikely(n != segments)) {
+		PMD_TX_LOG(DEBUG, "Failed to allocate buffers "
+			   "n=%u, segments=%u, orig=%u\n",
+			   n, segments, orig_nb_pkts);
+		txq->errors += orig_nb_pkts;
+		txq->xstats.nobuf += nb_pkts;
+		return 0;
+	}
+	AVP_STAGE_MARK(txq, tsc, RTE_PMD_AVP_STAGE_FIFO_GET);
+
+	tx_bytes = 0;
+	nb_bad = 0;
+	count = 0;
+	for (i = 0; i < nb_pkts; i++) {
+		/* process each packet to be transmitted */
+		m = tx_pkts[i];
+
+		/* determine how many buffers are required for this packet */
+		required = (rte_pktmbuf_pkt_len(m) + avp->host_mbuf_size - 1) /
+			avp->host_mbuf_size;
+
+		copied = avp_dev_copy_to_buffers(avp, m, &avp_bufs[count],
+						 required);
+		if (unlikely(copied == 0)) {
+			/* drop the packet, its first buffer goes back as is */
+			txq->errors++;
+			txq->xstats.bad_address++;
+			nb_bad++;
+		}
+		tx_bytes += copied;
+		tx_bufs[i] = avp_bufs[count];
+		count += required;
+	}
+	AVP_STAGE_MARK(txq, tsc, RTE_PMD_AVP_STAGE_COPY);
+
+	/* free the original mbufs */
+	avp_dev_free_pkts(tx_pkts, nb_pkts);
+	AVP_STAGE_MARK(txq, tsc, RTE_PMD_AVP_STAGE_ALLOC);
+
+	txq->packets += nb_pkts - nb_bad;
+	txq->bytes += tx_bytes;
+
+#ifdef RTE_LIBRTE_AVP_DEBUG_BUFFERS
+	for (i = 0; i < nb_pkts; i++)
+		avp_dev_buffer_sanity_check(avp, tx_bufs[i]);
+#endif
+
+	/* send the packets */
+	avp_copy_fence(avp->tx_copy);
+	n = avp_dev_fifo_put(avp, tx_q, (void **)&tx_bufs[0], nb_pkts);
+	avp_dev_burst_account(txq, n);
+	AVP_STAGE_END(txq, tsc);
+	if (unlikely(n != orig_nb_pkts))
+		txq->errors += (orig_nb_pkts - n);
+
+	return n;
+}
+
+
+static inline __attribute__((always_inline)) uint16_t
+avp_xmit_pkts_common(void *tx_queue,
+		     struct rte_mbuf **tx_pkts,
+		     uint16_t nb_pkts,
+		     const unsigned int variant)
+{
+	struct avp_queue *txq = (struct avp_queue *)tx_queue;
+	struct rte_avp_desc *avp_bufs[AVP_MAX_TX_BURST];
+	struct avp_dev *avp = txq->avp;
+	struct rte_avp_desc *pkt_buf;
+	struct rte_avp_fifo *alloc_q;
+	struct rte_avp_fifo *tx_q;
+	unsigned int count, avail, n;
+	unsigned int nb_chained = 0;
+	struct rte_mbuf *m;
+	unsigned int pkt_len;
+	unsigned int tx_bytes;
+	unsigned int nb_bad;
+	char *pkt_data;
+	unsigned int i;
+	uint64_t tsc __rte_unused;
+
+	if (unlikely(avp->flags & AVP_F_DETACHED)) {
+		/* VM live migration in progress */
+		/* packets are held by avp_xmit_pkts_hold() if configured */
+		txq->errors++;
+		txq->xstats.detached += nb_pkts;
+		return 0;
+	}
+
+	tx_q = avp->tx_q[txq->queue_id];
+	alloc_q = avp->alloc_q[txq->queue_id];
+
+	/* limit the number of transmitted packets to the max burst size */
+	if (unlikely(nb_pkts > AVP_MAX_TX_BURST))
+		nb_pkts = AVP_MAX_TX_BURST;
+
+	if ((variant & AVP_TX_OFFLOAD) &&
+	    (avp->features & RTE_AVP_FEATURE_TSO)) {
+		/*
+		 * segmentation requests need chained host buffers so send
+		 * them, and the packets that follow, with the scattered
+		 * transmit function.
+		 */
+		for (i = 0; i < nb_pkts; i++)
+			if (tx_pkts[i]->ol_flags & PKT_TX_TCP_SEG)
+				break;
+		if (i == 0)
+			return avp_xmit_scattered_pkts(tx_queue, tx_pkts,
+						       nb_pkts);
+		nb_chained = nb_pkts - i;
+		nb_pkts = i;
+	}
+
+	AVP_STAGE_START(txq, tsc);
+
+	/* determine how many buffers are available to copy into */
+	avail = avp_dev_fifo_count(avp, alloc_q, nb_pkts);
+
+	/* determine how many slots are available in the transmit queue */
+	count = avp_dev_fifo_free_count(avp, tx_q, nb_pkts);
+	avp_dev_fifo_watermarks(txq, avail, count);
+
+	/* determine how many packets can be sent */
+	if (unlikely(count < nb_pkts))
+		txq->xstats.fifo_full += nb_pkts - count;
+	count = RTE_MIN(count, nb_pkts);
+	if (unlikely(avail < count)) {
+		txq->xstats.nobuf += count - avail;
+		count = avail;
+	}
+
+	if (unlikely(count == 0)) {
+		/* no available buffers, or no space on the tx queue */
+		txq->errors += nb_pkts;
+		return 0;
+	}
+
+	PMD_TX_LOG(DEBUG, "Sending %u packets on Tx queue at %p\n",
+		   count, tx_q);
+
+	/* retrieve sufficient send buffers */
+	n = avp_dev_fifo_get(avp, alloc_q, (void **)&avp_bufs, count);
+	if (unlikely(n != count)) {
+		txq->errors++;
+		txq->xstats.nobuf += count;
+		return 0;
+	}
+	AVP_STAGE_MARK(txq, tsc, RTE_PMD_AVP_STAGE_FIFO_GET);
+
+	tx_bytes = 0;
+	nb_bad = 0;
+	for (i = 0; i < count; i++) {
+		/* prefetch next entry while processing the current one */
+		if (i < count - 1) {
+			pkt_buf = avp_dev_translate_buffer(avp,
+							   avp_bufs[i + 1]);
+			rte_prefetch0(pkt_buf);
+		}
+
+		/* process each packet to be transmitted */
+		m = tx_pkts[i];
+
+		/* Adjust pointers for guest addressing */
+		pkt_buf = avp_dev_translate_buffer(avp, avp_bufs[i]);
+		pkt_len = rte_pktmbuf_pkt_len(m);
+
+		if (unlikely((pkt_len > avp->guest_mbuf_size) ||
+					 (pkt_len > avp->host_mbuf_size))) {
+			/*
+			 * application should be using the scattered transmit
+			 * function; send it truncated to avoid the performance
+			 * hit of having to manage returning the already
+			 * allocated buffer to the free list.  This should not
+			 * happen since the application should have set the
+			 * max_rx_pkt_len based on its MTU and it should be
+			 * policing its own packet sizes.
+			 */
+			txq->errors++;
+			txq->xstats.oversized++;
+			pkt_len = RTE_MIN(avp->guest_mbuf_size,
+					  avp->host_mbuf_size);
+		}
+
+		if (unlikely(pkt_buf == NULL)) {
+			pkt_data = NULL;
+		} else if ((variant & AVP_TX_INLINE) &&
+			   (pkt_len <= avp->inline_len)) {
+			/* carry small packets in the descriptor extension */
+			pkt_buf->ol_flags |= RTE_AVP_INLINE_PKT;
+			pkt_data = RTE_PTR_ADD(pkt_buf, sizeof(*pkt_buf));
+		} else {
+			pkt_data = avp_dev_translate_buffer(avp,
+							    pkt_buf->data);
+		}
+
+		if (unlikely(pkt_data == NULL)) {
+			/* drop the packet, the buffer goes back as is */
+			txq->errors++;
+			txq->xstats.bad_address++;
+			nb_bad++;
+			continue;
+		}
 
-#ifdef RTE_LIBRTE_AVP_DEBUG_BUFFERS
-static inline void
-__avp_dev_buffer_sanity_check(struct avp_dev *avp, struct rte_avp_desc *buf)
-{
-	struct rte_avp_desc *first_buf;
-	struct rte_avp_desc *pkt_buf;
-	unsigned int pkt_len;
-	unsigned int nb_segs;
-	void *pkt_data;
-	unsigned int i;
+		/* copy data out of our mbuf and into the AVP buffer */
+		avp_copy(avp->tx_copy, pkt_data, rte_pktmbuf_mtod(m, void *),
+			 pkt_len);
+		pkt_buf->pkt_len = pkt_len;
+		pkt_buf->data_len = pkt_len;
+		pkt_buf->nb_segs = 1;
+		pkt_buf->next = NULL;
 
-	first_buf = avp_dev_translate_buffer(avp, buf);
+		if ((variant & AVP_TX_VLAN) &&
+		    (m->ol_flags & PKT_TX_VLAN_PKT)) {
+			pkt_buf->ol_flags |= RTE_AVP_TX_VLAN_PKT;
+			pkt_buf->vlan_tci = rte_pktmbuf_vlan_tci(m);
+		}
 
-	i = 0;
-	pkt_len = 0;
-	nb_segs = first_buf->nb_segs;
-	do {
-		/* Adjust pointers for guest addressing */
-		pkt_buf = avp_dev_translate_buffer(avp, buf);
-		if (pkt_buf == NULL)
-			rte_panic("bad buffer: segment %u has an invalid address %p\n",
-				  i, buf);
-		pkt_data = avp_dev_translate_buffer(avp, pkt_buf->data);
-		if (pkt_data == NULL)
-			rte_panic("bad buffer: segment %u has a NULL data pointer\n",
-				  i);
-		if (pkt_buf->data_len == 0)
-			rte_panic("bad buffer: segment %u has 0 data length\n",
-				  i);
-		pkt_len += pkt_buf->data_len;
-		nb_segs--;
-		i++;
+		if (variant & AVP_TX_OFFLOAD)
+			avp_dev_tx_offload(avp, m, pkt_buf);
 
-	} while (nb_segs && (buf = pkt_buf->next) != NULL);
+		tx_bytes += pkt_len;
+	}
+	AVP_STAGE_MARK(txq, tsc, RTE_PMD_AVP_STAGE_COPY);
 
-	if (nb_segs != 0)
-		rte_panic("bad buffer: expected %u segments found %u\n",
-			  first_buf->nb_segs, (first_buf->nb_segs - nb_segs));
-	if (pkt_len != first_buf->pkt_len)
-		rte_panic("bad buffer: expected length %u found %u\n",
-			  first_buf->pkt_len, pkt_len);
-}
+	/* free the original mbufs */
+	avp_dev_free_pkts(tx_pkts, count);
+	AVP_STAGE_MARK(txq, tsc, RTE_PMD_AVP_STAGE_ALLOC);
 
-#define avp_dev_buffer_sanity_check(a, b) \
-	__avp_dev_buffer_sanity_check((a), (b))
+	txq->packets += count - nb_bad;
+	txq->bytes += tx_bytes;
 
-#else /* RTE_LIBRTE_AVP_DEBUG_BUFFERS */
+	/* send the packets */
+	avp_copy_fence(avp->tx_copy);
+	n = avp_dev_fifo_put(avp, tx_q, (void **)&avp_bufs[0], count);
+	AVP_STAGE_END(txq, tsc);
+	avp_dev_burst_account(txq, n);
 
-#define avp_dev_buffer_sanity_check(a, b) do {} while (0)
+	if ((variant & AVP_TX_OFFLOAD) && (nb_chained != 0) && (n == nb_pkts))
+		n += avp_xmit_scattered_pkts(tx_queue, &tx_pkts[n], nb_chained);
 
-#endif
+	return n;
+}
+
+AVP_BURST_VARIANTS(avp_xmit_pkts, avp_xmit_pkts_common, eth_tx_burst_t);
 
 /*
- * Copy a host buffer chain to a set of mbufs.	This function assumes that
- * there exactly the required number of mbufs to copy all source bytes.
+ * Copy a chained mbuf to a set of host buffers described by compact
+ * descriptors.  This function assumes that there are sufficient destination
+ * buffers to contain the entire source packet.
  */
-static inline struct rte_mbuf *
-avp_dev_copy_from_buffers(struct avp_dev *avp,
-			  struct rte_avp_desc *buf,
-			  struct rte_mbuf **mbufs,
-			  unsigned int count)
+static inline unsigned int
+avp_dev_copy_to_cdesc(struct avp_dev *avp,
+		      struct rte_mbuf *mbuf,
+		      struct rte_avp_cdesc *descs,
+		      unsigned int count)
 {
-	struct rte_mbuf *m_previous = NULL;
-	struct rte_avp_desc *pkt_buf;
-	unsigned int total_length = 0;
+	struct rte_mbuf *m = mbuf;
 	unsigned int copy_length;
 	unsigned int src_offset;
-	struct rte_mbuf *m;
-	uint16_t ol_flags;
-	uint16_t vlan_tci;
-	void *pkt_data;
+	char *pkt_data;
+	uint16_t flags;
 	unsigned int i;
 
-	avp_dev_buffer_sanity_check(avp, buf);
+	avp_mbuf_sanity_check(mbuf, 1);
 
-	/* setup the first source buffer */
-	pkt_buf = avp_dev_translate_buffer(avp, buf);
-	pkt_data = avp_dev_translate_buffer(avp, pkt_buf->data);
-	total_length = pkt_buf->pkt_len;
 	src_offset = 0;
-
-	if (pkt_buf->ol_flags & RTE_AVP_RX_VLAN_PKT) {
-		ol_flags = PKT_RX_VLAN_PKT;
-		vlan_tci = pkt_buf->vlan_tci;
-	} else {
-		ol_flags = 0;
-		vlan_tci = 0;
-	}
-
-	for (i = 0; (i < count) && (buf != NULL); i++) {
+	for (i = 0; (i < count) && (m != NULL); i++) {
 		/* fill each destination buffer */
-		m = mbufs[i];
-
-		if (m_previous != NULL)
-			rte_pktmbuf_next(m_previous) = m;
-
-		m_previous = m;
+		pkt_data = avp_dev_cdesc_data(avp, &descs[i]);
+		descs[i].data_len = 0;
+		descs[i].flags = (i < count - 1) ? RTE_AVP_CDESC_MORE : 0;
 
 		do {
 			/*
-			 * Copy as many source buffers as will fit in the
+			 * copy as many source mbuf segments as will fit in the
 			 * destination buffer.
 			 */
-			copy_length = RTE_MIN((avp->guest_mbuf_size -
-					       rte_pktmbuf_data_len(m)),
-					      (pkt_buf->data_len -
+			copy_length = RTE_MIN((avp->host_mbuf_size -
+					       descs[i].data_len),
+					      (rte_pktmbuf_data_len(m) -
 					       src_offset));
-			rte_memcpy(RTE_PTR_ADD(rte_pktmbuf_mtod(m, void *),
-					       rte_pktmbuf_data_len(m)),
-				   RTE_PTR_ADD(pkt_data, src_offset),
-				   copy_length);
-			rte_pktmbuf_data_len(m) += copy_length;
+			avp_copy(avp->tx_copy,
+				 RTE_PTR_ADD(pkt_data, descs[i].data_len),
+				 RTE_PTR_ADD(rte_pktmbuf_mtod(m, void *),
+					     src_offset),
+				 copy_length);
+			descs[i].data_len += copy_length;
 			src_offset += copy_length;
 
-			if (likely(src_offset == pkt_buf->data_len)) {
+			if (likely(src_offset == rte_pktmbuf_data_len(m))) {
 				/* need a new source buffer */
-				buf = pkt_buf->next;
-				if (buf != NULL) {
-					pkt_buf = avp_dev_translate_buffer(
-						avp, buf);
-					pkt_data = avp_dev_translate_buffer(
-						avp, pkt_buf->data);
-					src_offset = 0;
-				}
-			}
-
-			if (unlikely(rte_pktmbuf_data_len(m) ==
-				     avp->guest_mbuf_size)) {
-				/* need a new destination mbuf */
-				break;
+				m = rte_pktmbuf_next(m);
+				src_offset = 0;
 			}
 
-		} while (buf != NULL);
+		} while ((m != NULL) &&
+			 (descs[i].data_len < avp->host_mbuf_size));
 	}
 
-	m = mbufs[0];
-	m->ol_flags = ol_flags;
-	rte_pktmbuf_nb_segs(m) = count;
-	rte_pktmbuf_pkt_len(m) = total_length;
-	rte_pktmbuf_vlan_tci(m) = vlan_tci;
+	if (mbuf->ol_flags & PKT_TX_VLAN_PKT) {
+		descs[0].flags |= RTE_AVP_TX_VLAN_PKT;
+		descs[0].vlan_tci = rte_pktmbuf_vlan_tci(mbuf);
+	}
 
-	avp_mbuf_sanity_check(m, 1);
+	flags = avp_dev_tx_offload_flags(avp, mbuf);
+	if (flags != 0) {
+		descs[0].flags |= flags;
+		descs[0].tso_segsz = mbuf->tso_segsz;
+		descs[0].l2_len = mbuf->l2_len;
+		descs[0].l3_len = mbuf->l3_len;
+	}
 
-	return m;
+	return rte_pktmbuf_pkt_len(mbuf);
 }
 
+/*
+ * Transmit packets to a host that exchanges compact descriptors.  A single
+ * function handles both flat and chained packets.
+ */
 static uint16_t
-avp_recv_scattered_pkts(void *rx_queue,
-			struct rte_mbuf **rx_pkts,
-			uint16_t nb_pkts)
+avp_xmit_pkts_cdesc(void *tx_queue, struct rte_mbuf **tx_pkts, uint16_t nb_pkts)
 {
-	struct avp_queue *rxq = (struct avp_queue *)rx_queue;
-	struct rte_avp_desc *avp_bufs[AVP_MAX_RX_BURST];
-	struct rte_mbuf *mbufs[RTE_AVP_MAX_MBUF_SEGMENTS];
-	struct avp_dev *avp = rxq->avp;
-	struct rte_avp_desc *pkt_buf;
-	struct rte_avp_fifo *free_q;
-	struct rte_avp_fifo *rx_q;
-	struct rte_avp_desc *buf;
+	struct avp_queue *txq = (struct avp_queue *)tx_queue;
+	struct rte_avp_cdesc descs[AVP_MAX_TX_BURST * RTE_AVP_MAX_MBUF_SEGMENTS];
+	uint8_t segments[AVP_MAX_TX_BURST];
+	struct avp_dev *avp = txq->avp;
+	struct rte_avp_fifo *alloc_q;
+	struct rte_avp_fifo *tx_q;
 	unsigned int count, avail, n;
-	unsigned int guest_mbuf_size;
+	unsigned int orig_nb_pkts;
+	unsigned int required;
+	unsigned int tx_bytes;
+	unsigned int total;
+	unsigned int tx_free;
 	struct rte_mbuf *m;
+	unsigned int i;
+	uint64_t tsc __rte_unused;
+
+	orig_nb_pkts = nb_pkts;
+	if (unlikely(avp->flags & AVP_F_DETACHED)) {
+		/* VM live migration in progress */
+		/* packets are held by avp_xmit_pkts_hold() if configured */
+		txq->errors += nb_pkts;
+		txq->xstats.detached += nb_pkts;
+		return 0;
+	}
+
+	tx_q = avp->tx_q[txq->queue_id];
+	alloc_q = avp->alloc_q[txq->queue_id];
+
+	/* limit the number of transmitted packets to the max burst size */
+	if (unlikely(nb_pkts > AVP_MAX_TX_BURST))
+		nb_pkts = AVP_MAX_TX_BURST;
+
+	AVP_STAGE_START(txq, tsc);
+
+	/* determine how many buffers are available to copy into */
+	avail = avp_dev_fifo_count(avp, alloc_q, nb_pkts);
+
+	/* determine how many slots are available in the transmit queue */
+	tx_free = avp_dev_fifo_free_count(avp, tx_q, nb_pkts);
+	avp_dev_fifo_watermarks(txq, avail, tx_free);
+
+	/* determine how many descriptors can be sent */
+	avail = RTE_MIN(avail, tx_free);
+	avail = RTE_MIN(avail, RTE_DIM(descs));
+
+	/* determine how many packets will fit in the available buffers */
+	count = 0;
+	total = 0;
+	for (i = 0; i < nb_pkts; i++) {
+		m = tx_pkts[i];
+		required = (rte_pktmbuf_pkt_len(m) + avp->host_mbuf_size - 1) /
+			avp->host_mbuf_size;
+
+		if (unlikely((required == 0) ||
+			     (required > avp_dev_tx_max_segments(avp, m)) ||
+			     (rte_pktmbuf_pkt_len(m) > UINT16_MAX))) {
+			/* refuse this packet and those queued behind it */
+			txq->xstats.oversized += nb_pkts - i;
+			break;
+		} else if (unlikely(required + total > avail)) {
+			if (avail == tx_free)
+				txq->xstats.fifo_full += nb_pkts - i;
+			else if (avail != RTE_DIM(descs))
+				txq->xstats.nobuf += nb_pkts - i;
+			break;
+		}
+		segments[i] = required;
+		total += required;
+		count++;
+	}
+	nb_pkts = count;
+
+	if (unlikely(nb_pkts == 0)) {
+		/* no available buffers, or no space on the tx queue */
+		txq->errors += orig_nb_pkts;
+		return 0;
+	}
+
+	PMD_TX_LOG(DEBUG, "Sending %u packets on Tx queue at %p\n",
+		   nb_pkts, tx_q);
+
+	/*
+	 * retrieve sufficient send buffers; none are removed from the ring
+	 * unless all of them are available.
+	 */
+	n = avp_ring_peek(AVP_RING(alloc_q), descs, total);
+	if (unlikely(n != total)) {
+		txq->errors += orig_nb_pkts;
+		txq->xstats.nobuf += nb_pkts;
+		return 0;
+	}
+	avp_ring_consume(AVP_RING(alloc_q), total);
+	AVP_STAGE_MARK(txq, tsc, RTE_PMD_AVP_STAGE_FIFO_GET);
+
+	tx_bytes = 0;
+	count = 0;
+	for (i = 0; i < nb_pkts; i++) {
+		/* process each packet to be transmitted */
+		tx_bytes += avp_dev_copy_to_cdesc(avp, tx_pkts[i],
+						  &descs[count], segments[i]);
+		count += segments[i];
+	}
+	AVP_STAGE_MARK(txq, tsc, RTE_PMD_AVP_STAGE_COPY);
+
+	/* free the original mbufs */
+	avp_dev_free_pkts(tx_pkts, nb_pkts);
+	AVP_STAGE_MARK(txq, tsc, RTE_PMD_AVP_STAGE_ALLOC);
+
+	txq->packets += nb_pkts;
+	txq->bytes += tx_bytes;
+
+	/* send the packets */
+	avp_copy_fence(avp->tx_copy);
+	avp_ring_put(AVP_RING(tx_q), descs, total);
+	AVP_STAGE_END(txq, tsc);
+	avp_dev_burst_account(txq, nb_pkts);
+	if (unlikely(nb_pkts != orig_nb_pkts))
+		txq->errors += (orig_nb_pkts - nb_pkts);
+
+	return nb_pkts;
+}
+
+#ifdef AVP_TX_MP
+/*
+ * Claim the host buffers and reserve the transmit fifo slots of as many
+ * packets as both allow with a single compare-and-set, so that a queue never
+ * holds buffers it cannot send or slots it cannot fill.  A packet takes one
+ * transmit slot, or one per segment on a compact descriptor ring.  Returns the
+ * number of packets, with the first claimed entry in cons_start, the first
+ * reserved slot in prod_start and the number of buffers in total.
+ */
+static inline __attribute__((always_inline)) unsigned int
+avp_dev_tx_mp_reserve(struct avp_queue *txq, const uint8_t *segments,
+		      unsigned int nb_pkts, unsigned int max_bufs, int cdesc,
+		      uint32_t *cons_start, uint32_t *prod_start,
+		      unsigned int *total)
+{
+	struct avp_dev *avp = txq->avp;
+	struct rte_avp_fifo *alloc_q = avp->alloc_q[txq->queue_id];
+	struct rte_avp_fifo *tx_q = avp->tx_q[txq->queue_id];
+	struct avp_tx_mp *mp = &avp->tx_mp[txq->queue_id];
+	unsigned int alloc_mask, tx_mask;
+	unsigned int avail, tx_free;
+	unsigned int bufs, slots;
+	uint32_t cons, prod;
+	uint64_t head;
+	unsigned int i;
+
+	if (cdesc) {
+		alloc_mask = AVP_RING(alloc_q)->len - 1;
+		tx_mask = AVP_RING(tx_q)->len - 1;
+	} else {
+		alloc_mask = avp_dev_fifo_len(avp, alloc_q) - 1;
+		tx_mask = avp_dev_fifo_len(avp, tx_q) - 1;
+	}
+
+	do {
+		head = mp->head;
+		cons = AVP_MP_CONS(head);
+		prod = AVP_MP_PROD(head);
+
+		/* the host indices must not be read ahead of the head */
+		rte_smp_rmb();
+		avail = (*avp_dev_fifo_write_index(avp, alloc_q) - cons) &
+			alloc_mask;
+		tx_free = (*avp_dev_fifo_read_index(avp, tx_q) - prod - 1) &
+			tx_mask;
+
+		/* determine how many packets fit in both fifos */
+		bufs = 0;
+		slots = 0;
+		for (i = 0; i < nb_pkts; i++) {
+			if ((bufs + segments[i] > RTE_MIN(avail, max_bufs)) ||
+			    (slots + (cdesc ? segments[i] : 1) > tx_free))
+				break;
+			bufs += segments[i];
+			slots += cdesc ? segments[i] : 1;
+		}
+		if (i == 0)
+			break;
+	} while (rte_atomic64_cmpset(&mp->head, head,
+				     AVP_MP_HEAD(cons + bufs,
+						 prod + slots)) == 0);
+
+	avp_dev_fifo_watermarks(txq, avail, tx_free);
+	if (unlikely(i != nb_pkts)) {
+		if (slots + (cdesc ? segments[i] : 1) > tx_free)
+			txq->xstats.fifo_full += nb_pkts - i;
+		else if (avail <= max_bufs)
+			txq->xstats.nobuf += nb_pkts - i;
+	}
+
+	*cons_start = cons;
+	*prod_start = prod;
+	*total = bufs;
+	return i;
+}
+
+/*
+ * Count a queue as transmitting on its shared fifo pair while the burst
+ * function runs so that avp_dev_tx_mp_reset() never moves the indices under
+ * it.  The burst function checks AVP_F_DETACHED only once counted.
+ */
+static inline __attribute__((always_inline)) uint16_t
+avp_xmit_pkts_mp_common(void *tx_queue, struct rte_mbuf **tx_pkts,
+			uint16_t nb_pkts, eth_tx_burst_t xmit)
+{
+	struct avp_queue *txq = (struct avp_queue *)tx_queue;
+	struct avp_tx_mp *mp = &txq->avp->tx_mp[txq->queue_id];
+	uint16_t sent;
+
+	rte_atomic32_inc(&mp->busy);
+	sent = xmit(tx_queue, tx_pkts, nb_pkts);
+	rte_atomic32_dec(&mp->busy);
+
+	return sent;
+}
+
+/*
+ * Transmit packets on a host fifo that is shared with other queues.  The
+ * buffers and the transmit fifo slots of the packets are reserved together
+ * before the copy, as rte_ring does, so the only wait is for the queues that
+ * reserved earlier to fill their slots.
+ */
+static uint16_t
+_avp_xmit_pkts_mp(void *tx_queue, struct rte_mbuf **tx_pkts, uint16_t nb_pkts)
+{
+	struct rte_avp_desc *avp_bufs[(AVP_MAX_TX_BURST *
+				       RTE_AVP_MAX_MBUF_SEGMENTS)];
+	struct avp_queue *txq = (struct avp_queue *)tx_queue;
+	struct rte_avp_desc *tx_bufs[AVP_MAX_TX_BURST];
+	uint8_t segments[AVP_MAX_TX_BURST];
+	struct avp_dev *avp = txq->avp;
+	struct rte_avp_fifo *alloc_q;
+	struct rte_avp_fifo *tx_q;
+	struct avp_tx_mp *mp;
+	unsigned int orig_nb_pkts;
 	unsigned int required;
-	unsigned int buf_len;
-	unsigned int port_id;
+	unsigned int tx_bytes;
+	uint32_t cons, prod;
+	unsigned int nb_bad;
+	unsigned int copied;
+	unsigned int total;
+	unsigned int count;
+	struct rte_mbuf *m;
 	unsigned int i;
+	uint64_t tsc __rte_unused;
 
+	orig_nb_pkts = nb_pkts;
 	if (unlikely(avp->flags & AVP_F_DETACHED)) {
 		/* VM live migration in progress */
+		/* packets are held by avp_xmit_pkts_hold() if configured */
+		txq->errors += nb_pkts;
+		txq->xstats.detached += nb_pkts;
 		return 0;
 	}
 
-	guest_mbuf_size = avp->guest_mbuf_size;
-	port_id = avp->port_id;
-	rx_q = avp->rx_q[rxq->queue_id];
-	free_q = avp->free_q[rxq->queue_id];
+	tx_q = avp->tx_q[txq->queue_id];
+	alloc_q = avp->alloc_q[txq->queue_id];
+	mp = &avp->tx_mp[txq->queue_id];
 
-	/* setup next queue to service */
-	rxq->queue_id = (rxq->queue_id < rxq->queue_limit) ?
-		(rxq->queue_id + 1) : rxq->queue_base;
+	/* limit the number of transmitted packets to the max burst size */
+	if (unlikely(nb_pkts > AVP_MAX_TX_BURST))
+		nb_pkts = AVP_MAX_TX_BURST;
 
-	/* determine how many slots are available in the free queue */
-	count = avp_fifo_free_count(free_q);
+	AVP_STAGE_START(txq, tsc);
 
-	/* determine how many packets are available in the rx queue */
-	avail = avp_fifo_count(rx_q);
+	/* determine how many buffers each packet needs */
+	for (i = 0; i < nb_pkts; i++) {
+		m = tx_pkts[i];
+		required = (rte_pktmbuf_pkt_len(m) + avp->host_mbuf_size - 1) /
+			avp->host_mbuf_size;
 
-	/* determine how many packets can be received */
-	count = RTE_MIN(count, avail);
-	count = RTE_MIN(count, nb_pkts);
-	count = RTE_MIN(count, (unsigned int)AVP_MAX_RX_BURST);
+		if (unlikely((required == 0) ||
+			     (required > avp_dev_tx_max_segments(avp, m)) ||
+			     (rte_pktmbuf_pkt_len(m) > UINT16_MAX))) {
+			/* refuse this packet and those queued behind it */
+			txq->xstats.oversized += nb_pkts - i;
+			break;
+		}
+		segments[i] = required;
+	}
 
-	if (unlikely(count == 0)) {
-		/* no free buffers, or no buffers on the rx queue */
+	/* claim the buffers and the transmit slots of the packets that fit */
+	nb_pkts = avp_dev_tx_mp_reserve(txq, segments, i, RTE_DIM(avp_bufs), 0,
+					&cons, &prod, &total);
+	if (unlikely(nb_pkts == 0)) {
+		/* no available buffers, or no space on the tx queue */
+		txq->errors += orig_nb_pkts;
 		return 0;
 	}
 
-	/* retrieve pending packets */
-	n = avp_fifo_get(rx_q, (void **)&avp_bufs, count);
-	PMD_RX_LOG(DEBUG, "Receiving %u packets from Rx queue at %p\n",
-		   count, rx_q);
+	/* retrieve the send buffers */
+	avp_dev_fifo_mc_get(avp, mp, alloc_q, cons, (void **)avp_bufs, total);
+	AVP_STAGE_MARK(txq, tsc, RTE_PMD_AVP_STAGE_FIFO_GET);
 
+	tx_bytes = 0;
+	nb_bad = 0;
 	count = 0;
-	for (i = 0; i < n; i++) {
-		/* prefetch next entry while processing current one */
-		if (i + 1 < n) {
-			pkt_buf = avp_dev_translate_buffer(avp,
-							   avp_bufs[i + 1]);
-			rte_prefetch0(pkt_buf);
+	for (i = 0; i < nb_pkts; i++) {
+		/* process each packet to be transmitted */
+		copied = avp_dev_copy_to_buffers(avp, tx_pkts[i],
+						 &avp_bufs[count],
+						 segments[i]);
+		if (unlikely(copied == 0)) {
+			/* fill the reserved slot with the untouched buffer */
+			txq->errors++;
+			txq->xstats.bad_address++;
+			nb_bad++;
 		}
-		buf = avp_bufs[i];
-
-		/* Peek into the first buffer to determine the total length */
-		pkt_buf = avp_dev_translate_buffer(avp, buf);
-		buf_len = pkt_buf->pkt_len;
+		tx_bytes += copied;
+		tx_bufs[i] = avp_bufs[count];
+		count += segments[i];
+	}
+	AVP_STAGE_MARK(txq, tsc, RTE_PMD_AVP_STAGE_COPY);
 
-		/* Allocate enough mbufs to receive the entire packet */
-		required = (buf_len + guest_mbuf_size - 1) / guest_mbuf_size;
-#if RTE_VERSION >= RTE_VERSION_NUM(17, 2, 0, 0)
-		if (rte_pktmbuf_alloc_bulk(avp->pool, mbufs, required)) {
-#else
-		if (wrs_pktmbuf_alloc_bulk(avp->pool, mbufs, required)) {
+#ifdef RTE_LIBRTE_AVP_DEBUG_BUFFERS
+	for (i = 0; i < nb_pkts; i++)
+		avp_dev_buffer_sanity_check(avp, tx_bufs[i]);
 #endif
-			rxq->dev_data->rx_mbuf_alloc_failed++;
-			continue;
-		}
-
-		/* Copy the data from the buffers to our mbufs */
-		m = avp_dev_copy_from_buffers(avp, buf, mbufs, required);
-
-		/* finalize mbuf */
-		rte_pktmbuf_port(m) = port_id;
 
-		if (_avp_mac_filter(avp, m) != 0) {
-			/* silently discard packets not destined to our MAC */
-			rte_pktmbuf_free(m);
-			continue;
-		}
-
-		/* return new mbuf to caller */
-		rx_pkts[count++] = m;
-		rxq->bytes += buf_len;
-	}
+	/* send the packets */
+	avp_copy_fence(avp->tx_copy);
+	avp_dev_fifo_mp_put(avp, mp, tx_q, prod, (void **)tx_bufs, nb_pkts);
+	AVP_STAGE_MARK(txq, tsc, RTE_PMD_AVP_STAGE_FIFO_PUT);
 
-	rxq->packets += count;
+	/* free the original mbufs */
+	avp_dev_free_pkts(tx_pkts, nb_pkts);
+	AVP_STAGE_END(txq, tsc);
 
-	/* return the buffers to the free queue */
-	avp_fifo_put(free_q, (void **)&avp_bufs[0], n);
+	txq->packets += nb_pkts - nb_bad;
+	txq->bytes += tx_bytes;
+	avp_dev_burst_account(txq, nb_pkts);
+	if (unlikely(nb_pkts != orig_nb_pkts))
+		txq->errors += (orig_nb_pkts - nb_pkts);
 
-	return count;
+	return nb_pkts;
 }
 
-
+/*
+ * Transmit packets on a compact descriptor ring that is shared with other
+ * queues.  As avp_xmit_pkts_mp() except that a transmit slot is reserved for
+ * each segment, always for whole packets so that the host never sees part of
+ * a chained packet.
+ */
 static uint16_t
-avp_recv_pkts(void *rx_queue,
-	      struct rte_mbuf **rx_pkts,
-	      uint16_t nb_pkts)
+_avp_xmit_pkts_cdesc_mp(void *tx_queue, struct rte_mbuf **tx_pkts,
+			uint16_t nb_pkts)
 {
-	struct avp_queue *rxq = (struct avp_queue *)rx_queue;
-	struct rte_avp_desc *avp_bufs[AVP_MAX_RX_BURST];
-	struct avp_dev *avp = rxq->avp;
-	struct rte_avp_desc *pkt_buf;
-	struct rte_avp_fifo *free_q;
-	struct rte_avp_fifo *rx_q;
-	unsigned int count, avail, n;
-	unsigned int pkt_len;
+	struct avp_queue *txq = (struct avp_queue *)tx_queue;
+	struct rte_avp_cdesc descs[AVP_MAX_TX_BURST * RTE_AVP_MAX_MBUF_SEGMENTS];
+	uint8_t segments[AVP_MAX_TX_BURST];
+	struct avp_dev *avp = txq->avp;
+	struct rte_avp_fifo *alloc_q;
+	struct rte_avp_fifo *tx_q;
+	struct avp_tx_mp *mp;
+	unsigned int orig_nb_pkts;
+	unsigned int required;
+	unsigned int tx_bytes;
+	uint32_t cons, prod;
+	unsigned int total;
+	unsigned int count;
 	struct rte_mbuf *m;
-	char *pkt_data;
 	unsigned int i;
+	uint64_t tsc __rte_unused;
 
+	orig_nb_pkts = nb_pkts;
 	if (unlikely(avp->flags & AVP_F_DETACHED)) {
 		/* VM live migration in progress */
+		/* packets are held by avp_xmit_pkts_hold() if configured */
+		txq->errors += nb_pkts;
+		txq->xstats.detached += nb_pkts;
 		return 0;
 	}
 
-	rx_q = avp->rx_q[rxq->queue_id];
-	free_q = avp->free_q[rxq->queue_id];
+	tx_q = avp->tx_q[txq->queue_id];
+	alloc_q = avp->alloc_q[txq->queue_id];
+	mp = &avp->tx_mp[txq->queue_id];
 
-	/* setup next queue to service */
-	rxq->queue_id = (rxq->queue_id < rxq->queue_limit) ?
-		(rxq->queue_id + 1) : rxq->queue_base;
+	/* limit the number of transmitted packets to the max burst size */
+	if (unlikely(nb_pkts > AVP_MAX_TX_BURST))
+		nb_pkts = AVP_MAX_TX_BURST;
 
-	/* determine how many slots are available in the free queue */
-	count = avp_fifo_free_count(free_q);
+	AVP_STAGE_START(txq, tsc);
 
-	/* determine how many packets are available in the rx queue */
-	avail = avp_fifo_count(rx_q);
+	/* determine how many buffers each packet needs */
+	for (i = 0; i < nb_pkts; i++) {
+		m = tx_pkts[i];
+		required = (rte_pktmbuf_pkt_len(m) + avp->host_mbuf_size - 1) /
+			avp->host_mbuf_size;
 
-	/* determine how many packets can be received */
-	count = RTE_MIN(count, avail);
-	count = RTE_MIN(count, nb_pkts);
-	count = RTE_MIN(count, (unsigned int)AVP_MAX_RX_BURST);
+		if (unlikely((required == 0) ||
+			     (required > avp_dev_tx_max_segments(avp, m)) ||
+			     (rte_pktmbuf_pkt_len(m) > UINT16_MAX))) {
+			/* refuse this packet and those queued behind it */
+			txq->xstats.oversized += nb_pkts - i;
+			break;
+		}
+		segments[i] = required;
+	}
 
-	if (unlikely(count == 0)) {
-		/* no free buffers, or no buffers on the rx queue */
+	/* claim the buffers and the transmit slots of the packets that fit */
+	nb_pkts = avp_dev_tx_mp_reserve(txq, segments, i, RTE_DIM(descs), 1,
+					&cons, &prod, &total);
+	if (unlikely(nb_pkts == 0)) {
+		/* no available buffers, or no space on the tx queue */
+		txq->errors += orig_nb_pkts;
 		return 0;
 	}
 
-	/* retrieve pending packets */
-	n = avp_fifo_get(rx_q, (void **)&avp_bufs, count);
-	PMD_RX_LOG(DEBUG, "Receiving %u packets from Rx queue at %p\n",
-		   count, rx_q);
+	/* retrieve the send buffers */
+	avp_ring_mc_get(avp, mp, alloc_q, cons, descs, total);
+	AVP_STAGE_MARK(txq, tsc, RTE_PMD_AVP_STAGE_FIFO_GET);
 
+	tx_bytes = 0;
 	count = 0;
-	for (i = 0; i < n; i++) {
-		/* prefetch next entry while processing current one */
-		if (i < n - 1) {
-			pkt_buf = avp_dev_translate_buffer(avp,
-							   avp_bufs[i + 1]);
-			rte_prefetch0(pkt_buf);
-		}
+	for (i = 0; i < nb_pkts; i++) {
+		/* process each packet to be transmitted */
+		tx_bytes += avp_dev_copy_to_cdesc(avp, tx_pkts[i],
+						  &descs[count], segments[i]);
+		count += segments[i];
+	}
+	AVP_STAGE_MARK(txq, tsc, RTE_PMD_AVP_STAGE_COPY);
 
-		/* Adjust host pointers for guest addressing */
-		pkt_buf = avp_dev_translate_buffer(avp, avp_bufs[i]);
-		pkt_data = avp_dev_translate_buffer(avp, pkt_buf->data);
-		pkt_len = pkt_buf->pkt_len;
+	/* send the packets */
+	avp_copy_fence(avp->tx_copy);
+	avp_ring_mp_put(avp, mp, tx_q, prod, descs, total);
+	AVP_STAGE_MARK(txq, tsc, RTE_PMD_AVP_STAGE_FIFO_PUT);
 
-		if (unlikely((pkt_len > avp->guest_mbuf_size) ||
-			     (pkt_buf->nb_segs > 1))) {
-			/*
-			 * application should be using the scattered receive
-			 * function
-			 */
-			rxq->errors++;
-			continue;
-		}
+	/* free the original mbufs */
+	avp_dev_free_pkts(tx_pkts, nb_pkts);
+	AVP_STAGE_END(txq, tsc);
 
-		/* process each packet to be transmitted */
-		m = rte_pktmbuf_alloc(avp->pool);
-		if (unlikely(m == NULL)) {
-			rxq->dev_data->rx_mbuf_alloc_failed++;
-			continue;
-		}
+	txq->packets += nb_pkts;
+	txq->bytes += tx_bytes;
+	avp_dev_burst_account(txq, nb_pkts);
+	if (unlikely(nb_pkts != orig_nb_pkts))
+		txq->errors += (orig_nb_pkts - nb_pkts);
 
-		/* copy data out of the host buffer to our buffer */
-		rte_pktmbuf_data_offset(m, RTE_PKTMBUF_HEADROOM);
-		rte_memcpy(rte_pktmbuf_mtod(m, void *), pkt_data, pkt_len);
+	return nb_pkts;
+}
 
-		/* initialize the local mbuf */
-		rte_pktmbuf_data_len(m) = pkt_len;
-		rte_pktmbuf_pkt_len(m) = pkt_len;
-		rte_pktmbuf_port(m) = avp->port_id;
+static uint16_t
+avp_xmit_pkts_mp(void *tx_queue, struct rte_mbuf **tx_pkts, uint16_t nb_pkts)
+{
+	return avp_xmit_pkts_mp_common(tx_queue, tx_pkts, nb_pkts,
+				       _avp_xmit_pkts_mp);
+}
 
-		if (pkt_buf->ol_flags & RTE_AVP_RX_VLAN_PKT) {
-			m->ol_flags = PKT_RX_VLAN_PKT;
-			rte_pktmbuf_vlan_tci(m) = pkt_buf->vlan_tci;
-		}
+static uint16_t
+avp_xmit_pkts_cdesc_mp(void *tx_queue, struct rte_mbuf **tx_pkts,
+		       uint16_t nb_pkts)
+{
+	return avp_xmit_pkts_mp_common(tx_queue, tx_pkts, nb_pkts,
+				       _avp_xmit_pkts_cdesc_mp);
+}
+#endif
 
-		if (_avp_mac_filter(avp, m) != 0) {
-			/* silently discard packets not destined to our MAC */
-			rte_pktmbuf_free(m);
-			continue;
-		}
+/*
+ * Hold onto a burst of packets while the device is detached.  Packets that do
+ * not fit within the configured limits are refused and left to the caller.
+ */
+static uint16_t
+avp_dev_tx_hold(struct avp_queue *txq, struct rte_mbuf **tx_pkts,
+		uint16_t nb_pkts)
+{
+	struct avp_tx_hold *hold = txq->hold;
+	unsigned int count;
+	unsigned int i;
 
-		/* return new mbuf to caller */
-		rx_pkts[count++] = m;
-		rxq->bytes += pkt_len;
+	for (i = 0; i < nb_pkts; i++) {
+		count = hold->head - hold->tail;
+		if (count >= hold->max_pkts)
+			break;
+		if ((hold->max_bytes != 0) &&
+		    (hold->bytes + rte_pktmbuf_pkt_len(tx_pkts[i]) >
+		     hold->max_bytes))
+			break;
+
+		hold->bytes += rte_pktmbuf_pkt_len(tx_pkts[i]);
+		hold->mbufs[hold->head++ & (hold->size - 1)] = tx_pkts[i];
 	}
 
-	rxq->packets += count;
+	txq->held += i;
+	txq->overflows += nb_pkts - i;
 
-	/* return the buffers to the free queue */
-	avp_fifo_put(free_q, (void **)&avp_bufs[0], n);
+	return i;
+}
 
-	return count;
+/*
+ * Send the held packets in order.  Returns the number of packets still held.
+ */
+static unsigned int
+avp_dev_tx_flush(struct avp_dev *avp, struct avp_queue *txq)
+{
+	eth_tx_burst_t tx_pkt_burst =
+		avp_burst_functions[avp->port_id].tx_pkt_burst;
+	struct avp_tx_hold *hold = txq->hold;
+	uint32_t lens[AVP_MAX_TX_BURST];
+	unsigned int count, idx, n, sent;
+	unsigned int i;
+
+	while ((count = hold->head - hold->tail) != 0) {
+		/* send the contiguous slots starting at the oldest packet */
+		idx = hold->tail & (hold->size - 1);
+		n = RTE_MIN(count, hold->size - idx);
+		n = RTE_MIN(n, (unsigned int)AVP_MAX_TX_BURST);
+
+		/* the mbufs are released once sent so get their lengths first */
+		for (i = 0; i < n; i++)
+			lens[i] = rte_pktmbuf_pkt_len(hold->mbufs[idx + i]);
+		sent = tx_pkt_burst(txq, &hold->mbufs[idx], n);
+		for (i = 0; i < sent; i++)
+			hold->bytes -= lens[i];
+
+		hold->tail += sent;
+		txq->flushed += sent;
+		if (sent < n)
+			break;
+	}
+
+	return hold->head - hold->tail;
 }
 
 /*
- * Copy a chained mbuf to a set of host buffers.  This function assumes that
- * there are sufficient destination buffers to contain the entire source
- * packet.
+ * Transmit function used when a holding ring is configured.  While the device
+ * is detached the packets are held rather than refused, and once re-attached
+ * the held packets are sent ahead of any new packets.
  */
-static inline uint16_t
-avp_dev_copy_to_buffers(struct avp_dev *avp,
-			struct rte_mbuf *mbuf,
-			struct rte_avp_desc **buffers,
-			unsigned int count)
+static uint16_t
+avp_xmit_pkts_hold(void *tx_queue, struct rte_mbuf **tx_pkts, uint16_t nb_pkts)
 {
-	struct rte_avp_desc *previous_buf = NULL;
-	struct rte_avp_desc *first_buf = NULL;
-	struct rte_avp_desc *pkt_buf;
-	struct rte_avp_desc *buf;
-	size_t total_length;
+	struct avp_queue *txq = (struct avp_queue *)tx_queue;
+	struct avp_dev *avp = txq->avp;
+
+	if (unlikely(avp->flags & AVP_F_DETACHED)) {
+		/* VM live migration in progress */
+		return avp_dev_tx_hold(txq, tx_pkts, nb_pkts);
+	}
+
+	if (unlikely(txq->hold->head != txq->hold->tail) &&
+	    (avp_dev_tx_flush(avp, txq) != 0)) {
+		/* preserve ordering behind the packets still held */
+		return avp_dev_tx_hold(txq, tx_pkts, nb_pkts);
+	}
+
+	return avp_burst_functions[avp->port_id].tx_pkt_burst(tx_queue,
+							       tx_pkts,
+							       nb_pkts);
+}
+
+#ifdef AVP_ZERO_COPY
+/*
+ * Recycle the mbuf headers of zero-copy transmit mbufs that the application
+ * has released.  Host buffers that were never transmitted are stashed so that
+ * they can be handed out again.
+ */
+static inline void
+avp_dev_zc_tx_reclaim(struct avp_dev *avp, struct avp_zc_ring *ring)
+{
+	struct avp_zc_priv *priv;
 	struct rte_mbuf *m;
-	size_t copy_length;
-	size_t src_offset;
-	char *pkt_data;
-	unsigned int i;
 
-	avp_mbuf_sanity_check(mbuf, 1);
+	if (unlikely(ring->stash_epoch != avp->epoch)) {
+		/* stashed buffers belong to a previous host */
+		ring->nb_stash = 0;
+		ring->stash_epoch = avp->epoch;
+	}
 
-	m = mbuf;
-	src_offset = 0;
-	total_length = rte_pktmbuf_pkt_len(m);
-	for (i = 0; (i < count) && (m != NULL); i++) {
-		/* fill each destination buffer */
-		buf = buffers[i];
+	while (ring->tail != ring->head) {
+		m = ring->mbufs[ring->tail & AVP_ZC_RING_MASK];
+		if (!avp_zc_mbuf_released(m)) {
+			/* still in use; preserve ordering */
+			break;
+		}
+
+		priv = AVP_ZC_PRIV(m);
+		if ((priv->host_buf != NULL) && (priv->epoch == avp->epoch))
+			ring->stash[ring->nb_stash++] = priv->host_buf;
+
+		avp_zc_mbuf_free(m);
+		ring->tail++;
+	}
+}
+
+/*
+ * Release the zero-copy ring of a queue that is being released.  The host
+ * buffers of the mbufs released by the application are handed back to the
+ * host; those still held by the application lose the PMD reference so that
+ * their headers return to the pool once freed, but their host buffers can no
+ * longer be reclaimed.
+ */
+static void
+avp_dev_zc_ring_free(struct avp_queue *q, int rx)
+{
+	struct avp_zc_ring *ring = q->zc;
+	struct avp_dev *avp = q->avp;
+	struct rte_avp_fifo *free_q;
+	struct rte_mbuf *m_seg;
+	struct rte_mbuf *m;
+	unsigned int n;
 
-		if (i < count - 1) {
-			/* prefetch next entry while processing this one */
-			pkt_buf = avp_dev_translate_buffer(avp, buffers[i + 1]);
-			rte_prefetch0(pkt_buf);
+	if (!(avp->flags & AVP_F_DETACHED)) {
+		if (rx) {
+			avp_dev_zc_rx_reclaim(avp, ring);
+		} else {
+			/*
+			 * Unsent transmit buffers are returned on a free
+			 * queue; the host releases the buffers of any free
+			 * queue to their pool.
+			 */
+			avp_dev_zc_tx_reclaim(avp, ring);
+			free_q = avp->free_q[q->queue_id % avp->max_rx_queues];
+			n = avp_dev_fifo_put(avp, free_q, ring->stash,
+					     ring->nb_stash);
+			if (n != ring->nb_stash)
+				PMD_DRV_LOG(ERR, "Failed to return %u zero-copy buffers to the host\n",
+					    ring->nb_stash - n);
+			ring->nb_stash = 0;
 		}
+	}
 
-		/* Adjust pointers for guest addressing */
-		pkt_buf = avp_dev_translate_buffer(avp, buf);
-		pkt_data = avp_dev_translate_buffer(avp, pkt_buf->data);
+	while (ring->tail != ring->head) {
+		m = ring->mbufs[ring->tail++ & AVP_ZC_RING_MASK];
+		if (avp_zc_mbuf_released(m)) {
+			avp_zc_mbuf_free(m);
+			continue;
+		}
+		for (m_seg = m; m_seg != NULL; m_seg = rte_pktmbuf_next(m_seg))
+			rte_mbuf_refcnt_update(m_seg, -1);
+	}
 
-		/* setup the buffer chain */
-		if (previous_buf != NULL)
-			previous_buf->next = buf;
-		else
-			first_buf = pkt_buf;
+	rte_free(ring);
+	q->zc = NULL;
+}
 
-		previous_buf = pkt_buf;
+/* check whether an mbuf wraps a host buffer owned by this transmit queue */
+static inline int
+avp_dev_zc_tx_owned(struct avp_queue *txq, struct rte_mbuf *m)
+{
+	struct avp_zc_priv *priv = AVP_ZC_PRIV(m);
 
-		do {
-			/*
-			 * copy as many source mbuf segments as will fit in the
-			 * destination buffer.
-			 */
-			copy_length = RTE_MIN((avp->host_mbuf_size -
-					       pkt_buf->data_len),
-					      (rte_pktmbuf_data_len(m) -
-					       src_offset));
-			rte_memcpy(RTE_PTR_ADD(pkt_data, pkt_buf->data_len),
-				   RTE_PTR_ADD(rte_pktmbuf_mtod(m, void *),
-					       src_offset),
-				   copy_length);
-			pkt_buf->data_len += copy_length;
-			src_offset += copy_length;
+	return ((m->pool == txq->zc->pool) &&
+		(rte_pktmbuf_nb_segs(m) == 1) &&
+		(priv->host_buf != NULL) &&
+		(priv->epoch == txq->avp->epoch));
+}
 
-			if (likely(src_offset == rte_pktmbuf_data_len(m))) {
-				/* need a new source buffer */
-				m = rte_pktmbuf_next(m);
-				src_offset = 0;
-			}
+/*
+ * Publish the host buffer that is wrapped by a zero-copy mbuf.  Returns the
+ * host address of the buffer to be enqueued on the transmit queue.
+ */
+static inline void *
+avp_dev_zc_to_buffer(struct avp_dev *avp, struct rte_mbuf *m)
+{
+	struct avp_zc_priv *priv = AVP_ZC_PRIV(m);
+	struct rte_avp_desc *pkt_buf;
+	unsigned int pkt_len;
+	void *buf;
 
-			if (unlikely(pkt_buf->data_len ==
-				     avp->host_mbuf_size)) {
-				/* need a new destination buffer */
-				break;
-			}
+	buf = priv->host_buf;
+	pkt_buf = avp_dev_translate_buffer(avp, buf);
+	pkt_len = rte_pktmbuf_data_len(m);
 
-		} while (m != NULL);
+	if (unlikely(m->data_off != 0)) {
+		/* the host expects the data at the start of its buffer */
+		memmove(m->buf_addr, rte_pktmbuf_mtod(m, void *), pkt_len);
+		rte_pktmbuf_data_offset(m, 0);
 	}
 
-	first_buf->nb_segs = count;
-	first_buf->pkt_len = total_length;
+	pkt_buf->pkt_len = pkt_len;
+	pkt_buf->data_len = pkt_len;
+	pkt_buf->nb_segs = 1;
+	pkt_buf->next = NULL;
 
-	if (mbuf->ol_flags & PKT_TX_VLAN_PKT) {
-		first_buf->ol_flags |= RTE_AVP_TX_VLAN_PKT;
-		first_buf->vlan_tci = rte_pktmbuf_vlan_tci(mbuf);
+	if (m->ol_flags & PKT_TX_VLAN_PKT) {
+		pkt_buf->ol_flags |= RTE_AVP_TX_VLAN_PKT;
+		pkt_buf->vlan_tci = rte_pktmbuf_vlan_tci(m);
 	}
 
-	avp_dev_buffer_sanity_check(avp, buffers[0]);
+	avp_dev_tx_offload(avp, m, pkt_buf);
 
-	return total_length;
-}
+	/* the buffer now belongs to the host */
+	priv->host_buf = NULL;
 
+	return buf;
+}
 
 static uint16_t
-avp_xmit_scattered_pkts(void *tx_queue,
-			struct rte_mbuf **tx_pkts,
-			uint16_t nb_pkts)
+avp_xmit_pkts_zc(void *tx_queue,
+		 struct rte_mbuf **tx_pkts,
+		 uint16_t nb_pkts)
 {
 	struct rte_avp_desc *avp_bufs[(AVP_MAX_TX_BURST *
 				       RTE_AVP_MAX_MBUF_SEGMENTS)];
@@ -1866,13 +6671,15 @@ avp_xmit_scattered_pkts(void *tx_queue,
 	unsigned int required;
 	unsigned int segments;
 	unsigned int tx_bytes;
+	unsigned int nb_bad;
+	unsigned int copied;
 	unsigned int i;
 
 	orig_nb_pkts = nb_pkts;
 	if (unlikely(avp->flags & AVP_F_DETACHED)) {
 		/* VM live migration in progress */
-		/* TODO ... buffer for X packets then drop? */
 		txq->errors += nb_pkts;
+		txq->xstats.detached += nb_pkts;
 		return 0;
 	}
 
@@ -1884,18 +6691,26 @@ avp_xmit_scattered_pkts(void *tx_queue,
 		nb_pkts = AVP_MAX_TX_BURST;
 
 	/* determine how many buffers are available to copy into */
-	avail = avp_fifo_count(alloc_q);
+	avail = avp_dev_fifo_count(avp, alloc_q, nb_pkts);
+
+	/* determine how many slots are available in the transmit queue */
+	count = avp_dev_fifo_free_count(avp, tx_q, nb_pkts);
+	avp_dev_fifo_watermarks(txq, avail, count);
+
 	if (unlikely(avail > (AVP_MAX_TX_BURST *
 			      RTE_AVP_MAX_MBUF_SEGMENTS)))
 		avail = AVP_MAX_TX_BURST * RTE_AVP_MAX_MBUF_SEGMENTS;
 
-	/* determine how many slots are available in the transmit queue */
-	count = avp_fifo_free_count(tx_q);
-
 	/* determine how many packets can be sent */
-	nb_pkts = RTE_MIN(count, nb_pkts);
+	if (unlikely(count < nb_pkts)) {
+		txq->xstats.fifo_full += nb_pkts - count;
+		nb_pkts = count;
+	}
 
-	/* determine how many packets will fit in the available buffers */
+	/*
+	 * determine how many packets will fit in the available buffers;
+	 * zero-copy packets already own their host buffer.
+	 */
 	count = 0;
 	segments = 0;
 	for (i = 0; i < nb_pkts; i++) {
@@ -1904,14 +6719,24 @@ avp_xmit_scattered_pkts(void *tx_queue,
 			/* prefetch next entry while processing this one */
 			rte_prefetch0(tx_pkts[i + 1]);
 		}
+
+		if (avp_dev_zc_tx_owned(txq, m)) {
+			count++;
+			continue;
+		}
+
 		required = (rte_pktmbuf_pkt_len(m) + avp->host_mbuf_size - 1) /
 			avp->host_mbuf_size;
 
 		if (unlikely((required == 0) ||
-			     (required > RTE_AVP_MAX_MBUF_SEGMENTS)))
+			     (required > RTE_AVP_MAX_MBUF_SEGMENTS))) {
+			/* refuse this packet and those queued behind it */
+			txq->xstats.oversized += nb_pkts - i;
 			break;
-		else if (unlikely(required + segments > avail))
+		} else if (unlikely(required + segments > avail)) {
+			txq->xstats.nobuf += nb_pkts - i;
 			break;
+		}
 		segments += required;
 		count++;
 	}
@@ -1926,166 +6751,298 @@ avp_xmit_scattered_pkts(void *tx_queue,
 	PMD_TX_LOG(DEBUG, "Sending %u packets on Tx queue at %p\n",
 		   nb_pkts, tx_q);
 
-	/* retrieve sufficient send buffers */
-	n = avp_fifo_get(alloc_q, (void **)&avp_bufs, segments);
+	/* retrieve sufficient send buffers for the packets to be copied */
+	n = (segments > 0) ?
+		avp_dev_fifo_get(avp, alloc_q, (void **)&avp_bufs, segments) : 0;
 	if (unlikely(n != segments)) {
 		PMD_TX_LOG(DEBUG, "Failed to allocate buffers "
 			   "n=%u, segments=%u, orig=%u\n",
 			   n, segments, orig_nb_pkts);
 		txq->errors += orig_nb_pkts;
+		txq->xstats.nobuf += nb_pkts;
 		return 0;
 	}
 
 	tx_bytes = 0;
+	nb_bad = 0;
 	count = 0;
 	for (i = 0; i < nb_pkts; i++) {
 		/* process each packet to be transmitted */
 		m = tx_pkts[i];
 
-		/* determine how many buffers are required for this packet */
-		required = (rte_pktmbuf_pkt_len(m) + avp->host_mbuf_size - 1) /
-			avp->host_mbuf_size;
-
-		tx_bytes += avp_dev_copy_to_buffers(avp, m,
-						    &avp_bufs[count], required);
-		tx_bufs[i] = avp_bufs[count];
-		count += required;
-
-		/* free the original mbuf */
-		rte_pktmbuf_free(m);
+		if (avp_dev_zc_tx_owned(txq, m)) {
+			tx_bytes += rte_pktmbuf_pkt_len(m);
+			tx_bufs[i] = avp_dev_zc_to_buffer(avp, m);
+		} else {
+			/* determine how many buffers are required */
+			required = (rte_pktmbuf_pkt_len(m) +
+				    avp->host_mbuf_size - 1) /
+				avp->host_mbuf_size;
+
+			copied = avp_dev_copy_to_buffers(avp, m,
+							 &avp_bufs[count],
+							 required);
+			if (unlikely(copied == 0)) {
+				/* drop it, its first buffer goes back as is */
+				txq->errors++;
+				txq->xstats.bad_address++;
+				nb_bad++;
+			}
+			tx_bytes += copied;
+			tx_bufs[i] = avp_bufs[count];
+			count += required;
+		}
 	}
 
-	txq->packets += nb_pkts;
-	txq->bytes += tx_bytes;
+	/* release the application references on the mbufs */
+	avp_dev_free_pkts(tx_pkts, nb_pkts);
 
-#ifdef RTE_LIBRTE_AVP_DEBUG_BUFFERS
-	for (i = 0; i < nb_pkts; i++)
-		avp_dev_buffer_sanity_check(avp, tx_bufs[i]);
-#endif
+	txq->packets += nb_pkts - nb_bad;
+	txq->bytes += tx_bytes;
 
 	/* send the packets */
-	n = avp_fifo_put(tx_q, (void **)&tx_bufs[0], nb_pkts);
+	avp_copy_fence(avp->tx_copy);
+	n = avp_dev_fifo_put(avp, tx_q, (void **)&tx_bufs[0], nb_pkts);
+	avp_dev_burst_account(txq, n);
 	if (unlikely(n != orig_nb_pkts))
 		txq->errors += (orig_nb_pkts - n);
 
 	return n;
 }
 
-
-static uint16_t
-avp_xmit_pkts(void *tx_queue, struct rte_mbuf **tx_pkts, uint16_t nb_pkts)
+int
+rte_pmd_avp_tx_buf_alloc(uint8_t port_id, uint16_t queue_id,
+			 struct rte_mbuf **mbufs, unsigned int n)
 {
-	struct avp_queue *txq = (struct avp_queue *)tx_queue;
-	struct rte_avp_desc *avp_bufs[AVP_MAX_TX_BURST];
-	struct avp_dev *avp = txq->avp;
+	void *avp_bufs[AVP_MAX_TX_BURST];
 	struct rte_avp_desc *pkt_buf;
-	struct rte_avp_fifo *alloc_q;
-	struct rte_avp_fifo *tx_q;
-	unsigned int count, avail, n;
+	struct rte_eth_dev *eth_dev;
+	struct avp_zc_priv *priv;
+	struct avp_zc_ring *ring;
+	struct avp_queue *txq;
+	struct avp_dev *avp;
+	unsigned int count;
 	struct rte_mbuf *m;
-	unsigned int pkt_len;
-	unsigned int tx_bytes;
-	char *pkt_data;
 	unsigned int i;
+	void *data;
+
+	if (!rte_eth_dev_is_valid_port(port_id))
+		return -ENODEV;
+
+	eth_dev = &rte_eth_devices[port_id];
+	if (eth_dev->dev_ops != &avp_eth_dev_ops)
+		return -ENOTSUP;
+
+	if (queue_id >= eth_dev->data->nb_tx_queues)
+		return -EINVAL;
+
+	txq = eth_dev->data->tx_queues[queue_id];
+	if ((txq == NULL) || (txq->zc == NULL) ||
+	    (txq->avp->flags & AVP_F_CDESC))
+		return -ENOTSUP;
+
+	avp = txq->avp;
+	ring = txq->zc;
 
 	if (unlikely(avp->flags & AVP_F_DETACHED)) {
 		/* VM live migration in progress */
-		/* TODO ... buffer for X packets then drop?! */
-		txq->errors++;
 		return 0;
 	}
 
-	tx_q = avp->tx_q[txq->queue_id];
-	alloc_q = avp->alloc_q[txq->queue_id];
+	avp_dev_zc_tx_reclaim(avp, ring);
 
-	/* limit the number of transmitted packets to the max burst size */
-	if (unlikely(nb_pkts > AVP_MAX_TX_BURST))
-		nb_pkts = AVP_MAX_TX_BURST;
+	/* each buffer holds a ring slot until it is released */
+	n = RTE_MIN(n, (unsigned int)AVP_MAX_TX_BURST);
+	n = RTE_MIN(n, AVP_ZC_RING_SIZE - (ring->head - ring->tail));
 
-	/* determine how many buffers are available to copy into */
-	avail = avp_fifo_count(alloc_q);
+	/* reuse unsent buffers before taking new ones from the host */
+	count = RTE_MIN(n, ring->nb_stash);
+	for (i = 0; i < count; i++)
+		avp_bufs[i] = ring->stash[--ring->nb_stash];
+	if (count < n)
+		count += avp_dev_fifo_get(avp, avp->alloc_q[txq->queue_id],
+				      &avp_bufs[count], n - count);
 
-	/* determine how many slots are available in the transmit queue */
-	count = avp_fifo_free_count(tx_q);
+	for (i = 0, n = 0; i < count; i++) {
+		pkt_buf = avp_dev_translate_buffer(avp, avp_bufs[i]);
+		data = (pkt_buf != NULL) ?
+			avp_dev_translate_buffer(avp, pkt_buf->data) : NULL;
+		if (unlikely(data == NULL)) {
+			/* the host address is outside of all pools */
+			txq->errors++;
+			txq->xstats.bad_address++;
+			continue;
+		}
 
-	/* determine how many packets can be sent */
-	count = RTE_MIN(count, avail);
-	count = RTE_MIN(count, nb_pkts);
+		m = rte_mbuf_raw_alloc(ring->pool);
+		if (unlikely(m == NULL))
+			break;
 
-	if (unlikely(count == 0)) {
-		/* no available buffers, or no space on the tx queue */
-		txq->errors += nb_pkts;
-		return 0;
-	}
+		m->buf_addr = data;
+		m->buf_physaddr = avp_dev_translate_buffer_phys(avp,
+								pkt_buf->data);
+		m->buf_len = avp->host_mbuf_size;
+		rte_pktmbuf_reset(m);
+		rte_pktmbuf_data_offset(m, 0);
+		rte_pktmbuf_port(m) = avp->port_id;
 
-	PMD_TX_LOG(DEBUG, "Sending %u packets on Tx queue at %p\n",
-		   count, tx_q);
+		priv = AVP_ZC_PRIV(m);
+		priv->host_buf = avp_bufs[i];
+		priv->epoch = avp->epoch;
+		priv->fifo = txq->queue_id;
 
-	/* retrieve sufficient send buffers */
-	n = avp_fifo_get(alloc_q, (void **)&avp_bufs, count);
-	if (unlikely(n != count)) {
-		txq->errors++;
-		return 0;
+		/* keep our own reference so that the mbuf comes back to us */
+		rte_mbuf_refcnt_set(m, 2);
+		ring->mbufs[ring->head++ & AVP_ZC_RING_MASK] = m;
+		mbufs[n++] = m;
 	}
 
-	tx_bytes = 0;
-	for (i = 0; i < count; i++) {
-		/* prefetch next entry while processing the current one */
-		if (i < count - 1) {
-			pkt_buf = avp_dev_translate_buffer(avp,
-							   avp_bufs[i + 1]);
-			rte_prefetch0(pkt_buf);
-		}
+	/* keep any buffers that could not be wrapped for the next call */
+	while (i < count)
+		ring->stash[ring->nb_stash++] = avp_bufs[i++];
 
-		/* process each packet to be transmitted */
-		m = tx_pkts[i];
+	return n;
+}
+#else
+int
+rte_pmd_avp_tx_buf_alloc(uint8_t port_id __rte_unused,
+			 uint16_t queue_id __rte_unused,
+			 struct rte_mbuf **mbufs __rte_unused,
+			 unsigned int n __rte_unused)
+{
+	return -ENOTSUP;
+}
+#endif
 
-		/* Adjust pointers for guest addressing */
-		pkt_buf = avp_dev_translate_buffer(avp, avp_bufs[i]);
-		pkt_data = avp_dev_translate_buffer(avp, pkt_buf->data);
-		pkt_len = rte_pktmbuf_pkt_len(m);
+/* locate a receive queue of an AVP port for the public API */
+static int
+avp_dev_rx_queue_lookup(uint8_t port_id, uint16_t queue_id,
+			struct rte_eth_dev **eth_dev, struct avp_queue **rxq)
+{
+	if (!rte_eth_dev_is_valid_port(port_id))
+		return -ENODEV;
 
-		if (unlikely((pkt_len > avp->guest_mbuf_size) ||
-					 (pkt_len > avp->host_mbuf_size))) {
-			/*
-			 * application should be using the scattered transmit
-			 * function; send it truncated to avoid the performance
-			 * hit of having to manage returning the already
-			 * allocated buffer to the free list.  This should not
-			 * happen since the application should have set the
-			 * max_rx_pkt_len based on its MTU and it should be
-			 * policing its own packet sizes.
-			 */
-			txq->errors++;
-			pkt_len = RTE_MIN(avp->guest_mbuf_size,
-					  avp->host_mbuf_size);
-		}
+	*eth_dev = &rte_eth_devices[port_id];
+	if ((*eth_dev)->dev_ops != &avp_eth_dev_ops)
+		return -ENOTSUP;
 
-		/* copy data out of our mbuf and into the AVP buffer */
-		rte_memcpy(pkt_data, rte_pktmbuf_mtod(m, void *), pkt_len);
-		pkt_buf->pkt_len = pkt_len;
-		pkt_buf->data_len = pkt_len;
-		pkt_buf->nb_segs = 1;
-		pkt_buf->next = NULL;
+	if (queue_id >= (*eth_dev)->data->nb_rx_queues)
+		return -EINVAL;
 
-		if (m->ol_flags & PKT_TX_VLAN_PKT) {
-			pkt_buf->ol_flags |= RTE_AVP_TX_VLAN_PKT;
-			pkt_buf->vlan_tci = rte_pktmbuf_vlan_tci(m);
-		}
+	*rxq = (*eth_dev)->data->rx_queues[queue_id];
+	if (*rxq == NULL)
+		return -EINVAL;
 
-		tx_bytes += pkt_len;
+	return 0;
+}
 
-		/* free the original mbuf */
-		rte_pktmbuf_free(m);
-	}
+int
+rte_pmd_avp_rx_gro_set(uint8_t port_id, uint16_t queue_id, int on)
+{
+	struct rte_eth_dev *eth_dev;
+	struct avp_queue *rxq;
+	int ret;
 
-	txq->packets += count;
-	txq->bytes += tx_bytes;
+	ret = avp_dev_rx_queue_lookup(port_id, queue_id, &eth_dev, &rxq);
+	if (ret < 0)
+		return ret;
 
-	/* send the packets */
-	n = avp_fifo_put(tx_q, (void **)&avp_bufs[0], count);
+	rxq->gro = (on != 0);
+	avp_dev_set_burst_functions(eth_dev);
 
-	return n;
+	PMD_DRV_LOG(DEBUG, "AVP receive coalescing %s on port %u queue %u\n",
+		    rxq->gro ? "enabled" : "disabled", port_id, queue_id);
+
+	return 0;
+}
+
+int
+rte_pmd_avp_rx_gro_stats_get(uint8_t port_id, uint16_t queue_id,
+			     struct rte_pmd_avp_gro_stats *stats)
+{
+	struct rte_eth_dev *eth_dev;
+	struct avp_queue *rxq;
+	int ret;
+
+	if (stats == NULL)
+		return -EINVAL;
+
+	ret = avp_dev_rx_queue_lookup(port_id, queue_id, &eth_dev, &rxq);
+	if (ret < 0)
+		return ret;
+
+	stats->segments = rxq->gro_segments;
+	stats->merged = rxq->gro_merged;
+
+	return 0;
+}
+
+/* locate a transmit queue of an AVP port for the public API */
+static int
+avp_dev_tx_queue_lookup(uint8_t port_id, uint16_t queue_id,
+			struct rte_eth_dev **eth_dev, struct avp_queue **txq)
+{
+	if (!rte_eth_dev_is_valid_port(port_id))
+		return -ENODEV;
+
+	*eth_dev = &rte_eth_devices[port_id];
+	if ((*eth_dev)->dev_ops != &avp_eth_dev_ops)
+		return -ENOTSUP;
+
+	if (queue_id >= (*eth_dev)->data->nb_tx_queues)
+		return -EINVAL;
+
+	*txq = (*eth_dev)->data->tx_queues[queue_id];
+	if (*txq == NULL)
+		return -EINVAL;
+
+	return 0;
+}
+
+int
+rte_pmd_avp_rx_stage_stats_get(uint8_t port_id, uint16_t queue_id,
+			       struct rte_pmd_avp_stage_stats *stats)
+{
+	struct rte_eth_dev *eth_dev;
+	struct avp_queue *rxq;
+	int ret;
+
+	if (stats == NULL)
+		return -EINVAL;
+
+	ret = avp_dev_rx_queue_lookup(port_id, queue_id, &eth_dev, &rxq);
+	if (ret < 0)
+		return ret;
+
+#ifdef RTE_LIBRTE_AVP_STAGE_CYCLES
+	*stats = rxq->stages;
+	return 0;
+#else
+	return -ENOTSUP;
+#endif
+}
+
+int
+rte_pmd_avp_tx_stage_stats_get(uint8_t port_id, uint16_t queue_id,
+			       struct rte_pmd_avp_stage_stats *stats)
+{
+	struct rte_eth_dev *eth_dev;
+	struct avp_queue *txq;
+	int ret;
+
+	if (stats == NULL)
+		return -EINVAL;
+
+	ret = avp_dev_tx_queue_lookup(port_id, queue_id, &eth_dev, &txq);
+	if (ret < 0)
+		return ret;
+
+#ifdef RTE_LIBRTE_AVP_STAGE_CYCLES
+	*stats = txq->stages;
+	return 0;
+#else
+	return -ENOTSUP;
+#endif
 }
 
 static void
@@ -2100,6 +7057,16 @@ avp_dev_rx_queue_release(void *rx_queue)
 		if (data->rx_queues[i] == rxq)
 			data->rx_queues[i] = NULL;
 	}
+
+	/* release any mbufs allocated in advance of being received */
+	for (i = 0; i < rxq->nb_mbufs; i++)
+		rte_pktmbuf_free(rxq->mbufs[i]);
+	rxq->nb_mbufs = 0;
+
+#ifdef AVP_ZERO_COPY
+	if (rxq->zc != NULL)
+		avp_dev_zc_ring_free(rxq, 1);
+#endif
 }
 
 static void
@@ -2110,10 +7077,21 @@ avp_dev_tx_queue_release(void *tx_queue)
 	struct rte_eth_dev_data *data = avp->dev_data;
 	unsigned int i;
 
-	for (i = 0; i < avp->num_tx_queues; i++) {
+	for (i = 0; i < data->nb_tx_queues; i++) {
 		if (data->tx_queues[i] == txq)
 			data->tx_queues[i] = NULL;
 	}
+
+	if (txq->hold != NULL) {
+		/* packets still held can no longer be sent */
+		avp_dev_tx_hold_free(txq->hold);
+		txq->hold = NULL;
+	}
+
+#ifdef AVP_ZERO_COPY
+	if (txq->zc != NULL)
+		avp_dev_zc_ring_free(txq, 0);
+#endif
 }
 
 static int
@@ -2145,6 +7123,20 @@ avp_dev_configure(struct rte_eth_dev *eth_dev)
 		ETH_VLAN_EXTEND_MASK);
 	avp_vlan_offload_set(eth_dev, mask);
 
+	avp_dev_rss_configure(eth_dev);
+	avp_dev_inline_negotiate(eth_dev);
+	avp_dev_offload_negotiate(eth_dev);
+	avp_dev_rx_intr_negotiate(eth_dev);
+
+#ifdef AVP_RX_INTR
+	if (eth_dev->data->dev_conf.intr_conf.rxq &&
+	    !(avp->features & RTE_AVP_FEATURE_RX_INTR)) {
+		PMD_DRV_LOG(ERR, "Receive queue interrupts not supported by host\n");
+		ret = -ENOTSUP;
+		goto unlock;
+	}
+#endif
+
 	/* update device config */
 	memset(&config, 0, sizeof(config));
 	config.device_id = host_info->device_id;
@@ -2161,6 +7153,10 @@ avp_dev_configure(struct rte_eth_dev *eth_dev)
 		goto unlock;
 	}
 
+	ret = avp_dev_rss_apply(eth_dev);
+	if (ret < 0)
+		goto unlock;
+
 	avp->flags |= AVP_F_CONFIGURED;
 	ret = 0;
 
@@ -2183,22 +7179,46 @@ avp_dev_start(struct rte_eth_dev *eth_dev)
 	}
 
 	/* disable features that we do not support */
-	eth_dev->data->dev_conf.rxmode.hw_ip_checksum = 0;
+	if (!(avp->features & RTE_AVP_FEATURE_RX_CSUM))
+		eth_dev->data->dev_conf.rxmode.hw_ip_checksum = 0;
 	eth_dev->data->dev_conf.rxmode.hw_vlan_filter = 0;
 	eth_dev->data->dev_conf.rxmode.hw_vlan_extend = 0;
 	eth_dev->data->dev_conf.rxmode.hw_strip_crc = 0;
 
+	/* specialize the burst functions for the final configuration */
+	avp_dev_set_burst_functions(eth_dev);
+
+#ifdef AVP_TX_MP
+	/* the host fifos may have been used before the port was started */
+	avp_dev_tx_mp_reset(avp);
+#endif
+
+#ifdef AVP_RX_INTR
+	if (eth_dev->data->dev_conf.intr_conf.rxq) {
+		ret = avp_dev_rx_intr_setup(eth_dev);
+		if (ret < 0)
+			goto unlock;
+	}
+#endif
+
 	/* update link state */
 	ret = avp_dev_ctrl_set_link_state(eth_dev, 1);
 	if (ret < 0) {
 		PMD_DRV_LOG(ERR, "Link state change failed by host, ret=%d\n",
 			    ret);
+#ifdef AVP_RX_INTR
+		avp_dev_rx_intr_teardown(eth_dev);
+#endif
 		goto unlock;
 	}
 
 	/* remember current link state */
 	avp->flags |= AVP_F_LINKUP;
 
+#ifdef AVP_TELEMETRY
+	avp_dev_telemetry_start(eth_dev);
+#endif
+
 	ret = 0;
 
 unlock:
@@ -2228,6 +7248,16 @@ avp_dev_stop(struct rte_eth_dev *eth_dev)
 			    ret);
 	}
 
+#ifdef AVP_RX_INTR
+	avp_dev_rx_intr_teardown(eth_dev);
+#endif
+
+#ifdef AVP_TELEMETRY
+	/* publish the final state; the queues may be released from now on */
+	avp_dev_telemetry_stop(eth_dev);
+	avp_dev_telemetry_update(eth_dev);
+#endif
+
 unlock:
 	rte_spinlock_unlock(&avp->lock);
 }
@@ -2248,6 +7278,15 @@ avp_dev_close(struct rte_eth_dev *eth_dev)
 	avp->flags &= ~AVP_F_LINKUP;
 	avp->flags &= ~AVP_F_CONFIGURED;
 
+#ifdef AVP_RX_INTR
+	avp_dev_rx_intr_teardown(eth_dev);
+#endif
+
+#ifdef AVP_TELEMETRY
+	avp_dev_telemetry_stop(eth_dev);
+	avp_dev_telemetry_update(eth_dev);
+#endif
+
 	ret = avp_dev_disable_interrupts(eth_dev);
 	if (ret < 0) {
 		PMD_DRV_LOG(ERR, "Failed to disable interrupts\n");
@@ -2262,6 +7301,13 @@ avp_dev_close(struct rte_eth_dev *eth_dev)
 		/* continue */
 	}
 
+	/*
+	 * The receive functions of secondary processes may still be running
+	 * so the state is only freed when the device is released.
+	 */
+	if (avp->rss != NULL)
+		avp_dev_rss_publish(avp, NULL);
+
 unlock:
 	rte_spinlock_unlock(&avp->lock);
 }
@@ -2294,6 +7340,7 @@ avp_dev_promiscuous_enable(struct rte_eth_dev *eth_dev)
 		avp->flags |= AVP_F_PROMISC;
 		PMD_DRV_LOG(DEBUG, "Promiscuous mode enabled on %u\n",
 			    eth_dev->data->port_id);
+		avp_dev_set_burst_functions(eth_dev);
 	}
 	rte_spinlock_unlock(&avp->lock);
 }
@@ -2308,8 +7355,268 @@ avp_dev_promiscuous_disable(struct rte_eth_dev *eth_dev)
 		avp->flags &= ~AVP_F_PROMISC;
 		PMD_DRV_LOG(DEBUG, "Promiscuous mode disabled on %u\n",
 			    eth_dev->data->port_id);
+		avp_dev_set_burst_functions(eth_dev);
+	}
+	rte_spinlock_unlock(&avp->lock);
+}
+
+static void
+avp_dev_allmulticast_enable(struct rte_eth_dev *eth_dev)
+{
+	struct avp_dev *avp = AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
+
+	rte_spinlock_lock(&avp->lock);
+	if ((avp->flags & AVP_F_ALLMULTI) == 0) {
+		avp->flags |= AVP_F_ALLMULTI;
+		PMD_DRV_LOG(DEBUG, "All-multicast mode enabled on %u\n",
+			    eth_dev->data->port_id);
+	}
+	rte_spinlock_unlock(&avp->lock);
+}
+
+static void
+avp_dev_allmulticast_disable(struct rte_eth_dev *eth_dev)
+{
+	struct avp_dev *avp = AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
+
+	rte_spinlock_lock(&avp->lock);
+	if ((avp->flags & AVP_F_ALLMULTI) != 0) {
+		avp->flags &= ~AVP_F_ALLMULTI;
+		PMD_DRV_LOG(DEBUG, "All-multicast mode disabled on %u\n",
+			    eth_dev->data->port_id);
+	}
+	rte_spinlock_unlock(&avp->lock);
+}
+
+/*
+ * The host delivers all packets that are sent to the port therefore additional
+ * unicast addresses are filtered in software by the receive functions.
+ */
+#if RTE_VERSION >= RTE_VERSION_NUM(17, 5, 0, 0)
+static int
+#else
+static void
+#endif
+avp_dev_mac_addr_add(struct rte_eth_dev *eth_dev,
+		     struct ether_addr *mac_addr,
+		     uint32_t index, __rte_unused uint32_t vmdq)
+{
+	struct avp_dev *avp = AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
+	int ret = 0;
+
+	if ((index == 0) || (index >= AVP_MAX_MAC_ADDRS) ||
+	    !is_unicast_ether_addr(mac_addr)) {
+		PMD_DRV_LOG(ERR, "Invalid MAC address index %u on %u\n",
+			    index, eth_dev->data->port_id);
+		ret = -EINVAL;
+		goto done;
+	}
+
+	rte_spinlock_lock(&avp->lock);
+	ether_addr_copy(mac_addr, &avp->mac_addrs[index]);
+	rte_wmb();
+	avp->mac_addr_mask |= (1 << index);
+	rte_spinlock_unlock(&avp->lock);
+
+	PMD_DRV_LOG(DEBUG, "MAC address %u added on %u\n",
+		    index, eth_dev->data->port_id);
+
+done:
+#if RTE_VERSION >= RTE_VERSION_NUM(17, 5, 0, 0)
+	return ret;
+#else
+	RTE_SET_USED(ret);
+#endif
+}
+
+static void
+avp_dev_mac_addr_remove(struct rte_eth_dev *eth_dev, uint32_t index)
+{
+	struct avp_dev *avp = AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
+
+	if (index >= AVP_MAX_MAC_ADDRS)
+		return;
+
+	rte_spinlock_lock(&avp->lock);
+	avp->mac_addr_mask &= ~(1 << index);
+	rte_spinlock_unlock(&avp->lock);
+
+	PMD_DRV_LOG(DEBUG, "MAC address %u removed on %u\n",
+		    index, eth_dev->data->port_id);
+}
+
+/*
+ * Multicast addresses are added to a hash filter which may accept a small
+ * number of packets destined to other groups; the application remains
+ * responsible for discarding those.  An empty list accepts all multicast.
+ */
+static int
+avp_dev_set_mc_addr_list(struct rte_eth_dev *eth_dev,
+			 struct ether_addr *mc_addr_set,
+			 uint32_t nb_mc_addr)
+{
+	struct avp_dev *avp = AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
+	uint64_t mc_hash[AVP_MC_HASH_SIZE / 64];
+	unsigned int hash;
+	uint32_t i;
+
+	memset(mc_hash, 0, sizeof(mc_hash));
+	for (i = 0; i < nb_mc_addr; i++) {
+		if (!is_multicast_ether_addr(&mc_addr_set[i])) {
+			PMD_DRV_LOG(ERR, "Invalid multicast address %u on %u\n",
+				    i, eth_dev->data->port_id);
+			return -EINVAL;
+		}
+
+		hash = _avp_mc_hash(&mc_addr_set[i]);
+		mc_hash[hash / 64] |= (1ULL << (hash % 64));
+	}
+
+	rte_spinlock_lock(&avp->lock);
+	memcpy(avp->mc_hash, mc_hash, sizeof(avp->mc_hash));
+	rte_wmb();
+	avp->nb_mc_addrs = nb_mc_addr;
+	rte_spinlock_unlock(&avp->lock);
+
+	PMD_DRV_LOG(DEBUG, "%u multicast addresses set on %u\n",
+		    nb_mc_addr, eth_dev->data->port_id);
+
+	return 0;
+}
+
+static int
+avp_dev_reta_update(struct rte_eth_dev *eth_dev,
+		    struct rte_eth_rss_reta_entry64 *reta_conf,
+		    uint16_t reta_size)
+{
+	struct avp_dev *avp = AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
+	uint16_t nb_rx_queues = eth_dev->data->nb_rx_queues;
+	unsigned int idx, shift;
+	unsigned int i;
+	int ret;
+
+	rte_spinlock_lock(&avp->lock);
+	if (avp->flags & AVP_F_DETACHED) {
+		PMD_DRV_LOG(ERR, "Operation not supported during VM live migration\n");
+		ret = -ENOTSUP;
+		goto unlock;
+	}
+
+	if (reta_size != RTE_AVP_RSS_RETA_SIZE) {
+		PMD_DRV_LOG(ERR, "Invalid RETA size %u, expected %u\n",
+			    reta_size, RTE_AVP_RSS_RETA_SIZE);
+		ret = -EINVAL;
+		goto unlock;
+	}
+
+	for (i = 0; i < reta_size; i++) {
+		idx = i / RTE_RETA_GROUP_SIZE;
+		shift = i % RTE_RETA_GROUP_SIZE;
+		if (((reta_conf[idx].mask >> shift) & 1) &&
+		    (reta_conf[idx].reta[shift] >= nb_rx_queues)) {
+			PMD_DRV_LOG(ERR, "Invalid RETA queue %u at %u\n",
+				    reta_conf[idx].reta[shift], i);
+			ret = -EINVAL;
+			goto unlock;
+		}
+	}
+
+	for (i = 0; i < reta_size; i++) {
+		idx = i / RTE_RETA_GROUP_SIZE;
+		shift = i % RTE_RETA_GROUP_SIZE;
+		if ((reta_conf[idx].mask >> shift) & 1)
+			avp->reta[i] = reta_conf[idx].reta[shift];
+	}
+
+	ret = 0;
+	if (avp->features & RTE_AVP_FEATURE_RSS)
+		ret = avp_dev_rss_apply(eth_dev);
+
+unlock:
+	rte_spinlock_unlock(&avp->lock);
+	return ret;
+}
+
+static int
+avp_dev_reta_query(struct rte_eth_dev *eth_dev,
+		   struct rte_eth_rss_reta_entry64 *reta_conf,
+		   uint16_t reta_size)
+{
+	struct avp_dev *avp = AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
+	unsigned int idx, shift;
+	unsigned int i;
+
+	if (reta_size != RTE_AVP_RSS_RETA_SIZE) {
+		PMD_DRV_LOG(ERR, "Invalid RETA size %u, expected %u\n",
+			    reta_size, RTE_AVP_RSS_RETA_SIZE);
+		return -EINVAL;
+	}
+
+	for (i = 0; i < reta_size; i++) {
+		idx = i / RTE_RETA_GROUP_SIZE;
+		shift = i % RTE_RETA_GROUP_SIZE;
+		if ((reta_conf[idx].mask >> shift) & 1)
+			reta_conf[idx].reta[shift] = avp->reta[i];
+	}
+
+	return 0;
+}
+
+static int
+avp_dev_rss_hash_update(struct rte_eth_dev *eth_dev,
+			struct rte_eth_rss_conf *rss_conf)
+{
+	struct avp_dev *avp = AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
+	int ret;
+
+	rte_spinlock_lock(&avp->lock);
+	if (avp->flags & AVP_F_DETACHED) {
+		PMD_DRV_LOG(ERR, "Operation not supported during VM live migration\n");
+		ret = -ENOTSUP;
+		goto unlock;
+	}
+
+	if ((rss_conf->rss_key != NULL) &&
+	    (rss_conf->rss_key_len != RTE_AVP_RSS_KEY_SIZE)) {
+		PMD_DRV_LOG(ERR, "Invalid RSS key length %u, expected %u\n",
+			    rss_conf->rss_key_len, RTE_AVP_RSS_KEY_SIZE);
+		ret = -EINVAL;
+		goto unlock;
 	}
+
+	if (rss_conf->rss_hf & ~AVP_RSS_OFFLOAD_ALL) {
+		PMD_DRV_LOG(ERR, "Unsupported RSS hash functions 0x%" PRIx64 "\n",
+			    rss_conf->rss_hf);
+		ret = -EINVAL;
+		goto unlock;
+	}
+
+	if (rss_conf->rss_key != NULL)
+		memcpy(avp->rss_key, rss_conf->rss_key, RTE_AVP_RSS_KEY_SIZE);
+	avp->rss_hash_types = _avp_rss_hf_to_types(rss_conf->rss_hf);
+
+	ret = 0;
+	if (avp->flags & AVP_F_CONFIGURED)
+		ret = avp_dev_rss_apply(eth_dev);
+
+unlock:
 	rte_spinlock_unlock(&avp->lock);
+	return ret;
+}
+
+static int
+avp_dev_rss_hash_conf_get(struct rte_eth_dev *eth_dev,
+			  struct rte_eth_rss_conf *rss_conf)
+{
+	struct avp_dev *avp = AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
+
+	if (rss_conf->rss_key != NULL) {
+		memcpy(rss_conf->rss_key, avp->rss_key, RTE_AVP_RSS_KEY_SIZE);
+		rss_conf->rss_key_len = RTE_AVP_RSS_KEY_SIZE;
+	}
+	rss_conf->rss_hf = _avp_rss_types_to_hf(avp->rss_hash_types);
+
+	return 0;
 }
 
 static void
@@ -2328,14 +7635,33 @@ avp_dev_info_get(struct rte_eth_dev *eth_dev,
 #endif
 	dev_info->max_rx_queues = avp->max_rx_queues;
 	dev_info->max_tx_queues = avp->max_tx_queues;
+#ifdef AVP_TX_MP
+	if (avp->options & AVP_OPT_TX_MP)
+		dev_info->max_tx_queues = AVP_TX_MP_MAX_QUEUES;
+#endif
 	dev_info->min_rx_bufsize = AVP_MIN_RX_BUFSIZE;
 	dev_info->max_rx_pktlen = avp->max_rx_pkt_len;
 	dev_info->max_mac_addrs = AVP_MAX_MAC_ADDRS;
+#if RTE_VERSION >= RTE_VERSION_NUM(2, 2, 0, 0)
+	dev_info->reta_size = RTE_AVP_RSS_RETA_SIZE;
+	dev_info->hash_key_size = RTE_AVP_RSS_KEY_SIZE;
+	dev_info->flow_type_rss_offloads = AVP_RSS_OFFLOAD_ALL;
+#endif
 #if RTE_VERSION >= RTE_VERSION_NUM(1, 7, 0, 0)
 	if (avp->host_features & RTE_AVP_FEATURE_VLAN_OFFLOAD) {
 		dev_info->rx_offload_capa = DEV_RX_OFFLOAD_VLAN_STRIP;
 		dev_info->tx_offload_capa = DEV_TX_OFFLOAD_VLAN_INSERT;
 	}
+	if (avp->host_features & RTE_AVP_FEATURE_RX_CSUM)
+		dev_info->rx_offload_capa |= (DEV_RX_OFFLOAD_IPV4_CKSUM |
+					      DEV_RX_OFFLOAD_UDP_CKSUM |
+					      DEV_RX_OFFLOAD_TCP_CKSUM);
+	if (avp->host_features & RTE_AVP_FEATURE_TX_CSUM)
+		dev_info->tx_offload_capa |= (DEV_TX_OFFLOAD_IPV4_CKSUM |
+					      DEV_TX_OFFLOAD_UDP_CKSUM |
+					      DEV_TX_OFFLOAD_TCP_CKSUM);
+	if (avp->host_features & RTE_AVP_FEATURE_TSO)
+		dev_info->tx_offload_capa |= DEV_TX_OFFLOAD_TCP_TSO;
 #endif
 }
 
@@ -2350,6 +7676,7 @@ avp_vlan_offload_set(struct rte_eth_dev *eth_dev, int mask)
 				avp->features |= RTE_AVP_FEATURE_VLAN_OFFLOAD;
 			else
 				avp->features &= ~RTE_AVP_FEATURE_VLAN_OFFLOAD;
+			avp_dev_set_burst_functions(eth_dev);
 		} else {
 			PMD_DRV_LOG(ERR, "VLAN strip offload not supported\n");
 		}
@@ -2386,7 +7713,8 @@ avp_dev_stats_get(struct rte_eth_dev *eth_dev, struct rte_eth_stats *stats)
 		}
 	}
 
-	for (i = 0; i < avp->num_tx_queues; i++) {
+	/* there may be more transmit queues than host fifos (tx_mp) */
+	for (i = 0; i < avp->dev_data->nb_tx_queues; i++) {
 		struct avp_queue *txq = avp->dev_data->tx_queues[i];
 
 		if (txq) {
@@ -2394,6 +7722,8 @@ avp_dev_stats_get(struct rte_eth_dev *eth_dev, struct rte_eth_stats *stats)
 			stats->obytes += txq->bytes;
 			stats->oerrors += txq->errors;
 
+			if (i >= RTE_ETHDEV_QUEUE_STAT_CNTRS)
+				continue;
 			stats->q_opackets[i] += txq->packets;
 			stats->q_obytes[i] += txq->bytes;
 			stats->q_errors[i] += txq->errors;
@@ -2414,20 +7744,240 @@ avp_dev_stats_reset(struct rte_eth_dev *eth_dev)
 			rxq->bytes = 0;
 			rxq->packets = 0;
 			rxq->errors = 0;
+			rxq->gro_segments = 0;
+			rxq->gro_merged = 0;
+			memset(&rxq->stages, 0, sizeof(rxq->stages));
+			avp_dev_queue_xstats_reset(rxq);
 		}
 	}
 
-	for (i = 0; i < avp->num_tx_queues; i++) {
+	for (i = 0; i < avp->dev_data->nb_tx_queues; i++) {
 		struct avp_queue *txq = avp->dev_data->tx_queues[i];
 
 		if (txq) {
 			txq->bytes = 0;
 			txq->packets = 0;
 			txq->errors = 0;
+			txq->held = 0;
+			txq->flushed = 0;
+			txq->overflows = 0;
+			memset(&txq->stages, 0, sizeof(txq->stages));
+			avp_dev_queue_xstats_reset(txq);
 		}
 	}
 }
 
+#ifdef AVP_XSTATS
+/* Extended statistic located at an offset within a queue */
+struct avp_xstats_name_off {
+	const char *name;
+	unsigned int offset;
+};
+
+static const struct avp_xstats_name_off avp_rxq_xstats[] = {
+	{"filtered_packets", offsetof(struct avp_queue, xstats.filtered)},
+	{"oversized_errors", offsetof(struct avp_queue, xstats.oversized)},
+	{"mbuf_allocation_errors", offsetof(struct avp_queue, xstats.nombuf)},
+	{"bad_address_errors", offsetof(struct avp_queue, xstats.bad_address)},
+	{"fifo_full_events", offsetof(struct avp_queue, xstats.fifo_full)},
+	{"gro_segments", offsetof(struct avp_queue, gro_segments)},
+	{"gro_merged_packets", offsetof(struct avp_queue, gro_merged)},
+};
+
+static const struct avp_xstats_name_off avp_txq_xstats[] = {
+	{"fifo_full_errors", offsetof(struct avp_queue, xstats.fifo_full)},
+	{"no_buffer_errors", offsetof(struct avp_queue, xstats.nobuf)},
+	{"oversized_errors", offsetof(struct avp_queue, xstats.oversized)},
+	{"detached_errors", offsetof(struct avp_queue, xstats.detached)},
+	{"bad_address_errors", offsetof(struct avp_queue, xstats.bad_address)},
+	{"held_packets", offsetof(struct avp_queue, held)},
+	{"flushed_packets", offsetof(struct avp_queue, flushed)},
+	{"hold_overflow_errors", offsetof(struct avp_queue, overflows)},
+};
+
+static const char * const avp_burst_xstats[AVP_BURST_BUCKETS] = {
+	"bursts_size_1", "bursts_size_2_3", "bursts_size_4_7",
+	"bursts_size_8_15", "bursts_size_16_31", "bursts_size_32_63",
+	"bursts_size_64_plus",
+};
+
+/* fifo the queue consumes from, then the fifo it produces to */
+static const char * const avp_rxq_fifo_xstats[2] = {
+	"rx_fifo_high_watermark", "free_fifo_high_watermark",
+};
+
+static const char * const avp_txq_fifo_xstats[2] = {
+	"alloc_fifo_high_watermark", "tx_fifo_high_watermark",
+};
+
+static const char * const avp_dev_xstats_names[] = {
+	"migration_detaches", "migration_attaches",
+	"migration_blackout_us", "migration_max_blackout_us",
+};
+
+#define AVP_QUEUE_XSTATS(table) \
+	(RTE_DIM(table) + AVP_BURST_BUCKETS + RTE_DIM(avp_rxq_fifo_xstats))
+
+static unsigned int
+avp_dev_xstats_count(struct rte_eth_dev *eth_dev)
+{
+	return RTE_DIM(avp_dev_xstats_names) +
+		(eth_dev->data->nb_rx_queues *
+		 AVP_QUEUE_XSTATS(avp_rxq_xstats)) +
+		(eth_dev->data->nb_tx_queues *
+		 AVP_QUEUE_XSTATS(avp_txq_xstats));
+}
+
+static unsigned int
+avp_dev_queue_xstats_names(struct rte_eth_xstat_name *names, unsigned int k,
+			   const char *dir, unsigned int queue_id,
+			   const struct avp_xstats_name_off *table,
+			   unsigned int size, const char * const *fifo_names)
+{
+	unsigned int i;
+
+	for (i = 0; i < size; i++)
+		snprintf(names[k++].name, sizeof(names[0].name), "%s_q%u_%s",
+			 dir, queue_id, table[i].name);
+	for (i = 0; i < AVP_BURST_BUCKETS; i++)
+		snprintf(names[k++].name, sizeof(names[0].name), "%s_q%u_%s",
+			 dir, queue_id, avp_burst_xstats[i]);
+	for (i = 0; i < RTE_DIM(avp_rxq_fifo_xstats); i++)
+		snprintf(names[k++].name, sizeof(names[0].name), "%s_q%u_%s",
+			 dir, queue_id, fifo_names[i]);
+
+	return k;
+}
+
+static int
+avp_dev_xstats_get_names(struct rte_eth_dev *eth_dev,
+			 struct rte_eth_xstat_name *names,
+			 unsigned int limit)
+{
+	unsigned int count = avp_dev_xstats_count(eth_dev);
+	unsigned int i, k;
+
+	if ((names == NULL) || (limit < count))
+		return count;
+
+	for (k = 0; k < RTE_DIM(avp_dev_xstats_names); k++)
+		snprintf(names[k].name, sizeof(names[0].name), "%s",
+			 avp_dev_xstats_names[k]);
+
+	for (i = 0; i < eth_dev->data->nb_rx_queues; i++)
+		k = avp_dev_queue_xstats_names(names, k, "rx", i,
+					       avp_rxq_xstats,
+					       RTE_DIM(avp_rxq_xstats),
+					       avp_rxq_fifo_xstats);
+
+	for (i = 0; i < eth_dev->data->nb_tx_queues; i++)
+		k = avp_dev_queue_xstats_names(names, k, "tx", i,
+					       avp_txq_xstats,
+					       RTE_DIM(avp_txq_xstats),
+					       avp_txq_fifo_xstats);
+
+	return k;
+}
+
+/* occupancy of a fifo given the fewest free slots seen by a queue */
+static uint64_t
+avp_dev_fifo_high_watermark(struct avp_dev *avp, struct rte_avp_fifo *fifo,
+			    uint64_t min_free)
+{
+	unsigned int len;
+
+	if ((fifo == NULL) || (min_free == UINT64_MAX) ||
+	    (avp->flags & AVP_F_DETACHED))
+		return 0;
+
+	len = avp_dev_fifo_len(avp, fifo);
+	return (min_free < len) ? (len - 1 - min_free) : 0;
+}
+
+static unsigned int
+avp_dev_queue_xstats_get(struct avp_dev *avp, struct avp_queue *q,
+			 struct rte_avp_fifo *fifo, struct rte_eth_xstat *xstats,
+			 unsigned int k, const struct avp_xstats_name_off *table,
+			 unsigned int size)
+{
+	unsigned int i;
+
+	if (q == NULL) {
+		/* the queue has not been set up */
+		for (i = 0; i < size + AVP_BURST_BUCKETS + 2; i++)
+			xstats[k++].value = 0;
+		return k;
+	}
+
+	for (i = 0; i < size; i++)
+		xstats[k++].value =
+			*(const uint64_t *)RTE_PTR_ADD(q, table[i].offset);
+	for (i = 0; i < AVP_BURST_BUCKETS; i++)
+		xstats[k++].value = q->xstats.bursts[i];
+	xstats[k++].value = q->xstats.fifo_max;
+	xstats[k++].value = avp_dev_fifo_high_watermark(avp, fifo,
+						q->xstats.fifo_min_free);
+
+	return k;
+}
+
+static int
+avp_dev_xstats_get(struct rte_eth_dev *eth_dev, struct rte_eth_xstat *xstats,
+		   unsigned int n)
+{
+	struct avp_dev *avp = AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
+	unsigned int count = avp_dev_xstats_count(eth_dev);
+	uint64_t cycles_per_us;
+	struct avp_queue *q;
+	unsigned int i, k;
+
+	if ((xstats == NULL) || (n < count))
+		return count;
+
+	cycles_per_us = RTE_MAX(rte_get_tsc_hz() / US_PER_S, UINT64_C(1));
+
+	k = 0;
+	xstats[k++].value = avp->detaches;
+	xstats[k++].value = avp->attaches;
+	xstats[k++].value = avp->blackout_cycles / cycles_per_us;
+	xstats[k++].value = avp->blackout_max / cycles_per_us;
+
+	for (i = 0; i < eth_dev->data->nb_rx_queues; i++) {
+		q = eth_dev->data->rx_queues[i];
+		k = avp_dev_queue_xstats_get(avp, q,
+					     q ? avp->free_q[q->queue_base] :
+					     NULL, xstats, k, avp_rxq_xstats,
+					     RTE_DIM(avp_rxq_xstats));
+	}
+
+	for (i = 0; i < eth_dev->data->nb_tx_queues; i++) {
+		q = eth_dev->data->tx_queues[i];
+		k = avp_dev_queue_xstats_get(avp, q,
+					     q ? avp->tx_q[q->queue_id] : NULL,
+					     xstats, k, avp_txq_xstats,
+					     RTE_DIM(avp_txq_xstats));
+	}
+
+	for (i = 0; i < k; i++)
+		xstats[i].id = i;
+
+	return k;
+}
+
+static void
+avp_dev_xstats_reset(struct rte_eth_dev *eth_dev)
+{
+	struct avp_dev *avp = AVP_DEV_PRIVATE_TO_HW(eth_dev->data->dev_private);
+
+	avp_dev_stats_reset(eth_dev);
+
+	avp->detaches = 0;
+	avp->attaches = 0;
+	avp->blackout_cycles = 0;
+	avp->blackout_max = 0;
+}
+#endif
+
 #if RTE_VERSION < RTE_VERSION_NUM(16, 11, 0, 0)
 #if RTE_VERSION >= RTE_VERSION_NUM(1, 7, 0, 0)
 static struct rte_driver rte_avp_driver = {
@@ -2446,4 +7996,14 @@ PMD_REGISTER_DRIVER(rte_avp_driver);
 #else /* < v16.11 */
 RTE_PMD_REGISTER_PCI(rte_avp, rte_avp_pmd.pci_drv);
 RTE_PMD_REGISTER_PCI_TABLE(rte_avp, pci_id_avp_map);
+#ifdef AVP_DEVARGS
+RTE_PMD_REGISTER_PARAM_STRING(rte_avp,
+			      AVP_ZERO_COPY_RX_ARG "=<0|1> "
+			      AVP_ZERO_COPY_TX_ARG "=<0|1> "
+			      AVP_RX_POLICY_ARG "=<rr|drain|weighted> "
+			      AVP_TX_HOLD_PKTS_ARG "=<packets> "
+			      AVP_TX_HOLD_BYTES_ARG "=<bytes> "
+			      AVP_TX_COPY_ARG "=<memcpy|stream|avx512> "
+			      AVP_RX_COPY_ARG "=<memcpy|stream|avx512>");
+#endif
 #endif
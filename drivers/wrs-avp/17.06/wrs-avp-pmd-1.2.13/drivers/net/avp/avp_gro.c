@@ -0,0 +1,406 @@
+/*
+ * BSD LICENSE
+ *
+ * Copyright (c) 2017, Wind River Systems, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1) Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2) Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3) Neither the name of Wind River Systems nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdint.h>
+#include <string.h>
+
+#include <rte_byteorder.h>
+#include <rte_branch_prediction.h>
+#include <rte_mbuf.h>
+#include <rte_ether.h>
+#include <rte_ip.h>
+#include <rte_tcp.h>
+#include <rte_version.h>
+
+#include "avp_gro.h"
+
+/**@{ TCP header flags */
+#define AVP_GRO_TCP_PSH 0x08
+#define AVP_GRO_TCP_ACK 0x10
+/**@} */
+
+/* IPv4 version and header length of a header without options */
+#define AVP_GRO_IPV4_VERSION_IHL 0x45
+
+/*
+ * Headers of a TCP segment that is a candidate for coalescing
+ */
+struct avp_gro_seg {
+	struct ipv4_hdr *ipv4; /**< IPv4 header (NULL if IPv6) */
+	struct ipv6_hdr *ipv6; /**< IPv6 header (NULL if IPv4) */
+	struct tcp_hdr *tcp; /**< TCP header */
+	uint16_t hdr_len; /**< Length of the Ethernet, IP and TCP headers */
+	uint16_t ip_len; /**< IPv4 total length or IPv6 payload length */
+	uint16_t payload_len; /**< Length of the TCP payload */
+};
+
+/*
+ * A flow being coalesced within a burst
+ */
+struct avp_gro_flow {
+	struct rte_mbuf *head; /**< First packet of the flow (NULL if unused) */
+	struct rte_mbuf *last; /**< Last segment of the packet chain */
+	struct avp_gro_seg seg; /**< Headers of the first packet */
+	uint32_t next_seq; /**< Sequence number expected next */
+};
+
+/*
+ * Check the IP and TCP checksums of a segment unless the host has already
+ * validated them.  The checksum of a coalesced packet is not updated so each
+ * segment must be known to be valid before it is merged.
+ */
+static inline int
+avp_gro_cksum_valid(const struct rte_mbuf *m, const struct avp_gro_seg *seg)
+{
+	unsigned int l4_len;
+	uint32_t sum;
+
+#if RTE_VERSION >= RTE_VERSION_NUM(16, 11, 0, 0)
+	if (((m->ol_flags & PKT_RX_L4_CKSUM_MASK) == PKT_RX_L4_CKSUM_GOOD) &&
+	    ((seg->ipv4 == NULL) ||
+	     ((m->ol_flags & PKT_RX_IP_CKSUM_MASK) == PKT_RX_IP_CKSUM_GOOD)))
+		return 1;
+#endif
+
+	if (seg->ipv4 != NULL) {
+		if (rte_raw_cksum(seg->ipv4, sizeof(*seg->ipv4)) != 0xffff)
+			return 0;
+		sum = rte_ipv4_phdr_cksum(seg->ipv4, 0);
+		l4_len = seg->ip_len - sizeof(*seg->ipv4);
+	} else {
+		sum = rte_ipv6_phdr_cksum(seg->ipv6, 0);
+		l4_len = seg->ip_len;
+	}
+
+	sum += rte_raw_cksum(seg->tcp, l4_len);
+	sum = (sum & 0xffff) + (sum >> 16);
+	sum = (sum & 0xffff) + (sum >> 16);
+
+	return sum == 0xffff;
+}
+
+/*
+ * Locate the headers of a received packet.
+ *
+ * @return
+ *   0 if the packet is a TCP data segment that may be coalesced, 1 if it is
+ *   another TCP segment whose connection is known from seg, -1 otherwise.
+ */
+static inline int
+avp_gro_parse(const struct rte_mbuf *m, struct avp_gro_seg *seg)
+{
+	unsigned int len = rte_pktmbuf_data_len(m);
+	struct ether_hdr *eth;
+	unsigned int frame_len;
+	unsigned int l2_len;
+	unsigned int l3_len;
+	unsigned int l4_len;
+
+	eth = rte_pktmbuf_mtod(m, struct ether_hdr *);
+	l2_len = sizeof(*eth);
+
+	if (eth->ether_type == rte_cpu_to_be_16(ETHER_TYPE_IPv4)) {
+		if (unlikely(len < l2_len + sizeof(struct ipv4_hdr)))
+			return -1;
+
+		seg->ipv4 = (struct ipv4_hdr *)(eth + 1);
+		seg->ipv6 = NULL;
+
+		/* only the first fragment carries the TCP header */
+		l3_len = (seg->ipv4->version_ihl & 0x0f) * 4;
+		if ((l3_len < sizeof(struct ipv4_hdr)) ||
+		    (seg->ipv4->fragment_offset &
+		     rte_cpu_to_be_16(IPV4_HDR_OFFSET_MASK)) ||
+		    (seg->ipv4->next_proto_id != IPPROTO_TCP))
+			return -1;
+
+		seg->ip_len = rte_be_to_cpu_16(seg->ipv4->total_length);
+		frame_len = l2_len + seg->ip_len;
+
+	} else if (eth->ether_type == rte_cpu_to_be_16(ETHER_TYPE_IPv6)) {
+		l3_len = sizeof(struct ipv6_hdr);
+		if (unlikely(len < l2_len + l3_len))
+			return -1;
+
+		seg->ipv4 = NULL;
+		seg->ipv6 = (struct ipv6_hdr *)(eth + 1);
+
+		/* extension headers are not parsed */
+		if (seg->ipv6->proto != IPPROTO_TCP)
+			return -1;
+
+		seg->ip_len = rte_be_to_cpu_16(seg->ipv6->payload_len);
+		frame_len = l2_len + l3_len + seg->ip_len;
+
+	} else {
+		return -1;
+	}
+
+	if (len < l2_len + l3_len + sizeof(struct tcp_hdr))
+		return -1;
+
+	/* the connection is known from here on */
+	seg->tcp = (struct tcp_hdr *)((char *)eth + l2_len + l3_len);
+
+	if ((m->nb_segs != 1) ||
+	    (m->ol_flags & (PKT_RX_IP_CKSUM_BAD | PKT_RX_L4_CKSUM_BAD)))
+		return 1;
+
+	/* options and fragments are not coalesced */
+	if ((seg->ipv4 != NULL) &&
+	    ((seg->ipv4->version_ihl != AVP_GRO_IPV4_VERSION_IHL) ||
+	     (seg->ipv4->fragment_offset &
+	      rte_cpu_to_be_16(IPV4_HDR_MF_FLAG))))
+		return 1;
+
+	/* padded frames would carry the padding into the coalesced payload */
+	if (frame_len != len)
+		return 1;
+
+	l4_len = (seg->tcp->data_off >> 4) * 4;
+	if ((l4_len < sizeof(struct tcp_hdr)) ||
+	    (len <= l2_len + l3_len + l4_len))
+		return 1;
+
+	/* only plain data segments are coalesced */
+	if ((seg->tcp->tcp_flags & ~AVP_GRO_TCP_PSH) != AVP_GRO_TCP_ACK)
+		return 1;
+
+	seg->hdr_len = l2_len + l3_len + l4_len;
+	seg->payload_len = len - seg->hdr_len;
+
+	return avp_gro_cksum_valid(m, seg) ? 0 : 1;
+}
+
+/* check whether a segment belongs to the same connection as a flow */
+static inline int
+avp_gro_same_flow(const struct avp_gro_flow *flow, const struct rte_mbuf *m,
+		  const struct avp_gro_seg *seg)
+{
+	const struct avp_gro_seg *first = &flow->seg;
+	const struct rte_mbuf *head = flow->head;
+
+	if ((head->ol_flags ^ m->ol_flags) & PKT_RX_VLAN_PKT)
+		return 0;
+	if ((m->ol_flags & PKT_RX_VLAN_PKT) && (head->vlan_tci != m->vlan_tci))
+		return 0;
+
+	if (first->ipv4 != NULL) {
+		if ((seg->ipv4 == NULL) ||
+		    (first->ipv4->src_addr != seg->ipv4->src_addr) ||
+		    (first->ipv4->dst_addr != seg->ipv4->dst_addr))
+			return 0;
+	} else {
+		if ((seg->ipv6 == NULL) ||
+		    memcmp(first->ipv6->src_addr, seg->ipv6->src_addr,
+			   sizeof(seg->ipv6->src_addr) +
+			   sizeof(seg->ipv6->dst_addr)))
+			return 0;
+	}
+
+	return (first->tcp->src_port == seg->tcp->src_port) &&
+		(first->tcp->dst_port == seg->tcp->dst_port);
+}
+
+/*
+ * Check whether a segment of a flow directly follows the segments coalesced
+ * so far and carries the same headers apart from the sequence number, window
+ * and push flag.
+ */
+static inline int
+avp_gro_can_merge(const struct avp_gro_flow *flow,
+		  const struct avp_gro_seg *seg)
+{
+	const struct avp_gro_seg *first = &flow->seg;
+
+	if ((rte_be_to_cpu_32(seg->tcp->sent_seq) != flow->next_seq) ||
+	    (first->tcp->recv_ack != seg->tcp->recv_ack) ||
+	    (first->tcp->data_off != seg->tcp->data_off))
+		return 0;
+
+	if (first->ipv4 != NULL) {
+		if ((first->ipv4->type_of_service !=
+		     seg->ipv4->type_of_service) ||
+		    (first->ipv4->time_to_live != seg->ipv4->time_to_live))
+			return 0;
+	} else {
+		if ((first->ipv6->vtc_flow != seg->ipv6->vtc_flow) ||
+		    (first->ipv6->hop_limits != seg->ipv6->hop_limits))
+			return 0;
+	}
+
+	/* options such as timestamps must match those of the first segment */
+	if (memcmp(first->tcp + 1, seg->tcp + 1,
+		   ((seg->tcp->data_off >> 4) * 4) - sizeof(struct tcp_hdr)))
+		return 0;
+
+	return (flow->head->nb_segs < AVP_GRO_MAX_SEGMENTS) &&
+		((unsigned int)first->ip_len + seg->payload_len <= UINT16_MAX);
+}
+
+/* append the payload of a segment to the packet chain of a flow */
+static inline void
+avp_gro_merge(struct avp_gro_flow *flow, struct rte_mbuf *m,
+	      const struct avp_gro_seg *seg)
+{
+	struct rte_mbuf *head = flow->head;
+
+	/* the latest window and push indication apply to the whole packet */
+	flow->seg.tcp->rx_win = seg->tcp->rx_win;
+	flow->seg.tcp->tcp_flags |= (seg->tcp->tcp_flags & AVP_GRO_TCP_PSH);
+
+	rte_pktmbuf_adj(m, seg->hdr_len);
+	flow->last->next = m;
+	flow->last = m;
+	head->nb_segs++;
+	head->pkt_len += seg->payload_len;
+
+	flow->seg.ip_len += seg->payload_len;
+	flow->next_seq += seg->payload_len;
+}
+
+/* update the headers of a coalesced packet and release its flow */
+static inline void
+avp_gro_flush(struct avp_gro_flow *flow)
+{
+	struct rte_mbuf *head = flow->head;
+	struct avp_gro_seg *seg = &flow->seg;
+
+	flow->head = NULL;
+	if (head->nb_segs == 1)
+		return;
+
+	if (seg->ipv4 != NULL) {
+		seg->ipv4->total_length = rte_cpu_to_be_16(seg->ip_len);
+		seg->ipv4->hdr_checksum = 0;
+		seg->ipv4->hdr_checksum = rte_ipv4_cksum(seg->ipv4);
+	} else {
+		seg->ipv6->payload_len = rte_cpu_to_be_16(seg->ip_len);
+	}
+
+#if RTE_VERSION >= RTE_VERSION_NUM(16, 11, 0, 0)
+	/* every segment was validated but the TCP checksum is left stale */
+	head->ol_flags &= ~(PKT_RX_IP_CKSUM_MASK | PKT_RX_L4_CKSUM_MASK);
+	head->ol_flags |= PKT_RX_L4_CKSUM_GOOD;
+	if (seg->ipv4 != NULL)
+		head->ol_flags |= PKT_RX_IP_CKSUM_GOOD;
+#endif
+}
+
+unsigned int
+avp_gro_reassemble(struct rte_mbuf **pkts, unsigned int nb_pkts,
+		   uint64_t *merged)
+{
+	struct avp_gro_flow flows[AVP_GRO_MAX_FLOWS];
+	struct avp_gro_flow *flow;
+	unsigned int nb_flows = 0;
+	unsigned int count = 0;
+	struct avp_gro_seg seg;
+	struct rte_mbuf *m;
+	unsigned int i;
+	unsigned int j;
+	int ret;
+
+	for (i = 0; i < nb_pkts; i++) {
+		m = pkts[i];
+
+		ret = avp_gro_parse(m, &seg);
+		if (ret < 0) {
+			pkts[count++] = m;
+			continue;
+		}
+
+		flow = NULL;
+		for (j = 0; j < nb_flows; j++) {
+			if ((flows[j].head != NULL) &&
+			    avp_gro_same_flow(&flows[j], m, &seg)) {
+				flow = &flows[j];
+				break;
+			}
+		}
+
+		if (ret > 0) {
+			/*
+			 * later segments of the flow must not be merged ahead
+			 * of a segment that is passed through, such as a FIN.
+			 */
+			if (flow != NULL)
+				avp_gro_flush(flow);
+			pkts[count++] = m;
+			continue;
+		}
+
+		if (flow != NULL) {
+			if (avp_gro_can_merge(flow, &seg)) {
+				avp_gro_merge(flow, m, &seg);
+				(*merged)++;
+
+				if (seg.tcp->tcp_flags & AVP_GRO_TCP_PSH)
+					avp_gro_flush(flow);
+				continue;
+			}
+
+			/* out of order or changed headers; start over */
+			avp_gro_flush(flow);
+		}
+
+		pkts[count++] = m;
+
+		/* nothing is appended to a segment that ends a push */
+		if (seg.tcp->tcp_flags & AVP_GRO_TCP_PSH)
+			continue;
+
+		if (flow == NULL) {
+			for (j = 0; j < nb_flows; j++)
+				if (flows[j].head == NULL)
+					break;
+			if (j == AVP_GRO_MAX_FLOWS)
+				continue; /* too many flows in this burst */
+			if (j == nb_flows)
+				nb_flows++;
+			flow = &flows[j];
+		}
+
+		flow->head = m;
+		flow->last = m;
+		flow->seg = seg;
+		flow->next_seq = rte_be_to_cpu_32(seg.tcp->sent_seq) +
+			seg.payload_len;
+	}
+
+	for (j = 0; j < nb_flows; j++)
+		if (flows[j].head != NULL)
+			avp_gro_flush(&flows[j]);
+
+	return count;
+}
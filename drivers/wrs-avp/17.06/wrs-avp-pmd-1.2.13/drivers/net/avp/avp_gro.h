@@ -0,0 +1,64 @@
+/*
+ * BSD LICENSE
+ *
+ * Copyright (c) 2017, Wind River Systems, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1) Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2) Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3) Neither the name of Wind River Systems nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _AVP_GRO_H_
+#define _AVP_GRO_H_
+
+#include <stdint.h>
+
+struct rte_mbuf;
+
+/* maximum number of flows coalesced concurrently within a burst */
+#define AVP_GRO_MAX_FLOWS 8
+
+/* maximum number of segments coalesced into a single packet */
+#define AVP_GRO_MAX_SEGMENTS 64
+
+/**
+ * Coalesce in-order TCP segments of the same flow within a burst of received
+ * packets.  Each segment is appended to the mbuf chain of the first packet of
+ * its flow and removed from the burst; the remaining packets keep their
+ * relative order.
+ *
+ * @param pkts
+ *   The burst of received packets; compacted in place.
+ * @param nb_pkts
+ *   The number of packets in the burst.
+ * @param merged
+ *   Incremented by the number of packets appended to a preceding packet.
+ * @return
+ *   The number of packets left in the burst.
+ */
+unsigned int avp_gro_reassemble(struct rte_mbuf **pkts, unsigned int nb_pkts,
+				uint64_t *merged);
+
+#endif /* _AVP_GRO_H_ */
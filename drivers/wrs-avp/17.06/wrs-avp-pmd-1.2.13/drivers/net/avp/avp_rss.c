@@ -0,0 +1,183 @@
+/*
+ * BSD LICENSE
+ *
+ * Copyright (c) 2017, Wind River Systems, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1) Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2) Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3) Neither the name of Wind River Systems nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include <rte_byteorder.h>
+#include <rte_branch_prediction.h>
+#include <rte_ether.h>
+#include <rte_ip.h>
+
+#include "avp_rss.h"
+
+const uint8_t avp_rss_default_key[RTE_AVP_RSS_KEY_SIZE] = {
+	0x6d, 0x5a, 0x56, 0xda, 0x25, 0x5b, 0x0e, 0xc2,
+	0x41, 0x67, 0x25, 0x3d, 0x43, 0xa3, 0x8f, 0xb0,
+	0xd0, 0xca, 0x2b, 0xcb, 0xae, 0x7b, 0x30, 0xb4,
+	0x77, 0xcb, 0x2d, 0xa3, 0x80, 0x30, 0xf2, 0x0c,
+	0x6a, 0x42, 0xb7, 0x3b, 0xbe, 0xac, 0x01, 0xfa,
+};
+
+void
+avp_rss_init(struct avp_rss *rss, const uint8_t *key, uint32_t hash_types)
+{
+	uint64_t window;
+	unsigned int pos;
+	unsigned int bit;
+	unsigned int val;
+	uint32_t hash;
+
+	rss->hash_types = hash_types;
+	memcpy(rss->key, key, sizeof(rss->key));
+
+	for (pos = 0; pos < AVP_RSS_TUPLE_MAX_LEN; pos++) {
+		/* the 40 key bits that cover the 8 bits of this input byte */
+		window = ((uint64_t)key[pos] << 32) |
+			((uint64_t)key[pos + 1] << 24) |
+			((uint64_t)key[pos + 2] << 16) |
+			((uint64_t)key[pos + 3] << 8) |
+			(uint64_t)key[pos + 4];
+
+		for (val = 0; val < 256; val++) {
+			hash = 0;
+			for (bit = 0; bit < 8; bit++)
+				if (val & (0x80 >> bit))
+					hash ^= (uint32_t)(window >> (8 - bit));
+			rss->table[pos][val] = hash;
+		}
+	}
+}
+
+static inline uint32_t
+avp_rss_toeplitz(const struct avp_rss *rss, unsigned int pos,
+		 const uint8_t *data, unsigned int len, uint32_t hash)
+{
+	unsigned int i;
+
+	for (i = 0; i < len; i++)
+		hash ^= rss->table[pos + i][data[i]];
+
+	return hash;
+}
+
+int
+avp_rss_hash(const struct avp_rss *rss, const void *data,
+	     unsigned int len, uint32_t *hash)
+{
+	const struct ether_hdr *eth = data;
+	const struct vlan_hdr *vlan;
+	const struct ipv4_hdr *ipv4;
+	const struct ipv6_hdr *ipv6;
+	const uint8_t *l4 = NULL;
+	unsigned int offset;
+	unsigned int addr_len;
+	const uint8_t *addr;
+	uint16_t ether_type;
+	uint32_t l4_types;
+	uint32_t l3_type;
+	uint8_t proto;
+
+	if (rss->hash_types == 0)
+		return -1;
+
+	offset = sizeof(*eth);
+	if (unlikely(len < offset))
+		return -1;
+
+	ether_type = eth->ether_type;
+	if (ether_type == rte_cpu_to_be_16(ETHER_TYPE_VLAN)) {
+		vlan = (const struct vlan_hdr *)(eth + 1);
+		offset += sizeof(*vlan);
+		if (unlikely(len < offset))
+			return -1;
+		ether_type = vlan->eth_proto;
+	}
+
+	if (ether_type == rte_cpu_to_be_16(ETHER_TYPE_IPv4)) {
+		ipv4 = (const struct ipv4_hdr *)((const uint8_t *)data + offset);
+		if (unlikely(len < offset + sizeof(*ipv4)))
+			return -1;
+
+		addr = (const uint8_t *)&ipv4->src_addr;
+		addr_len = 2 * sizeof(ipv4->src_addr);
+		l3_type = RTE_AVP_RSS_IPV4;
+		proto = ipv4->next_proto_id;
+		offset += (ipv4->version_ihl & IPV4_HDR_IHL_MASK) *
+			IPV4_IHL_MULTIPLIER;
+
+		/* only the first fragment holds the ports */
+		if (ipv4->fragment_offset &
+		    rte_cpu_to_be_16(IPV4_HDR_MF_FLAG | IPV4_HDR_OFFSET_MASK))
+			proto = 0;
+
+		if (proto == IPPROTO_TCP)
+			l4_types = RTE_AVP_RSS_IPV4_TCP;
+		else if (proto == IPPROTO_UDP)
+			l4_types = RTE_AVP_RSS_IPV4_UDP;
+		else
+			l4_types = 0;
+
+	} else if (ether_type == rte_cpu_to_be_16(ETHER_TYPE_IPv6)) {
+		ipv6 = (const struct ipv6_hdr *)((const uint8_t *)data + offset);
+		if (unlikely(len < offset + sizeof(*ipv6)))
+			return -1;
+
+		addr = ipv6->src_addr;
+		addr_len = sizeof(ipv6->src_addr) + sizeof(ipv6->dst_addr);
+		l3_type = RTE_AVP_RSS_IPV6;
+		proto = ipv6->proto; /* extension headers are not parsed */
+		offset += sizeof(*ipv6);
+
+		if (proto == IPPROTO_TCP)
+			l4_types = RTE_AVP_RSS_IPV6_TCP;
+		else if (proto == IPPROTO_UDP)
+			l4_types = RTE_AVP_RSS_IPV6_UDP;
+		else
+			l4_types = 0;
+
+	} else {
+		return -1;
+	}
+
+	/* the source and destination ports are at the start of both headers */
+	if ((rss->hash_types & l4_types) && (len >= offset + 4))
+		l4 = (const uint8_t *)data + offset;
+	else if ((rss->hash_types & l3_type) == 0)
+		return -1;
+
+	*hash = avp_rss_toeplitz(rss, 0, addr, addr_len, 0);
+	if (l4 != NULL)
+		*hash = avp_rss_toeplitz(rss, addr_len, l4, 4, *hash);
+
+	return 0;
+}
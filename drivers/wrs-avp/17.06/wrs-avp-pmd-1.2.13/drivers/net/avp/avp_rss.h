@@ -0,0 +1,75 @@
+/*
+ * BSD LICENSE
+ *
+ * Copyright (c) 2017, Wind River Systems, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1) Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2) Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3) Neither the name of Wind River Systems nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _AVP_RSS_H_
+#define _AVP_RSS_H_
+
+#include <stdint.h>
+
+#include "rte_avp_common.h"
+
+/* maximum hash input; i.e., IPv6 source and destination addresses and ports */
+#define AVP_RSS_TUPLE_MAX_LEN (2 * 16 + 2 * 2)
+
+/*
+ * Software Toeplitz hash state used when the host does not provide a flow
+ * hash.  The hash of each input byte at each position is precomputed from the
+ * key so that hashing a tuple costs one table lookup per input byte rather
+ * than one key shift per input bit.
+ */
+struct avp_rss {
+	uint32_t hash_types; /**< Enabled RTE_AVP_RSS_* hash types */
+	uint8_t key[RTE_AVP_RSS_KEY_SIZE]; /**< Toeplitz hash key */
+	uint32_t table[AVP_RSS_TUPLE_MAX_LEN][256];
+	/**< Hash of each byte value at each input position */
+};
+
+/* Toeplitz key used until the application provides one */
+extern const uint8_t avp_rss_default_key[RTE_AVP_RSS_KEY_SIZE];
+
+/**
+ * Set the hash key and types and rebuild the lookup tables.
+ */
+void avp_rss_init(struct avp_rss *rss, const uint8_t *key,
+		  uint32_t hash_types);
+
+/**
+ * Compute the hash of an Ethernet frame according to the enabled hash types.
+ *
+ * @return
+ *   0 and the hash in *hash if the frame matches an enabled hash type,
+ *   -1 otherwise.
+ */
+int avp_rss_hash(const struct avp_rss *rss, const void *data,
+		 unsigned int len, uint32_t *hash);
+
+#endif /* _AVP_RSS_H_ */
@@ -81,6 +81,7 @@ enum rte_avp_req_id {
 	RTE_AVP_REQ_CFG_NETWORK_IF,
 	RTE_AVP_REQ_CFG_DEVICE,
 	RTE_AVP_REQ_SHUTDOWN_DEVICE,
+	RTE_AVP_REQ_CFG_RSS,
 	RTE_AVP_REQ_MAX,
 };
 
@@ -110,8 +111,35 @@ struct rte_avp_device_config {
 	uint8_t if_up; /**< 1: interface up, 0: interface down */
 } __attribute__ ((__packed__));
 
+/**@{ AVP receive side scaling parameters */
+#define RTE_AVP_RSS_KEY_SIZE 40 /**< Toeplitz hash key length */
+#define RTE_AVP_RSS_RETA_SIZE 128 /**< Redirection table entries */
+/**@} */
+
+/**@{ AVP receive side scaling hash types */
+#define RTE_AVP_RSS_IPV4 (1 << 0) /**< IPv4 addresses */
+#define RTE_AVP_RSS_IPV4_TCP (1 << 1) /**< IPv4 addresses and TCP ports */
+#define RTE_AVP_RSS_IPV4_UDP (1 << 2) /**< IPv4 addresses and UDP ports */
+#define RTE_AVP_RSS_IPV6 (1 << 3) /**< IPv6 addresses */
+#define RTE_AVP_RSS_IPV6_TCP (1 << 4) /**< IPv6 addresses and TCP ports */
+#define RTE_AVP_RSS_IPV6_UDP (1 << 5) /**< IPv6 addresses and UDP ports */
+/**@} */
+
+/*
+ * Structure for AVP receive side scaling configuration request.  Each hash
+ * value selects the receive fifo at reta[hash % RTE_AVP_RSS_RETA_SIZE].
+ */
+struct rte_avp_rss_config {
+	uint32_t hash_types; /**< Enabled hash types; 0 disables hashing */
+	uint8_t key[RTE_AVP_RSS_KEY_SIZE]; /**< Toeplitz hash key */
+	uint8_t reta[RTE_AVP_RSS_RETA_SIZE]; /**< Receive fifo indices */
+} __attribute__ ((__packed__));
+
 /*
- * Structure for AVP request.
+ * Structure for AVP request.  The receive side scaling configuration follows
+ * the result so that the layout of the other requests is unchanged for hosts
+ * that do not implement RTE_AVP_FEATURE_RSS; it is only transferred with
+ * RTE_AVP_REQ_CFG_RSS requests.
  */
 struct rte_avp_request {
 	uint32_t req_id; /**< Request id */
@@ -121,19 +149,126 @@ struct rte_avp_request {
 	struct rte_avp_device_config config; /**< Queue configuration */
 	};
 	int32_t result;	/**< Result for processing request */
+	struct rte_avp_rss_config rss; /**< Receive side scaling config */
 } __attribute__ ((__packed__));
 
+/*
+ * The FIFO indices and buffers are accessed with explicit acquire/release
+ * atomics when built for the C11 memory model so they need not be volatile.
+ */
+#if defined(RTE_LIBRTE_AVP_C11_MEM_MODEL) && !defined(__KERNEL__)
+#define RTE_AVP_FIFO_VOLATILE
+#else
+#define RTE_AVP_FIFO_VOLATILE volatile
+#endif
+
 /*
  * FIFO struct mapped in a shared memory. It describes a circular buffer FIFO
  * Write and read should wrap around. FIFO is empty when write == read
  * Writing should never overwrite the read position
  */
 struct rte_avp_fifo {
-	volatile unsigned int write; /**< Next position to be written*/
-	volatile unsigned int read; /**< Next position to be read */
+	RTE_AVP_FIFO_VOLATILE unsigned int write;
+	/**< Next position to be written*/
+	RTE_AVP_FIFO_VOLATILE unsigned int read;
+	/**< Next position to be read */
 	unsigned int len; /**< Circular buffer length */
 	unsigned int elem_size; /**< Pointer size - for 32/64 bit OS */
-	void *volatile buffer[0]; /**< The buffer contains mbuf pointers */
+	void *RTE_AVP_FIFO_VOLATILE buffer[0];
+	/**< The buffer contains mbuf pointers */
+};
+
+/*
+ * FIFO struct mapped in a shared memory by hosts that implement AVP major
+ * version 3 or later.  The semantics are the same as rte_avp_fifo but the
+ * producer and consumer indices are kept in separate cache lines so that the
+ * two sides do not contend on a single line.  Each side also keeps a shadow
+ * copy of the peer index in its own cache line and only reloads the peer
+ * index when the shadow copy indicates that the FIFO is full (producer) or
+ * empty (consumer).
+ */
+struct rte_avp_fifo_v3 {
+	/* read-only after initialization */
+	unsigned int len; /**< Circular buffer length */
+	unsigned int elem_size; /**< Pointer size - for 32/64 bit OS */
+
+	/* written by the producer only */
+	RTE_AVP_FIFO_VOLATILE unsigned int write
+	__attribute__ ((__aligned__(RTE_CACHE_LINE_SIZE)));
+	/**< Next position to be written */
+	unsigned int read_shadow; /**< Producer copy of the read position */
+
+	/* written by the consumer only */
+	RTE_AVP_FIFO_VOLATILE unsigned int read
+	__attribute__ ((__aligned__(RTE_CACHE_LINE_SIZE)));
+	/**< Next position to be read */
+	unsigned int write_shadow; /**< Consumer copy of the write position */
+
+	void *RTE_AVP_FIFO_VOLATILE buffer[0]
+	__attribute__ ((__aligned__(RTE_CACHE_LINE_SIZE)));
+	/**< The buffer contains mbuf pointers */
+};
+
+/*
+ * Compact packet descriptor exchanged by hosts that implement AVP major
+ * version 4 or later.  Buffers are referenced by index rather than by host
+ * virtual address.  The top bits of the index select the host mbuf pool (see
+ * rte_avp_device_info.pool) and the remaining bits select a buffer of
+ * buf_stride bytes within that pool.  A packet that spans several buffers is
+ * described by consecutive descriptors, all but the last of which have
+ * RTE_AVP_CDESC_MORE set.  Descriptors on the alloc and free rings only
+ * carry a buffer index (and data offset on the alloc ring).
+ */
+struct rte_avp_cdesc {
+	uint32_t buf_id; /**< Pool and buffer index */
+	uint16_t offset; /**< Start of data relative to the buffer */
+	uint16_t data_len; /**< Amount of data in the buffer */
+	uint16_t flags; /**< RTE_AVP_CDESC_MORE and offload flags */
+	uint16_t vlan_tci; /**< VLAN Tag Control Identifier (CPU order). */
+	union {
+		uint32_t rss_hash; /**< Flow hash (RTE_AVP_RX_RSS_HASH) */
+		struct {
+			uint16_t tso_segsz; /**< TCP segment size (TX) */
+			uint8_t l2_len; /**< L2 header length (TX) */
+			uint8_t l3_len; /**< L3 header length (TX) */
+		};
+	};
+} __attribute__ ((__packed__));
+
+/**@{ Compact descriptor buffer index fields */
+#define RTE_AVP_CDESC_POOL_SHIFT 29
+#define RTE_AVP_CDESC_INDEX_MASK ((1U << RTE_AVP_CDESC_POOL_SHIFT) - 1)
+/**@} */
+
+#define RTE_AVP_CDESC_MORE 0x8000 /**< Packet continues in next descriptor. */
+
+
+/*
+ * Ring of compact descriptors mapped in a shared memory by hosts that
+ * implement AVP major version 4 or later for their tx, rx, alloc and free
+ * queues.  The indices are laid out and updated exactly as in
+ * rte_avp_fifo_v3; only the elements differ.
+ */
+struct rte_avp_ring {
+	/* read-only after initialization */
+	unsigned int len; /**< Circular buffer length */
+	unsigned int elem_size; /**< Descriptor size */
+
+	/* written by the producer only */
+	RTE_AVP_FIFO_VOLATILE unsigned int write
+	__attribute__ ((__aligned__(RTE_CACHE_LINE_SIZE)));
+	/**< Next position to be written */
+	unsigned int read_shadow; /**< Producer copy of the read position */
+
+	/* written by the consumer only */
+	RTE_AVP_FIFO_VOLATILE unsigned int read
+	__attribute__ ((__aligned__(RTE_CACHE_LINE_SIZE)));
+	/**< Next position to be read */
+	unsigned int write_shadow; /**< Consumer copy of the write position */
+
+	struct rte_avp_cdesc desc[0]
+	__attribute__ ((__aligned__(RTE_CACHE_LINE_SIZE)));
+	/**< The buffer contains compact descriptors */
 };
 
 
@@ -151,20 +286,51 @@ struct rte_avp_desc {
 	uint8_t nb_segs; /**< Number of segments */
 	uint8_t pad2;
 	uint16_t pkt_len; /**< Total pkt len: sum of all segment data_len. */
-	uint32_t pad3;
+	uint32_t rss_hash; /**< Flow hash (RTE_AVP_RX_RSS_HASH) */
 	uint16_t vlan_tci; /**< VLAN Tag Control Identifier (CPU order). */
-	uint32_t pad4;
+	uint16_t tso_segsz; /**< TCP segment size (RTE_AVP_TX_TCP_SEG) */
+	uint8_t l2_len; /**< L2 header length (TX checksum and segmentation) */
+	uint8_t l3_len; /**< L3 header length (TX checksum and segmentation) */
 } __attribute__ ((__aligned__(RTE_CACHE_LINE_SIZE), __packed__));
 
+/** Maximum number of payload bytes carried in a descriptor extension */
+#define RTE_AVP_INLINE_MAX_LEN (2 * RTE_CACHE_LINE_SIZE)
+
+/*
+ * Descriptor extension which immediately follows the descriptor of every
+ * buffer when RTE_AVP_FEATURE_INLINE is negotiated.  Packets flagged with
+ * RTE_AVP_INLINE_PKT hold their data here rather than at the address
+ * referenced by the descriptor data field.
+ */
+struct rte_avp_desc_ext {
+	uint8_t data[RTE_AVP_INLINE_MAX_LEN]; /**< Inline packet data */
+} __attribute__ ((__aligned__(RTE_CACHE_LINE_SIZE)));
+
 
 /**{ AVP device features */
 #define RTE_AVP_FEATURE_VLAN_OFFLOAD (1 << 0) /**< Emulated HW VLAN offload */
+#define RTE_AVP_FEATURE_RSS (1 << 1) /**< Host hashes and steers rx packets */
+#define RTE_AVP_FEATURE_INLINE (1 << 2) /**< Small packets carried inline */
+#define RTE_AVP_FEATURE_RX_CSUM (1 << 3) /**< Host validates rx checksums */
+#define RTE_AVP_FEATURE_TX_CSUM (1 << 4) /**< Host computes tx checksums */
+#define RTE_AVP_FEATURE_TSO (1 << 5) /**< Host segments large TCP packets */
+#define RTE_AVP_FEATURE_RX_INTR (1 << 6) /**< Host raises rx fifo interrupts */
 /**@} */
 
 
 /**@{ Offload feature flags */
 #define RTE_AVP_TX_VLAN_PKT 0x0001 /**< TX packet is a 802.1q VLAN packet. */
+#define RTE_AVP_RX_RSS_HASH 0x0002 /**< RX packet has a valid rss_hash. */
+#define RTE_AVP_INLINE_PKT 0x0004 /**< Data is in the descriptor extension. */
+#define RTE_AVP_TX_IP_CKSUM 0x0010 /**< TX IPv4 header checksum requested. */
+#define RTE_AVP_TX_TCP_CKSUM 0x0020 /**< TX TCP checksum requested. */
+#define RTE_AVP_TX_UDP_CKSUM 0x0040 /**< TX UDP checksum requested. */
+#define RTE_AVP_TX_TCP_SEG 0x0080 /**< TX TCP segmentation requested. */
+#define RTE_AVP_RX_IP_CKSUM_GOOD 0x0100 /**< RX IPv4 header checksum valid. */
+#define RTE_AVP_RX_L4_CKSUM_GOOD 0x0200 /**< RX TCP/UDP checksum valid. */
+#define RTE_AVP_RX_IP_CKSUM_BAD 0x0400 /**< RX IPv4 header checksum invalid. */
 #define RTE_AVP_RX_VLAN_PKT 0x0800 /**< RX packet is a 802.1q VLAN packet. */
+#define RTE_AVP_RX_L4_CKSUM_BAD 0x1000 /**< RX TCP/UDP checksum invalid. */
 /**@} */
 
 
@@ -197,7 +363,9 @@ struct rte_avp_desc {
 
 /**@{ AVP PCI MSI-X vectors */
 #define RTE_AVP_MIGRATION_MSIX_VECTOR 0	/**< Migration interrupts */
-#define RTE_AVP_MAX_MSIX_VECTORS 1
+#define RTE_AVP_RX_MSIX_VECTOR_BASE 1 /**< First receive queue interrupt */
+#define RTE_AVP_MAX_MSIX_VECTORS \
+	(RTE_AVP_RX_MSIX_VECTOR_BASE + RTE_AVP_MAX_QUEUES)
 /**@} */
 
 /**@} AVP Migration status/ack register values */
@@ -213,6 +381,14 @@ struct rte_avp_desc {
 #define RTE_AVP_INTERRUPT_STATUS_OFFSET (RTE_AVP_REGISTER_BASE + 4)
 #define RTE_AVP_MIGRATION_STATUS_OFFSET (RTE_AVP_REGISTER_BASE + 8)
 #define RTE_AVP_MIGRATION_ACK_OFFSET (RTE_AVP_REGISTER_BASE + 12)
+/*
+ * Receive fifo interrupt control (RTE_AVP_FEATURE_RX_INTR).  Writing an MSI-X
+ * vector number arms the receive fifo; the host raises that vector once when
+ * it next adds packets to the fifo and then disarms it.  Writing 0 disarms the
+ * fifo.
+ */
+#define RTE_AVP_RX_INTERRUPT_OFFSET(_fifo) \
+	(RTE_AVP_REGISTER_BASE + 16 + ((_fifo) * 4))
 /**@} */
 
 /**@} AVP Interrupt Status Mask */
@@ -270,11 +446,13 @@ struct rte_avp_memmap_info {
 #define RTE_AVP_MAJOR_VERSION_0 0
 #define RTE_AVP_MAJOR_VERSION_1 1
 #define RTE_AVP_MAJOR_VERSION_2 2
-#define RTE_AVP_MAJOR_VERSION RTE_AVP_MAJOR_VERSION_2
+#define RTE_AVP_MAJOR_VERSION_3 3
+#define RTE_AVP_MAJOR_VERSION_4 4
+#define RTE_AVP_MAJOR_VERSION RTE_AVP_MAJOR_VERSION_4
 #define RTE_AVP_MINOR_VERSION_0 0
 #define RTE_AVP_MINOR_VERSION_1 1
 #define RTE_AVP_MINOR_VERSION_13 13
-#define RTE_AVP_MINOR_VERSION RTE_AVP_MINOR_VERSION_13
+#define RTE_AVP_MINOR_VERSION RTE_AVP_MINOR_VERSION_0
 /**@} */
 
 
@@ -304,8 +482,27 @@ RTE_AVP_MAKE_VERSION(RTE_AVP_RELEASE_VERSION_1, \
  */
 #define RTE_AVP_CURRENT_GUEST_VERSION \
 RTE_AVP_MAKE_VERSION(RTE_AVP_RELEASE_VERSION_1, \
-		     RTE_AVP_MAJOR_VERSION_2, \
-		     RTE_AVP_MINOR_VERSION_13)
+		     RTE_AVP_MAJOR_VERSION_4, \
+		     RTE_AVP_MINOR_VERSION_0)
+
+
+/**
+ * Represents the first AVP version that lays out its FIFOs as
+ * struct rte_avp_fifo_v3
+ */
+#define RTE_AVP_FIFO_V3_VERSION \
+RTE_AVP_MAKE_VERSION(RTE_AVP_RELEASE_VERSION_1, \
+		     RTE_AVP_MAJOR_VERSION_3, \
+		     RTE_AVP_MINOR_VERSION_0)
+
+/**
+ * Represents the first AVP version that lays out its packet queues as
+ * struct rte_avp_ring of struct rte_avp_cdesc
+ */
+#define RTE_AVP_CDESC_VERSION \
+RTE_AVP_MAKE_VERSION(RTE_AVP_RELEASE_VERSION_1, \
+		     RTE_AVP_MAJOR_VERSION_4, \
+		     RTE_AVP_MINOR_VERSION_0)
 
 /**
  * Access AVP device version values
@@ -399,6 +596,10 @@ struct rte_avp_device_info {
 	uint64_t device_id;
 
 	uint32_t max_rx_pkt_len; /**< Maximum receive unit size */
+
+	uint32_t inline_len; /**< Maximum inline packet length */
+
+	uint32_t buf_stride; /**< Buffer size of each pool (version 4 only) */
 };
 
 #define RTE_AVP_MAX_QUEUES 8 /**< Maximum number of queues per device */
@@ -406,6 +607,9 @@ struct rte_avp_device_info {
 /** Maximum number of chained mbufs in a packet */
 #define RTE_AVP_MAX_MBUF_SEGMENTS 5
 
+/** Maximum number of chained mbufs in a packet with RTE_AVP_TX_TCP_SEG set */
+#define RTE_AVP_MAX_TSO_SEGMENTS 64
+
 #define RTE_AVP_DEVICE "avp"
 
 #define RTE_AVP_IOCTL_TEST    _IOWR(0, 1, int)
@@ -85,8 +85,29 @@ avp_fifo_init(struct rte_avp_fifo *fifo, unsigned int size)
 	fifo->len = size;
 	fifo->elem_size = sizeof(void *);
 }
+
+/**
+ * Initializes the avp fifo structure (AVP major version 3 layout)
+ */
+static inline void
+avp_fifo_v3_init(struct rte_avp_fifo_v3 *fifo, unsigned int size)
+{
+	/* Ensure size is power of 2 */
+	if (size & (size - 1))
+		rte_panic("AVP fifo size must be power of 2\n");
+
+	fifo->write = 0;
+	fifo->read_shadow = 0;
+	fifo->read = 0;
+	fifo->write_shadow = 0;
+	fifo->len = size;
+	fifo->elem_size = sizeof(void *);
+}
 #endif
 
+#if defined(RTE_LIBRTE_AVP_C11_MEM_MODEL) && !defined(__KERNEL__)
+#include "rte_avp_fifo_c11.h"
+#else
 /**
  * Adds num elements into the fifo. Return the number actually written
  */
@@ -136,6 +157,38 @@ avp_fifo_get(struct rte_avp_fifo *fifo, void **data, unsigned int num)
 	return i;
 }
 
+/**
+ * Get up to num elements from the fifo without removing them. Return the
+ * number actually read; avp_fifo_consume() removes them
+ */
+static inline unsigned int
+avp_fifo_peek(struct rte_avp_fifo *fifo, void **data, unsigned int num)
+{
+	unsigned int mask = fifo->len - 1;
+	unsigned int fifo_read = fifo->read;
+	unsigned int count;
+	unsigned int i;
+
+	count = (fifo->write - fifo_read) & mask;
+	AVP_RMB();
+	if (num > count)
+		num = count;
+
+	for (i = 0; i < num; i++)
+		data[i] = fifo->buffer[(fifo_read + i) & mask];
+	return num;
+}
+
+/**
+ * Remove num elements previously returned by avp_fifo_peek() from the fifo
+ */
+static inline void
+avp_fifo_consume(struct rte_avp_fifo *fifo, unsigned int num)
+{
+	AVP_RMB();
+	fifo->read = (fifo->read + num) & (fifo->len - 1);
+}
+
 /**
  * Get the num of elements in the fifo
  */
@@ -154,4 +207,288 @@ avp_fifo_free_count(struct rte_avp_fifo *fifo)
 	return (fifo->read - fifo->write - 1) & (fifo->len - 1);
 }
 
+/*
+ * The following functions operate on the AVP major version 3 fifo layout.
+ * Each side only reads the index owned by its peer when its shadow copy of
+ * that index cannot satisfy the request.  Therefore avp_fifo_v3_put() and
+ * avp_fifo_v3_free_count() must only be called by the producer, and
+ * avp_fifo_v3_get(), avp_fifo_v3_peek(), avp_fifo_v3_consume() and
+ * avp_fifo_v3_count() must only be called by the consumer.  Only
+ * avp_fifo_v3_level() may be called by other threads.
+ */
+
+/**
+ * Adds num elements into the fifo. Return the number actually written
+ */
+static inline unsigned int
+avp_fifo_v3_put(struct rte_avp_fifo_v3 *fifo, void **data, unsigned int num)
+{
+	unsigned int mask = fifo->len - 1;
+	unsigned int fifo_write = fifo->write;
+	unsigned int free_count;
+	unsigned int i;
+
+	free_count = (fifo->read_shadow - fifo_write - 1) & mask;
+	if (free_count < num) {
+		/* refresh from the consumer only when short of space */
+		fifo->read_shadow = fifo->read;
+		free_count = (fifo->read_shadow - fifo_write - 1) & mask;
+		if (num > free_count)
+			num = free_count;
+	}
+
+	if (num == 0)
+		return 0; /* full */
+
+	for (i = 0; i < num; i++) {
+		fifo->buffer[fifo_write] = data[i];
+		fifo_write = (fifo_write + 1) & mask;
+	}
+	AVP_WMB();
+	fifo->write = fifo_write;
+	return num;
+}
+
+/**
+ * Get up to num elements from the fifo. Return the number actually read
+ */
+static inline unsigned int
+avp_fifo_v3_get(struct rte_avp_fifo_v3 *fifo, void **data, unsigned int num)
+{
+	unsigned int mask = fifo->len - 1;
+	unsigned int fifo_read = fifo->read;
+	unsigned int count;
+	unsigned int i;
+
+	count = (fifo->write_shadow - fifo_read) & mask;
+	if (count < num) {
+		/* refresh from the producer only when short of elements */
+		fifo->write_shadow = fifo->write;
+		AVP_RMB();
+		count = (fifo->write_shadow - fifo_read) & mask;
+		if (num > count)
+			num = count;
+	}
+
+	if (num == 0)
+		return 0; /* empty */
+
+	for (i = 0; i < num; i++) {
+		data[i] = fifo->buffer[fifo_read];
+		fifo_read = (fifo_read + 1) & mask;
+	}
+	AVP_RMB();
+	fifo->read = fifo_read;
+	return num;
+}
+
+/**
+ * Get up to num elements from the fifo without removing them. Return the
+ * number actually read; avp_fifo_v3_consume() removes them
+ */
+static inline unsigned int
+avp_fifo_v3_peek(struct rte_avp_fifo_v3 *fifo, void **data, unsigned int num)
+{
+	unsigned int mask = fifo->len - 1;
+	unsigned int fifo_read = fifo->read;
+	unsigned int count;
+	unsigned int i;
+
+	count = (fifo->write_shadow - fifo_read) & mask;
+	if (count < num) {
+		/* refresh from the producer only when short of elements */
+		fifo->write_shadow = fifo->write;
+		AVP_RMB();
+		count = (fifo->write_shadow - fifo_read) & mask;
+		if (num > count)
+			num = count;
+	}
+
+	for (i = 0; i < num; i++)
+		data[i] = fifo->buffer[(fifo_read + i) & mask];
+	return num;
+}
+
+/**
+ * Remove num elements previously returned by avp_fifo_v3_peek() from the fifo
+ */
+static inline void
+avp_fifo_v3_consume(struct rte_avp_fifo_v3 *fifo, unsigned int num)
+{
+	AVP_RMB();
+	fifo->read = (fifo->read + num) & (fifo->len - 1);
+}
+
+/**
+ * Get the num of elements in the fifo (consumer only).  As for
+ * avp_fifo_v3_get() the producer index is only reloaded when fewer than num
+ * elements are seen.
+ */
+static inline unsigned int
+avp_fifo_v3_count(struct rte_avp_fifo_v3 *fifo, unsigned int num)
+{
+	unsigned int mask = fifo->len - 1;
+	unsigned int count;
+
+	count = (fifo->write_shadow - fifo->read) & mask;
+	if (count < num) {
+		fifo->write_shadow = fifo->write;
+		AVP_RMB();
+		count = (fifo->write_shadow - fifo->read) & mask;
+	}
+	return count;
+}
+
+/**
+ * Get the num of available elements in the fifo (producer only).  As for
+ * avp_fifo_v3_put() the consumer index is only reloaded when fewer than num
+ * free slots are seen.
+ */
+static inline unsigned int
+avp_fifo_v3_free_count(struct rte_avp_fifo_v3 *fifo, unsigned int num)
+{
+	unsigned int mask = fifo->len - 1;
+	unsigned int free_count;
+
+	free_count = (fifo->read_shadow - fifo->write - 1) & mask;
+	if (free_count < num) {
+		fifo->read_shadow = fifo->read;
+		free_count = (fifo->read_shadow - fifo->write - 1) & mask;
+	}
+	return free_count;
+}
+
+/**
+ * Get the num of elements in the fifo without updating the shadow indices.
+ * The result may be stale but the function may be called from any thread.
+ */
+static inline unsigned int
+avp_fifo_v3_level(const struct rte_avp_fifo_v3 *fifo)
+{
+	return (fifo->write - fifo->read) & (fifo->len - 1);
+}
+
+/*
+ * The following functions operate on the AVP major version 4 compact
+ * descriptor ring.  The ring indices are laid out as in rte_avp_fifo_v3 so the
+ * version 3 count functions apply to it unchanged.
+ */
+
+/**
+ * Adds num descriptors into the ring. Return the number actually written
+ */
+static inline unsigned int
+avp_ring_put(struct rte_avp_ring *ring, const struct rte_avp_cdesc *descs,
+	     unsigned int num)
+{
+	unsigned int mask = ring->len - 1;
+	unsigned int ring_write = ring->write;
+	unsigned int free_count;
+	unsigned int i;
+
+	free_count = (ring->read_shadow - ring_write - 1) & mask;
+	if (free_count < num) {
+		/* refresh from the consumer only when short of space */
+		ring->read_shadow = ring->read;
+		free_count = (ring->read_shadow - ring_write - 1) & mask;
+		if (num > free_count)
+			num = free_count;
+	}
+
+	if (num == 0)
+		return 0; /* full */
+
+	for (i = 0; i < num; i++) {
+		ring->desc[ring_write] = descs[i];
+		ring_write = (ring_write + 1) & mask;
+	}
+	AVP_WMB();
+	ring->write = ring_write;
+	return num;
+}
+
+/**
+ * Get up to num descriptors from the ring without splitting a packet that
+ * spans several descriptors. Return the number actually read
+ */
+static inline unsigned int
+avp_ring_get(struct rte_avp_ring *ring, struct rte_avp_cdesc *descs,
+	     unsigned int num)
+{
+	unsigned int mask = ring->len - 1;
+	unsigned int ring_read = ring->read;
+	unsigned int count;
+	unsigned int i;
+
+	count = (ring->write_shadow - ring_read) & mask;
+	if (count < num) {
+		/* refresh from the producer only when short of elements */
+		ring->write_shadow = ring->write;
+		AVP_RMB();
+		count = (ring->write_shadow - ring_read) & mask;
+		if (num > count)
+			num = count;
+	}
+
+	for (i = 0; i < num; i++)
+		descs[i] = ring->desc[(ring_read + i) & mask];
+
+	/* leave a partial packet for the next call */
+	while ((num > 0) && (descs[num - 1].flags & RTE_AVP_CDESC_MORE))
+		num--;
+
+	if (num == 0)
+		return 0; /* empty */
+
+	AVP_RMB();
+	ring->read = (ring_read + num) & mask;
+	return num;
+}
+
+/**
+ * Get up to num descriptors from the ring without removing them and without
+ * splitting a packet that spans several descriptors. Return the number
+ * actually read; avp_ring_consume() removes them
+ */
+static inline unsigned int
+avp_ring_peek(struct rte_avp_ring *ring, struct rte_avp_cdesc *descs,
+	      unsigned int num)
+{
+	unsigned int mask = ring->len - 1;
+	unsigned int ring_read = ring->read;
+	unsigned int count;
+	unsigned int i;
+
+	count = (ring->write_shadow - ring_read) & mask;
+	if (count < num) {
+		/* refresh from the producer only when short of elements */
+		ring->write_shadow = ring->write;
+		AVP_RMB();
+		count = (ring->write_shadow - ring_read) & mask;
+		if (num > count)
+			num = count;
+	}
+
+	for (i = 0; i < num; i++)
+		descs[i] = ring->desc[(ring_read + i) & mask];
+
+	/* leave a partial packet for the next call */
+	while ((num > 0) && (descs[num - 1].flags & RTE_AVP_CDESC_MORE))
+		num--;
+
+	return num;
+}
+
+/**
+ * Remove num descriptors previously returned by avp_ring_peek() from the ring
+ */
+static inline void
+avp_ring_consume(struct rte_avp_ring *ring, unsigned int num)
+{
+	AVP_RMB();
+	ring->read = (ring->read + num) & (ring->len - 1);
+}
+
+#endif /* RTE_LIBRTE_AVP_C11_MEM_MODEL */
+
 #endif /* _RTE_AVP_FIFO_H_ */
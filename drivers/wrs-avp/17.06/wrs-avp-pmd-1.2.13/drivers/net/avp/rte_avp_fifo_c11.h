@@ -0,0 +1,475 @@
+/*
+ *   BSD LICENSE
+ *
+ * Copyright (c) 2013-2017, Wind River Systems, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1) Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2) Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3) Neither the name of Wind River Systems nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef _RTE_AVP_FIFO_C11_H_
+#define _RTE_AVP_FIFO_C11_H_
+
+/*
+ * AVP fifo accessors implemented with C11 acquire/release atomics instead of
+ * explicit memory barriers.  The shared memory layout and the index update
+ * protocol are identical to the barrier based accessors so either side of a
+ * fifo may use either implementation.  The producer publishes entries with a
+ * release store of its index and the consumer observes them with an acquire
+ * load of that index, and vice versa for the consumer index.
+ *
+ * This file is included by rte_avp_fifo.h when RTE_LIBRTE_AVP_C11_MEM_MODEL
+ * is defined and must not be included directly.
+ */
+
+/**
+ * Adds num elements into the fifo. Return the number actually written
+ */
+static inline unsigned int
+avp_fifo_put(struct rte_avp_fifo *fifo, void **data, unsigned int num)
+{
+	unsigned int mask = fifo->len - 1;
+	unsigned int fifo_write;
+	unsigned int fifo_read;
+	unsigned int free_count;
+	unsigned int i;
+
+	fifo_write = __atomic_load_n(&fifo->write, __ATOMIC_RELAXED);
+	fifo_read = __atomic_load_n(&fifo->read, __ATOMIC_ACQUIRE);
+
+	free_count = (fifo_read - fifo_write - 1) & mask;
+	if (num > free_count)
+		num = free_count;
+
+	if (num == 0)
+		return 0; /* full */
+
+	for (i = 0; i < num; i++) {
+		fifo->buffer[fifo_write] = data[i];
+		fifo_write = (fifo_write + 1) & mask;
+	}
+	__atomic_store_n(&fifo->write, fifo_write, __ATOMIC_RELEASE);
+	return num;
+}
+
+/**
+ * Get up to num elements from the fifo. Return the number actually read
+ */
+static inline unsigned int
+avp_fifo_get(struct rte_avp_fifo *fifo, void **data, unsigned int num)
+{
+	unsigned int mask = fifo->len - 1;
+	unsigned int fifo_write;
+	unsigned int fifo_read;
+	unsigned int count;
+	unsigned int i;
+
+	fifo_read = __atomic_load_n(&fifo->read, __ATOMIC_RELAXED);
+	fifo_write = __atomic_load_n(&fifo->write, __ATOMIC_ACQUIRE);
+
+	count = (fifo_write - fifo_read) & mask;
+	if (num > count)
+		num = count;
+
+	if (num == 0)
+		return 0; /* empty */
+
+	for (i = 0; i < num; i++) {
+		data[i] = fifo->buffer[fifo_read];
+		fifo_read = (fifo_read + 1) & mask;
+	}
+	__atomic_store_n(&fifo->read, fifo_read, __ATOMIC_RELEASE);
+	return num;
+}
+
+/**
+ * Get up to num elements from the fifo without removing them. Return the
+ * number actually read; avp_fifo_consume() removes them
+ */
+static inline unsigned int
+avp_fifo_peek(struct rte_avp_fifo *fifo, void **data, unsigned int num)
+{
+	unsigned int mask = fifo->len - 1;
+	unsigned int fifo_write;
+	unsigned int fifo_read;
+	unsigned int count;
+	unsigned int i;
+
+	fifo_read = __atomic_load_n(&fifo->read, __ATOMIC_RELAXED);
+	fifo_write = __atomic_load_n(&fifo->write, __ATOMIC_ACQUIRE);
+
+	count = (fifo_write - fifo_read) & mask;
+	if (num > count)
+		num = count;
+
+	for (i = 0; i < num; i++)
+		data[i] = fifo->buffer[(fifo_read + i) & mask];
+	return num;
+}
+
+/**
+ * Remove num elements previously returned by avp_fifo_peek() from the fifo
+ */
+static inline void
+avp_fifo_consume(struct rte_avp_fifo *fifo, unsigned int num)
+{
+	unsigned int fifo_read;
+
+	fifo_read = __atomic_load_n(&fifo->read, __ATOMIC_RELAXED);
+	__atomic_store_n(&fifo->read, (fifo_read + num) & (fifo->len - 1),
+			 __ATOMIC_RELEASE);
+}
+
+/**
+ * Get the num of elements in the fifo
+ */
+static inline unsigned int
+avp_fifo_count(struct rte_avp_fifo *fifo)
+{
+	unsigned int fifo_write;
+	unsigned int fifo_read;
+
+	fifo_write = __atomic_load_n(&fifo->write, __ATOMIC_RELAXED);
+	fifo_read = __atomic_load_n(&fifo->read, __ATOMIC_RELAXED);
+	return (fifo_write - fifo_read) & (fifo->len - 1);
+}
+
+/**
+ * Get the num of available elements in the fifo
+ */
+static inline unsigned int
+avp_fifo_free_count(struct rte_avp_fifo *fifo)
+{
+	unsigned int fifo_write;
+	unsigned int fifo_read;
+
+	fifo_write = __atomic_load_n(&fifo->write, __ATOMIC_RELAXED);
+	fifo_read = __atomic_load_n(&fifo->read, __ATOMIC_RELAXED);
+	return (fifo_read - fifo_write - 1) & (fifo->len - 1);
+}
+
+/*
+ * AVP major version 3 fifo layout.  The same producer/consumer restrictions
+ * as the barrier based accessors apply.  A refreshed shadow index is loaded
+ * with acquire semantics since a later put or get may rely on it without
+ * reloading the peer index.
+ */
+
+/**
+ * Adds num elements into the fifo. Return the number actually written
+ */
+static inline unsigned int
+avp_fifo_v3_put(struct rte_avp_fifo_v3 *fifo, void **data, unsigned int num)
+{
+	unsigned int mask = fifo->len - 1;
+	unsigned int fifo_write;
+	unsigned int free_count;
+	unsigned int i;
+
+	fifo_write = __atomic_load_n(&fifo->write, __ATOMIC_RELAXED);
+	free_count = (fifo->read_shadow - fifo_write - 1) & mask;
+	if (free_count < num) {
+		/* refresh from the consumer only when short of space */
+		fifo->read_shadow = __atomic_load_n(&fifo->read,
+						    __ATOMIC_ACQUIRE);
+		free_count = (fifo->read_shadow - fifo_write - 1) & mask;
+		if (num > free_count)
+			num = free_count;
+	}
+
+	if (num == 0)
+		return 0; /* full */
+
+	for (i = 0; i < num; i++) {
+		fifo->buffer[fifo_write] = data[i];
+		fifo_write = (fifo_write + 1) & mask;
+	}
+	__atomic_store_n(&fifo->write, fifo_write, __ATOMIC_RELEASE);
+	return num;
+}
+
+/**
+ * Get up to num elements from the fifo. Return the number actually read
+ */
+static inline unsigned int
+avp_fifo_v3_get(struct rte_avp_fifo_v3 *fifo, void **data, unsigned int num)
+{
+	unsigned int mask = fifo->len - 1;
+	unsigned int fifo_read;
+	unsigned int count;
+	unsigned int i;
+
+	fifo_read = __atomic_load_n(&fifo->read, __ATOMIC_RELAXED);
+	count = (fifo->write_shadow - fifo_read) & mask;
+	if (count < num) {
+		/* refresh from the producer only when short of elements */
+		fifo->write_shadow = __atomic_load_n(&fifo->write,
+						     __ATOMIC_ACQUIRE);
+		count = (fifo->write_shadow - fifo_read) & mask;
+		if (num > count)
+			num = count;
+	}
+
+	if (num == 0)
+		return 0; /* empty */
+
+	for (i = 0; i < num; i++) {
+		data[i] = fifo->buffer[fifo_read];
+		fifo_read = (fifo_read + 1) & mask;
+	}
+	__atomic_store_n(&fifo->read, fifo_read, __ATOMIC_RELEASE);
+	return num;
+}
+
+/**
+ * Get up to num elements from the fifo without removing them. Return the
+ * number actually read; avp_fifo_v3_consume() removes them
+ */
+static inline unsigned int
+avp_fifo_v3_peek(struct rte_avp_fifo_v3 *fifo, void **data, unsigned int num)
+{
+	unsigned int mask = fifo->len - 1;
+	unsigned int fifo_read;
+	unsigned int count;
+	unsigned int i;
+
+	fifo_read = __atomic_load_n(&fifo->read, __ATOMIC_RELAXED);
+	count = (fifo->write_shadow - fifo_read) & mask;
+	if (count < num) {
+		/* refresh from the producer only when short of elements */
+		fifo->write_shadow = __atomic_load_n(&fifo->write,
+						     __ATOMIC_ACQUIRE);
+		count = (fifo->write_shadow - fifo_read) & mask;
+		if (num > count)
+			num = count;
+	}
+
+	for (i = 0; i < num; i++)
+		data[i] = fifo->buffer[(fifo_read + i) & mask];
+	return num;
+}
+
+/**
+ * Remove num elements previously returned by avp_fifo_v3_peek() from the fifo
+ */
+static inline void
+avp_fifo_v3_consume(struct rte_avp_fifo_v3 *fifo, unsigned int num)
+{
+	unsigned int fifo_read;
+
+	fifo_read = __atomic_load_n(&fifo->read, __ATOMIC_RELAXED);
+	__atomic_store_n(&fifo->read, (fifo_read + num) & (fifo->len - 1),
+			 __ATOMIC_RELEASE);
+}
+
+/**
+ * Get the num of elements in the fifo (consumer only).  As for
+ * avp_fifo_v3_get() the producer index is only reloaded when fewer than num
+ * elements are seen.
+ */
+static inline unsigned int
+avp_fifo_v3_count(struct rte_avp_fifo_v3 *fifo, unsigned int num)
+{
+	unsigned int mask = fifo->len - 1;
+	unsigned int fifo_read;
+	unsigned int count;
+
+	fifo_read = __atomic_load_n(&fifo->read, __ATOMIC_RELAXED);
+	count = (fifo->write_shadow - fifo_read) & mask;
+	if (count < num) {
+		fifo->write_shadow = __atomic_load_n(&fifo->write,
+						     __ATOMIC_ACQUIRE);
+		count = (fifo->write_shadow - fifo_read) & mask;
+	}
+	return count;
+}
+
+/**
+ * Get the num of available elements in the fifo (producer only).  As for
+ * avp_fifo_v3_put() the consumer index is only reloaded when fewer than num
+ * free slots are seen.
+ */
+static inline unsigned int
+avp_fifo_v3_free_count(struct rte_avp_fifo_v3 *fifo, unsigned int num)
+{
+	unsigned int mask = fifo->len - 1;
+	unsigned int fifo_write;
+	unsigned int free_count;
+
+	fifo_write = __atomic_load_n(&fifo->write, __ATOMIC_RELAXED);
+	free_count = (fifo->read_shadow - fifo_write - 1) & mask;
+	if (free_count < num) {
+		fifo->read_shadow = __atomic_load_n(&fifo->read,
+						    __ATOMIC_ACQUIRE);
+		free_count = (fifo->read_shadow - fifo_write - 1) & mask;
+	}
+	return free_count;
+}
+
+/**
+ * Get the num of elements in the fifo without updating the shadow indices.
+ * The result may be stale but the function may be called from any thread.
+ */
+static inline unsigned int
+avp_fifo_v3_level(const struct rte_avp_fifo_v3 *fifo)
+{
+	unsigned int fifo_write;
+	unsigned int fifo_read;
+
+	fifo_write = __atomic_load_n(&fifo->write, __ATOMIC_RELAXED);
+	fifo_read = __atomic_load_n(&fifo->read, __ATOMIC_RELAXED);
+	return (fifo_write - fifo_read) & (fifo->len - 1);
+}
+
+/*
+ * AVP major version 4 compact descriptor ring.  The ring indices are laid out
+ * as in rte_avp_fifo_v3 so the version 3 count functions apply to it
+ * unchanged.
+ */
+
+/**
+ * Adds num descriptors into the ring. Return the number actually written
+ */
+static inline unsigned int
+avp_ring_put(struct rte_avp_ring *ring, const struct rte_avp_cdesc *descs,
+	     unsigned int num)
+{
+	unsigned int mask = ring->len - 1;
+	unsigned int ring_write;
+	unsigned int free_count;
+	unsigned int i;
+
+	ring_write = __atomic_load_n(&ring->write, __ATOMIC_RELAXED);
+	free_count = (ring->read_shadow - ring_write - 1) & mask;
+	if (free_count < num) {
+		/* refresh from the consumer only when short of space */
+		ring->read_shadow = __atomic_load_n(&ring->read,
+						    __ATOMIC_ACQUIRE);
+		free_count = (ring->read_shadow - ring_write - 1) & mask;
+		if (num > free_count)
+			num = free_count;
+	}
+
+	if (num == 0)
+		return 0; /* full */
+
+	for (i = 0; i < num; i++) {
+		ring->desc[ring_write] = descs[i];
+		ring_write = (ring_write + 1) & mask;
+	}
+	__atomic_store_n(&ring->write, ring_write, __ATOMIC_RELEASE);
+	return num;
+}
+
+/**
+ * Get up to num descriptors from the ring without splitting a packet that
+ * spans several descriptors. Return the number actually read
+ */
+static inline unsigned int
+avp_ring_get(struct rte_avp_ring *ring, struct rte_avp_cdesc *descs,
+	     unsigned int num)
+{
+	unsigned int mask = ring->len - 1;
+	unsigned int ring_read;
+	unsigned int count;
+	unsigned int i;
+
+	ring_read = __atomic_load_n(&ring->read, __ATOMIC_RELAXED);
+	count = (ring->write_shadow - ring_read) & mask;
+	if (count < num) {
+		/* refresh from the producer only when short of elements */
+		ring->write_shadow = __atomic_load_n(&ring->write,
+						     __ATOMIC_ACQUIRE);
+		count = (ring->write_shadow - ring_read) & mask;
+		if (num > count)
+			num = count;
+	}
+
+	for (i = 0; i < num; i++)
+		descs[i] = ring->desc[(ring_read + i) & mask];
+
+	/* leave a partial packet for the next call */
+	while ((num > 0) && (descs[num - 1].flags & RTE_AVP_CDESC_MORE))
+		num--;
+
+	if (num == 0)
+		return 0; /* empty */
+
+	__atomic_store_n(&ring->read, (ring_read + num) & mask,
+			 __ATOMIC_RELEASE);
+	return num;
+}
+
+/**
+ * Get up to num descriptors from the ring without removing them and without
+ * splitting a packet that spans several descriptors. Return the number
+ * actually read; avp_ring_consume() removes them
+ */
+static inline unsigned int
+avp_ring_peek(struct rte_avp_ring *ring, struct rte_avp_cdesc *descs,
+	      unsigned int num)
+{
+	unsigned int mask = ring->len - 1;
+	unsigned int ring_read;
+	unsigned int count;
+	unsigned int i;
+
+	ring_read = __atomic_load_n(&ring->read, __ATOMIC_RELAXED);
+	count = (ring->write_shadow - ring_read) & mask;
+	if (count < num) {
+		/* refresh from the producer only when short of elements */
+		ring->write_shadow = __atomic_load_n(&ring->write,
+						     __ATOMIC_ACQUIRE);
+		count = (ring->write_shadow - ring_read) & mask;
+		if (num > count)
+			num = count;
+	}
+
+	for (i = 0; i < num; i++)
+		descs[i] = ring->desc[(ring_read + i) & mask];
+
+	/* leave a partial packet for the next call */
+	while ((num > 0) && (descs[num - 1].flags & RTE_AVP_CDESC_MORE))
+		num--;
+
+	return num;
+}
+
+/**
+ * Remove num descriptors previously returned by avp_ring_peek() from the ring
+ */
+static inline void
+avp_ring_consume(struct rte_avp_ring *ring, unsigned int num)
+{
+	unsigned int ring_read;
+
+	ring_read = __atomic_load_n(&ring->read, __ATOMIC_RELAXED);
+	__atomic_store_n(&ring->read, (ring_read + num) & (ring->len - 1),
+			 __ATOMIC_RELEASE);
+}
+
+#endif /* _RTE_AVP_FIFO_C11_H_ */
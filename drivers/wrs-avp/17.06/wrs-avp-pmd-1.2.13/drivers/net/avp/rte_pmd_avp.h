@@ -0,0 +1,380 @@
+/*
+ *   BSD LICENSE
+ *
+ * Copyright (c) 2013-2017, Wind River Systems, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1) Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2) Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3) Neither the name of Wind River Systems nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef _RTE_PMD_AVP_H_
+#define _RTE_PMD_AVP_H_
+
+/**
+ * @file rte_pmd_avp.h
+ *
+ * AVP PMD specific functions.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include <rte_atomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct rte_mbuf;
+
+/**
+ * Receive segment coalescing counters of a queue.  The average number of
+ * segments per coalesced packet is segments / (segments - merged).
+ */
+struct rte_pmd_avp_gro_stats {
+	uint64_t segments; /**< Packets received while coalescing is enabled */
+	uint64_t merged; /**< Packets appended to a preceding packet */
+};
+
+/**
+ * Stages of a receive or transmit burst.  On transmit, address translation
+ * is accounted as part of the copy and the alloc stage covers freeing the
+ * transmitted mbufs.
+ */
+enum rte_pmd_avp_stage {
+	RTE_PMD_AVP_STAGE_FIFO_GET = 0, /**< Dequeue host buffers */
+	RTE_PMD_AVP_STAGE_TRANSLATE, /**< Host to guest address translation */
+	RTE_PMD_AVP_STAGE_FILTER, /**< Destination MAC filtering */
+	RTE_PMD_AVP_STAGE_ALLOC, /**< Mbuf allocation or release */
+	RTE_PMD_AVP_STAGE_COPY, /**< Packet data and metadata copy */
+	RTE_PMD_AVP_STAGE_FIFO_PUT, /**< Enqueue host buffers */
+	RTE_PMD_AVP_STAGE_MAX
+};
+
+/**
+ * TSC cycles spent in each stage of the bursts of a queue.  Bursts that
+ * find nothing to do are not counted.
+ */
+struct rte_pmd_avp_stage_stats {
+	uint64_t bursts; /**< Bursts accounted */
+	uint64_t cycles[RTE_PMD_AVP_STAGE_MAX]; /**< Cycles per stage */
+};
+
+/** Name of the memzone holding the telemetry page of a port */
+#define RTE_PMD_AVP_TELEMETRY_MZ_FMT "avp_telemetry_%u"
+/** Telemetry page validation marker */
+#define RTE_PMD_AVP_TELEMETRY_MAGIC 0x41565054
+/** Telemetry page layout version */
+#define RTE_PMD_AVP_TELEMETRY_VERSION 1
+/** Maximum number of queues of each direction in a telemetry page */
+#define RTE_PMD_AVP_TELEMETRY_MAX_QUEUES 8
+
+/**@{ Port state flags of a telemetry page */
+#define RTE_PMD_AVP_TELEMETRY_F_CONFIGURED (1 << 0)
+#define RTE_PMD_AVP_TELEMETRY_F_LINKUP (1 << 1)
+#define RTE_PMD_AVP_TELEMETRY_F_DETACHED (1 << 2)
+#define RTE_PMD_AVP_TELEMETRY_F_PROMISC (1 << 3)
+#define RTE_PMD_AVP_TELEMETRY_F_ALLMULTI (1 << 4)
+/**@} */
+
+/**
+ * Counters and fifo levels of a queue in a telemetry page.  The fifo levels
+ * are the sum over all the host fifos serviced by the queue and are reported
+ * as 0 while the port is detached.
+ */
+struct rte_pmd_avp_telemetry_queue {
+	uint64_t packets; /**< Packets received or transmitted */
+	uint64_t bytes; /**< Bytes received or transmitted */
+	uint64_t errors; /**< Packets dropped or refused */
+	uint32_t fifo_count; /**< Entries in the rx_q (rx) or tx_q (tx) fifos */
+	uint32_t fifo_size; /**< Capacity of the rx_q (rx) or tx_q (tx) fifos */
+	uint32_t buf_count; /**< Entries in the free_q (rx) or alloc_q (tx) */
+	uint32_t reserved;
+};
+
+/**
+ * Telemetry page of a port, published in a memzone named after
+ * RTE_PMD_AVP_TELEMETRY_MZ_FMT when the port is probed with the
+ * "telemetry_ms" device argument.  The page is updated by the primary process
+ * outside of the receive and transmit functions; seq is odd while an update
+ * is in progress.  Use rte_pmd_avp_telemetry_read() to take a consistent
+ * snapshot.
+ */
+struct rte_pmd_avp_telemetry {
+	uint32_t magic; /**< RTE_PMD_AVP_TELEMETRY_MAGIC */
+	uint32_t version; /**< RTE_PMD_AVP_TELEMETRY_VERSION */
+	uint32_t size; /**< Size of the page structure */
+	volatile uint32_t seq; /**< Update sequence number */
+	uint64_t tsc_hz; /**< TSC frequency of the primary process */
+	uint64_t tsc; /**< TSC of the last update */
+	uint64_t updates; /**< Number of updates */
+	uint32_t port_id; /**< Ethernet port identifier */
+	uint32_t flags; /**< RTE_PMD_AVP_TELEMETRY_F_* */
+	uint32_t epoch; /**< Incremented each time the device is re-attached */
+	uint16_t nb_rx_queues; /**< Valid entries in rxq */
+	uint16_t nb_tx_queues; /**< Valid entries in txq */
+	uint64_t detaches; /**< Live migration detach events */
+	uint64_t attaches; /**< Live migration attach events */
+	struct rte_pmd_avp_telemetry_queue rxq[RTE_PMD_AVP_TELEMETRY_MAX_QUEUES];
+	/**< Receive queues */
+	struct rte_pmd_avp_telemetry_queue txq[RTE_PMD_AVP_TELEMETRY_MAX_QUEUES];
+	/**< Transmit queues */
+};
+
+/**
+ * Take a consistent snapshot of a telemetry page without blocking its
+ * writer.  May be used from any process that has the page mapped.
+ *
+ * @param page
+ *   The telemetry page, typically the address of the memzone.
+ * @param snapshot
+ *   Filled with a copy of the page.
+ * @param retries
+ *   Number of additional attempts if the page is being updated.
+ * @return
+ *   - (0) if successful.
+ *   - (-EINVAL) if *page* is not a telemetry page of a supported version.
+ *   - (-EAGAIN) if every attempt overlapped an update.
+ */
+static inline int
+rte_pmd_avp_telemetry_read(const struct rte_pmd_avp_telemetry *page,
+			   struct rte_pmd_avp_telemetry *snapshot,
+			   unsigned int retries)
+{
+	uint32_t seq;
+
+	if ((page->magic != RTE_PMD_AVP_TELEMETRY_MAGIC) ||
+	    (page->version != RTE_PMD_AVP_TELEMETRY_VERSION) ||
+	    (page->size < sizeof(*page)))
+		return -EINVAL;
+
+	do {
+		seq = page->seq;
+		rte_smp_rmb();
+		if ((seq & 1) == 0) {
+			memcpy(snapshot, page, sizeof(*snapshot));
+			rte_smp_rmb();
+			if (page->seq == seq)
+				return 0;
+		}
+	} while (retries-- > 0);
+
+	return -EAGAIN;
+}
+
+/**
+ * Allocate transmit mbufs that reference host buffers directly.
+ *
+ * The returned mbufs have no headroom and their data room is a single host
+ * buffer; packets built in them are handed to the host without a copy when
+ * passed to rte_eth_tx_burst() on the same port and queue.  Mbufs that are
+ * freed without being transmitted return their host buffer to the queue.
+ * Must be called from the lcore that transmits on the queue, and the port
+ * must have been probed with the "zero_copy_tx=1" device argument.
+ *
+ * @param port_id
+ *   The port identifier of the AVP device.
+ * @param queue_id
+ *   The transmit queue the mbufs will be sent on.
+ * @param mbufs
+ *   Array to be filled with the allocated mbufs.
+ * @param n
+ *   Maximum number of mbufs to allocate.
+ * @return
+ *   - (>= 0) Number of mbufs stored in the array; may be less than n when
+ *     the host has not supplied enough buffers.
+ *   - (-ENODEV) if *port_id* is invalid.
+ *   - (-EINVAL) if *queue_id* is invalid.
+ *   - (-ENOTSUP) if zero-copy transmit is not enabled on the port.
+ */
+int
+rte_pmd_avp_tx_buf_alloc(uint8_t port_id, uint16_t queue_id,
+			 struct rte_mbuf **mbufs, unsigned int n);
+
+/**
+ * Enable or disable receive segment coalescing on a queue.
+ *
+ * When enabled, in-order TCP segments of the same connection that are
+ * received in a single burst are merged into one chained mbuf carrying the
+ * headers of the first segment with updated IP lengths.  The TCP checksum of
+ * a merged packet is not updated; every segment is validated before it is
+ * merged and the packet is flagged with PKT_RX_L4_CKSUM_GOOD.  The setting is
+ * lost if the queue is set up again.
+ *
+ * @param port_id
+ *   The port identifier of the AVP device.
+ * @param queue_id
+ *   The receive queue to configure.
+ * @param on
+ *   1 to enable coalescing, 0 to disable it.
+ * @return
+ *   - (0) if successful.
+ *   - (-ENODEV) if *port_id* is invalid.
+ *   - (-ENOTSUP) if *port_id* is not an AVP device.
+ *   - (-EINVAL) if *queue_id* is invalid or the queue is not set up.
+ */
+int
+rte_pmd_avp_rx_gro_set(uint8_t port_id, uint16_t queue_id, int on);
+
+/**
+ * Retrieve the receive segment coalescing counters of a queue.  The
+ * counters are cleared by rte_eth_stats_reset().
+ *
+ * @param port_id
+ *   The port identifier of the AVP device.
+ * @param queue_id
+ *   The receive queue to query.
+ * @param stats
+ *   Filled with the counters of the queue.
+ * @return
+ *   - (0) if successful.
+ *   - (-ENODEV) if *port_id* is invalid.
+ *   - (-ENOTSUP) if *port_id* is not an AVP device.
+ *   - (-EINVAL) if *queue_id* or *stats* is invalid.
+ */
+int
+rte_pmd_avp_rx_gro_stats_get(uint8_t port_id, uint16_t queue_id,
+			     struct rte_pmd_avp_gro_stats *stats);
+
+/**
+ * Retrieve the per stage cycle counters of the receive bursts of a queue.
+ * Only the scalar copying receive functions are instrumented, and only when
+ * the PMD is built with CONFIG_RTE_LIBRTE_AVP_STAGE_CYCLES=y.  The counters
+ * are cleared by rte_eth_stats_reset().
+ *
+ * @param port_id
+ *   The port identifier of the AVP device.
+ * @param queue_id
+ *   The receive queue to query.
+ * @param stats
+ *   Filled with the counters of the queue.
+ * @return
+ *   - (0) if successful.
+ *   - (-ENODEV) if *port_id* is invalid.
+ *   - (-ENOTSUP) if *port_id* is not an AVP device or the PMD was built
+ *     without stage accounting.
+ *   - (-EINVAL) if *queue_id* or *stats* is invalid.
+ */
+int
+rte_pmd_avp_rx_stage_stats_get(uint8_t port_id, uint16_t queue_id,
+			       struct rte_pmd_avp_stage_stats *stats);
+
+/**
+ * Retrieve the per stage cycle counters of the transmit bursts of a queue.
+ * The same restrictions as for rte_pmd_avp_rx_stage_stats_get() apply.
+ *
+ * @param port_id
+ *   The port identifier of the AVP device.
+ * @param queue_id
+ *   The transmit queue to query.
+ * @param stats
+ *   Filled with the counters of the queue.
+ * @return
+ *   - (0) if successful.
+ *   - (-ENODEV) if *port_id* is invalid.
+ *   - (-ENOTSUP) if *port_id* is not an AVP device or the PMD was built
+ *     without stage accounting.
+ *   - (-EINVAL) if *queue_id* or *stats* is invalid.
+ */
+int
+rte_pmd_avp_tx_stage_stats_get(uint8_t port_id, uint16_t queue_id,
+			       struct rte_pmd_avp_stage_stats *stats);
+
+/**
+ * Counters of an emulated AVP host (net_avp_emu virtual device).
+ */
+struct rte_pmd_avp_emu_stats {
+	uint64_t tx_packets; /**< Packets consumed from the transmit fifos */
+	uint64_t rx_packets; /**< Packets placed on the receive fifos */
+	uint64_t rx_dropped; /**< Looped back packets with no receive space */
+	uint64_t errors; /**< Invalid buffers returned by the guest */
+};
+
+/**
+ * Detach an emulated AVP device from its host as is done at the start of a
+ * live migration.  The migration status register is set to DETACHED and the
+ * migration interrupt is handled by the PMD before the function returns.
+ * The port stops receiving and transmitting until it is attached again.
+ *
+ * @param port_id
+ *   The port identifier of a net_avp_emu device.
+ * @return
+ *   - (0) if the PMD acknowledged the detach.
+ *   - (-ENODEV) if *port_id* is not an emulated AVP device.
+ *   - (-ENOTSUP) if the PMD was built without CONFIG_RTE_LIBRTE_AVP_EMU=y.
+ *   - (-EIO) if migration interrupts are disabled or the PMD reported an
+ *     error.
+ */
+int
+rte_pmd_avp_emu_detach(uint8_t port_id);
+
+/**
+ * Attach a detached emulated AVP device to a new host as is done at the end
+ * of a live migration.  The host memory is initialized again, so buffers
+ * held by the PMD before the detach are forgotten, and the device id
+ * changes.
+ *
+ * @param port_id
+ *   The port identifier of a net_avp_emu device.
+ * @param version
+ *   AVP major version implemented by the new host, or 0 to keep the
+ *   current one.
+ * @return
+ *   - (0) if the PMD acknowledged the attach.
+ *   - (-ENODEV) if *port_id* is not an emulated AVP device.
+ *   - (-EINVAL) if the device is not detached or *version* is invalid.
+ *   - (-ENOTSUP) if the PMD was built without CONFIG_RTE_LIBRTE_AVP_EMU=y.
+ *   - (-EIO) if migration interrupts are disabled or the PMD reported an
+ *     error.
+ */
+int
+rte_pmd_avp_emu_attach(uint8_t port_id, unsigned int version);
+
+/**
+ * Retrieve the counters of an emulated AVP host.  The counters are updated
+ * by the host service thread without synchronization.
+ *
+ * @param port_id
+ *   The port identifier of a net_avp_emu device.
+ * @param stats
+ *   Filled with the counters of the host.
+ * @return
+ *   - (0) if successful.
+ *   - (-ENODEV) if *port_id* is not an emulated AVP device.
+ *   - (-EINVAL) if *stats* is NULL.
+ *   - (-ENOTSUP) if the PMD was built without CONFIG_RTE_LIBRTE_AVP_EMU=y.
+ */
+int
+rte_pmd_avp_emu_stats_get(uint8_t port_id,
+			  struct rte_pmd_avp_emu_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RTE_PMD_AVP_H_ */